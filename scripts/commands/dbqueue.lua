@@ -0,0 +1,24 @@
+---------------------------------------------------------------------------------------------------
+-- func: dbqueue
+-- desc: Shows the state of the asynchronous character save queue.
+---------------------------------------------------------------------------------------------------
+
+cmdprops =
+{
+    permission = 4,
+    parameters = ""
+}
+
+function onTrigger(player)
+    local stats = GetWriteBehindStats()
+
+    if not stats.enabled then
+        player:PrintToPlayer("Character saves are synchronous (async_char_save is off).")
+        return
+    end
+
+    player:PrintToPlayer(string.format("Pending: %i  Queued: %i  Merged: %i  Transactions: %i",
+        stats.depth, stats.queued, stats.coalesced, stats.batches))
+    player:PrintToPlayer(string.format("Flush latency (ms) last: %i  avg: %i  max: %i",
+        stats.lastLatency, stats.avgLatency, stats.maxLatency))
+end
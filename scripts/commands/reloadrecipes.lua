@@ -0,0 +1,19 @@
+---------------------------------------------------------------------------------------------------
+-- func: reloadrecipes
+-- desc: Reads synth_recipes from the database again. Only affects the map server the GM is on.
+---------------------------------------------------------------------------------------------------
+
+cmdprops =
+{
+    permission = 4,
+    parameters = ""
+}
+
+function onTrigger(player)
+    local count = ReloadSynthRecipes()
+    if count < 0 then
+        player:PrintToPlayer("Could not read synth_recipes, the previous recipes stay in use.")
+    else
+        player:PrintToPlayer(string.format("Synth recipes reloaded (%i recipes).", count))
+    end
+end
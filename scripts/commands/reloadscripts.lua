@@ -0,0 +1,16 @@
+---------------------------------------------------------------------------------------------------
+-- func: reloadscripts
+-- desc: Drops all compiled zone, npc, mob, effect, spell and item scripts so they are read
+--       from disk again on their next use.
+---------------------------------------------------------------------------------------------------
+
+cmdprops =
+{
+    permission = 4,
+    parameters = ""
+}
+
+function onTrigger(player)
+    local count = ClearScriptCache()
+    player:PrintToPlayer(string.format("Script cache cleared (%i scripts).", count))
+end
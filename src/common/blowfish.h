@@ -42,6 +42,10 @@ struct blowfish_t
 void blowfish_decipher(uint32* xl, uint32* xr, uint32* P, uint32* S);
 void blowfish_encipher(uint32* xl, uint32* xr, uint32* P, uint32* S);
 
+// ECB over count 8-byte blocks (data[2*i], data[2*i+1]), several blocks in lockstep
+void blowfish_decipher_blocks(uint32* data, uint32 count, uint32* P, uint32* S);
+void blowfish_encipher_blocks(uint32* data, uint32 count, uint32* P, uint32* S);
+
 uint32* blowfish_init(int8 key[], int16 keybytes, uint32* P, uint32* S);
 
 #endif
@@ -20,6 +20,9 @@
 */
 
 #include <string.h>
+#include <algorithm>
+#include <numeric>
+#include <vector>
 #include "md52.h"
 
 #define GET_UINT32(n,b,i)                       \
@@ -254,3 +257,213 @@ void md5(unsigned char *text, unsigned char *hash, int size)
 	md5_update( &ctx, (uint8 *) text, size);
 	md5_finish( &ctx, hash );
 }
+
+/************************************************************************
+*                                                                       *
+*  Multi-buffer MD5. The messages are grouped MD5_LANES at a time and   *
+*  each step of the compression function is done for the whole group   *
+*  on interleaved state, which the compiler turns into vector code.     *
+*  Messages are sorted by length first so a group runs out of blocks    *
+*  at about the same time; lanes that are done keep computing on a      *
+*  zero block and their result is thrown away.                          *
+*                                                                       *
+************************************************************************/
+
+#define MD5_LANES 4
+
+static uint32 md5_block_count(uint32 size)
+{
+    // data, the 0x80 byte and the 8 byte length, rounded up to whole blocks
+    return (size + 8) / 64 + 1;
+}
+
+// loads block `index` of the padded message as 16 little endian words
+static void md5_load_block(const uint8* text, uint32 size, uint32 index, uint32 X[16])
+{
+    uint32 offset = index * 64;
+    uint8 block[64];
+    const uint8* data = block;
+
+    if (offset + 64 <= size)
+    {
+        data = text + offset;
+    }
+    else
+    {
+        uint32 fill = offset < size ? size - offset : 0;
+
+        if (fill > 0)
+        {
+            memcpy(block, text + offset, fill);
+        }
+        memset(block + fill, 0, 64 - fill);
+
+        if (offset <= size)
+        {
+            block[size - offset] = 0x80;
+        }
+        if (index + 1 == md5_block_count(size))
+        {
+            PUT_UINT32(size << 3, block, 56);
+            PUT_UINT32(size >> 29, block, 60);
+        }
+    }
+    for (uint32 i = 0; i < 16; ++i)
+    {
+        GET_UINT32(X[i], data, i * 4);
+    }
+}
+
+void md5_batch(uint8* const* text, uint8* const* hash, const uint32* size, uint32 count)
+{
+    std::vector<uint32> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [size](uint32 a, uint32 b) { return size[a] < size[b]; });
+
+    for (uint32 group = 0; group < count; group += MD5_LANES)
+    {
+        uint32 lanes = std::min<uint32>(MD5_LANES, count - group);
+        uint32 blocks[MD5_LANES] = {};
+        uint32 maxBlocks = 0;
+
+        uint32 state[4][MD5_LANES];
+        uint32 X[16][MD5_LANES];
+
+        for (uint32 l = 0; l < MD5_LANES; ++l)
+        {
+            state[0][l] = 0x67452301;
+            state[1][l] = 0xEFCDAB89;
+            state[2][l] = 0x98BADCFE;
+            state[3][l] = 0x10325476;
+
+            if (l < lanes)
+            {
+                blocks[l] = md5_block_count(size[order[group + l]]);
+                maxBlocks = std::max(maxBlocks, blocks[l]);
+            }
+        }
+
+        for (uint32 b = 0; b < maxBlocks; ++b)
+        {
+            for (uint32 l = 0; l < MD5_LANES; ++l)
+            {
+                uint32 words[16] = {};
+                if (b < blocks[l])
+                {
+                    uint32 index = order[group + l];
+                    md5_load_block(text[index], size[index], b, words);
+                }
+                for (uint32 i = 0; i < 16; ++i)
+                {
+                    X[i][l] = words[i];
+                }
+            }
+
+            uint32 A[MD5_LANES], B[MD5_LANES], C[MD5_LANES], D[MD5_LANES];
+            memcpy(A, state[0], sizeof(A));
+            memcpy(B, state[1], sizeof(B));
+            memcpy(C, state[2], sizeof(C));
+            memcpy(D, state[3], sizeof(D));
+
+#define STEP(a,b,c,d,k,s,t)                                            \
+            for (uint32 l = 0; l < MD5_LANES; ++l)                      \
+            {                                                           \
+                a[l] += F(b[l],c[l],d[l]) + X[k][l] + t;                \
+                a[l] = ((a[l] << s) | (a[l] >> (32 - s))) + b[l];       \
+            }
+
+#define F(x,y,z) (z ^ (x & (y ^ z)))
+            STEP(A, B, C, D,  0,  7, 0xD76AA478);
+            STEP(D, A, B, C,  1, 12, 0xE8C7B756);
+            STEP(C, D, A, B,  2, 17, 0x242070DB);
+            STEP(B, C, D, A,  3, 22, 0xC1BDCEEE);
+            STEP(A, B, C, D,  4,  7, 0xF57C0FAF);
+            STEP(D, A, B, C,  5, 12, 0x4787C62A);
+            STEP(C, D, A, B,  6, 17, 0xA8304613);
+            STEP(B, C, D, A,  7, 22, 0xFD469501);
+            STEP(A, B, C, D,  8,  7, 0x698098D8);
+            STEP(D, A, B, C,  9, 12, 0x8B44F7AF);
+            STEP(C, D, A, B, 10, 17, 0xFFFF5BB1);
+            STEP(B, C, D, A, 11, 22, 0x895CD7BE);
+            STEP(A, B, C, D, 12,  7, 0x6B901122);
+            STEP(D, A, B, C, 13, 12, 0xFD987193);
+            STEP(C, D, A, B, 14, 17, 0xA679438E);
+            STEP(B, C, D, A, 15, 22, 0x49B40821);
+#undef F
+#define F(x,y,z) (y ^ (z & (x ^ y)))
+            STEP(A, B, C, D,  1,  5, 0xF61E2562);
+            STEP(D, A, B, C,  6,  9, 0xC040B340);
+            STEP(C, D, A, B, 11, 14, 0x265E5A51);
+            STEP(B, C, D, A,  0, 20, 0xE9B6C7AA);
+            STEP(A, B, C, D,  5,  5, 0xD62F105D);
+            STEP(D, A, B, C, 10,  9, 0x02441453);
+            STEP(C, D, A, B, 15, 14, 0xD8A1E681);
+            STEP(B, C, D, A,  4, 20, 0xE7D3FBC8);
+            STEP(A, B, C, D,  9,  5, 0x21E1CDE6);
+            STEP(D, A, B, C, 14,  9, 0xC33707D6);
+            STEP(C, D, A, B,  3, 14, 0xF4D50D87);
+            STEP(B, C, D, A,  8, 20, 0x455A14ED);
+            STEP(A, B, C, D, 13,  5, 0xA9E3E905);
+            STEP(D, A, B, C,  2,  9, 0xFCEFA3F8);
+            STEP(C, D, A, B,  7, 14, 0x676F02D9);
+            STEP(B, C, D, A, 12, 20, 0x8D2A4C8A);
+#undef F
+#define F(x,y,z) (x ^ y ^ z)
+            STEP(A, B, C, D,  5,  4, 0xFFFA3942);
+            STEP(D, A, B, C,  8, 11, 0x8771F681);
+            STEP(C, D, A, B, 11, 16, 0x6D9D6122);
+            STEP(B, C, D, A, 14, 23, 0xFDE5380C);
+            STEP(A, B, C, D,  1,  4, 0xA4BEEA44);
+            STEP(D, A, B, C,  4, 11, 0x4BDECFA9);
+            STEP(C, D, A, B,  7, 16, 0xF6BB4B60);
+            STEP(B, C, D, A, 10, 23, 0xBEBFBC70);
+            STEP(A, B, C, D, 13,  4, 0x289B7EC6);
+            STEP(D, A, B, C,  0, 11, 0xEAA127FA);
+            STEP(C, D, A, B,  3, 16, 0xD4EF3085);
+            STEP(B, C, D, A,  6, 23, 0x04881D05);
+            STEP(A, B, C, D,  9,  4, 0xD9D4D039);
+            STEP(D, A, B, C, 12, 11, 0xE6DB99E5);
+            STEP(C, D, A, B, 15, 16, 0x1FA27CF8);
+            STEP(B, C, D, A,  2, 23, 0xC4AC5665);
+#undef F
+#define F(x,y,z) (y ^ (x | ~z))
+            STEP(A, B, C, D,  0,  6, 0xF4292244);
+            STEP(D, A, B, C,  7, 10, 0x432AFF97);
+            STEP(C, D, A, B, 14, 15, 0xAB9423A7);
+            STEP(B, C, D, A,  5, 21, 0xFC93A039);
+            STEP(A, B, C, D, 12,  6, 0x655B59C3);
+            STEP(D, A, B, C,  3, 10, 0x8F0CCC92);
+            STEP(C, D, A, B, 10, 15, 0xFFEFF47D);
+            STEP(B, C, D, A,  1, 21, 0x85845DD1);
+            STEP(A, B, C, D,  8,  6, 0x6FA87E4F);
+            STEP(D, A, B, C, 15, 10, 0xFE2CE6E0);
+            STEP(C, D, A, B,  6, 15, 0xA3014314);
+            STEP(B, C, D, A, 13, 21, 0x4E0811A1);
+            STEP(A, B, C, D,  4,  6, 0xF7537E82);
+            STEP(D, A, B, C, 11, 10, 0xBD3AF235);
+            STEP(C, D, A, B,  2, 15, 0x2AD7D2BB);
+            STEP(B, C, D, A,  9, 21, 0xEB86D391);
+#undef F
+#undef STEP
+
+            for (uint32 l = 0; l < MD5_LANES; ++l)
+            {
+                // lanes past their last block must keep the finished state
+                uint32 mask = b < blocks[l] ? 0xFFFFFFFF : 0;
+                state[0][l] += A[l] & mask;
+                state[1][l] += B[l] & mask;
+                state[2][l] += C[l] & mask;
+                state[3][l] += D[l] & mask;
+            }
+        }
+
+        for (uint32 l = 0; l < lanes; ++l)
+        {
+            uint8* digest = hash[order[group + l]];
+            PUT_UINT32(state[0][l], digest, 0);
+            PUT_UINT32(state[1][l], digest, 4);
+            PUT_UINT32(state[2][l], digest, 8);
+            PUT_UINT32(state[3][l], digest, 12);
+        }
+    }
+}
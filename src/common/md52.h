@@ -37,4 +37,7 @@ void md5_starts( md5_context *ctx );
 void md5_update( md5_context *ctx, uint8 *input, uint32 length );
 void md5_finish( md5_context *ctx, uint8 digest[16] );
 
+// hashes count independent messages, several at a time in lockstep
+void md5_batch(uint8* const* text, uint8* const* hash, const uint32* size, uint32 count);
+
 #endif /* md5.h */
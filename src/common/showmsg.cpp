@@ -14,6 +14,11 @@ Copyright (c) Athena Dev Teams - Licensed under GNU G
 #include <time.h>
 #include <stdlib.h> // atexit
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #ifdef WIN32
     #define WIN32_LEAN_AND_MEAN
     #include <windows.h>
@@ -583,25 +588,41 @@ int	FPRINTF(FILE *file, std::string fmt)
 
 char timestamp_format[20] = ""; // For displaying Timestamps
 
-int _vShowMessage(MSGTYPE flag, const std::string& string)
+///////////////////////////////////////////////////////////////////////////////
+/// asynchronous output
+///
+/// Messages are queued in a bounded multi-producer ring and written by one
+/// background thread, which keeps the log file open and flushes once per batch.
+/// Until InitializeLog starts the writer, messages are written directly.
+
+struct LogEntry
+{
+    std::atomic<size_t> sequence;
+    MSGTYPE             flag;
+    time_t              time;
+    std::string         text;
+};
+
+static constexpr size_t LOG_QUEUE_SIZE = 4096; // must be a power of two
+
+static LogEntry                log_queue[LOG_QUEUE_SIZE];
+static std::atomic<size_t>     log_enqueue_pos(0);
+static size_t                  log_dequeue_pos = 0;    // writer thread only
+static std::atomic<size_t>     log_written_pos(0);
+static std::atomic<bool>       log_async(false);
+static std::atomic<bool>       log_stop(false);
+static std::atomic<bool>       log_writer_sleeping(false);
+static std::mutex              log_mutex;
+static std::condition_variable log_condition;
+static std::thread             log_writer;
+static FILE*                   log_fp = NULL;
+
+static void WriteMessage(MSGTYPE flag, time_t t, const std::string& string)
 {
     char prefix[100];
-    FILE *fp;
-
-    if (string.empty())
-    {
-        ShowError("Empty string passed to _vShowMessage().\n");
-        return 1;
-    }
-
-    if (flag & msg_silent)
-    {
-        return 0; // Do not print it.
-    }
 
     if (timestamp_format[0] && flag != MSG_NONE)
     {   // Display time format. [Skotlex]
-        time_t t = time(NULL);
         strftime(prefix, 80, timestamp_format, localtime(&t));
     }
     else
@@ -647,8 +668,7 @@ int _vShowMessage(MSGTYPE flag, const std::string& string)
             strcat(prefix, CL_WHITE"[Action Info]" CL_RESET);
             break;
         default:
-            ShowError("In function _vShowMessage() -> Invalid flag passed.\n");
-            return 1;
+            break;
     }
 
     if (flag == MSG_ERROR || flag == MSG_FATALERROR || flag == MSG_SQL)
@@ -656,7 +676,6 @@ int _vShowMessage(MSGTYPE flag, const std::string& string)
         std::string prefix_v = fmt::sprintf("%s ", prefix);
         FPRINTF(STDERR, prefix_v);
         VFPRINTF(STDERR, string);
-        FFLUSH(STDERR);
     }
     else
     {
@@ -666,26 +685,203 @@ int _vShowMessage(MSGTYPE flag, const std::string& string)
             FPRINTF(STDOUT, prefix_v);
         }
         VFPRINTF(STDOUT, string);
-        FFLUSH(STDOUT);
     }
 
-    if (log_file.size() > 0) {
-        fp = fopen(log_file.c_str(), "a");
-        if (fp == NULL) {
-            std::string str_v = fmt::sprintf(CL_RED"[ERROR]" CL_RESET": Could not open '" CL_WHITE"%s" CL_RESET"', access denied.\n", log_file.c_str());
-            FPRINTF(STDERR, str_v);
-            FFLUSH(STDERR);
+    if (log_fp != NULL)
+    {
+        fprintf(log_fp, "%s ", prefix);
+        fputs(string.c_str(), log_fp);
+    }
+}
+
+static void FlushOutput()
+{
+    FFLUSH(STDOUT);
+    FFLUSH(STDERR);
+    if (log_fp != NULL)
+    {
+        fflush(log_fp);
+    }
+}
+
+static void OpenLogFile()
+{
+    if (log_file.empty())
+    {
+        return;
+    }
+
+    log_fp = fopen(log_file.c_str(), "a");
+    if (log_fp == NULL)
+    {
+        std::string str_v = fmt::sprintf(CL_RED"[ERROR]" CL_RESET": Could not open '" CL_WHITE"%s" CL_RESET"', access denied.\n", log_file.c_str());
+        FPRINTF(STDERR, str_v);
+        FFLUSH(STDERR);
+    }
+}
+
+static void EnqueueMessage(MSGTYPE flag, std::string&& string)
+{
+    size_t pos = log_enqueue_pos.load(std::memory_order_relaxed);
+    LogEntry* entry;
+
+    while (true)
+    {
+        entry = &log_queue[pos & (LOG_QUEUE_SIZE - 1)];
+        size_t seq = entry->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0)
+        {
+            if (log_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // queue is full, wait for the writer instead of dropping the message
+            log_condition.notify_one();
+            std::this_thread::yield();
+            pos = log_enqueue_pos.load(std::memory_order_relaxed);
         }
         else
         {
-            fprintf(fp, "%s ", prefix);
-            fputs(string.c_str(), fp);
-            fclose(fp);
+            pos = log_enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    entry->flag = flag;
+    entry->time = time(NULL);
+    entry->text = std::move(string);
+    entry->sequence.store(pos + 1, std::memory_order_release);
+
+    if (log_writer_sleeping.load(std::memory_order_relaxed))
+    {
+        log_condition.notify_one();
+    }
+}
+
+static void LogWriterThread()
+{
+    while (true)
+    {
+        size_t written = 0;
+
+        while (true)
+        {
+            LogEntry& entry = log_queue[log_dequeue_pos & (LOG_QUEUE_SIZE - 1)];
+            if (entry.sequence.load(std::memory_order_acquire) != log_dequeue_pos + 1)
+                break;
+
+            WriteMessage(entry.flag, entry.time, entry.text);
+            std::string().swap(entry.text);
+
+            entry.sequence.store(log_dequeue_pos + LOG_QUEUE_SIZE, std::memory_order_release);
+            ++log_dequeue_pos;
+            ++written;
+        }
+
+        if (written > 0)
+        {
+            FlushOutput();
+            log_written_pos.store(log_dequeue_pos, std::memory_order_release);
+            continue;
+        }
+
+        if (log_stop.load())
+        {
+            break;
         }
+
+        // producers only notify while the writer sleeps, the timeout covers a missed wakeup
+        std::unique_lock<std::mutex> lock(log_mutex);
+        log_writer_sleeping.store(true);
+        log_condition.wait_for(lock, std::chrono::milliseconds(10));
+        log_writer_sleeping.store(false);
+    }
+}
+
+static void StopLogWriter()
+{
+    if (log_async.exchange(false))
+    {
+        log_stop.store(true);
+        log_condition.notify_one();
+        log_writer.join();
+    }
+    if (log_fp != NULL)
+    {
+        fclose(log_fp);
+        log_fp = NULL;
+    }
+}
+
+/// Blocks until every message queued so far has been written.
+void FlushLog()
+{
+    if (!log_async.load())
+    {
+        return;
+    }
+
+    size_t target = log_enqueue_pos.load();
+    while (log_written_pos.load(std::memory_order_acquire) < target)
+    {
+        log_condition.notify_one();
+        std::this_thread::yield();
+    }
+}
+
+int _vShowMessage(MSGTYPE flag, const std::string& string)
+{
+    if (string.empty())
+    {
+        ShowError("Empty string passed to _vShowMessage().\n");
+        return 1;
+    }
+
+    if (flag & msg_silent)
+    {
+        return 0; // Do not print it.
+    }
+
+    switch (flag)
+    {
+        case MSG_NONE:
+        case MSG_STATUS:
+        case MSG_SQL:
+        case MSG_INFORMATION:
+        case MSG_NOTICE:
+        case MSG_WARNING:
+        case MSG_DEBUG:
+        case MSG_ERROR:
+        case MSG_FATALERROR:
+        case MSG_LUASCRIPT:
+        case MSG_NAVMESH:
+        case MSG_ACTION:
+            break;
+        default:
+            ShowError("In function _vShowMessage() -> Invalid flag passed.\n");
+            return 1;
+    }
+
+    if (!log_async.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lock(log_mutex);
+        WriteMessage(flag, time(NULL), string);
+        FlushOutput();
+        return 0;
     }
 
+    EnqueueMessage(flag, std::string(string));
+
+    if (flag == MSG_FATALERROR)
+    {
+        // the process is usually about to exit
+        FlushLog();
+    }
     return 0;
 }
+
 void ClearScreen(void)
 {
 #ifndef _WIN32
@@ -695,5 +891,24 @@ void ClearScreen(void)
 
 void InitializeLog(std::string logFile)
 {
+    if (log_async.load())
+    {
+        return;
+    }
+
     log_file = logFile;
+    OpenLogFile();
+
+    for (size_t i = 0; i < LOG_QUEUE_SIZE; ++i)
+    {
+        log_queue[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    log_enqueue_pos.store(0);
+    log_dequeue_pos = 0;
+    log_written_pos.store(0);
+    log_stop.store(false);
+
+    log_writer = std::thread(LogWriterThread);
+    log_async.store(true);
+    atexit(StopLogWriter);
 }
@@ -107,93 +107,106 @@ enum MSGTYPE
     MSG_ACTION      = 0x0800
 };
 
+// Message types in this mask are compiled out entirely,
+// e.g. -DSHOWMSG_COMPILE_SILENT=0x0024 removes ShowInfo and ShowDebug.
+#ifndef SHOWMSG_COMPILE_SILENT
+#define SHOWMSG_COMPILE_SILENT 0
+#endif
+
 void ClearScreen(void);
 
 void InitializeLog(std::string logFile);
+void FlushLog();
 int32 _vShowMessage(MSGTYPE, const std::string&);
 
-template<typename... Args>
-int32 ShowMessage(const std::string& fmt_string, Args... args)
+// Types silenced at compile time or through msg_silent return before the message is formatted
+template<MSGTYPE flag, typename S, typename... Args>
+inline int32 _ShowMessage(const S& fmt_string, Args... args)
+{
+    if constexpr ((flag & SHOWMSG_COMPILE_SILENT) != 0)
+    {
+        return 0;
+    }
+    else
+    {
+        if (flag & msg_silent)
+        {
+            return 0;
+        }
+        return _vShowMessage(flag, fmt::sprintf(fmt_string, args...));
+    }
+}
+
+template<typename S, typename... Args>
+int32 ShowMessage(const S& fmt_string, Args... args)
 {
-    std::string fmt_string_v = fmt::sprintf(fmt_string, args...);
-    return _vShowMessage(MSG_NONE, fmt_string_v);
+    return _ShowMessage<MSG_NONE>(fmt_string, args...);
 }
 
-template<typename... Args>
-int32 ShowStatus(const std::string& fmt_string, Args... args)
+template<typename S, typename... Args>
+int32 ShowStatus(const S& fmt_string, Args... args)
 {
-    std::string fmt_string_v = fmt::sprintf(fmt_string, args...);
-    return _vShowMessage(MSG_STATUS, fmt_string_v);
+    return _ShowMessage<MSG_STATUS>(fmt_string, args...);
 }
 
-template<typename... Args>
-int32 ShowSQL(const std::string& fmt_string, Args... args)
+template<typename S, typename... Args>
+int32 ShowSQL(const S& fmt_string, Args... args)
 {
-    std::string fmt_string_v = fmt::sprintf(fmt_string, args...);
-    return _vShowMessage(MSG_SQL, fmt_string_v);
+    return _ShowMessage<MSG_SQL>(fmt_string, args...);
 }
 
-template<typename... Args>
-int32 ShowInfo(const std::string& fmt_string, Args... args)
+template<typename S, typename... Args>
+int32 ShowInfo(const S& fmt_string, Args... args)
 {
-    std::string fmt_string_v = fmt::sprintf(fmt_string, args...);
-    return _vShowMessage(MSG_INFORMATION, fmt_string_v);
+    return _ShowMessage<MSG_INFORMATION>(fmt_string, args...);
 }
 
-template<typename... Args>
-int32 ShowNotice(const std::string& fmt_string, Args... args)
+template<typename S, typename... Args>
+int32 ShowNotice(const S& fmt_string, Args... args)
 {
-    std::string fmt_string_v = fmt::sprintf(fmt_string, args...);
-    return _vShowMessage(MSG_NOTICE, fmt_string_v);
+    return _ShowMessage<MSG_NOTICE>(fmt_string, args...);
 }
 
-template<typename... Args>
-int32 ShowWarning(const std::string& fmt_string, Args... args)
+template<typename S, typename... Args>
+int32 ShowWarning(const S& fmt_string, Args... args)
 {
-    std::string fmt_string_v = fmt::sprintf(fmt_string, args...);
-    return _vShowMessage(MSG_WARNING, fmt_string_v);
+    return _ShowMessage<MSG_WARNING>(fmt_string, args...);
 }
 
-template<typename... Args>
-int32 ShowDebug(const std::string& fmt_string, Args... args)
+template<typename S, typename... Args>
+int32 ShowDebug(const S& fmt_string, Args... args)
 {
-    std::string fmt_string_v = fmt::sprintf(fmt_string, args...);
-    return _vShowMessage(MSG_DEBUG, fmt_string_v);
+    return _ShowMessage<MSG_DEBUG>(fmt_string, args...);
 }
 
-template<typename... Args>
-int32 ShowError(const std::string& fmt_string, Args... args)
+template<typename S, typename... Args>
+int32 ShowError(const S& fmt_string, Args... args)
 {
-    std::string fmt_string_v = fmt::sprintf(fmt_string, args...);
-    return _vShowMessage(MSG_ERROR, fmt_string_v);
+    return _ShowMessage<MSG_ERROR>(fmt_string, args...);
 }
 
-template<typename... Args>
-int32 ShowFatalError(const std::string& fmt_string, Args... args)
+template<typename S, typename... Args>
+int32 ShowFatalError(const S& fmt_string, Args... args)
 {
-    std::string fmt_string_v = fmt::sprintf(fmt_string, args...);
-    return _vShowMessage(MSG_FATALERROR, fmt_string_v);
+    return _ShowMessage<MSG_FATALERROR>(fmt_string, args...);
 }
 
-template<typename... Args>
-int32 ShowScript(const std::string& fmt_string, Args... args)
+template<typename S, typename... Args>
+int32 ShowScript(const S& fmt_string, Args... args)
 {
-    std::string fmt_string_v = fmt::sprintf(fmt_string, args...);
-    return _vShowMessage(MSG_LUASCRIPT, fmt_string_v);
+    return _ShowMessage<MSG_LUASCRIPT>(fmt_string, args...);
 }
 
-template<typename... Args>
-int32 ShowNavError(const std::string& fmt_string, Args... args)
+template<typename S, typename... Args>
+int32 ShowNavError(const S& fmt_string, Args... args)
 {
-    std::string fmt_string_v = fmt::sprintf(fmt_string, args...);
-    return _vShowMessage(MSG_NAVMESH, fmt_string_v);
+    return _ShowMessage<MSG_NAVMESH>(fmt_string, args...);
 }
 
-template<typename... Args>
-int32 ShowAction(const std::string& fmt_string, Args... args)
+template<typename S, typename... Args>
+int32 ShowAction(const S& fmt_string, Args... args)
 {
-    std::string fmt_string_v = fmt::sprintf(fmt_string, args...);
-    return _vShowMessage(MSG_ACTION, fmt_string_v);
+    return _ShowMessage<MSG_ACTION>(fmt_string, args...);
 }
 
 #endif /* _SHOWMSG_H_ */
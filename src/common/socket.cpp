@@ -1011,6 +1011,111 @@ int32 sendudp(int32 fd,void *buff,size_t nbytes,int32 flags,const struct sockadd
 	return sSendto(fd,(const char*)buff,(int)nbytes,flags,from,addrlen);
 }
 
+int32 recvudp_batch(int32 fd, udp_datagram_t* msgs, size_t count, size_t nbytes)
+{
+    count = std::min<size_t>(count, UDP_BATCH_MAX);
+#if defined(__linux__)
+    mmsghdr hdrs[UDP_BATCH_MAX];
+    iovec   iovs[UDP_BATCH_MAX];
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        iovs[i].iov_base = msgs[i].data;
+        iovs[i].iov_len = nbytes;
+
+        memset(&hdrs[i], 0, sizeof(mmsghdr));
+        hdrs[i].msg_hdr.msg_name = &msgs[i].addr;
+        hdrs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        hdrs[i].msg_hdr.msg_iov = &iovs[i];
+        hdrs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int32 ret = recvmmsg(fd, hdrs, (uint32)count, MSG_DONTWAIT, nullptr);
+    if (ret == SOCKET_ERROR)
+    {
+        return (sErrno == S_EWOULDBLOCK || sErrno == S_EINTR) ? 0 : -1;
+    }
+    for (int32 i = 0; i < ret; ++i)
+    {
+        msgs[i].size = hdrs[i].msg_len;
+    }
+    return ret;
+#else
+    // no recvmmsg, pull whatever is already queued one datagram at a time
+    int32 received = 0;
+    while ((size_t)received < count)
+    {
+#ifdef WIN32
+        u_long pending = 0;
+        if (sIoctl(fd, FIONREAD, &pending) != 0 || pending == 0)
+        {
+            break;
+        }
+        int32 flags = 0;
+#else
+        int32 flags = MSG_DONTWAIT;
+#endif
+        socklen_t fromlen = sizeof(sockaddr_in);
+        int32 ret = recvudp(fd, msgs[received].data, nbytes, flags, (sockaddr*)&msgs[received].addr, &fromlen);
+        if (ret == SOCKET_ERROR)
+        {
+            if (received == 0 && sErrno != S_EWOULDBLOCK && sErrno != S_EINTR)
+            {
+                return -1;
+            }
+            break;
+        }
+        msgs[received++].size = ret;
+    }
+    return received;
+#endif
+}
+
+int32 sendudp_batch(int32 fd, udp_datagram_t* msgs, size_t count)
+{
+    int32 sent = 0;
+#if defined(__linux__)
+    mmsghdr hdrs[UDP_BATCH_MAX];
+    iovec   iovs[UDP_BATCH_MAX];
+
+    while ((size_t)sent < count)
+    {
+        size_t chunk = std::min<size_t>(count - sent, UDP_BATCH_MAX);
+        for (size_t i = 0; i < chunk; ++i)
+        {
+            udp_datagram_t& msg = msgs[sent + i];
+
+            iovs[i].iov_base = msg.data;
+            iovs[i].iov_len = msg.size;
+
+            memset(&hdrs[i], 0, sizeof(mmsghdr));
+            hdrs[i].msg_hdr.msg_name = &msg.addr;
+            hdrs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            hdrs[i].msg_hdr.msg_iov = &iovs[i];
+            hdrs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int32 ret = sendmmsg(fd, hdrs, (uint32)chunk, 0);
+        if (ret == SOCKET_ERROR)
+        {
+            if (sErrno == S_EINTR)
+            {
+                continue;
+            }
+            // drop the datagram that failed, same as a failed sendto would
+            ret = 1;
+        }
+        sent += ret;
+    }
+#else
+    for (; (size_t)sent < count; ++sent)
+    {
+        sendudp(fd, msgs[sent].data, msgs[sent].size, 0, (const sockaddr*)&msgs[sent].addr, sizeof(sockaddr_in));
+    }
+#endif
+    return sent;
+}
+
 void socket_init()
 {
     switch (SOCKET_TYPE)
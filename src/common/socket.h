@@ -291,6 +291,22 @@ void socket_final_udp(void);
 int32 recvudp(int32 fd,void *buff,size_t nbytes,int32 flags,struct sockaddr *from, socklen_t *addrlen);
 int32 sendudp(int32 fd,void *buff,size_t nbytes,int32 flags,const struct sockaddr *from,socklen_t addrlen);
 
+// upper bound of datagrams moved by a single recvudp_batch/sendudp_batch call
+#define UDP_BATCH_MAX 64
+
+struct udp_datagram_t
+{
+    int8*       data;   // datagram buffer
+    size_t      size;   // recv: filled with received length, send: length to send
+    sockaddr_in addr;   // recv: sender address, send: destination address
+};
+
+// receives up to count datagrams already queued on the socket without blocking,
+// returns number of datagrams received or -1 on error
+int32 recvudp_batch(int32 fd, udp_datagram_t* msgs, size_t count, size_t nbytes);
+// sends count datagrams, returns number of datagrams handed to the socket
+int32 sendudp_batch(int32 fd, udp_datagram_t* msgs, size_t count);
+
 template<typename T, typename U>
 T& ref(U* buf, std::size_t index)
 {
@@ -29,6 +29,8 @@
 #include <stdlib.h>
 #include <cstdio>
 #include <any>
+#include <algorithm>
+#include <vector>
 
 /************************************************************************
 *																		*
@@ -58,7 +60,7 @@ Sql_t* Sql_Malloc(void)
 	mysql_init(&self->handle);
 	self->lengths = NULL;
 	self->result  = NULL;
-	self->keepalive = CTaskMgr::TASK_INVALID;
+	self->keepalive = nullptr;
 	return self;
 }
 
@@ -212,7 +214,8 @@ int32 Sql_Keepalive(Sql_t* self)
 	}
 	// establish keepalive
 	ping_interval = timeout - 30; // 30-second reserve
-	CTaskMgr::getInstance()->AddTask("Sql_P_KeepAliveTimer",server_clock::now()+std::chrono::seconds(ping_interval),self,CTaskMgr::TASK_INTERVAL,Sql_P_KeepaliveTimer,std::chrono::seconds(ping_interval));
+	if( self->keepalive ) CTaskMgr::getInstance()->RemoveTask(self->keepalive);
+	self->keepalive = CTaskMgr::getInstance()->AddTask("Sql_P_KeepAliveTimer",server_clock::now()+std::chrono::seconds(ping_interval),self,CTaskMgr::TASK_INTERVAL,Sql_P_KeepaliveTimer,std::chrono::seconds(ping_interval));
 	return 0;
 }
 
@@ -505,7 +508,7 @@ void Sql_Free(Sql_t* self)
 	{
         mysql_close(&self->handle);
 		Sql_FreeResult(self);
-		if( self->keepalive != CTaskMgr::TASK_INVALID ) CTaskMgr::getInstance()->RemoveTask("Sql_P_KeepAliveTimer");
+		if( self->keepalive ) CTaskMgr::getInstance()->RemoveTask(self->keepalive);
 		delete self;
 	}
 }
@@ -575,3 +578,225 @@ bool Sql_TransactionRollback(Sql_t* self)
     ShowFatalError("Sql_TransactionRollback: SQL_ERROR\n");
     return false;
 }
+
+/************************************************************************
+*																		*
+*  Prepared statements													*
+*																		*
+************************************************************************/
+
+#if defined(LIBMYSQL_VERSION_ID) && LIBMYSQL_VERSION_ID >= 80000 && !defined(MARIADB_BASE_VERSION)
+typedef bool my_bool;
+#endif
+
+struct SqlStmt_column_t
+{
+	void* buffer;
+	size_t buffer_len;
+	SqlDataType type;
+	bool* out_is_null;
+	my_bool is_null;
+	unsigned long length;
+};
+
+struct SqlStmt_t
+{
+	MYSQL_STMT* stmt;
+	std::vector<MYSQL_BIND> params;
+	std::vector<MYSQL_BIND> columns;
+	std::vector<SqlStmt_column_t> column_info;
+	bool result_bound;
+};
+
+/// Fills the type fields of bind, returns false for unsupported types
+static bool SqlStmt_P_BindType(MYSQL_BIND* bind, SqlDataType type)
+{
+	switch( type )
+	{
+	case SQLDT_INT8:   bind->buffer_type = MYSQL_TYPE_TINY;     bind->is_unsigned = 0; return true;
+	case SQLDT_UINT8:  bind->buffer_type = MYSQL_TYPE_TINY;     bind->is_unsigned = 1; return true;
+	case SQLDT_INT16:  bind->buffer_type = MYSQL_TYPE_SHORT;    bind->is_unsigned = 0; return true;
+	case SQLDT_UINT16: bind->buffer_type = MYSQL_TYPE_SHORT;    bind->is_unsigned = 1; return true;
+	case SQLDT_INT32:  bind->buffer_type = MYSQL_TYPE_LONG;     bind->is_unsigned = 0; return true;
+	case SQLDT_UINT32: bind->buffer_type = MYSQL_TYPE_LONG;     bind->is_unsigned = 1; return true;
+	case SQLDT_INT64:  bind->buffer_type = MYSQL_TYPE_LONGLONG; bind->is_unsigned = 0; return true;
+	case SQLDT_UINT64: bind->buffer_type = MYSQL_TYPE_LONGLONG; bind->is_unsigned = 1; return true;
+	case SQLDT_STRING: bind->buffer_type = MYSQL_TYPE_STRING;   bind->is_unsigned = 0; return true;
+	default:
+		return false;
+	}
+}
+
+SqlStmt_t* SqlStmt_Malloc(Sql_t* sql)
+{
+	if( sql == NULL )
+		return NULL;
+
+	MYSQL_STMT* stmt = mysql_stmt_init(&sql->handle);
+	if( stmt == NULL )
+	{
+		ShowSQL("DB error - %s\n", mysql_error(&sql->handle));
+		return NULL;
+	}
+
+	SqlStmt_t* self = new SqlStmt_t{};
+	self->stmt = stmt;
+	return self;
+}
+
+int32 SqlStmt_Prepare(SqlStmt_t* self, const char* query)
+{
+	if( self == NULL )
+		return SQL_ERROR;
+
+	SqlStmt_FreeResult(self);
+	if( mysql_stmt_prepare(self->stmt, query, (unsigned long)strlen(query)) )
+	{
+		ShowSQL("DB error - %s\nSQL: %s\n", mysql_stmt_error(self->stmt), query);
+		return SQL_ERROR;
+	}
+
+	// bind arrays must cover every parameter and column, unbound columns are skipped on fetch
+	self->params.assign(mysql_stmt_param_count(self->stmt), MYSQL_BIND{});
+	self->columns.assign(mysql_stmt_field_count(self->stmt), MYSQL_BIND{});
+	self->column_info.assign(self->columns.size(), SqlStmt_column_t{});
+	for( MYSQL_BIND& column : self->columns )
+		column.buffer_type = MYSQL_TYPE_NULL;
+	self->result_bound = false;
+
+	return SQL_SUCCESS;
+}
+
+int32 SqlStmt_BindParam(SqlStmt_t* self, size_t idx, SqlDataType buffer_type, void* buffer, size_t buffer_len)
+{
+	if( self == NULL || idx >= self->params.size() )
+		return SQL_ERROR;
+
+	MYSQL_BIND& bind = self->params[idx];
+	bind = MYSQL_BIND{};
+	if( !SqlStmt_P_BindType(&bind, buffer_type) )
+	{
+		ShowDebug("SqlStmt_BindParam: unsupported buffer type %d\n", buffer_type);
+		return SQL_ERROR;
+	}
+	bind.buffer = buffer;
+	bind.buffer_length = (unsigned long)buffer_len;
+	return SQL_SUCCESS;
+}
+
+int32 SqlStmt_BindColumn(SqlStmt_t* self, size_t idx, SqlDataType buffer_type, void* buffer, size_t buffer_len, bool* out_is_null)
+{
+	if( self == NULL || idx >= self->columns.size() || buffer_len == 0 )
+		return SQL_ERROR;
+
+	MYSQL_BIND& bind = self->columns[idx];
+	SqlStmt_column_t& info = self->column_info[idx];
+	bind = MYSQL_BIND{};
+	if( !SqlStmt_P_BindType(&bind, buffer_type) )
+	{
+		ShowDebug("SqlStmt_BindColumn: unsupported buffer type %d\n", buffer_type);
+		return SQL_ERROR;
+	}
+
+	info.buffer = buffer;
+	info.buffer_len = buffer_len;
+	info.type = buffer_type;
+	info.out_is_null = out_is_null;
+
+	// strings keep room for the terminator
+	bind.buffer = buffer;
+	bind.buffer_length = (unsigned long)(buffer_type == SQLDT_STRING ? buffer_len - 1 : buffer_len);
+	bind.is_null = &info.is_null;
+	bind.length = &info.length;
+	self->result_bound = false;
+	return SQL_SUCCESS;
+}
+
+int32 SqlStmt_Execute(SqlStmt_t* self)
+{
+	if( self == NULL )
+		return SQL_ERROR;
+
+	SqlStmt_FreeResult(self);
+	if( (!self->params.empty() && mysql_stmt_bind_param(self->stmt, self->params.data())) ||
+		mysql_stmt_execute(self->stmt) )
+	{
+		ShowSQL("DB error - %s\n", mysql_stmt_error(self->stmt));
+		return SQL_ERROR;
+	}
+
+	if( !self->columns.empty() )
+	{
+		if( !self->result_bound )
+		{
+			if( mysql_stmt_bind_result(self->stmt, self->columns.data()) )
+			{
+				ShowSQL("DB error - %s\n", mysql_stmt_error(self->stmt));
+				return SQL_ERROR;
+			}
+			self->result_bound = true;
+		}
+		if( mysql_stmt_store_result(self->stmt) )
+		{
+			ShowSQL("DB error - %s\n", mysql_stmt_error(self->stmt));
+			return SQL_ERROR;
+		}
+	}
+	return SQL_SUCCESS;
+}
+
+uint64 SqlStmt_NumRows(SqlStmt_t* self)
+{
+	if( self )
+		return (uint64)mysql_stmt_num_rows(self->stmt);
+	return 0;
+}
+
+int32 SqlStmt_NextRow(SqlStmt_t* self)
+{
+	if( self == NULL )
+		return SQL_ERROR;
+
+	int err = mysql_stmt_fetch(self->stmt);
+	if( err == MYSQL_NO_DATA )
+		return SQL_NO_DATA;
+	if( err != 0 && err != MYSQL_DATA_TRUNCATED )
+	{
+		ShowSQL("DB error - %s\n", mysql_stmt_error(self->stmt));
+		return SQL_ERROR;
+	}
+
+	for( SqlStmt_column_t& info : self->column_info )
+	{
+		if( info.buffer == NULL )
+			continue;
+
+		if( info.is_null )
+		{
+			memset(info.buffer, 0, info.buffer_len);
+		}
+		else if( info.type == SQLDT_STRING )
+		{
+			((char*)info.buffer)[std::min<size_t>(info.length, info.buffer_len - 1)] = '\0';
+		}
+		if( info.out_is_null )
+			*info.out_is_null = info.is_null != 0;
+	}
+	return SQL_SUCCESS;
+}
+
+void SqlStmt_FreeResult(SqlStmt_t* self)
+{
+	if( self )
+		mysql_stmt_free_result(self->stmt);
+}
+
+void SqlStmt_Free(SqlStmt_t* self)
+{
+	if( self )
+	{
+		SqlStmt_FreeResult(self);
+		mysql_stmt_close(self->stmt);
+		delete self;
+	}
+}
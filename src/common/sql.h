@@ -18,6 +18,7 @@
 //#endif
 
 #include "fmt/printf.h"
+#include "taskmgr.h"
 
 // Return codes
 #define SQL_ERROR -1
@@ -74,7 +75,7 @@ struct Sql_t
 	MYSQL_RES* result;
 	MYSQL_ROW row;
 	unsigned long* lengths;
-	int keepalive;
+	CTaskMgr::CTask* keepalive;
 };
 
 /// Allocates and initializes a new Sql handle.
@@ -196,6 +197,49 @@ bool Sql_TransactionStart(Sql_t* self);
 bool Sql_TransactionCommit(Sql_t* self);
 bool Sql_TransactionRollback(Sql_t* self);
 
+/*
+*
+*					PREPARED STATEMENT LEVEL
+*
+*/
+
+/// Server-side prepared statement bound to one Sql handle.
+/// Parameters and columns are bound to caller owned buffers that must stay valid while the statement is used.
+struct SqlStmt_t;
+
+/// Allocates a statement on the connection of sql.
+SqlStmt_t* SqlStmt_Malloc(Sql_t* sql);
+
+/// Prepares the statement, parameters are marked with '?'.
+/// @return SQL_SUCCESS or SQL_ERROR
+int32 SqlStmt_Prepare(SqlStmt_t* self, const char* query);
+
+/// Binds parameter idx to buffer. Supported types are the fixed size integers and SQLDT_STRING.
+/// @return SQL_SUCCESS or SQL_ERROR
+int32 SqlStmt_BindParam(SqlStmt_t* self, size_t idx, SqlDataType buffer_type, void* buffer, size_t buffer_len);
+
+/// Executes the statement with the currently bound parameters and buffers the result set.
+/// @return SQL_SUCCESS or SQL_ERROR
+int32 SqlStmt_Execute(SqlStmt_t* self);
+
+/// Binds result column idx to buffer, strings are always null-terminated and truncated to buffer_len - 1.
+/// NULL values leave a zeroed buffer. out_is_null may be nullptr.
+/// @return SQL_SUCCESS or SQL_ERROR
+int32 SqlStmt_BindColumn(SqlStmt_t* self, size_t idx, SqlDataType buffer_type, void* buffer, size_t buffer_len, bool* out_is_null);
+
+/// Number of rows in the buffered result set.
+uint64 SqlStmt_NumRows(SqlStmt_t* self);
+
+/// Fetches the next row into the bound column buffers.
+/// @return SQL_SUCCESS, SQL_NO_DATA or SQL_ERROR
+int32 SqlStmt_NextRow(SqlStmt_t* self);
+
+/// Frees the result set of the last execution.
+void SqlStmt_FreeResult(SqlStmt_t* self);
+
+/// Frees a statement returned by SqlStmt_Malloc.
+void SqlStmt_Free(SqlStmt_t* self);
+
 #endif
 
 //											End level									//
@@ -24,6 +24,17 @@
 #include "../common/timer.h"
 #include "../common/taskmgr.h"
 
+// histogram bucket upper bounds, anything slower lands in the last bucket
+static const std::array<duration, task_stats_t::buckets - 1> taskStatsBounds
+{
+    100us, 500us, 1ms, 5ms, 10ms, 50ms, 100ms, 500ms
+};
+
+static uint64 toMilliseconds(time_point tick)
+{
+    return (uint64)std::chrono::duration_cast<std::chrono::milliseconds>(tick.time_since_epoch()).count();
+}
+
 CTaskMgr* CTaskMgr::_instance = nullptr;
 
 CTaskMgr* CTaskMgr::getInstance()
@@ -44,6 +55,37 @@ void CTaskMgr::delInstance()
     }
 }
 
+CTaskMgr::CTaskMgr()
+{
+    m_current = toMilliseconds(server_clock::now());
+}
+
+CTaskMgr::~CTaskMgr()
+{
+    auto freeList = [](TaskList& list)
+    {
+        while (list.head)
+        {
+            CTask* PTask = list.head;
+            list.head = PTask->m_next;
+            delete PTask;
+        }
+    };
+    for (auto& slot : m_root)
+    {
+        freeList(slot);
+    }
+    for (auto& level : m_levels)
+    {
+        for (auto& slot : level)
+        {
+            freeList(slot);
+        }
+    }
+    freeList(m_overflow);
+    freeList(m_due);
+}
+
 CTaskMgr::CTask *CTaskMgr::AddTask(std::string InitName, time_point InitTick, std::any InitData,TASKTYPE InitType,TaskFunc_t InitFunc,duration InitInterval)
 {
 	return AddTask( new CTask(InitName,InitTick,InitData,InitType,InitFunc,InitInterval) );
@@ -51,50 +93,291 @@ CTaskMgr::CTask *CTaskMgr::AddTask(std::string InitName, time_point InitTick, st
 
 CTaskMgr::CTask *CTaskMgr::AddTask(CTask *PTask)
 {
-	m_TaskList.push(PTask);
+    std::lock_guard<std::mutex> lk(m_mutex);
+
+    PTask->m_stats = &m_stats[PTask->m_name];
+    insert(PTask);
 	return PTask;
 }
 
+void CTaskMgr::RemoveTask(CTask* PTask)
+{
+    if (PTask == nullptr)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lk(m_mutex);
+
+    if (PTask == m_running)
+    {
+        // freed by DoTimer once the callback returns
+        PTask->m_type = TASK_REMOVE;
+        return;
+    }
+    unlink(PTask);
+    delete PTask;
+}
+
 void CTaskMgr::RemoveTask(std::string TaskName)
 {
-	//empty method
+    std::lock_guard<std::mutex> lk(m_mutex);
+
+    auto removeFrom = [&](TaskList& list)
+    {
+        CTask* PTask = list.head;
+        while (PTask)
+        {
+            CTask* PNext = PTask->m_next;
+            if (PTask->m_name == TaskName)
+            {
+                unlink(PTask);
+                delete PTask;
+            }
+            PTask = PNext;
+        }
+    };
+    for (auto& slot : m_root)
+    {
+        removeFrom(slot);
+    }
+    for (auto& level : m_levels)
+    {
+        for (auto& slot : level)
+        {
+            removeFrom(slot);
+        }
+    }
+    removeFrom(m_overflow);
+    removeFrom(m_due);
+
+    if (m_running && m_running->m_name == TaskName)
+    {
+        m_running->m_type = TASK_REMOVE;
+    }
 }
 
+/************************************************************************
+*                                                                       *
+*  Wheel maintenance, m_mutex must be held                              *
+*                                                                       *
+************************************************************************/
+
+void CTaskMgr::link(TaskList& list, CTask* PTask)
+{
+    PTask->m_prev = nullptr;
+    PTask->m_next = list.head;
+    if (list.head)
+    {
+        list.head->m_prev = PTask;
+    }
+    list.head = PTask;
+    PTask->m_list = &list;
+}
+
+void CTaskMgr::unlink(CTask* PTask)
+{
+    if (PTask->m_list == nullptr)
+    {
+        return;
+    }
+    if (PTask->m_prev)
+    {
+        PTask->m_prev->m_next = PTask->m_next;
+    }
+    else
+    {
+        PTask->m_list->head = PTask->m_next;
+    }
+    if (PTask->m_next)
+    {
+        PTask->m_next->m_prev = PTask->m_prev;
+    }
+    PTask->m_prev = nullptr;
+    PTask->m_next = nullptr;
+    PTask->m_list = nullptr;
+}
+
+void CTaskMgr::insert(CTask* PTask)
+{
+    // anything already due runs on the next slot processed
+    uint64 expires = std::max(toMilliseconds(PTask->m_tick), m_current);
+    uint64 delta = expires - m_current;
+
+    if (delta < (1ull << RootBits))
+    {
+        link(m_root[expires & ((1 << RootBits) - 1)], PTask);
+        return;
+    }
+    for (size_t level = 0; level < WheelLevels - 1; ++level)
+    {
+        uint32 shift = RootBits + (uint32)level * LevelBits;
+        if (delta < (1ull << (shift + LevelBits)))
+        {
+            link(m_levels[level][(expires >> shift) & ((1 << LevelBits) - 1)], PTask);
+            return;
+        }
+    }
+    link(m_overflow, PTask);
+}
+
+// moves every task of a higher level slot down to where it now belongs
+void CTaskMgr::cascade(size_t level, size_t index)
+{
+    TaskList& list = level < WheelLevels - 1 ? m_levels[level][index] : m_overflow;
+    CTask* PTask = list.head;
+    list.head = nullptr;
+
+    while (PTask)
+    {
+        CTask* PNext = PTask->m_next;
+        PTask->m_list = nullptr;
+        insert(PTask);
+        PTask = PNext;
+    }
+}
+
+void CTaskMgr::record(CTask* PTask, duration elapsed)
+{
+    task_stats_t& stats = *PTask->m_stats;
+
+    stats.count++;
+    stats.total += elapsed;
+    stats.max = std::max(stats.max, elapsed);
+    if (PTask->m_type == TASK_INTERVAL && elapsed > PTask->m_interval)
+    {
+        stats.overruns++;
+    }
+
+    size_t bucket = 0;
+    while (bucket < taskStatsBounds.size() && elapsed > taskStatsBounds[bucket])
+    {
+        bucket++;
+    }
+    stats.histogram[bucket]++;
+}
+
+/************************************************************************
+*                                                                       *
+*  Runs every task that expired up to tick and returns the time until   *
+*  the next one (at most one second)                                    *
+*                                                                       *
+************************************************************************/
+
 duration CTaskMgr::DoTimer(time_point tick)
 {
-	duration diff = 1s;
+    std::unique_lock<std::mutex> lk(m_mutex);
 
-	while( !m_TaskList.empty() )
-	{
-		CTask * PTask = m_TaskList.top();
-		diff = PTask->m_tick - tick;
-
-		if( diff > 0s ) break; // no more expired timers to process
-
-		m_TaskList.pop();
-
-		if( PTask->m_func )
-		{
-			PTask->m_func(( diff < -1s ? tick : PTask->m_tick),PTask);
-		}
-
-		switch( PTask->m_type )
-		{
-			case TASK_INTERVAL:
-			{
-				PTask->m_tick = PTask->m_interval + (diff < - 1s ? tick : PTask->m_tick);
-				m_TaskList.push(PTask);
-			}
-				break;
-			case TASK_ONCE:
-			case TASK_REMOVE:
-			default:
-			{
-				delete PTask; // suppose that all tasks were allocated by new
-			}
-				break;
-		}
-		diff = std::clamp<duration>(diff, 50ms, 1000ms);
-	}
-	return diff;
+    uint64 now = toMilliseconds(tick);
+
+    while (m_current <= now)
+    {
+        size_t index = m_current & ((1 << RootBits) - 1);
+        if (index == 0)
+        {
+            for (size_t level = 0; level < WheelLevels; ++level)
+            {
+                uint32 shift = RootBits + (uint32)level * LevelBits;
+                size_t slot = (m_current >> shift) & ((1 << LevelBits) - 1);
+                cascade(level, slot);
+                if (slot != 0)
+                {
+                    break;
+                }
+            }
+        }
+
+        // take the slot before running anything, tasks added meanwhile go to later slots
+        TaskList& list = m_root[index];
+        m_due.head = list.head;
+        list.head = nullptr;
+        for (CTask* PTask = m_due.head; PTask; PTask = PTask->m_next)
+        {
+            PTask->m_list = &m_due;
+        }
+        m_current++;
+
+        while (CTask* PTask = m_due.head)
+        {
+            unlink(PTask);
+            m_running = PTask;
+
+            duration diff = PTask->m_tick - tick;
+            lk.unlock();
+
+            auto start = server_clock::now();
+            if (PTask->m_func)
+            {
+                PTask->m_func((diff < -1s ? tick : PTask->m_tick), PTask);
+            }
+            auto elapsed = server_clock::now() - start;
+
+            lk.lock();
+            m_running = nullptr;
+            record(PTask, elapsed);
+
+            switch (PTask->m_type)
+            {
+                case TASK_INTERVAL:
+                {
+                    PTask->m_tick = PTask->m_interval + (diff < -1s ? tick : PTask->m_tick);
+                    insert(PTask);
+                }
+                    break;
+                case TASK_ONCE:
+                case TASK_REMOVE:
+                default:
+                {
+                    delete PTask; // suppose that all tasks were allocated by new
+                }
+                    break;
+            }
+        }
+    }
+
+    // time until the first occupied slot or the next cascade, re-checked at least every second
+    for (uint64 slot = m_current; slot < m_current + 1000; ++slot)
+    {
+        if (m_root[slot & ((1 << RootBits) - 1)].head || (slot & ((1 << RootBits) - 1)) == 0)
+        {
+            return std::chrono::milliseconds(slot > now ? slot - now : 0);
+        }
+    }
+    return 1s;
+}
+
+/************************************************************************
+*                                                                       *
+*  Execution time statistics                                            *
+*                                                                       *
+************************************************************************/
+
+std::map<std::string, task_stats_t> CTaskMgr::GetTaskStats()
+{
+    std::lock_guard<std::mutex> lk(m_mutex);
+    return m_stats;
+}
+
+void CTaskMgr::PrintTaskStats()
+{
+    auto toMs = [](duration value)
+    {
+        return std::chrono::duration<double, std::milli>(value).count();
+    };
+
+    ShowInfo("Task timings (runs: avg/max ms, overruns, histogram <0.1 <0.5 <1 <5 <10 <50 <100 <500 >=500 ms)\n");
+    for (auto& [name, stats] : GetTaskStats())
+    {
+        if (stats.count == 0)
+        {
+            continue;
+        }
+        std::string histogram;
+        for (auto count : stats.histogram)
+        {
+            histogram += " " + std::to_string(count);
+        }
+        ShowInfo("  %-24s %8llu: %.3f/%.3f ms, %llu overruns,%s\n", name.c_str(), (unsigned long long)stats.count,
+            toMs(stats.total) / stats.count, toMs(stats.max), (unsigned long long)stats.overruns, histogram.c_str());
+    }
 }
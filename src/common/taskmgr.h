@@ -24,18 +24,36 @@
 
 #include "../common/cbasetypes.h"
 
-#include <string>
-#include <queue>
-#include <functional>
 #include <any>
+#include <array>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+/************************************************************************
+*                                                                       *
+*  Timer tasks are kept in a hierarchical timing wheel with 1 ms        *
+*  resolution: 256 one-millisecond slots, then three levels of 64       *
+*  slots that cascade down as time passes, and an overflow list for     *
+*  anything further than ~18 hours out. Adding and removing a task is   *
+*  O(1); DoTimer touches only the slots between two calls.              *
+*                                                                       *
+*  AddTask and RemoveTask may be called from any thread, tasks always   *
+*  run on the thread calling DoTimer.                                   *
+*                                                                       *
+************************************************************************/
+
+// execution time histogram of every task sharing a name
+struct task_stats_t
+{
+    static constexpr size_t buckets = 9;                // see CTaskMgr::PrintTaskStats for the bounds
 
-template<class _Ty>
-    struct greater_equal
-{    // functor for operator>
-    bool operator()(const _Ty& _Left, const _Ty& _Right) const
-    {    // apply operator> to operands
-        return ((*_Left) > (*_Right));
-    }
+    uint64   count {0};
+    uint64   overruns {0};                              // runs longer than the task's interval
+    duration total {0};
+    duration max {0};
+    std::array<uint64, buckets> histogram {};
 };
 
 class CTaskMgr
@@ -50,10 +68,7 @@ public:
         TASK_REMOVE,
         TASK_INVALID
     };
-    typedef int32 (*TaskFunc_t)(time_point tick,CTask*);
-    typedef std::priority_queue<CTask*,std::deque<CTask*>,greater_equal<CTask*> > TaskList_t;
-
-    TaskList_t& getTaskList(){ return m_TaskList; };
+    typedef std::function<int32(time_point, CTask*)> TaskFunc_t;
 
     CTask* AddTask(CTask*);
     CTask* AddTask(
@@ -65,20 +80,47 @@ public:
         duration InitInterval=1s);
 
     duration    DoTimer(time_point tick);
-    void    RemoveTask(std::string TaskName);
+    void    RemoveTask(CTask* PTask);                   // cancels and frees the task
+    void    RemoveTask(std::string TaskName);           // cancels every task with that name
+
+    std::map<std::string, task_stats_t> GetTaskStats();
+    void    PrintTaskStats();
 
     static CTaskMgr * getInstance();
     static void delInstance();
 
-    ~CTaskMgr() {};
+    ~CTaskMgr();
 
 private:
 
+    struct TaskList
+    {
+        CTask* head {nullptr};
+    };
+
+    static constexpr size_t   WheelLevels = 4;
+    static constexpr uint32   RootBits = 8;             // level 0: 256 x 1 ms
+    static constexpr uint32   LevelBits = 6;            // levels 1-3: 64 slots each
+
     static CTaskMgr* _instance;
 
-    TaskList_t m_TaskList;
+    std::mutex  m_mutex;
+    uint64      m_current;                              // next millisecond to process
+    std::array<TaskList, 1 << RootBits> m_root;
+    std::array<std::array<TaskList, 1 << LevelBits>, WheelLevels - 1> m_levels;
+    TaskList    m_overflow;
+    TaskList    m_due;                                  // popped from a slot, waiting to run
+    CTask*      m_running {nullptr};
 
-    CTaskMgr() {};
+    std::map<std::string, task_stats_t> m_stats;
+
+    void    insert(CTask* PTask);
+    void    link(TaskList& list, CTask* PTask);
+    void    unlink(CTask* PTask);
+    void    cascade(size_t level, size_t index);
+    void    record(CTask* PTask, duration elapsed);
+
+    CTaskMgr();
 };
 
 class CTaskMgr::CTask
@@ -104,26 +146,14 @@ public:
     duration    m_interval;
     std::any    m_data;
     TaskFunc_t  m_func;
-};
-
-inline bool operator<(const CTaskMgr::CTask& a,const CTaskMgr::CTask& b)
-{
-    return a.m_tick < b.m_tick;
-};
 
-inline bool operator>(const CTaskMgr::CTask& a,const CTaskMgr::CTask& b)
-{
-    return a.m_tick > b.m_tick;
-};
+private:
+    friend class CTaskMgr;
 
-inline bool operator >=(const CTaskMgr::CTask& a,const CTaskMgr::CTask& b)
-{
-    return a.m_tick >= b.m_tick;
+    CTask*        m_prev {nullptr};                     // wheel slot links
+    CTask*        m_next {nullptr};
+    TaskList*     m_list {nullptr};
+    task_stats_t* m_stats {nullptr};
 };
 
-inline bool operator <=(const CTaskMgr::CTask& a,const CTaskMgr::CTask &b)
-{
-    return a.m_tick <= b.m_tick;
-}
-
 #endif
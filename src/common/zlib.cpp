@@ -47,10 +47,28 @@ struct zlib_jump
     const void *ptr;
 };
 
+// Number of input bits resolved by a single decoder table lookup
+#define ZLIB_LOOKUP_BITS 10
+
+struct zlib_lookup
+{
+    const struct zlib_jump *node; // tree node reached after consuming bits (root if leaf)
+    uint8 bits;                   // bits consumed, 0 if the tree can't be walked this far
+    uint8 value;                  // decoded byte if leaf is set
+    bool leaf;
+};
+
 struct zlib
 {
     std::vector<uint32> enc;
     std::vector<struct zlib_jump> jump;
+
+    // Encoder tables indexed by the input byte
+    uint32 code[256];
+    uint8 bits[256];
+
+    // Decoder table indexed by the next ZLIB_LOOKUP_BITS input bits, starting at the root
+    std::vector<struct zlib_lookup> lookup;
 };
 
 static struct zlib zlib;
@@ -118,42 +136,103 @@ static void populate_jump_table(std::vector<struct zlib_jump> &jump, const std::
     }
 }
 
+static inline bool is_jump_node(const struct zlib_jump *jmp)
+{
+    return jmp >= zlib.jump.data() && jmp + 4 <= zlib.jump.data() + zlib.jump.size();
+}
+
+static inline bool is_jump_leaf(const struct zlib_jump *jmp)
+{
+    return jmp[0].ptr == 0 && jmp[1].ptr == 0;
+}
+
+static bool populate_encode_table()
+{
+    if (zlib.enc.size() < 0x200)
+    {
+        ShowFatalError("zlib: compress.dat is too small (%u entries)\n", (uint32)zlib.enc.size());
+        return false;
+    }
+
+    for (uint32 b = 0; b < 256; ++b)
+    {
+        // The original tables are indexed by the signed value of the input byte
+        const uint32 index = static_cast<int8>(b) + 0x80;
+        const uint32 bits = zlib.enc[index + 0x100];
+
+        if (bits == 0 || bits > 32)
+        {
+            ShowFatalError("zlib: invalid code length %u for byte %u\n", bits, b);
+            return false;
+        }
+
+        zlib.code[b] = bits < 32 ? zlib.enc[index] & ((1u << bits) - 1) : zlib.enc[index];
+        zlib.bits[b] = static_cast<uint8>(bits);
+    }
+    return true;
+}
+
+static void populate_decode_table()
+{
+    const struct zlib_jump *root = static_cast<const struct zlib_jump*>(zlib.jump[0].ptr);
+
+    zlib.lookup.assign(1 << ZLIB_LOOKUP_BITS, zlib_lookup{ root, 0, 0, false });
+
+    for (uint32 pattern = 0; pattern < zlib.lookup.size(); ++pattern)
+    {
+        struct zlib_lookup &entry = zlib.lookup[pattern];
+        const struct zlib_jump *jmp = root;
+
+        for (uint8 bit = 0; bit < ZLIB_LOOKUP_BITS; ++bit)
+        {
+            jmp = static_cast<const struct zlib_jump*>(jmp[(pattern >> bit) & 1].ptr);
+
+            // Paths that leave the tree are left to the bit-by-bit walker
+            if (!is_jump_node(jmp))
+                break;
+
+            if (is_jump_leaf(jmp))
+            {
+                entry = zlib_lookup{ root, static_cast<uint8>(bit + 1), static_cast<uint8>(reinterpret_cast<std::uintptr_t>(jmp[3].ptr)), true };
+                break;
+            }
+
+            if (bit + 1 == ZLIB_LOOKUP_BITS)
+                entry = zlib_lookup{ jmp, ZLIB_LOOKUP_BITS, 0, false };
+        }
+    }
+}
+
 int32 zlib_init()
 {
     std::vector<uint32> dec;
     if (!read_to_vector("compress.dat", zlib.enc) || !read_to_vector("decompress.dat", dec))
         return -1;
 
+    if (!populate_encode_table())
+        return -1;
+
     populate_jump_table(zlib.jump, dec);
+    populate_decode_table();
     return 0;
 }
 
-static int32 zlib_compress_sub(const uint8 *b32, const uint32 read, const uint32 elem, int8 *out, const uint32 out_sz)
+// Writes the completed bytes of the bit accumulator to out.
+// The last partial byte is merged so bits past the end keep their previous value.
+static inline void zlib_flush_bits(uint8 *out, uint64 &acc, uint32 &acc_bits, const bool partial)
 {
-    assert(b32 && out);
-
-    if (zlib_compressed_size(elem) > sizeof(uint32))
+    while (acc_bits >= 8)
     {
-        ShowWarning("zlib_compress_sub: element exceeds 4 bytes (%u)\n", elem);
-        return -1;
+        *out++ = static_cast<uint8>(acc);
+        acc >>= 8;
+        acc_bits -= 8;
     }
 
-    if (zlib_compressed_size(read + elem) > out_sz)
+    if (partial && acc_bits > 0)
     {
-        ShowWarning("zlib_compress_sub: ran out of space (%u : %u : %u)\n", read, elem, out_sz);
-        return -1;
-    }
-
-    for (uint32 i = 0; i < elem; ++i)
-    {
-        const uint8 shift = (read + i) & 7;
-        const uint32 v = (read + i) / 8;
-        const uint32 inv_mask = ~(1 << shift);
-        assert(shift < 8);
-        out[v] = (inv_mask & out[v]) + (JMPBIT(b32, i) << shift);
+        const uint8 mask = static_cast<uint8>((1u << acc_bits) - 1);
+        *out = static_cast<uint8>((*out & ~mask) | (acc & mask));
     }
-
-    return 0;
 }
 
 int32 zlib_compress(const int8 *in, const uint32 in_sz, int8 *out, const uint32 out_sz)
@@ -163,23 +242,37 @@ int32 zlib_compress(const int8 *in, const uint32 in_sz, int8 *out, const uint32
 
     uint32 read = 0;
     const uint32 max_sz = (out_sz - 1) * 8; // Output buffer may be at least 8 times big than original
+
+    // Codes are gathered in a 64 bit accumulator and stored 32 bits at a time
+    uint8 *dst = reinterpret_cast<uint8*>(out + 1);
+    uint64 acc = 0;
+    uint32 acc_bits = 0;
+
     for (uint32 i = 0; i < in_sz; ++i)
     {
-        const uint32 elem = zlib.enc[static_cast<int8>(in[i]) + 0x180];
+        const uint8 b = static_cast<uint8>(in[i]);
+        const uint32 elem = zlib.bits[b];
         if (elem + read < max_sz)
         {
-            const uint32 index = static_cast<int8>(in[i]) + 0x80;
-            assert(index < zlib.enc.size());
-            uint32 v = zlib.enc[index];
-            swap32_if_be(&v, 1);
-            uint8 b32[sizeof(v)];
-            memcpy(b32, &v, sizeof(b32));
-            zlib_compress_sub(b32, read, elem, out + 1, out_sz - 1);
+            acc |= static_cast<uint64>(zlib.code[b]) << acc_bits;
+            acc_bits += elem;
             read += elem;
+
+            if (acc_bits >= 32)
+            {
+                dst[0] = static_cast<uint8>(acc);
+                dst[1] = static_cast<uint8>(acc >> 8);
+                dst[2] = static_cast<uint8>(acc >> 16);
+                dst[3] = static_cast<uint8>(acc >> 24);
+                dst += 4;
+                acc >>= 32;
+                acc_bits -= 32;
+            }
         }
         else if (in_sz + 1 >= out_sz)
         {
             // Ran if input doesn't fit output, outputs garbage(?)
+            zlib_flush_bits(dst, acc, acc_bits, true);
             ShowWarning("zlib_compress: ran out of space, outputting garbage(?) (%u : %u : %u : %u)\n", read, elem, max_sz, in[i]);
             memset(out, 0, (out_sz / 4) + (in_sz & 3));
             memset(out + 1, in_sz, in_sz / 4);
@@ -188,21 +281,51 @@ int32 zlib_compress(const int8 *in, const uint32 in_sz, int8 *out, const uint32
         }
         else
         {
+            zlib_flush_bits(dst, acc, acc_bits, true);
             ShowWarning("zlib_compress: ran out of space (%u : %u : %u : %u)\n", read, elem, max_sz, in[i]);
             return -1;
         }
     }
 
+    zlib_flush_bits(dst, acc, acc_bits, true);
+
     out[0] = 1;
     return read + 8;
 }
 
+// Number of bits zlib_compress emits for in, excluding the leading marker byte
+uint32 zlib_compressed_bits(const int8 *in, const uint32 in_sz)
+{
+    assert(in);
+    assert(zlib.enc.size());
+
+    uint32 bits = 0;
+    for (uint32 i = 0; i < in_sz; ++i)
+        bits += zlib.bits[static_cast<uint8>(in[i])];
+
+    return bits;
+}
+
+// Reads count (<= 24) bits starting at bit pos, least significant bit first
+static inline uint32 zlib_peek_bits(const uint8 *data, const uint32 pos, const uint32 count)
+{
+    const uint32 shift = pos & 7;
+    const uint8 *p = data + pos / 8;
+
+    uint32 v = 0;
+    for (uint32 got = 0; got < count + shift; got += 8)
+        v |= static_cast<uint32>(*p++) << got;
+
+    return (v >> shift) & ((1u << count) - 1);
+}
+
 uint32 zlib_decompress(const int8 *in, const uint32 in_sz, int8 *out, const uint32 out_sz)
 {
     assert(in && out);
     assert(zlib.jump.size());
 
-    const struct zlib_jump *jmp = static_cast<const struct zlib_jump*>(zlib.jump[0].ptr);
+    const struct zlib_jump *root = static_cast<const struct zlib_jump*>(zlib.jump[0].ptr);
+    const struct zlib_jump *jmp = root;
     assert(jmp >= zlib.jump.data() && jmp <= zlib.jump.data() + zlib.jump.size());
 
     if (in[0] != 1)
@@ -212,20 +335,45 @@ uint32 zlib_decompress(const int8 *in, const uint32 in_sz, int8 *out, const uint
     }
 
     uint32 w = 0;
+    uint32 i = 0;
     const int8 *data = in + 1;
-    for (uint32 i = 0; i < in_sz && w < out_sz; ++i)
+    while (i < in_sz && w < out_sz)
     {
+        // Resolve up to ZLIB_LOOKUP_BITS bits at once when starting a new code
+        if (jmp == root && in_sz - i >= ZLIB_LOOKUP_BITS)
+        {
+            const struct zlib_lookup &entry = zlib.lookup[zlib_peek_bits(reinterpret_cast<const uint8*>(data), i, ZLIB_LOOKUP_BITS)];
+            if (entry.bits)
+            {
+                i += entry.bits;
+                jmp = entry.node;
+
+                if (!entry.leaf)
+                    continue;
+
+                out[w++] = entry.value;
+
+                if (w >= out_sz)
+                {
+                    ShowWarning("zlib_decompress: ran out of space (%u : %u)\n", in_sz, out_sz);
+                    return -1;
+                }
+                continue;
+            }
+        }
+
         jmp = static_cast<const struct zlib_jump*>(jmp[JMPBIT(data, i)].ptr);
         assert(jmp >= zlib.jump.data() && jmp <= zlib.jump.data() + zlib.jump.size());
+        ++i;
 
         // Repeat until there is nowhere to jump to
-        if (jmp[0].ptr != 0 || jmp[1].ptr != 0)
+        if (!is_jump_leaf(jmp))
             continue;
 
         // The remaining address should be data
         assert(jmp[3].ptr <= reinterpret_cast<void*>(0xff));
         out[w++] = static_cast<uint8>(reinterpret_cast<std::uintptr_t>(jmp[3].ptr));
-        jmp = static_cast<const struct zlib_jump*>(zlib.jump[0].ptr);
+        jmp = root;
 
         if (w >= out_sz)
         {
@@ -11,6 +11,7 @@ static inline size_t zlib_compressed_size(const size_t sz)
 
 int32 zlib_init();
 int32 zlib_compress(const int8 *in, const uint32 in_sz, int8 *out, const uint32 out_sz);
+uint32 zlib_compressed_bits(const int8 *in, const uint32 in_sz);
 uint32 zlib_decompress(const int8 *in, const uint32 in_sz, int8 *out, const uint32 out_sz);
 
 #endif
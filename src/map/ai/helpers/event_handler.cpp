@@ -21,16 +21,60 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 
 #include "event_handler.h"
 
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+
+#include "../../../common/showmsg.h"
+
+// event names are interned once and shared by every entity
+static std::deque<std::string> eventNames;
+static std::unordered_map<std::string_view, uint16> eventIDs;
+
+uint16 CAIEventHandler::internEvent(std::string_view eventname)
+{
+    if (auto it = eventIDs.find(eventname); it != eventIDs.end())
+    {
+        return it->second;
+    }
+    if (eventNames.size() >= MAX_EVENT_ID)
+    {
+        ShowError("CAIEventHandler: too many distinct events, <%s> ignored\n", std::string(eventname).c_str());
+        return MAX_EVENT_ID;
+    }
+    uint16 id = (uint16)eventNames.size();
+    eventNames.emplace_back(eventname);
+    eventIDs.emplace(eventNames.back(), id);
+    return id;
+}
+
+uint16 CAIEventHandler::findEvent(std::string_view eventname)
+{
+    auto it = eventIDs.find(eventname);
+    return it != eventIDs.end() ? it->second : MAX_EVENT_ID;
+}
+
 void CAIEventHandler::addListener(std::string eventname, int lua_func, std::string identifier)
 {
-    eventListeners[eventname].emplace_back(identifier, lua_func);
+    uint16 id = internEvent(eventname);
+    if (id >= MAX_EVENT_ID)
+    {
+        return;
+    }
+    if (eventListeners.size() <= id)
+    {
+        eventListeners.resize(id + 1);
+    }
+    eventListeners[id].emplace_back(identifier, lua_func);
+    m_subscribed.set(id);
 }
 
 void CAIEventHandler::removeListener(std::string identifier)
 {
-    for (auto&& eventListener : eventListeners)
+    for (size_t id = 0; id < eventListeners.size(); ++id)
     {
-        eventListener.second.erase(std::remove_if(eventListener.second.begin(), eventListener.second.end(), [&identifier](const ai_event_t& event)
+        auto& eventListener = eventListeners[id];
+        eventListener.erase(std::remove_if(eventListener.begin(), eventListener.end(), [&identifier](const ai_event_t& event)
         {
             if (identifier == event.identifier)
             {
@@ -41,6 +85,11 @@ void CAIEventHandler::removeListener(std::string identifier)
                 return true;
             }
             return false;
-        }), eventListener.second.end());
+        }), eventListener.end());
+
+        if (eventListener.empty())
+        {
+            m_subscribed.reset(id);
+        }
     }
 }
@@ -22,13 +22,18 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 #ifndef _EVENT_HANDLER
 #define _EVENT_HANDLER
 
-#include <map>
+#include <bitset>
+#include <string>
+#include <string_view>
 #include <vector>
 #include <functional>
 
 #include "../../../common/cbasetypes.h"
 #include "../../lua/luautils.h"
 
+// upper bound on distinct event names (core and script defined)
+#define MAX_EVENT_ID 256
+
 struct ai_event_t
 {
     std::string identifier;
@@ -46,11 +51,11 @@ public:
 
     // calls event from core
     template<class... Args>
-    void triggerListener(std::string eventname, Args&&... args)
+    void triggerListener(std::string_view eventname, Args&&... args)
     {
-        if (auto eventListener = eventListeners.find(eventname); eventListener != eventListeners.end())
+        if (auto eventListener = getListeners(eventname))
         {
-            for (auto&& event : eventListener->second)
+            for (auto&& event : *eventListener)
             {
                 int nargs = sizeof...(args);
                 luautils::pushFunc(event.lua_func);
@@ -61,11 +66,11 @@ public:
     }
 
     //calls event from lua
-    void triggerListener(std::string eventname, int nargs)
+    void triggerListener(std::string_view eventname, int nargs)
     {
-        if (auto eventListener = eventListeners.find(eventname); eventListener != eventListeners.end())
+        if (auto eventListener = getListeners(eventname))
         {
-            for (auto&& event : eventListener->second)
+            for (auto&& event : *eventListener)
             {
                 luautils::pushFunc(event.lua_func, nargs);
                 luautils::callFunc(nargs);
@@ -74,11 +79,31 @@ public:
     }
 
 private:
-    std::map<std::string, std::vector<ai_event_t>> eventListeners;
+    std::vector<std::vector<ai_event_t>> eventListeners;    // indexed by event id
+    std::bitset<MAX_EVENT_ID> m_subscribed;                 // event ids with at least one listener
+
+    static uint16 internEvent(std::string_view eventname);   // assigns an id on first use
+    static uint16 findEvent(std::string_view eventname);     // MAX_EVENT_ID if never interned
+
+    // listeners for eventname or nullptr, does not allocate
+    std::vector<ai_event_t>* getListeners(std::string_view eventname)
+    {
+        if (m_subscribed.none())
+        {
+            return nullptr;
+        }
+        uint16 id = findEvent(eventname);
+        if (id >= MAX_EVENT_ID || !m_subscribed.test(id))
+        {
+            return nullptr;
+        }
+        return &eventListeners[id];
+    }
 
     // push parameters on lua stack
     template<class T>
     void pushArg(T&& arg) { luautils::pushArg<std::decay_t<T>>(std::forward<T>(arg)); }
+
     template<class T, class... Args>
     void pushArg(T&& arg, Args&&... args)
     {
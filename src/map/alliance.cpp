@@ -31,6 +31,7 @@
 #include "utils/jailutils.h"
 #include "map.h"
 #include "party.h"
+#include "party_roster.h"
 #include "treasure_pool.h"
 #include "message.h"
 
@@ -54,6 +55,7 @@ CAlliance::CAlliance(CBattleEntity* PEntity)
     addParty(PEntity->PParty);
 	this->aLeader = PEntity->PParty;
     Sql_Query(SqlHandle, "UPDATE accounts_parties SET partyflag = partyflag | %d WHERE partyid = %u AND partyflag & %d;", ALLIANCE_LEADER, m_AllianceID, PARTY_LEADER);
+    partyroster::Refresh(m_AllianceID);
 }
 
 CAlliance::CAlliance(uint32 id): m_AllianceID(id), aLeader(nullptr)
@@ -76,6 +78,7 @@ void CAlliance::dissolveAlliance(bool playerInitiated)
                         SET allianceid = 0, partyflag = partyflag & ~%d \
                         WHERE allianceid = %u AND IF(%u = 0 AND %u = 0, true, server_addr = %u AND server_port = %u);",
                         ALLIANCE_LEADER | PARTY_SECOND | PARTY_THIRD, m_AllianceID, map_ip.s_addr, map_port, map_ip.s_addr, map_port);
+        partyroster::Refresh(m_AllianceID);
         //first kick out the third party if it exsists
         CParty* party = nullptr;
         if (this->partyList.size() == 3)
@@ -75,8 +75,7 @@ namespace anticheat
         if ((cellid == 0) || (cellid > 32)) {
             cellid = 1;
         }
-        const char* fmtQuery = "INSERT INTO char_vars SET charid = %u, varname = 'inJail', value = %i ON DUPLICATE KEY UPDATE value = %i;";
-        Sql_Query(SqlHandle, fmtQuery, PChar->id, cellid, cellid);
+        charutils::SetCharVar(PChar, "inJail", cellid);
         PChar->loc.p.x = (float)g_jailCells[cellid-1][0];
         PChar->loc.p.y = (float)g_jailCells[cellid - 1][1];
         PChar->loc.p.z = (float)g_jailCells[cellid - 1][2];
@@ -45,6 +45,7 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 #include "treasure_pool.h"
 
 #include "utils/itemutils.h"
+#include "utils/mobutils.h"
 #include "utils/zoneutils.h"
 #include "zone.h"
 #include <chrono>
@@ -586,34 +587,27 @@ void CBattlefield::Cleanup()
 
 bool CBattlefield::LoadMobs()
 {
-    //get ids from DB
-    auto fmtQuery = "SELECT monsterId, conditions \
-                            FROM bcnm_battlefield \
-                            WHERE bcnmId = %u AND battlefieldNumber = %u";
+    // ids come from the bcnm_battlefield lists cached at startup
+    auto mobList = mobutils::GetBattlefieldMobs(this->GetID(), this->GetArea());
 
-    auto ret = Sql_Query(SqlHandle, fmtQuery, this->GetID(), this->GetArea());
-
-    if (ret == SQL_ERROR ||
-        Sql_NumRows(SqlHandle) == 0)
+    if (!mobList)
     {
         ShowError("Battlefield::LoadMobs() : Cannot find any monster IDs for battlefield %i area %i \n",
             this->GetID(), this->GetArea());
     }
     else
     {
-        while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+        for (auto& mob : *mobList)
         {
-            auto mobid = Sql_GetUIntData(SqlHandle, 0);
-            auto condition = Sql_GetUIntData(SqlHandle, 1);
-            auto PMob = static_cast<CMobEntity*>(zoneutils::GetEntity(mobid, TYPE_MOB | TYPE_PET));
+            auto PMob = static_cast<CMobEntity*>(zoneutils::GetEntity(mob.mobid, TYPE_MOB | TYPE_PET));
 
             if (PMob)
             {
-                this->InsertEntity(PMob, true, static_cast<BATTLEFIELDMOBCONDITION>(condition));
+                this->InsertEntity(PMob, true, static_cast<BATTLEFIELDMOBCONDITION>(mob.condition));
             }
             else
             {
-                ShowDebug("Battlefield::LoadMobs() mob %u not found\n", mobid);
+                ShowDebug("Battlefield::LoadMobs() mob %u not found\n", mob.mobid);
                 return false;
             }
         }
@@ -76,10 +76,10 @@ CBattleEntity::CBattleEntity()
     StatusEffectContainer = std::make_unique<CStatusEffectContainer>(this);
     PRecastContainer = std::make_unique<CRecastContainer>(this);
 
-    m_modStat[Mod::SLASHRES] = 1000;
-    m_modStat[Mod::PIERCERES] = 1000;
-    m_modStat[Mod::HTHRES] = 1000;
-    m_modStat[Mod::IMPACTRES] = 1000;
+    modStat(Mod::SLASHRES) = 1000;
+    modStat(Mod::PIERCERES) = 1000;
+    modStat(Mod::HTHRES) = 1000;
+    modStat(Mod::IMPACTRES) = 1000;
 
     m_Immunity = 0;
     isCharmed = false;
@@ -153,8 +153,8 @@ void CBattleEntity::UpdateHealth()
 {
     int32 dif = (getMod(Mod::CONVMPTOHP) - getMod(Mod::CONVHPTOMP));
 
-    health.modmp = std::max(0, ((health.maxmp) * (100 + getMod(Mod::MPP)) / 100) + std::min<int16>((health.maxmp * m_modStat[Mod::FOOD_MPP] / 100), m_modStat[Mod::FOOD_MP_CAP]) + getMod(Mod::MP));
-    health.modhp = std::max(1, ((health.maxhp) * (100 + getMod(Mod::HPP)) / 100) + std::min<int16>((health.maxhp * m_modStat[Mod::FOOD_HPP] / 100), m_modStat[Mod::FOOD_HP_CAP]) + getMod(Mod::HP));
+    health.modmp = std::max(0, ((health.maxmp) * (100 + getMod(Mod::MPP)) / 100) + std::min<int16>((health.maxmp * getMod(Mod::FOOD_MPP) / 100), getMod(Mod::FOOD_MP_CAP)) + getMod(Mod::MP));
+    health.modhp = std::max(1, ((health.maxhp) * (100 + getMod(Mod::HPP)) / 100) + std::min<int16>((health.maxhp * getMod(Mod::FOOD_HPP) / 100), getMod(Mod::FOOD_HP_CAP)) + getMod(Mod::HP));
 
     dif = (health.modmp - 0) < dif ? (health.modmp - 0) : dif;
     dif = (health.modhp - 1) < -dif ? -(health.modhp - 1) : dif;
@@ -530,43 +530,43 @@ int32 CBattleEntity::takeDamage(int32 amount, CBattleEntity* attacker /* = nullp
 
 uint16 CBattleEntity::STR()
 {
-    return std::clamp(stats.STR + m_modStat[Mod::STR], 0, 999);
+    return std::clamp(stats.STR + getMod(Mod::STR), 0, 999);
 }
 
 uint16 CBattleEntity::DEX()
 {
-    return std::clamp(stats.DEX + m_modStat[Mod::DEX], 0, 999);
+    return std::clamp(stats.DEX + getMod(Mod::DEX), 0, 999);
 }
 
 uint16 CBattleEntity::VIT()
 {
-    return std::clamp(stats.VIT + m_modStat[Mod::VIT], 0, 999);
+    return std::clamp(stats.VIT + getMod(Mod::VIT), 0, 999);
 }
 
 uint16 CBattleEntity::AGI()
 {
-    return std::clamp(stats.AGI + m_modStat[Mod::AGI], 0, 999);
+    return std::clamp(stats.AGI + getMod(Mod::AGI), 0, 999);
 }
 
 uint16 CBattleEntity::INT()
 {
-    return std::clamp(stats.INT + m_modStat[Mod::INT], 0, 999);
+    return std::clamp(stats.INT + getMod(Mod::INT), 0, 999);
 }
 
 uint16 CBattleEntity::MND()
 {
-    return std::clamp(stats.MND + m_modStat[Mod::MND], 0, 999);
+    return std::clamp(stats.MND + getMod(Mod::MND), 0, 999);
 }
 
 uint16 CBattleEntity::CHR()
 {
-    return std::clamp(stats.CHR + m_modStat[Mod::CHR], 0, 999);
+    return std::clamp(stats.CHR + getMod(Mod::CHR), 0, 999);
 }
 
 uint16 CBattleEntity::ATT()
 {
     //TODO: consider which weapon!
-    int32 ATT = 8 + m_modStat[Mod::ATT];
+    int32 ATT = 8 + getMod(Mod::ATT);
     auto weapon = dynamic_cast<CItemWeapon*>(m_Weapons[SLOT_MAIN]);
     if (weapon && weapon->isTwoHanded())
     {
@@ -597,8 +597,8 @@ uint16 CBattleEntity::ATT()
     {
         ATT += this->GetSkill(SKILL_AUTOMATON_MELEE);
     }
-    return ATT + (ATT * m_modStat[Mod::ATTP] / 100) +
-        std::min<int16>((ATT * m_modStat[Mod::FOOD_ATTP] / 100), m_modStat[Mod::FOOD_ATT_CAP]);
+    return ATT + (ATT * getMod(Mod::ATTP) / 100) +
+        std::min<int16>((ATT * getMod(Mod::FOOD_ATTP) / 100), getMod(Mod::FOOD_ATT_CAP));
 }
 
 uint16 CBattleEntity::RATT(uint8 skill, uint16 bonusSkill)
@@ -608,9 +608,9 @@ uint16 CBattleEntity::RATT(uint8 skill, uint16 bonusSkill)
     {
         return 0;
     }
-    int32 ATT = 8 + GetSkill(skill) + bonusSkill + m_modStat[Mod::RATT] + battleutils::GetRangedAttackBonuses(this) + STR() / 2;
-    return ATT + (ATT * m_modStat[Mod::RATTP] / 100) +
-        std::min<int16>((ATT * m_modStat[Mod::FOOD_RATTP] / 100), m_modStat[Mod::FOOD_RATT_CAP]);
+    int32 ATT = 8 + GetSkill(skill) + bonusSkill + getMod(Mod::RATT) + battleutils::GetRangedAttackBonuses(this) + STR() / 2;
+    return ATT + (ATT * getMod(Mod::RATTP) / 100) +
+        std::min<int16>((ATT * getMod(Mod::FOOD_RATTP) / 100), getMod(Mod::FOOD_RATT_CAP));
 }
 
 uint16 CBattleEntity::RACC(uint8 skill, uint16 bonusSkill)
@@ -679,11 +679,11 @@ uint16 CBattleEntity::ACC(uint8 attackNumber, uint8 offsetAccuracy)
         {
             ACC += (int16)(DEX() * 0.5);
         }
-        ACC = (ACC + m_modStat[Mod::ACC] + offsetAccuracy);
+        ACC = (ACC + getMod(Mod::ACC) + offsetAccuracy);
         auto PChar = dynamic_cast<CCharEntity *>(this);
         if (PChar)
             ACC += PChar->PMeritPoints->GetMeritValue(MERIT_ACCURACY, PChar);
-        ACC = ACC + std::min<int16>((ACC * m_modStat[Mod::FOOD_ACCP] / 100), m_modStat[Mod::FOOD_ACC_CAP]);
+        ACC = ACC + std::min<int16>((ACC * getMod(Mod::FOOD_ACCP) / 100), getMod(Mod::FOOD_ACC_CAP));
         return std::max<int16>(0, ACC);
     }
     else if (this->objtype == TYPE_PET && ((CPetEntity*)this)->getPetType() == PETTYPE_AUTOMATON)
@@ -691,27 +691,27 @@ uint16 CBattleEntity::ACC(uint8 attackNumber, uint8 offsetAccuracy)
         int16 ACC = this->GetSkill(SKILL_AUTOMATON_MELEE);
         ACC = (ACC > 200 ? (int16)(((ACC - 200) * 0.9) + 200) : ACC);
         ACC += (int16)(DEX() * 0.5);
-        ACC += m_modStat[Mod::ACC] + offsetAccuracy;
-        ACC = ACC + std::min<int16>((ACC * m_modStat[Mod::FOOD_ACCP] / 100), m_modStat[Mod::FOOD_ACC_CAP]);
+        ACC += getMod(Mod::ACC) + offsetAccuracy;
+        ACC = ACC + std::min<int16>((ACC * getMod(Mod::FOOD_ACCP) / 100), getMod(Mod::FOOD_ACC_CAP));
         return std::max<int16>(0, ACC);
     }
     else
     {
-        int16 ACC = m_modStat[Mod::ACC];
-        ACC = ACC + std::min<int16>((ACC * m_modStat[Mod::FOOD_ACCP] / 100), m_modStat[Mod::FOOD_ACC_CAP]) + DEX() / 2; //food mods here for Snatch Morsel
+        int16 ACC = getMod(Mod::ACC);
+        ACC = ACC + std::min<int16>((ACC * getMod(Mod::FOOD_ACCP) / 100), getMod(Mod::FOOD_ACC_CAP)) + DEX() / 2; //food mods here for Snatch Morsel
         return std::max<int16>(0, ACC);
     }
 }
 
 uint16 CBattleEntity::DEF()
 {
-    int32 DEF = 8 + m_modStat[Mod::DEF] + VIT() / 2;
+    int32 DEF = 8 + getMod(Mod::DEF) + VIT() / 2;
     if (this->StatusEffectContainer->HasStatusEffect(EFFECT_COUNTERSTANCE, 0)) {
 	return DEF / 2;
     }
 
-    return DEF + (DEF * m_modStat[Mod::DEFP] / 100) +
-        std::min<int16>((DEF * m_modStat[Mod::FOOD_DEFP] / 100), m_modStat[Mod::FOOD_DEF_CAP]);
+    return DEF + (DEF * getMod(Mod::DEFP) / 100) +
+        std::min<int16>((DEF * getMod(Mod::FOOD_DEFP) / 100), getMod(Mod::FOOD_DEF_CAP));
 }
 
 uint16 CBattleEntity::EVA()
@@ -721,7 +721,7 @@ uint16 CBattleEntity::EVA()
     if (evasion > 200) { //Evasion skill is 0.9 evasion post-200
         evasion = (int16)(200 + (evasion - 200) * 0.9);
     }
-    return std::max(0, (m_modStat[Mod::EVA] + evasion + AGI() / 2));
+    return std::max(0, (getMod(Mod::EVA) + evasion + AGI() / 2));
 }
 
 /************************************************************************
@@ -767,9 +767,9 @@ void CBattleEntity::SetSJob(uint8 sjob)
 
 void CBattleEntity::SetMLevel(uint8 mlvl)
 {
-    m_modStat[Mod::DEF] -= m_mlvl + std::clamp(m_mlvl - 50, 0, 10);
+    modStat(Mod::DEF) -= m_mlvl + std::clamp(m_mlvl - 50, 0, 10);
     m_mlvl = (mlvl == 0 ? 1 : mlvl);
-    m_modStat[Mod::DEF] += m_mlvl + std::clamp(m_mlvl - 50, 0, 10);
+    modStat(Mod::DEF) += m_mlvl + std::clamp(m_mlvl - 50, 0, 10);
 
     if (this->objtype & TYPE_PC)
         Sql_Query(SqlHandle, "UPDATE char_stats SET mlvl = %u WHERE charid = %u LIMIT 1;", m_mlvl, this->id);
@@ -819,7 +819,7 @@ void CBattleEntity::SetSLevel(uint8 slvl)
 
 void CBattleEntity::addModifier(Mod type, int16 amount)
 {
-    m_modStat[type] += amount;
+    modStat(type) += amount;
 }
 
 /************************************************************************
@@ -832,7 +832,7 @@ void CBattleEntity::addModifiers(std::vector<CModifier> *modList)
 {
     for (auto modifier : *modList)
     {
-        m_modStat[modifier.getModID()] += modifier.getModAmount();
+        modStat(modifier.getModID()) += modifier.getModAmount();
     }
 }
 
@@ -846,16 +846,16 @@ void CBattleEntity::addEquipModifiers(std::vector<CModifier> *modList, uint8 ite
             {
                 if (modList->at(i).getModID() == Mod::MAIN_DMG_RANK)
                 {
-                    m_modStat[Mod::SUB_DMG_RANK] += modList->at(i).getModAmount();
+                    modStat(Mod::SUB_DMG_RANK) += modList->at(i).getModAmount();
                 }
                 else
                 {
-                    m_modStat[modList->at(i).getModID()] += modList->at(i).getModAmount();
+                    modStat(modList->at(i).getModID()) += modList->at(i).getModAmount();
                 }
             }
             else
             {
-                m_modStat[modList->at(i).getModID()] += modList->at(i).getModAmount();
+                modStat(modList->at(i).getModID()) += modList->at(i).getModAmount();
             }
         }
     }
@@ -901,16 +901,16 @@ void CBattleEntity::addEquipModifiers(std::vector<CModifier> *modList, uint8 ite
             {
                 if (modList->at(i).getModID() == Mod::MAIN_DMG_RANK)
                 {
-                    m_modStat[Mod::SUB_DMG_RANK] += modAmount;
+                    modStat(Mod::SUB_DMG_RANK) += modAmount;
                 }
                 else
                 {
-                    m_modStat[modList->at(i).getModID()] += modAmount;
+                    modStat(modList->at(i).getModID()) += modAmount;
                 }
             }
             else
             {
-                m_modStat[modList->at(i).getModID()] += modAmount;
+                modStat(modList->at(i).getModID()) += modAmount;
             }
         }
     }
@@ -924,7 +924,7 @@ void CBattleEntity::addEquipModifiers(std::vector<CModifier> *modList, uint8 ite
 
 void CBattleEntity::setModifier(Mod type, int16 amount)
 {
-    m_modStat[type] = amount;
+    modStat(type) = amount;
 }
 
 /************************************************************************
@@ -937,7 +937,7 @@ void CBattleEntity::setModifiers(std::vector<CModifier> *modList)
 {
     for (uint16 i = 0; i < modList->size(); ++i)
     {
-        m_modStat[modList->at(i).getModID()] = modList->at(i).getModAmount();
+        modStat(modList->at(i).getModID()) = modList->at(i).getModAmount();
     }
 }
 
@@ -949,17 +949,45 @@ void CBattleEntity::setModifiers(std::vector<CModifier> *modList)
 
 void CBattleEntity::delModifier(Mod type, int16 amount)
 {
-    m_modStat[type] -= amount;
+    modStat(type) -= amount;
 }
 
 void CBattleEntity::saveModifiers()
 {
-    m_modStatSave = m_modStat;
+    m_modStatDirty.reset();
+    m_modStatSave.clear();
+    m_modStatSaved = true;
 }
 
 void CBattleEntity::restoreModifiers()
 {
-    m_modStat = m_modStatSave;
+    if (!m_modStatSaved)
+    {
+        m_modStat.fill(0);
+        return;
+    }
+    for (auto& saved : m_modStatSave)
+    {
+        m_modStat[static_cast<size_t>(saved.first)] = saved.second;
+    }
+    m_modStatDirty.reset();
+    m_modStatSave.clear();
+}
+
+int16& CBattleEntity::modStat(Mod type)
+{
+    auto index = static_cast<size_t>(type);
+    if (index >= MAX_MODIFIER)
+    {
+        ShowWarning("CBattleEntity::modStat: modifier %u is out of range\n", static_cast<uint32>(index));
+        index = static_cast<size_t>(Mod::NONE);
+    }
+    if (m_modStatSaved && !m_modStatDirty.test(index))
+    {
+        m_modStatDirty.set(index);
+        m_modStatSave.emplace_back(static_cast<Mod>(index), m_modStat[index]);
+    }
+    return m_modStat[index];
 }
 
 /************************************************************************
@@ -972,7 +1000,7 @@ void CBattleEntity::delModifiers(std::vector<CModifier> *modList)
 {
     for (uint16 i = 0; i < modList->size(); ++i)
     {
-        m_modStat[modList->at(i).getModID()] -= modList->at(i).getModAmount();
+        modStat(modList->at(i).getModID()) -= modList->at(i).getModAmount();
     }
 }
 
@@ -986,16 +1014,16 @@ void CBattleEntity::delEquipModifiers(std::vector<CModifier> *modList, uint8 ite
             {
                 if (modList->at(i).getModID() == Mod::MAIN_DMG_RANK)
                 {
-                    m_modStat[Mod::SUB_DMG_RANK] -= modList->at(i).getModAmount();
+                    modStat(Mod::SUB_DMG_RANK) -= modList->at(i).getModAmount();
                 }
                 else
                 {
-                    m_modStat[modList->at(i).getModID()] -= modList->at(i).getModAmount();
+                    modStat(modList->at(i).getModID()) -= modList->at(i).getModAmount();
                 }
             }
             else
             {
-                m_modStat[modList->at(i).getModID()] -= modList->at(i).getModAmount();
+                modStat(modList->at(i).getModID()) -= modList->at(i).getModAmount();
             }
         }
     }
@@ -1041,16 +1069,16 @@ void CBattleEntity::delEquipModifiers(std::vector<CModifier> *modList, uint8 ite
             {
                 if (modList->at(i).getModID() == Mod::MAIN_DMG_RANK)
                 {
-                    m_modStat[Mod::SUB_DMG_RANK] -= modAmount;
+                    modStat(Mod::SUB_DMG_RANK) -= modAmount;
                 }
                 else
                 {
-                    m_modStat[modList->at(i).getModID()] -= modAmount;
+                    modStat(modList->at(i).getModID()) -= modAmount;
                 }
             }
             else
             {
-                m_modStat[modList->at(i).getModID()] -= modAmount;
+                modStat(modList->at(i).getModID()) -= modAmount;
             }
         }
     }
@@ -1064,7 +1092,8 @@ void CBattleEntity::delEquipModifiers(std::vector<CModifier> *modList, uint8 ite
 
 int16 CBattleEntity::getMod(Mod modID)
 {
-    return m_modStat[modID];
+    auto index = static_cast<size_t>(modID);
+    return index < MAX_MODIFIER ? m_modStat[index] : 0;
 }
 
 void CBattleEntity::addPetModifier(Mod type, PetModType petmod, int16 amount)
@@ -22,6 +22,8 @@
 #ifndef _BATTLEENTITY_H
 #define _BATTLEENTITY_H
 
+#include <array>
+#include <bitset>
 #include <vector>
 #include <unordered_map>
 
@@ -682,8 +684,12 @@ private:
     uint16      m_battleTarget {0};
     time_point  m_battleStartTime;
 
-    std::unordered_map<Mod, int16, EnumClassHash>		m_modStat;	// массив модификаторов
-    std::unordered_map<Mod, int16, EnumClassHash>		m_modStatSave;	// saved state
+    std::array<int16, MAX_MODIFIER>             m_modStat {};       // массив модификаторов
+    std::bitset<MAX_MODIFIER>                   m_modStatDirty;     // modifiers changed since saveModifiers
+    std::vector<std::pair<Mod, int16>>          m_modStatSave;      // their values at saveModifiers
+    bool                                        m_modStatSaved {false};
+
+    int16&      modStat(Mod type);      // writable modifier slot, remembers the saved value on first change
     std::unordered_map<PetModType, std::unordered_map<Mod, int16, EnumClassHash>, EnumClassHash> m_petMod;
 };
 
@@ -76,6 +76,7 @@
 #include "../packets/char_job_extra.h"
 #include "../packets/status_effects.h"
 #include "../mobskill.h"
+#include "../map.h"
 
 
 CCharEntity::CCharEntity()
@@ -239,40 +240,42 @@ uint8 CCharEntity::GetGender()
 
 bool CCharEntity::isPacketListEmpty()
 {
+    std::lock_guard<std::mutex> lk(m_PacketListMutex);
     return PacketList.empty();
 }
 
 void CCharEntity::clearPacketList()
 {
-    while (!PacketList.empty())
-    {
-        delete popPacket();
-    }
+    std::lock_guard<std::mutex> lk(m_PacketListMutex);
+    PacketList.clear();
 }
 
 void CCharEntity::pushPacket(CBasicPacket* packet)
 {
-    std::lock_guard<std::mutex> lk(m_PacketListMutex);
-    PacketList.push_back(packet);
+    pushPacket(std::shared_ptr<CBasicPacket>(packet));
 }
 
 void CCharEntity::pushPacket(std::unique_ptr<CBasicPacket> packet)
 {
-    pushPacket(packet.release());
+    pushPacket(std::shared_ptr<CBasicPacket>(std::move(packet)));
+}
+
+void CCharEntity::pushPacket(std::shared_ptr<CBasicPacket> packet)
+{
+    std::lock_guard<std::mutex> lk(m_PacketListMutex);
+    PacketList.push(std::move(packet), map_config.packet_queue_limit);
 }
 
-CBasicPacket* CCharEntity::popPacket()
+std::shared_ptr<CBasicPacket> CCharEntity::popPacket()
 {
     std::lock_guard<std::mutex> lk(m_PacketListMutex);
-    CBasicPacket* PPacket = PacketList.front();
-    PacketList.pop_front();
-    return PPacket;
+    return PacketList.pop();
 }
 
-PacketList_t CCharEntity::getPacketList()
+void CCharEntity::TakePackets(std::function<bool(CBasicPacket*)> func)
 {
     std::lock_guard<std::mutex> lk(m_PacketListMutex);
-    return PacketList;
+    PacketList.Take(func);
 }
 
 size_t CCharEntity::getPacketCount()
@@ -283,10 +286,14 @@ size_t CCharEntity::getPacketCount()
 
 void CCharEntity::erasePackets(uint8 num)
 {
-    for (auto i = 0; i < num; i++)
-    {
-        delete popPacket();
-    }
+    std::lock_guard<std::mutex> lk(m_PacketListMutex);
+    PacketList.erase(num);
+}
+
+packet_queue_stats_t CCharEntity::getPacketQueueStats()
+{
+    std::lock_guard<std::mutex> lk(m_PacketListMutex);
+    return PacketList.stats();
 }
 
 bool CCharEntity::isNewPlayer()
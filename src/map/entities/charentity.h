@@ -26,12 +26,17 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 #include "../../common/mmo.h"
 
 #include <map>
+#include <unordered_map>
 #include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <bitset>
 
 #include "battleentity.h"
 #include "petentity.h"
+#include "../spawn_list.h"
+#include "../packet_queue.h"
 
 #define MAX_QUESTAREA	 11
 #define MAX_QUESTID     256
@@ -162,8 +167,7 @@ class CRangeState;
 class CItemState;
 class CItemUsable;
 
-typedef std::deque<CBasicPacket*> PacketList_t;
-typedef std::map<uint32, CBaseEntity*> SpawnIDList_t;
+typedef CSpawnList SpawnIDList_t;
 typedef std::vector<EntityID_t> BazaarList_t;
 
 class CCharEntity : public CBattleEntity
@@ -228,17 +232,20 @@ public:
 
     //currency_t        m_currency;                 // conquest points, imperial standing points etc
     Teleport_t	      teleport;					    // Outposts, Runic Portals, Homepoints, Survival Guides, Maws, etc
+    std::unordered_map<std::string, int32> m_charVars; // char_vars of this character, loaded in LoadChar (use charutils::GetCharVar/SetCharVar)
 
     uint8             GetGender();                  // узнаем пол персонажа
 
     void              clearPacketList();            // отчистка PacketList
     void              pushPacket(CBasicPacket*);    // добавление копии пакета в PacketList
     void              pushPacket(std::unique_ptr<CBasicPacket>);    // push packet to packet list
+    void              pushPacket(std::shared_ptr<CBasicPacket>);    // push a packet shared with other recipients (must not be modified afterwards)
     bool			  isPacketListEmpty();          // проверка размера PacketList
-    CBasicPacket*	  popPacket();                  // получение первого пакета из PacketList
-    PacketList_t      getPacketList();              // returns a COPY of packet list
+    std::shared_ptr<CBasicPacket> popPacket();      // получение первого пакета из PacketList
+    void              TakePackets(std::function<bool(CBasicPacket*)> func);   // pop queued packets in order while func accepts them
     size_t            getPacketCount();
     void              erasePackets(uint8 num);      // erase num elements from front of packet list
+    packet_queue_stats_t getPacketQueueStats();     // pushed/coalesced/dropped counters of PacketList
     virtual void      HandleErrorMessage(std::unique_ptr<CBasicPacket>&) override;
 
     CLinkshell*       PLinkshell1;                  // linkshell, в которой общается персонаж
@@ -398,7 +405,7 @@ private:
     bool            m_isBlockingAid;
     bool			m_reloadParty;
 
-    PacketList_t      PacketList;					// the list of packets to be sent to the character during the next network cycle
+    CPacketQueue      PacketList;					// the list of packets to be sent to the character during the next network cycle
 
     std::mutex      m_PacketListMutex;
 };
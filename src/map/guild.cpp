@@ -103,7 +103,7 @@ uint8 CGuild::addGuildPoints(CCharEntity* PChar, CItem* PItem, int16& pointsAdde
                     }
                     charutils::AddPoints(PChar, pointsName.c_str(), points);
                     pointsAdded = points;
-                    Sql_Query(SqlHandle, "REPLACE INTO char_vars VALUES (%d, '[GUILD]daily_points', %u);", PChar->id, curPoints + points);
+                    charutils::SetCharVar(PChar, "[GUILD]daily_points", curPoints + points);
                     return quantity;
                 }
             }
@@ -22,11 +22,7 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 #ifndef _CINSTANCELOADER_H
 #define _CINSTANCELOADER_H
 
-#include <future>
-
 #include "../common/cbasetypes.h"
-#include "../common/socket.h"
-#include "../common/sql.h"
 
 class CCharEntity;
 class CInstance;
@@ -36,17 +32,15 @@ class CInstanceLoader
 {
 public:
     CInstanceLoader(uint8 instanceid, CZone* PZone, CCharEntity* PRequester);
-    ~CInstanceLoader();
 
     CInstance* GetInstance();
     bool Check();
 private:
     CZone* zone;
     CCharEntity* requester;
-    Sql_t* SqlInstanceHandle;
-    std::future<CInstance*> task;
+    CInstance* instance;
 
-    CInstance* LoadInstance(CInstance* instance);
+    CInstance* LoadInstance(CInstance* PInstance);
 
 };
 
@@ -346,28 +346,38 @@ void CLinkshell::BreakLinkshell(int8* lsname, bool gm)
 
 void CLinkshell::PushPacket(uint32 senderID, CBasicPacket* packet)
 {
+    // members holding this linkshell in their second slot get a single shared copy with the LS2 flags set
+    std::shared_ptr<CBasicPacket> sharedPacket(packet);
+    std::shared_ptr<CBasicPacket> sharedPacket2;
+
     for (uint32 i = 0; i < members.size(); ++i)
 	{
         if (members.at(i)->id != senderID &&
             members.at(i)->status != STATUS_DISAPPEAR &&
             !jailutils::InPrison(members.at(i)))
 		{
-            CBasicPacket* newPacket = new CBasicPacket(*packet);
             if (members.at(i)->PLinkshell2 == this)
             {
-                if (newPacket->id() == CChatMessagePacket::id)
-                {
-                    newPacket->ref<uint8>(0x04) = MESSAGE_LINKSHELL2;
-                }
-                else if (newPacket->id() == CLinkshellMessagePacket::id)
+                if (!sharedPacket2)
                 {
-                    newPacket->ref<uint8>(0x05) |= 0x40;
+                    sharedPacket2 = std::make_shared<CBasicPacket>(*packet);
+                    if (sharedPacket2->id() == CChatMessagePacket::id)
+                    {
+                        sharedPacket2->ref<uint8>(0x04) = MESSAGE_LINKSHELL2;
+                    }
+                    else if (sharedPacket2->id() == CLinkshellMessagePacket::id)
+                    {
+                        sharedPacket2->ref<uint8>(0x05) |= 0x40;
+                    }
                 }
+                members.at(i)->pushPacket(sharedPacket2);
+            }
+            else
+            {
+                members.at(i)->pushPacket(sharedPacket);
             }
-            members.at(i)->pushPacket(newPacket);
 		}
 	}
-    delete packet;
 }
 
 void CLinkshell::PushLinkshellMessage(CCharEntity* PChar, bool ls1)
@@ -566,16 +566,13 @@ inline int32 CLuaBaseEntity::setCharVar(lua_State *L)
     const char* varname = lua_tostring(L, -2);
     int32 value = (int32)lua_tointeger(L, -1);
 
+    charutils::SetCharVar((CCharEntity*)m_PBaseEntity, varname, value);
+
     if (value == 0)
     {
-        Sql_Query(SqlHandle, "DELETE FROM char_vars WHERE charid = %u AND varname = '%s' LIMIT 1;", m_PBaseEntity->id, varname);
         return 0;
     }
 
-    const char* fmtQuery = "INSERT INTO char_vars SET charid = %u, varname = '%s', value = %i ON DUPLICATE KEY UPDATE value = %i;";
-
-    Sql_Query(SqlHandle, fmtQuery, m_PBaseEntity->id, varname, value, value);
-
     lua_pushnil(L);
     return 1;
 }
@@ -598,13 +595,8 @@ inline int32 CLuaBaseEntity::addCharVar(lua_State *L)
     const char* varname = lua_tostring(L, -2);
     int32 value = (int32)lua_tointeger(L, -1);
 
-    const char* Query = "INSERT INTO char_vars SET charid = %u, varname = '%s', value = %i ON DUPLICATE KEY UPDATE value = value + %i;";
-
-    Sql_Query(SqlHandle, Query,
-        m_PBaseEntity->id,
-        varname,
-        value,
-        value);
+    CCharEntity* PChar = (CCharEntity*)m_PBaseEntity;
+    charutils::SetCharVar(PChar, varname, charutils::GetCharVar(PChar, varname) + value);
 
     return 0;
 }
@@ -718,9 +710,7 @@ inline int32 CLuaBaseEntity::setMaskBit(lua_State *L)
         value &= ~(1 << bit); // Delete
     }
 
-    const char* fmtQuery = "INSERT INTO char_vars SET charid = %u, varname = '%s', value = %i ON DUPLICATE KEY UPDATE value = %i;";
-
-    Sql_Query(SqlHandle, fmtQuery, m_PBaseEntity->id, varname, value, value);
+    charutils::SetCharVar((CCharEntity*)m_PBaseEntity, varname, value);
 
     lua_pushinteger(L, value);
     return 1;
@@ -9896,9 +9886,9 @@ inline int32 CLuaBaseEntity::getNearbyEntities(lua_State* L)
     lua_newtable(L);
     int newTable = lua_gettop(L);
 
-    for (auto&& list : {iterTarget->SpawnMOBList, iterTarget->SpawnPCList, iterTarget->SpawnPETList})
+    for (auto&& list : {&iterTarget->SpawnMOBList, &iterTarget->SpawnPCList, &iterTarget->SpawnPETList})
     {
-        for (auto&& entity : list)
+        for (auto&& entity : *list)
         {
             lua_getglobal(L, CLuaBaseEntity::className);
             lua_pushstring(L, "new");
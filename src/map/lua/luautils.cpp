@@ -23,6 +23,7 @@
 #include "../../common/timer.h"
 #include "../../common/utils.h"
 
+#include <sys/stat.h>
 #include <unordered_map>
 
 #include "luautils.h"
@@ -62,6 +63,8 @@
 #include "../entities/automatonentity.h"
 #include "../utils/itemutils.h"
 #include "../utils/charutils.h"
+#include "../utils/serverutils.h"
+#include "../utils/synthutils.h"
 #include "../conquest_system.h"
 #include "../weapon_skill.h"
 #include "../status_effect_container.h"
@@ -80,16 +83,28 @@
 #include "../ai/states/magic_state.h"
 #include <optional>
 #include "../battlefield.h"
+#include "../write_behind.h"
 
 namespace luautils
 {
 #define lua_prepscript(n,...) int8 File[255]; \
                               snprintf((char*)File, sizeof(File), n, ##__VA_ARGS__);
     lua_State*  LuaHandle = nullptr;
+    std::recursive_mutex LuaMutex;
 
     bool contentRestrictionEnabled;
     std::unordered_map<std::string, bool> contentEnabledMap;
 
+    struct lua_chunk_t
+    {
+        int        ref;         // registry reference of the compiled chunk, LUA_NOREF if the file does not exist
+        time_t     mtime;       // modification time of the file the chunk was compiled from
+        time_point checked;     // last time mtime was compared against the file on disk
+    };
+
+    std::unordered_map<std::string, lua_chunk_t> chunkCache;
+    constexpr auto chunkCheckInterval = 5s;
+
     /************************************************************************
     *                                                                       *
     *  Инициализация lua, пользовательских классов и глобальных функций     *
@@ -139,6 +154,9 @@ namespace luautils
         lua_register(LuaHandle, "clearVarFromAll", luautils::clearVarFromAll);
         lua_register(LuaHandle, "SendEntityVisualPacket", luautils::SendEntityVisualPacket);
         lua_register(LuaHandle, "UpdateServerMessage", luautils::UpdateServerMessage);
+        lua_register(LuaHandle, "ClearScriptCache", luautils::ClearScriptCache);
+        lua_register(LuaHandle, "GetWriteBehindStats", luautils::GetWriteBehindStats);
+        lua_register(LuaHandle, "ReloadSynthRecipes", luautils::ReloadSynthRecipes);
         lua_register(LuaHandle, "GetMobRespawnTime", luautils::GetMobRespawnTime);
         lua_register(LuaHandle, "DisallowRespawn", luautils::DisallowRespawn);
         lua_register(LuaHandle, "UpdateNMSpawnPoint", luautils::UpdateNMSpawnPoint);
@@ -189,6 +207,7 @@ namespace luautils
         if(LuaHandle)
         {
             ShowStatus(CL_WHITE"luautils::free" CL_RESET":lua free...");
+            clearChunkCache();
             lua_close(LuaHandle);
             LuaHandle = nullptr;
             ShowMessage("\t - " CL_GREEN"[OK]" CL_RESET"\n");
@@ -241,12 +260,149 @@ namespace luautils
         return 0;
     }
 
+    /************************************************************************
+    *                                                                       *
+    *  Drop-in replacement of luaL_loadfile for hook scripts. Compiled      *
+    *  chunks are kept in the registry and reused until the file changes,  *
+    *  so hot hooks neither read nor parse the script again. Missing files  *
+    *  are remembered too. Disk is checked once per chunkCheckInterval.     *
+    *                                                                       *
+    ************************************************************************/
+
+    int32 loadChunk(const char* File)
+    {
+        if (!map_config.lua_chunk_cache)
+        {
+            return luaL_loadfile(LuaHandle, File);
+        }
+
+        time_point now = server_clock::now();
+        auto it = chunkCache.find(File);
+
+        if (it == chunkCache.end() || now - it->second.checked >= chunkCheckInterval)
+        {
+            struct stat fileStat;
+            time_t mtime = stat(File, &fileStat) == 0 ? fileStat.st_mtime : 0;
+
+            if (it != chunkCache.end() && it->second.mtime == mtime)
+            {
+                it->second.checked = now;
+            }
+            else
+            {
+                if (it != chunkCache.end())
+                {
+                    luaL_unref(LuaHandle, LUA_REGISTRYINDEX, it->second.ref);
+                    chunkCache.erase(it);
+                }
+
+                auto ret = luaL_loadfile(LuaHandle, File);
+                if (ret != 0 && ret != LUA_ERRFILE)
+                {
+                    // syntax errors are not cached, the script is read again once fixed
+                    return ret;
+                }
+
+                int ref = LUA_NOREF;
+                if (ret == 0)
+                {
+                    lua_pushvalue(LuaHandle, -1);
+                    ref = luaL_ref(LuaHandle, LUA_REGISTRYINDEX);
+                }
+                chunkCache[File] = { ref, mtime, now };
+                return ret;
+            }
+        }
+
+        if (it->second.ref == LUA_NOREF)
+        {
+            lua_pushfstring(LuaHandle, "cannot open %s", File);
+            return LUA_ERRFILE;
+        }
+        lua_rawgeti(LuaHandle, LUA_REGISTRYINDEX, it->second.ref);
+        return 0;
+    }
+
+    void clearChunkCache()
+    {
+        for (auto& chunk : chunkCache)
+        {
+            luaL_unref(LuaHandle, LUA_REGISTRYINDEX, chunk.second.ref);
+        }
+        chunkCache.clear();
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Forget every cached script, they are read from disk on next use      *
+    *                                                                       *
+    ************************************************************************/
+
+    int32 ClearScriptCache(lua_State* L)
+    {
+        lua_pushinteger(L, (lua_Integer)chunkCache.size());
+        clearChunkCache();
+        return 1;
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Reads synth_recipes again, used after editing recipes in the DB      *
+    *                                                                       *
+    ************************************************************************/
+
+    int32 ReloadSynthRecipes(lua_State* L)
+    {
+        lua_pushinteger(L, synthutils::LoadSynthRecipes());
+        return 1;
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Queue depth and flush latency of the character save DB thread        *
+    *                                                                       *
+    ************************************************************************/
+
+    int32 GetWriteBehindStats(lua_State* L)
+    {
+        writebehind_stats_t stats = writebehind::GetStats();
+
+        lua_createtable(L, 0, 8);
+        int8 newTable = lua_gettop(L);
+
+        lua_pushboolean(L, writebehind::enabled());
+        lua_setfield(L, newTable, "enabled");
+
+        lua_pushinteger(L, (lua_Integer)stats.depth);
+        lua_setfield(L, newTable, "depth");
+
+        lua_pushinteger(L, (lua_Integer)stats.queued);
+        lua_setfield(L, newTable, "queued");
+
+        lua_pushinteger(L, (lua_Integer)stats.coalesced);
+        lua_setfield(L, newTable, "coalesced");
+
+        lua_pushinteger(L, (lua_Integer)stats.batches);
+        lua_setfield(L, newTable, "batches");
+
+        lua_pushinteger(L, stats.lastLatency);
+        lua_setfield(L, newTable, "lastLatency");
+
+        lua_pushinteger(L, stats.maxLatency);
+        lua_setfield(L, newTable, "maxLatency");
+
+        lua_pushinteger(L, stats.avgLatency);
+        lua_setfield(L, newTable, "avgLatency");
+
+        return 1;
+    }
+
     int32 prepFile(int8* File, const char* function)
     {
         lua_pushnil(LuaHandle);
         lua_setglobal(LuaHandle, function);
 
-        auto ret = luaL_loadfile(LuaHandle, (const char*)File);
+        auto ret = loadChunk((const char*)File);
         if (ret)
         {
             if (ret != LUA_ERRFILE)
@@ -527,7 +683,7 @@ namespace luautils
 
         snprintf(File, sizeof(File), "scripts/globals/conquest.lua");
 
-        if (luaL_loadfile(LuaHandle, File) || lua_pcall(LuaHandle, 0, 0, 0))
+        if (loadChunk(File) || lua_pcall(LuaHandle, 0, 0, 0))
         {
             ShowError("luautils::SetRegionalConquestOverseers: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1170,6 +1326,8 @@ namespace luautils
 
     uint8 GetSettingsVariable(const char* variable)
     {
+        std::lock_guard<std::recursive_mutex> lk(LuaMutex);
+
         lua_pushnil(LuaHandle);
         lua_setglobal(LuaHandle, variable);
 
@@ -1177,7 +1335,7 @@ namespace luautils
         memset(File, 0, sizeof(File));
         snprintf(File, sizeof(File), "scripts/globals/settings.lua");
 
-        if (luaL_loadfile(LuaHandle, File) || lua_pcall(LuaHandle, 0, 0, 0))
+        if (loadChunk(File) || lua_pcall(LuaHandle, 0, 0, 0))
         {
             lua_pop(LuaHandle, 1);
             return 0;
@@ -1208,6 +1366,8 @@ namespace luautils
     {
         if (contentTag != nullptr)
         {
+            std::lock_guard<std::recursive_mutex> lk(LuaMutex);
+
             std::string contentVariable("ENABLE_");
             contentVariable.append(contentTag);
 
@@ -1453,7 +1613,7 @@ namespace luautils
         lua_pushnil(LuaHandle);
         lua_setglobal(LuaHandle, "onTrigger");
 
-        auto ret = luaL_loadfile(LuaHandle, (const char*)File);
+        auto ret = loadChunk((const char*)File);
         if (ret)
         {
             ShowWarning("luautils::%s: %s\n", "onTrigger", lua_tostring(LuaHandle, -1));
@@ -2319,7 +2479,7 @@ namespace luautils
 
             //remove any previous definition of the global "mixins"
 
-            auto ret = luaL_loadfile(LuaHandle, (const char*)File);
+            auto ret = loadChunk((const char*)File);
             if (ret)
             {
                 lua_pop(LuaHandle, 1);
@@ -2385,7 +2545,7 @@ namespace luautils
 
                     //remove any previous definition of the global "mixins"
 
-                    auto ret = luaL_loadfile(LuaHandle, (const char*)File);
+                    auto ret = loadChunk((const char*)File);
                     if (ret)
                     {
                         lua_pop(LuaHandle, 1);
@@ -2439,7 +2599,7 @@ namespace luautils
 
                 //remove any previous definition of the global "mixins"
 
-                auto ret = luaL_loadfile(LuaHandle, (const char*)File);
+                auto ret = loadChunk((const char*)File);
                 if (ret)
                 {
                     lua_pop(LuaHandle, 1);
@@ -2852,7 +3012,7 @@ namespace luautils
                     PMember->m_event.Target = PMob;
                     PMember->m_event.Script.insert(0, (const char*)File);
 
-                    if (luaL_loadfile(LuaHandle, (const char*)File) || lua_pcall(LuaHandle, 0, 0, 0))
+                    if (loadChunk((const char*)File) || lua_pcall(LuaHandle, 0, 0, 0))
                     {
                         lua_pop(LuaHandle, 1);
                         return;
@@ -2899,7 +3059,7 @@ namespace luautils
 
             CLuaBaseEntity LuaMobEntity(PMob);
 
-            if (luaL_loadfile(LuaHandle, (const char*)File) || lua_pcall(LuaHandle, 0, 0, 0))
+            if (loadChunk((const char*)File) || lua_pcall(LuaHandle, 0, 0, 0))
             {
                 lua_pop(LuaHandle, 1);
                 return -1;
@@ -3386,7 +3546,7 @@ namespace luautils
         lua_pushnil(LuaHandle);
         lua_setglobal(LuaHandle, "onAbilityCheck");
 
-        auto ret = luaL_loadfile(LuaHandle, (const char*)File);
+        auto ret = loadChunk((const char*)File);
         if (ret)
         {
             if (ret != LUA_ERRFILE)
@@ -3541,7 +3701,7 @@ namespace luautils
 
         const char* varname = lua_tostring(L, -1);
 
-        Sql_Query(SqlHandle, "DELETE FROM char_vars WHERE varname = '%s';", varname);
+        charutils::ClearCharVarFromAll(varname);
 
         return 0;
     }
@@ -3696,12 +3856,12 @@ namespace luautils
         lua_setglobal(LuaHandle, "onInstanceCreated");
 
         int8 File[255];
-        if (luaL_loadfile(LuaHandle, PChar->m_event.Script.c_str()) || lua_pcall(LuaHandle, 0, 0, 0))
+        if (loadChunk(PChar->m_event.Script.c_str()) || lua_pcall(LuaHandle, 0, 0, 0))
         {
             memset(File, 0, sizeof(File));
             snprintf((char*)File, sizeof(File), "scripts/zones/%s/Zone.lua", PChar->loc.zone->GetName());
 
-            if (luaL_loadfile(LuaHandle, (const char*)File) || lua_pcall(LuaHandle, 0, 0, 0))
+            if (loadChunk((const char*)File) || lua_pcall(LuaHandle, 0, 0, 0))
             {
                 ShowError("luautils::onInstanceCreated %s\n", lua_tostring(LuaHandle, -1));
                 lua_pop(LuaHandle, 1);
@@ -3867,17 +4027,7 @@ namespace luautils
     {
         TPZ_DEBUG_BREAK_IF(lua_isnil(L, -1) || !lua_isstring(L, -1));
 
-        int32 value = 0;
-
-        int32 ret = Sql_Query(SqlHandle, "SELECT value FROM server_variables WHERE name = '%s' LIMIT 1;", lua_tostring(L, -1));
-
-        if (ret != SQL_ERROR &&
-            Sql_NumRows(SqlHandle) != 0 &&
-            Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-        {
-            value = (int32)Sql_GetIntData(SqlHandle, 0);
-        }
-        lua_pushinteger(L, value);
+        lua_pushinteger(L, serverutils::GetServerVar(lua_tostring(L, -1)));
         return 1;
     }
 
@@ -3895,12 +4045,7 @@ namespace luautils
         const char* name = lua_tostring(L, -2);
         int32 value = (int32)lua_tointeger(L, -1);
 
-        if (value == 0)
-        {
-            Sql_Query(SqlHandle, "DELETE FROM server_variables WHERE name = '%s' LIMIT 1;", name);
-            return 0;
-        }
-        Sql_Query(SqlHandle, "INSERT INTO server_variables VALUES ('%s', %i) ON DUPLICATE KEY UPDATE value = %i;", name, value, value);
+        serverutils::SetServerVar(name, value);
 
         return 0;
     }
@@ -4436,7 +4581,7 @@ namespace luautils
     {
         auto searchLuaFileForFunction = [&functionName](std::string filename)
         {
-            if (!(luaL_loadfile(LuaHandle, filename.c_str()) || lua_pcall(LuaHandle, 0, 0, 0)))
+            if (!(loadChunk(filename.c_str()) || lua_pcall(LuaHandle, 0, 0, 0)))
             {
                 lua_getglobal(LuaHandle, functionName);
                 if (!(lua_isnil(LuaHandle, -1)))
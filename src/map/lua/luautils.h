@@ -22,6 +22,7 @@
 #ifndef _LUAUTILS_H
 #define _LUAUTILS_H
 
+#include <mutex>
 #include <optional>
 #include "../../common/cbasetypes.h"
 #include "../../common/lua/lunar.h"
@@ -75,6 +76,7 @@ enum ConquestUpdate : uint8;
 namespace luautils
 {
     extern struct lua_State* LuaHandle;
+    extern std::recursive_mutex LuaMutex;   // taken by settings lookups and startup stages that may run next to loader threads
 
     int32 init();
     int32 free();
@@ -82,6 +84,8 @@ namespace luautils
     int register_fp(int index);
     void unregister_fp(int);
     int32 print(lua_State*);
+    int32 loadChunk(const char* File);                                          // luaL_loadfile through the compiled chunk cache
+    void  clearChunkCache();
     int32 prepFile(int8*, const char*);
 
     template<class T, class L>
@@ -271,6 +275,9 @@ namespace luautils
     int32 UpdateNMSpawnPoint(lua_State* L);                                     // Update the spawn point of an NM
     int32 SetDropRate(lua_State*);                                              // Set drop rate of a mob setDropRate(dropid,itemid,newrate)
     int32 UpdateServerMessage(lua_State*);                                      // update server message, first modify in conf and update
+    int32 ClearScriptCache(lua_State*);                                         // drop all compiled scripts, returns number of dropped entries
+    int32 GetWriteBehindStats(lua_State*);                                      // queue depth and flush latency of asynchronous character saves
+    int32 ReloadSynthRecipes(lua_State*);                                       // rebuild the synth recipe index from the database, returns the recipe count or -1
 
     int32 OnAdditionalEffect(CBattleEntity* PAttacker, CBattleEntity* PDefender, CItemWeapon* PItem, actionTarget_t* Action, uint32 damage); // for items with additional effects
     int32 OnSpikesDamage(CBattleEntity* PDefender, CBattleEntity* PAttacker, actionTarget_t* Action, uint32 damage);                         // for mobs with spikes
@@ -35,6 +35,7 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 
 #include "alliance.h"
 #include "ability.h"
+#include "utils/auctionutils.h"
 #include "utils/battleutils.h"
 #include "utils/charutils.h"
 #include "utils/fishingutils.h"
@@ -47,11 +48,13 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 #include "packet_system.h"
 #include "party.h"
 #include "utils/petutils.h"
+#include "utils/synthutils.h"
 #include "spell.h"
 #include "time_server.h"
 #include "transport.h"
 #include "vana_time.h"
 #include "status_effect_container.h"
+#include "startup_loader.h"
 #include "utils/zoneutils.h"
 #include "conquest_system.h"
 #include "utils/mobutils.h"
@@ -62,6 +65,7 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 #include "packets/basic.h"
 #include "packets/char_update.h"
 #include "message.h"
+#include "write_behind.h"
 
 
 const char* MAP_CONF_FILENAME = nullptr;
@@ -69,6 +73,12 @@ const char* MAP_CONF_FILENAME = nullptr;
 int8*  g_PBuff = nullptr;                // глобальный буфер обмена пакетами
 int8*  PTempBuff = nullptr;                // временный  буфер обмена пакетами
 
+udp_datagram_t      g_RecvBatch[UDP_BATCH_MAX];         // batched socket mode: receive slots, each owns a buffer
+udp_datagram_t      g_SendBatch[UDP_BATCH_MAX];         // batched socket mode: replies waiting for the flush
+map_session_data_t* g_SendBatchSession[UDP_BATCH_MAX];  // batched socket mode: owner of each pending reply
+bool                g_SendBatchUnsealed[UDP_BATCH_MAX]; // batched socket mode: reply still needs map_seal_packets
+size_t              g_SendBatchCount = 0;
+
 thread_local Sql_t* SqlHandle = nullptr;
 
 int32  map_fd = 0;                      // main socket
@@ -146,6 +156,7 @@ int32 do_init(int32 argc, char** argv)
 {
     ShowStatus("do_init: begin server initialization...");
     map_ip.s_addr = 0;
+    uint32 zoneTickBench = 0;
 
     for (int i = 1; i < argc; i++)
     {
@@ -157,6 +168,8 @@ int32 do_init(int32 argc, char** argv)
         }
         else if (strcmp(argv[i], "--port") == 0)
             map_port = std::stoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--zone-tick-bench") == 0)
+            zoneTickBench = std::stoi(argv[i + 1]);
     }
 
     MAP_CONF_FILENAME = "./conf/map.conf";
@@ -196,38 +209,49 @@ int32 do_init(int32 argc, char** argv)
     ShowMessage("\t\t\t - " CL_GREEN"[OK]" CL_RESET"\n");
 
     messageThread = std::thread(message::init, map_config.msg_server_ip.c_str(), map_config.msg_server_port);
-
-    ShowStatus("do_init: loading items");
-    itemutils::Initialize();
-    ShowMessage("\t\t\t - " CL_GREEN"[OK]" CL_RESET"\n");
-
-    // нужно будет написать один метод для инициализации всех данных в battleutils
-    // и один метод для освобождения этих данных
-
-    ShowStatus("do_init: loading spells");
-    spell::LoadSpellList();
-    mobSpellList::LoadMobSpellList();
-    autoSpell::LoadAutomatonSpellList();
-    ShowMessage("\t\t\t - " CL_GREEN"[OK]" CL_RESET"\n");
-
-    guildutils::Initialize();
-    charutils::LoadExpTable();
-    traits::LoadTraitsList();
-    effects::LoadEffectsParameters();
-    battleutils::LoadSkillTable();
-    meritNameSpace::LoadMeritsList();
-    ability::LoadAbilitiesList();
-    battleutils::LoadWeaponSkillsList();
-    battleutils::LoadMobSkillsList();
-    battleutils::LoadSkillChainDamageModifiers();
-    petutils::LoadPetList();
-    mobutils::LoadCustomMods();
-
-    ShowStatus("do_init: loading zones");
-    zoneutils::LoadZoneList();
-    ShowMessage("\t\t\t - " CL_GREEN"[OK]" CL_RESET"\n");
-
-    fishingutils::LoadFishingMessages();
+    writebehind::init();
+
+    // worker stages only read the database; serial stages run Lua or add tasks and stay on this thread
+    ShowStatus("do_init: loading game data\n");
+    CStartupLoader loader(map_config.startup_threads);
+
+    loader.AddStage("items", {}, itemutils::Initialize);
+    loader.AddStage("spells", {}, spell::LoadSpellList);
+    loader.AddStage("mob_spell_lists", {}, mobSpellList::LoadMobSpellList);
+    loader.AddStage("automaton_spells", {}, autoSpell::LoadAutomatonSpellList);
+    loader.AddStage("synth_recipes", {}, [] { synthutils::LoadSynthRecipes(); });
+    loader.AddStage("exp_table", {}, charutils::LoadExpTable);
+    loader.AddStage("traits", {}, traits::LoadTraitsList);
+    loader.AddStage("effects", {}, effects::LoadEffectsParameters);
+    loader.AddStage("skill_table", {}, battleutils::LoadSkillTable);
+    loader.AddStage("merits", {}, meritNameSpace::LoadMeritsList);
+    loader.AddStage("abilities", {}, ability::LoadAbilitiesList);
+    loader.AddStage("weapon_skills", {}, battleutils::LoadWeaponSkillsList);
+    loader.AddStage("mob_skills", {}, battleutils::LoadMobSkillsList);
+    loader.AddStage("skillchain_modifiers", {}, battleutils::LoadSkillChainDamageModifiers);
+    loader.AddStage("pets", {}, petutils::LoadPetList);
+    loader.AddStage("mob_mods", {}, mobutils::LoadCustomMods);
+    loader.AddStage("mob_templates", {}, mobutils::LoadMobTemplates);
+    loader.AddStage("instance_entities", { "mob_templates" }, instanceutils::LoadInstanceEntities);
+
+    loader.AddSerialStage("guilds", { "items" }, guildutils::Initialize);
+    loader.AddSerialStage("auction_house", { "items" }, auctionutils::Initialize);
+
+    // zone settings construct battlefield handlers, which call into Lua
+    loader.AddSerialStage("zones", {}, zoneutils::CreateZoneList);
+    loader.AddStage("navmeshes", { "zones" }, [] { zoneutils::LoadNavMeshes(std::max<uint8>(map_config.startup_threads, 1)); });
+
+    // mob and npc scripts may look at any of the data above
+    loader.AddSerialStage("zone_entities", { "items", "spells", "mob_spell_lists", "automaton_spells", "synth_recipes", "exp_table",
+        "traits", "effects", "skill_table", "merits", "abilities", "weapon_skills", "mob_skills", "skillchain_modifiers", "pets",
+        "mob_mods", "mob_templates", "instance_entities", "guilds", "auction_house", "zones", "navmeshes" }, zoneutils::LoadZoneEntities);
+    loader.AddSerialStage("fishing_messages", { "zone_entities" }, fishingutils::LoadFishingMessages);
+
+    if (!loader.Run())
+    {
+        do_final(EXIT_FAILURE);
+    }
+    loader.PrintTimings();
 
     ShowStatus("do_init: server is binding with port %u", map_port == 0 ? map_config.usMapPort : map_port);
     map_fd = makeBind_udp(map_config.uiMapIp, map_port == 0 ? map_config.usMapPort : map_port);
@@ -243,9 +267,37 @@ int32 do_init(int32 argc, char** argv)
     CTaskMgr::getInstance()->AddTask("map_cleanup", server_clock::now(), nullptr, CTaskMgr::TASK_INTERVAL, map_cleanup, 5s);
     CTaskMgr::getInstance()->AddTask("garbage_collect", server_clock::now(), nullptr, CTaskMgr::TASK_INTERVAL, map_garbage_collect, 15min);
 
+    if (map_config.task_stats_interval > 0)
+    {
+        auto interval = std::chrono::seconds(map_config.task_stats_interval);
+        CTaskMgr::getInstance()->AddTask("task_stats", server_clock::now() + interval, nullptr, CTaskMgr::TASK_INTERVAL,
+            [](time_point tick, CTaskMgr::CTask* PTask)
+            {
+                CTaskMgr::getInstance()->PrintTaskStats();
+                zoneutils::PrintZoneTickStats();
+                return 0;
+            }, interval);
+    }
+
     g_PBuff = new int8[map_config.buffer_size + 20];
     PTempBuff = new int8[map_config.buffer_size + 20];
 
+    if (map_config.udp_batch_size > 1)
+    {
+        for (udp_datagram_t& datagram : g_RecvBatch)
+        {
+            datagram.data = new int8[map_config.buffer_size + 20];
+        }
+        ShowStatus("do_init: batched socket mode, up to %u datagrams per pass\n", map_config.udp_batch_size);
+    }
+
+    // --zone-tick-bench <seconds per step>: measure zone ticks without clients, then exit
+    if (zoneTickBench > 0)
+    {
+        zoneutils::BenchmarkZoneTicks(zoneTickBench);
+        do_final(EXIT_SUCCESS);
+    }
+
     ShowStatus("The map-server is " CL_GREEN"ready" CL_RESET" to work...\n");
     ShowMessage("=======================================================================\n");
     return 0;
@@ -263,11 +315,18 @@ void do_final(int code)
     g_PBuff = nullptr;
     delete[] PTempBuff;
     PTempBuff = nullptr;
+    for (udp_datagram_t& datagram : g_RecvBatch)
+    {
+        delete[] datagram.data;
+        datagram.data = nullptr;
+    }
 
     itemutils::FreeItemList();
     battleutils::FreeWeaponSkillsList();
     battleutils::FreeMobSkillList();
 
+    writebehind::final();
+
     petutils::FreePetList();
     zoneutils::FreeZoneList();
     luautils::free();
@@ -277,12 +336,13 @@ void do_final(int code)
         messageThread.join();
     }
 
-    CTaskMgr::delInstance();
-    CVanaTime::delInstance();
-
+    // the handle's keepalive task belongs to the task manager
     Sql_Free(SqlHandle);
     SqlHandle = nullptr;
 
+    CTaskMgr::delInstance();
+    CVanaTime::delInstance();
+
     timer_final();
     socket_final();
 
@@ -312,6 +372,175 @@ void set_server_type()
     SOCKET_TYPE = socket_type::UDP;
 }
 
+/************************************************************************
+*                                                                       *
+*  map_session_from_addr                                                *
+*                                                                       *
+************************************************************************/
+
+map_session_data_t* map_session_from_addr(sockaddr_in* from)
+{
+#   ifdef WIN32
+    uint32 ip = ntohl(from->sin_addr.S_un.S_addr);
+#   else
+    uint32 ip = ntohl(from->sin_addr.s_addr);
+#   endif
+
+    uint64 port = ntohs(from->sin_port);
+    uint64 ipp = ip;
+    ipp |= port << 32;
+    map_session_data_t* map_session_data = mapsession_getbyipp(ipp);
+
+    if (map_session_data == nullptr)
+    {
+        map_session_data = mapsession_createsession(ip, ntohs(from->sin_port));
+        if (map_session_data == nullptr)
+        {
+            map_session_list.erase(ipp);
+            return nullptr;
+        }
+    }
+    map_session_data->last_update = time(nullptr);
+    return map_session_data;
+}
+
+/************************************************************************
+*                                                                       *
+*  Runs the datagram in g_PBuff through recv_parse/parse/send_parse.    *
+*  Returns true if g_PBuff holds a reply of *size bytes for the client  *
+*  If unsealed is given, a newly built reply is left for the caller to  *
+*  pass to map_seal_packets and *unsealed says whether that is needed   *
+*                                                                       *
+************************************************************************/
+
+bool map_process_datagram(size_t* size, sockaddr_in* from, map_session_data_t* map_session_data, bool* unsealed)
+{
+    if (unsealed)
+    {
+        *unsealed = false;
+    }
+    if (recv_parse(g_PBuff, size, from, map_session_data) != -1)
+    {
+        // если предыдущий пакет был потерян, то мы не собираем новый,
+        // а отправляем предыдущий пакет повторно
+        if (!parse(g_PBuff, size, from, map_session_data))
+        {
+            if (send_parse(g_PBuff, size, from, map_session_data, unsealed == nullptr) == 0 && unsealed)
+            {
+                *unsealed = true;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+/************************************************************************
+*                                                                       *
+*  Hands the reply in g_PBuff over to the session (kept for resending)  *
+*                                                                       *
+************************************************************************/
+
+void map_store_reply(size_t size, map_session_data_t* map_session_data)
+{
+    int8* data = g_PBuff;
+    g_PBuff = map_session_data->server_packet_data;
+
+    map_session_data->server_packet_data = data;
+    map_session_data->server_packet_size = size;
+}
+
+/************************************************************************
+*                                                                       *
+*  Batched socket mode (udp_batch_size > 1): every datagram waiting on  *
+*  map_fd is drained in one pass and replies are flushed together       *
+*                                                                       *
+************************************************************************/
+
+void map_flush_send_batch()
+{
+    if (g_SendBatchCount > 0)
+    {
+        int8* buff[UDP_BATCH_MAX];
+        size_t size[UDP_BATCH_MAX];
+        map_session_data_t* sessions[UDP_BATCH_MAX];
+        uint32 count = 0;
+
+        for (size_t i = 0; i < g_SendBatchCount; ++i)
+        {
+            if (g_SendBatchUnsealed[i])
+            {
+                buff[count] = g_SendBatch[i].data;
+                size[count] = g_SendBatch[i].size;
+                sessions[count++] = g_SendBatchSession[i];
+            }
+        }
+        map_seal_packets(buff, size, sessions, count);
+
+        sendudp_batch(map_fd, g_SendBatch, g_SendBatchCount);
+        g_SendBatchCount = 0;
+    }
+}
+
+void do_sockets_batch(duration next)
+{
+    time_point start = server_clock::now();
+    int32 received = 0;
+
+    do
+    {
+        received = recvudp_batch(map_fd, g_RecvBatch, map_config.udp_batch_size, map_config.buffer_size);
+        if (received == -1)
+        {
+            ShowError("do_sockets: recvudp_batch() failed, error code %d!\n", sErrno);
+            return;
+        }
+
+        for (int32 i = 0; i < received; ++i)
+        {
+            udp_datagram_t& datagram = g_RecvBatch[i];
+
+            map_session_data_t* map_session_data = map_session_from_addr(&datagram.addr);
+            if (map_session_data == nullptr)
+            {
+                continue;
+            }
+
+            // the pending reply of this session is kept for resending and may be touched by parse,
+            // so it has to leave before the session's next datagram is handled
+            if (std::find(g_SendBatchSession, g_SendBatchSession + g_SendBatchCount, map_session_data) != g_SendBatchSession + g_SendBatchCount)
+            {
+                map_flush_send_batch();
+            }
+
+            // the free buffer takes the slot, the received one becomes g_PBuff
+            std::swap(g_PBuff, datagram.data);
+            size_t size = datagram.size;
+            bool unsealed = false;
+
+            if (map_process_datagram(&size, &datagram.addr, map_session_data, &unsealed))
+            {
+                udp_datagram_t& reply = g_SendBatch[g_SendBatchCount];
+                reply.data = g_PBuff;
+                reply.size = size;
+                reply.addr = datagram.addr;
+                g_SendBatchUnsealed[g_SendBatchCount] = unsealed;
+                g_SendBatchSession[g_SendBatchCount++] = map_session_data;
+
+                map_store_reply(size, map_session_data);
+            }
+            if (map_session_data->shuttingDown > 0)
+            {
+                // closing the session frees its buffers, pending replies must go first
+                map_flush_send_batch();
+                map_close_session(server_clock::now(), map_session_data);
+            }
+        }
+        map_flush_send_batch();
+    }
+    while (received == map_config.udp_batch_size && server_clock::now() - start < next);
+}
+
 /************************************************************************
 *                                                                       *
 *  do_sockets                                                           *
@@ -343,6 +572,12 @@ int32 do_sockets(fd_set* rfd, duration next)
 
     if (sFD_ISSET(map_fd, rfd))
     {
+        if (map_config.udp_batch_size > 1)
+        {
+            do_sockets_batch(next);
+            return 0;
+        }
+
         struct sockaddr_in from;
         socklen_t fromlen = sizeof(from);
 
@@ -350,46 +585,20 @@ int32 do_sockets(fd_set* rfd, duration next)
         if (ret != -1)
         {
             // find player char
-#   ifdef WIN32
-            uint32 ip = ntohl(from.sin_addr.S_un.S_addr);
-#   else
-            uint32 ip = ntohl(from.sin_addr.s_addr);
-#   endif
-
-            uint64 port = ntohs(from.sin_port);
-            uint64 ipp = ip;
-            ipp |= port << 32;
-            map_session_data_t* map_session_data = mapsession_getbyipp(ipp);
+            map_session_data_t* map_session_data = map_session_from_addr(&from);
 
             if (map_session_data == nullptr)
             {
-                map_session_data = mapsession_createsession(ip, ntohs(from.sin_port));
-                if (map_session_data == nullptr)
-                {
-                    map_session_list.erase(ipp);
-                    return -1;
-                }
+                return -1;
             }
 
-            map_session_data->last_update = time(nullptr);
             size_t size = ret;
 
-            if (recv_parse(g_PBuff, &size, &from, map_session_data) != -1)
+            if (map_process_datagram(&size, &from, map_session_data))
             {
-                // если предыдущий пакет был потерян, то мы не собираем новый,
-                // а отправляем предыдущий пакет повторно
-                if (!parse(g_PBuff, &size, &from, map_session_data))
-                {
-                    send_parse(g_PBuff, &size, &from, map_session_data);
-                }
-
                 ret = sendudp(map_fd, g_PBuff, size, 0, (const struct sockaddr*)&from, fromlen);
 
-                int8* data = g_PBuff;
-                g_PBuff = map_session_data->server_packet_data;
-
-                map_session_data->server_packet_data = data;
-                map_session_data->server_packet_size = size;
+                map_store_reply(size, map_session_data);
             }
             if (map_session_data->shuttingDown > 0)
             {
@@ -419,7 +628,7 @@ int32 parse_console(int8* buf)
 
 int32 map_decipher_packet(int8* buff, size_t size, sockaddr_in* from, map_session_data_t* map_session_data)
 {
-    uint16 tmp, i;
+    uint16 tmp;
 
     // counting blocks whose size = 4 byte
     tmp = (uint16)((size - FFXI_HEADER_SIZE) / 4);
@@ -433,10 +642,7 @@ int32 map_decipher_packet(int8* buff, size_t size, sockaddr_in* from, map_sessio
 
     blowfish_t *pbfkey = &map_session_data->blowfish;
 
-    for (i = 0; i < tmp; i += 2)
-    {
-        blowfish_decipher((uint32*)buff + i + 7, (uint32*)buff + i + 8, pbfkey->P, pbfkey->S[0]);
-    }
+    blowfish_decipher_blocks((uint32*)buff + 7, tmp / 2, pbfkey->P, pbfkey->S[0]);
 
     if (checksum((uint8*)(buff + FFXI_HEADER_SIZE), (uint32)(size - (FFXI_HEADER_SIZE + 16)), (char*)(buff + size - 16)) == 0)
     {
@@ -632,10 +838,12 @@ int32 parse(int8* buff, size_t* buffsize, sockaddr_in* from, map_session_data_t*
 /************************************************************************
 *                                                                       *
 *  main function is building big packet                                 *
+*  With seal == false the md5 and blowfish are left to the caller,     *
+*  so the replies of a whole batch go through map_seal_packets at once *
 *                                                                       *
 ************************************************************************/
 
-int32 send_parse(int8 *buff, size_t* buffsize, sockaddr_in* from, map_session_data_t* map_session_data)
+int32 send_parse(int8 *buff, size_t* buffsize, sockaddr_in* from, map_session_data_t* map_session_data, bool seal)
 {
     // Модификация заголовка исходящего пакета
     // Суть преобразований:
@@ -651,86 +859,90 @@ int32 send_parse(int8 *buff, size_t* buffsize, sockaddr_in* from, map_session_da
 
     // собираем большой пакет, состоящий из нескольких маленьких
     CCharEntity *PChar = map_session_data->PChar;
-    CBasicPacket* PSmallPacket;
     uint32 PacketSize = UINT32_MAX;
-    auto PacketCount = PChar->getPacketCount();
     uint8 packets = 0;
 
-    do {
-        do {
-            *buffsize = FFXI_HEADER_SIZE;
-            PacketList_t packetList = PChar->getPacketList();
-            packets = 0;
+    // max compressed size for client to accept
+    const uint32 MaxPacketSize = 1300 - FFXI_HEADER_SIZE - 16;
 
-            while (!packetList.empty() && *buffsize + packetList.front()->length() < map_config.buffer_size &&
-                packets < PacketCount)
-            {
-                PSmallPacket = packetList.front();
+    // lengths of the packets in the buffer, so one that breaks compression can be cut out again
+    uint16 lengths[UINT8_MAX];
 
-                PSmallPacket->sequence(map_session_data->server_packet_id);
-                memcpy(buff + *buffsize, *PSmallPacket, PSmallPacket->length());
+    *buffsize = FFXI_HEADER_SIZE;
 
-                *buffsize += PSmallPacket->length();
-                packetList.pop_front();
-                packets++;
-            }
+    // The compressed size is known exactly from the per-byte code lengths, so packets
+    // are taken until the next one would push the datagram over the limit.
+    // The first packet is always taken, even if it is too large on its own.
+    // Packets are popped as they are copied, so nothing pushed meanwhile is lost or sent twice.
+    auto takePackets = [&]()
+    {
+        uint32 PacketBits = 8;
 
-            PacketCount /= 2;
+        PChar->TakePackets([&](CBasicPacket* PSmallPacket)
+        {
+            if (*buffsize + PSmallPacket->length() >= map_config.buffer_size || packets == UINT8_MAX)
+            {
+                return false;
+            }
 
-            //Сжимаем данные без учета заголовка
-            //Возвращаемый размер в 8 раз больше реальных данных
-            PacketSize = zlib_compress(buff + FFXI_HEADER_SIZE, (uint32)(*buffsize - FFXI_HEADER_SIZE), PTempBuff, map_config.buffer_size);
+            // packets may be shared between recipients, so the sequence is written into the output buffer only
+            memcpy(buff + *buffsize, *PSmallPacket, PSmallPacket->length());
+            ref<uint16>(buff, *buffsize + 2) = map_session_data->server_packet_id;
 
-            // handle compression error
-            if (PacketSize == static_cast<uint32>(-1))
+            uint32 SmallPacketBits = zlib_compressed_bits(buff + *buffsize, (uint32)PSmallPacket->length());
+            if (packets > 0 && zlib_compressed_size(PacketBits + SmallPacketBits) + 4 > MaxPacketSize)
             {
-                continue;
+                return false;
             }
 
-            ref<uint32>(PTempBuff, zlib_compressed_size(PacketSize)) = PacketSize;
+            PacketBits += SmallPacketBits;
+            *buffsize += PSmallPacket->length();
+            lengths[packets++] = (uint16)PSmallPacket->length();
+            return true;
+        });
+    };
 
-            PacketSize = (uint32)zlib_compressed_size(PacketSize) + 4;
+    takePackets();
 
-        } while (PacketCount > 0 && PacketSize > 1300 - FFXI_HEADER_SIZE - 16); //max size for client to accept
+    do {
+        //Сжимаем данные без учета заголовка
+        //Возвращаемый размер в 8 раз больше реальных данных
+        PacketSize = zlib_compress(buff + FFXI_HEADER_SIZE, (uint32)(*buffsize - FFXI_HEADER_SIZE), PTempBuff, map_config.buffer_size);
 
+        // handle compression error: drop the first packet and try the rest
         if (PacketSize == static_cast<uint32>(-1))
         {
-            if (PChar->getPacketCount() > 0)
-            {
-                PChar->erasePackets(1);
-                PacketCount = PChar->getPacketCount();
-            }
-            else
+            if (packets == 0)
             {
                 *buffsize = 0;
                 return -1;
             }
+
+            *buffsize -= lengths[0];
+            memmove(buff + FFXI_HEADER_SIZE, buff + FFXI_HEADER_SIZE + lengths[0], *buffsize - FFXI_HEADER_SIZE);
+            memmove(lengths, lengths + 1, (packets - 1) * sizeof(lengths[0]));
+            packets--;
+
+            if (packets == 0)
+            {
+                takePackets();
+            }
         }
     } while (PacketSize == static_cast<uint32>(-1));
-    PChar->erasePackets(packets);
 
-    //Запись размера данных без учета заголовка
-    uint8 hash[16];
-    md5((uint8*)PTempBuff, hash, PacketSize);
-    memcpy(PTempBuff + PacketSize, hash, 16);
-    PacketSize += 16;
+    ref<uint32>(PTempBuff, zlib_compressed_size(PacketSize)) = PacketSize;
+
+    PacketSize = (uint32)zlib_compressed_size(PacketSize) + 4;
 
-    if (PacketSize > map_config.buffer_size + 20)
+    // the md5 of the data goes after it, written by map_seal_packets
+    if (PacketSize + 16 > map_config.buffer_size + 20)
     {
-        ShowFatalError(CL_RED"%Memory manager: PTempBuff is overflowed (%u)\n" CL_RESET, PacketSize);
+        ShowFatalError(CL_RED"%Memory manager: PTempBuff is overflowed (%u)\n" CL_RESET, PacketSize + 16);
     }
 
     //making total packet
     memcpy(buff + FFXI_HEADER_SIZE, PTempBuff, PacketSize);
-
-    uint32 CypherSize = (PacketSize / 4)&-2;
-
-    blowfish_t* pbfkey = &map_session_data->blowfish;
-
-    for (uint32 j = 0; j < CypherSize; j += 2)
-    {
-        blowfish_encipher((uint32*)(buff)+j + 7, (uint32*)(buff)+j + 8, pbfkey->P, pbfkey->S[0]);
-    }
+    PacketSize += 16;
 
     // контролируем размер отправляемого пакета. в случае,
     // если его размер превышает 1400 байт (размер данных + 42 байта IP заголовок),
@@ -741,9 +953,45 @@ int32 send_parse(int8 *buff, size_t* buffsize, sockaddr_in* from, map_session_da
 
     *buffsize = PacketSize + FFXI_HEADER_SIZE;
 
+    if (seal)
+    {
+        map_seal_packets(&buff, buffsize, &map_session_data, 1);
+    }
     return 0;
 }
 
+/************************************************************************
+*                                                                       *
+*  Writes the md5 of each built packet and enciphers it with the key   *
+*  of its session. The hashes of all packets are computed together      *
+*  (md5_batch), the blocks of each packet are enciphered side by side   *
+*                                                                       *
+************************************************************************/
+
+void map_seal_packets(int8* const* buff, const size_t* size, map_session_data_t* const* sessions, uint32 count)
+{
+    uint8* text[UDP_BATCH_MAX];
+    uint8* hash[UDP_BATCH_MAX];
+    uint32 length[UDP_BATCH_MAX];
+
+    for (uint32 i = 0; i < count; ++i)
+    {
+        text[i] = (uint8*)buff[i] + FFXI_HEADER_SIZE;
+        length[i] = (uint32)(size[i] - FFXI_HEADER_SIZE - 16);
+        hash[i] = text[i] + length[i];
+    }
+    md5_batch(text, hash, length, count);
+
+    for (uint32 i = 0; i < count; ++i)
+    {
+        uint32 CypherSize = (uint32)((size[i] - FFXI_HEADER_SIZE) / 4) & -2;
+
+        blowfish_t* pbfkey = &sessions[i]->blowfish;
+
+        blowfish_encipher_blocks((uint32*)buff[i] + 7, CypherSize / 2, pbfkey->P, pbfkey->S[0]);
+    }
+}
+
 /************************************************************************
 *                                                                       *
 *  Таймер для завершения сессии (без таймера мы этого сделать не можем, *
@@ -758,6 +1006,14 @@ int32 map_close_session(time_point tick, map_session_data_t* map_session_data)
         map_session_data->PChar != nullptr)
     {
         charutils::SavePlayTime(map_session_data->PChar);
+        writebehind::Flush(map_session_data->PChar->id);
+
+        packet_queue_stats_t stats = map_session_data->PChar->getPacketQueueStats();
+        if (stats.dropped > 0)
+        {
+            ShowWarning("map_close_session: %s had %llu of %llu packets dropped (queue full), %llu coalesced\n", map_session_data->PChar->GetName(),
+                (unsigned long long)stats.dropped, (unsigned long long)stats.pushed, (unsigned long long)stats.coalesced);
+        }
 
         //clear accounts_sessions if character is logging out (not when zoning)
         if (map_session_data->shuttingDown == 1)
@@ -951,12 +1207,16 @@ int32 map_config_default()
     map_config.mysql_port = 3306;
     map_config.server_message = "";
     map_config.buffer_size = 1800;
+    map_config.udp_batch_size = 1;
+    map_config.packet_queue_limit = 4096;
     map_config.ah_base_fee_single = 1;
     map_config.ah_base_fee_stacks = 4;
     map_config.ah_tax_rate_single = 1.0;
     map_config.ah_tax_rate_stacks = 0.5;
     map_config.ah_max_fee = 10000;
     map_config.ah_list_limit = 7;
+    map_config.ah_order_book = false;
+    map_config.ah_expire_days = 3;
     map_config.exp_rate = 1.0f;
     map_config.exp_loss_rate = 1.0f;
     map_config.exp_retain = 0.0f;
@@ -1015,6 +1275,12 @@ int32 map_config_default()
     map_config.skillup_bloodpact = true;
     map_config.anticheat_enabled = false;
     map_config.anticheat_jail_disable = false;
+    map_config.lua_chunk_cache = true;
+    map_config.async_char_save = false;
+    map_config.async_char_save_interval = 1000;
+    map_config.server_var_cache_ttl = 5000;
+    map_config.task_stats_interval = 0;
+    map_config.startup_threads = 4;
     return 0;
 }
 
@@ -1076,6 +1342,14 @@ int32 map_config_read(const int8* cfgName)
         {
             map_config.buffer_size = atoi(w2);
         }
+        else if (strcmp(w1, "udp_batch_size") == 0)
+        {
+            map_config.udp_batch_size = std::clamp(atoi(w2), 1, UDP_BATCH_MAX);
+        }
+        else if (strcmp(w1, "packet_queue_limit") == 0)
+        {
+            map_config.packet_queue_limit = std::max(atoi(w2), 1);
+        }
         else if (strcmp(w1, "max_time_lastupdate") == 0)
         {
             map_config.max_time_lastupdate = atoi(w2);
@@ -1116,6 +1390,14 @@ int32 map_config_read(const int8* cfgName)
         {
             map_config.ah_list_limit = atoi(w2);
         }
+        else if (strcmp(w1, "ah_order_book") == 0)
+        {
+            map_config.ah_order_book = atoi(w2);
+        }
+        else if (strcmp(w1, "ah_expire_days") == 0)
+        {
+            map_config.ah_expire_days = atoi(w2);
+        }
         else if (strcmp(w1, "exp_rate") == 0)
         {
             map_config.exp_rate = (float)atof(w2);
@@ -1372,6 +1654,34 @@ int32 map_config_read(const int8* cfgName)
         {
             map_config.anticheat_jail_disable = atoi(w2);
         }
+        else if (strcmp(w1, "lua_chunk_cache") == 0)
+        {
+            map_config.lua_chunk_cache = atoi(w2);
+        }
+        else if (strcmp(w1, "async_char_save") == 0)
+        {
+            map_config.async_char_save = atoi(w2);
+        }
+        else if (strcmp(w1, "async_char_save_interval") == 0)
+        {
+            map_config.async_char_save_interval = std::clamp(atoi(w2), 10, 60000);
+        }
+        else if (strcmp(w1, "server_var_cache_ttl") == 0)
+        {
+            map_config.server_var_cache_ttl = std::max(atoi(w2), 0);
+        }
+        else if (strcmp(w1, "task_stats_interval") == 0)
+        {
+            map_config.task_stats_interval = atoi(w2);
+            if (map_config.task_stats_interval > 86400)
+            {
+                ShowWarning("task_stats_interval is in seconds, %u is more than a day\n", map_config.task_stats_interval);
+            }
+        }
+        else if (strcmp(w1, "startup_threads") == 0)
+        {
+            map_config.startup_threads = (uint8)std::clamp(atoi(w2), 0, 32);
+        }
         else
         {
             ShowWarning(CL_YELLOW"Unknown setting '%s' in file %s\n" CL_RESET, w1, cfgName);
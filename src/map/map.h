@@ -57,6 +57,8 @@ enum SKILLUP_STYLE
 struct map_config_t
 {
     uint32 buffer_size;             // max size of recv buffer -> default 1800 bytes
+    uint16 udp_batch_size;          // datagrams drained per socket wakeup, 1 = one datagram per select() -> default 1
+    uint32 packet_queue_limit;      // max packets queued for one character, oldest updates are dropped first -> default 4096
 
     uint16 usMapPort;               // port of map server      -> xxxxx
     uint32 uiMapIp;                 // ip of map server        -> INADDR_ANY
@@ -79,6 +81,8 @@ struct map_config_t
     float  ah_tax_rate_stacks;        // Percent of listing price to tax stacks
     uint32 ah_max_fee;                // Maximum total AH fees/taxes
     uint32 ah_list_limit;             // Maximum open AH listings per player
+    bool   ah_order_book;             // Keep open AH listings in memory, this map server owns the auction_house table
+    uint32 ah_expire_days;            // Days until an unsold listing is sent back to its seller (order book only, 0 = never)
 
     float  exp_rate;                  // множитель получаемого опыта
     float  exp_loss_rate;             // same as exp rate but applies when player dies
@@ -139,6 +143,12 @@ struct map_config_t
     bool   skillup_bloodpact;         // Enable/disable skillups for bloodpacts
     bool   anticheat_enabled;         // Is the anti-cheating system enabled
     bool   anticheat_jail_disable;    // Globally disable auto-jailing by the anti-cheat system
+    bool   lua_chunk_cache;           // Keep compiled hook scripts in memory instead of loading them on every call
+    bool   async_char_save;           // Write character saves from a dedicated DB thread instead of the main loop
+    uint32 async_char_save_interval;  // ms the DB thread waits for saves to coalesce before writing them
+    uint32 server_var_cache_ttl;      // ms a cached server variable is used before it is read from the database again
+    uint32 task_stats_interval;       // seconds between timer task timing reports in the log, 0 disables them
+    uint8  startup_threads;           // worker threads (each with its own DB connection) used to load game data at startup, 0 loads everything on the main thread
 };
 
 /************************************************************************
@@ -189,7 +199,14 @@ extern inline map_session_data_t* mapsession_createsession(uint32 ip,uint16 port
 
 int32 recv_parse(int8 *buff,size_t* buffsize,sockaddr_in *from,map_session_data_t*);    // main function to parse recv packets
 int32 parse(int8 *buff,size_t* buffsize,sockaddr_in *from,map_session_data_t*);         // main function parsing the packets
-int32 send_parse(int8 *buff,size_t* buffsize, sockaddr_in *from,map_session_data_t*);   // main function is building big packet
+int32 send_parse(int8 *buff,size_t* buffsize, sockaddr_in *from,map_session_data_t*, bool seal = true); // main function is building big packet
+void  map_seal_packets(int8* const* buff, const size_t* size, map_session_data_t* const* sessions, uint32 count); // md5 + blowfish of built packets
+
+map_session_data_t* map_session_from_addr(sockaddr_in* from);                           // find or create the session of a datagram sender
+bool  map_process_datagram(size_t* size, sockaddr_in* from, map_session_data_t*, bool* unsealed = nullptr); // recv_parse + parse + send_parse on g_PBuff
+void  map_store_reply(size_t size, map_session_data_t*);                                // keep sent reply in the session for resending
+void  map_flush_send_batch();                                                           // send all replies queued by do_sockets_batch
+void  do_sockets_batch(duration next);                                                  // drain every datagram waiting on map_fd
 
 void  map_helpscreen(int32 flag);                                                       // Map-Server Version Screen [venom]
 void  map_versionscreen(int32 flag);                                                    // Map-Server Version Screen [venom]
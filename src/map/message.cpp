@@ -21,10 +21,12 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 
 #include <mutex>
 #include <queue>
+#include <vector>
 
 #include "message.h"
 
 #include "party.h"
+#include "party_roster.h"
 #include "alliance.h"
 #include "linkshell.h"
 #include "status_effect_container.h"
@@ -153,18 +155,18 @@ namespace message
         }
         case MSG_CHAT_YELL:
         {
-            zoneutils::ForEachZone([&packet, &extra](CZone* PZone)
+            auto newPacket = std::make_shared<CBasicPacket>();
+            memcpy(*newPacket, packet->data(), std::min<size_t>(packet->size(), PACKET_SIZE));
+
+            zoneutils::ForEachZone([&newPacket, &extra](CZone* PZone)
             {
                 if (PZone->CanUseMisc(MISC_YELL))
                 {
-                    PZone->ForEachChar([&packet, &extra](CCharEntity* PChar)
+                    PZone->ForEachChar([&newPacket, &extra](CCharEntity* PChar)
                     {
                         // don't push to sender
                         if (PChar->id != ref<uint32>((uint8*)extra->data(), 0))
                         {
-                            CBasicPacket* newPacket = new CBasicPacket();
-                            memcpy(*newPacket, packet->data(), std::min<size_t>(packet->size(), PACKET_SIZE));
-
                             PChar->pushPacket(newPacket);
                         }
                     });
@@ -174,12 +176,13 @@ namespace message
         }
         case MSG_CHAT_SERVMES:
         {
-            zoneutils::ForEachZone([&packet](CZone* PZone)
+            auto newPacket = std::make_shared<CBasicPacket>();
+            memcpy(*newPacket, packet->data(), std::min<size_t>(packet->size(), PACKET_SIZE));
+
+            zoneutils::ForEachZone([&newPacket](CZone* PZone)
             {
-                PZone->ForEachChar([&packet](CCharEntity* PChar)
+                PZone->ForEachChar([&newPacket](CCharEntity* PChar)
                 {
-                    CBasicPacket* newPacket = new CBasicPacket();
-                    memcpy(*newPacket, packet->data(), std::min<size_t>(packet->size(), PACKET_SIZE));
                     PChar->pushPacket(newPacket);
                 });
             });
@@ -295,6 +298,10 @@ namespace message
         }
         case MSG_PT_RELOAD:
         {
+            if (packet->size() > 0)
+            {
+                partyroster::Apply((uint8*)packet->data(), packet->size());
+            }
             if (extra->size() == 8)
             {
                 CCharEntity* PChar = zoneutils::GetCharToUpdate(ref<uint32>((uint8*)extra->data(), 4), ref<uint32>((uint8*)extra->data(), 0));
@@ -649,6 +656,13 @@ namespace message
 
     void send(MSGSERVTYPE type, void* data, size_t datalen, CBasicPacket* packet)
     {
+        // party reloads carry the updated roster so receivers don't have to query it
+        std::vector<uint8> roster;
+        if (type == MSG_PT_RELOAD && !packet && datalen >= 4)
+        {
+            roster = partyroster::Snapshot(ref<uint32>((uint8*)data, 0));
+        }
+
         std::lock_guard<std::mutex> lk(send_mutex);
         chat_message_t msg;
         msg.type = new zmq::message_t(sizeof(MSGSERVTYPE));
@@ -662,6 +676,11 @@ namespace message
         {
             msg.packet = new zmq::message_t(*packet, packet->length(), [](void *data, void *hint) {delete[](uint8*) data; });
         }
+        else if (!roster.empty())
+        {
+            msg.packet = new zmq::message_t(roster.size());
+            memcpy(msg.packet->data(), roster.data(), roster.size());
+        }
         else
         {
             msg.packet = new zmq::message_t(0);
@@ -804,6 +804,9 @@ enum class Mod
     // SPARE = 965, // stuff
 };
 
+// size of the per-entity modifier array, must stay above the highest Mod id
+#define MAX_MODIFIER 1024
+
 //temporary workaround for using enum class as unordered_map key until compilers support it
 struct EnumClassHash
 {
@@ -21,6 +21,8 @@
 
 #include "navmesh.h"
 #include "../common/detour/DetourNavMeshQuery.h"
+#include "../common/detour/DetourCommon.h"
+#include <algorithm>
 #include <float.h>
 #include <string.h>
 #include <iostream>
@@ -89,16 +91,49 @@ CNavMesh::CNavMesh(uint16 zoneID)
 {
     m_zoneID = zoneID;
     m_navMesh = nullptr;
-    m_hit.path = m_hitPath;
-    m_hit.maxPath = 20;
 }
 
 CNavMesh::~CNavMesh()
 {
 }
 
+CNavMesh::CQuery::CQuery(CNavMesh* navMesh)
+    : m_navMesh(navMesh)
+{
+    {
+        std::lock_guard<std::mutex> lk(m_navMesh->m_queryMutex);
+        if (!m_navMesh->m_queryPool.empty())
+        {
+            m_query = std::move(m_navMesh->m_queryPool.back());
+            m_navMesh->m_queryPool.pop_back();
+            return;
+        }
+    }
+
+    m_query = std::make_unique<dtNavMeshQuery>();
+
+    dtStatus status = m_query->init(m_navMesh->m_navMesh.get(), MAX_NAV_POLYS);
+    if (dtStatusFailed(status))
+    {
+        ShowNavError("CNavMesh::CQuery Error initializing navmeshquery (%u)\n", m_navMesh->m_zoneID);
+        m_navMesh->outputError(status);
+        m_query.reset();
+    }
+}
+
+CNavMesh::CQuery::~CQuery()
+{
+    if (m_query)
+    {
+        std::lock_guard<std::mutex> lk(m_navMesh->m_queryMutex);
+        m_navMesh->m_queryPool.push_back(std::move(m_query));
+    }
+}
+
 bool CNavMesh::load(const std::string& filename)
 {
+    clearCaches();
+
     std::ifstream file(filename.c_str(), std::ios_base::in | std::ios_base::binary);
 
     if (!file.good())
@@ -149,13 +184,12 @@ bool CNavMesh::load(const std::string& filename)
 
     }
 
-    // init detour nav mesh path finder
-    status = m_navMeshQuery.init(m_navMesh.get(), MAX_NAV_POLYS);
+    // init detour nav mesh path finder, the first query goes straight back to the pool
+    CQuery query(this);
 
-    if (dtStatusFailed(status))
+    if (!query)
     {
         ShowNavError("CNavMesh::load Error loading navmeshquery (%s)\n", filename.c_str());
-        outputError(status);
         return false;
     }
 
@@ -193,14 +227,156 @@ void CNavMesh::outputError(uint32 status)
 
 void CNavMesh::unload()
 {
+    clearCaches();
     m_navMesh.reset();
 }
 
+void CNavMesh::clearCaches()
+{
+    {
+        std::lock_guard<std::mutex> lk(m_queryMutex);
+        m_queryPool.clear();
+    }
+    std::lock_guard<std::mutex> lk(m_pathCacheMutex);
+    m_pathCache.clear();
+    m_pathCacheIndex.clear();
+    m_pathCacheByStart.clear();
+}
+
+/************************************************************************
+*                                                                       *
+*  Polygon path cache. A path only depends on its start and end poly,   *
+*  so mobs chasing the same target from the same area share one         *
+*  search; the straight path is still built from the exact points.      *
+*                                                                       *
+************************************************************************/
+
+static uint64 pathCacheKey(dtPolyRef startRef, dtPolyRef endRef)
+{
+    // entries are checked against both refs, so a collision with 64 bit refs is only a miss
+    return ((uint64)startRef << 32) ^ (uint64)endRef;
+}
+
+bool CNavMesh::findCachedPath(dtPolyRef startRef, dtPolyRef endRef, std::vector<dtPolyRef>& polys)
+{
+    std::lock_guard<std::mutex> lk(m_pathCacheMutex);
+
+    auto found = m_pathCacheIndex.find(pathCacheKey(startRef, endRef));
+    if (found == m_pathCacheIndex.end() || found->second->startRef != startRef || found->second->endRef != endRef)
+    {
+        return false;
+    }
+    m_pathCache.splice(m_pathCache.begin(), m_pathCache, found->second);
+    polys = found->second->polys;
+    return true;
+}
+
+void CNavMesh::cachePath(dtPolyRef startRef, dtPolyRef endRef, const float* epos, const std::vector<dtPolyRef>& polys)
+{
+    std::lock_guard<std::mutex> lk(m_pathCacheMutex);
+
+    uint64 key = pathCacheKey(startRef, endRef);
+
+    auto found = m_pathCacheIndex.find(key);
+    if (found != m_pathCacheIndex.end())
+    {
+        eraseCachedPath(found->second);
+    }
+
+    m_pathCache.push_front({ startRef, endRef, { epos[0], epos[1], epos[2] }, polys });
+    m_pathCacheIndex[key] = m_pathCache.begin();
+    m_pathCacheByStart[startRef] = m_pathCache.begin();
+
+    if (m_pathCache.size() > NAV_PATH_CACHE_SIZE)
+    {
+        eraseCachedPath(std::prev(m_pathCache.end()));
+    }
+}
+
+void CNavMesh::eraseCachedPath(pathCache_t::iterator entry)
+{
+    auto byStart = m_pathCacheByStart.find(entry->startRef);
+    if (byStart != m_pathCacheByStart.end() && byStart->second == entry)
+    {
+        m_pathCacheByStart.erase(byStart);
+    }
+    m_pathCacheIndex.erase(pathCacheKey(entry->startRef, entry->endRef));
+    m_pathCache.erase(entry);
+}
+
+/************************************************************************
+*                                                                       *
+*  Extends the newest cached path from startRef when its end is close   *
+*  to the new end: the old end is walked along the surface to the new   *
+*  one and the polys crossed are spliced onto the path where they       *
+*  leave it. Fails (and a full search is done) if the walk is blocked.  *
+*                                                                       *
+************************************************************************/
+
+bool CNavMesh::repairPath(CQuery& query, dtPolyRef startRef, dtPolyRef endRef, const float* epos, const dtQueryFilter& filter, std::vector<dtPolyRef>& polys)
+{
+    float oldEnd[3];
+    {
+        std::lock_guard<std::mutex> lk(m_pathCacheMutex);
+
+        auto found = m_pathCacheByStart.find(startRef);
+        if (found == m_pathCacheByStart.end())
+        {
+            return false;
+        }
+        const pathCacheEntry_t& entry = *found->second;
+        if (entry.polys.empty() || entry.polys.back() != entry.endRef ||
+            dtVdistSqr(entry.end, epos) > NAV_PATH_REPAIR_DIST * NAV_PATH_REPAIR_DIST)
+        {
+            return false;
+        }
+        polys = entry.polys;
+        dtVcopy(oldEnd, entry.end);
+    }
+
+    const int32 maxVisited = 16;
+    dtPolyRef visited[maxVisited];
+    int32 visitedCount = 0;
+    float result[3];
+
+    dtStatus status = query->moveAlongSurface(polys.back(), oldEnd, epos, &filter, result, visited, &visitedCount, maxVisited);
+
+    if (dtStatusFailed(status) || visitedCount == 0 || visited[visitedCount - 1] != endRef)
+    {
+        return false;
+    }
+
+    for (int32 i = visitedCount - 1; i >= 0; --i)
+    {
+        auto found = std::find(polys.begin(), polys.end(), visited[i]);
+        if (found != polys.end())
+        {
+            polys.erase(found + 1, polys.end());
+            polys.insert(polys.end(), visited + i + 1, visited + visitedCount);
+            break;
+        }
+    }
+
+    if (polys.size() > MAX_NAV_POLYS)
+    {
+        return false;
+    }
+
+    cachePath(startRef, endRef, epos, polys);
+    return true;
+}
+
 std::vector<position_t> CNavMesh::findPath(const position_t& start, const position_t& end)
 {
     std::vector<position_t> ret;
     dtStatus status;
 
+    CQuery query(this);
+    if (!query)
+    {
+        return ret;
+    }
+
     float spos[3];
     CNavMesh::ToDetourPos(&start, spos);
     // ShowDebug("start pos %f %f %f\n", spos[0], spos[1], spos[2]);
@@ -224,7 +400,7 @@ std::vector<position_t> CNavMesh::findPath(const position_t& start, const positi
     float enearest[3];
     float snearest[3];
 
-    status = m_navMeshQuery.findNearestPoly(spos, polyPickExt, &filter, &startRef, snearest);
+    status = query->findNearestPoly(spos, polyPickExt, &filter, &startRef, snearest);
 
     if (dtStatusFailed(status))
     {
@@ -233,7 +409,7 @@ std::vector<position_t> CNavMesh::findPath(const position_t& start, const positi
         return ret;
     }
 
-    status = m_navMeshQuery.findNearestPoly(epos, polyPickExt, &filter, &endRef, enearest);
+    status = query->findNearestPoly(epos, polyPickExt, &filter, &endRef, enearest);
 
     if (dtStatusFailed(status))
     {
@@ -248,28 +424,36 @@ std::vector<position_t> CNavMesh::findPath(const position_t& start, const positi
         return ret;
     }
 
-    dtPolyRef m_polys[MAX_NAV_POLYS];
+    std::vector<dtPolyRef> polys;
     float straightPath[MAX_NAV_POLYS * 3];
     unsigned char straightPathFlags[MAX_NAV_POLYS];
     dtPolyRef straightPathPolys[MAX_NAV_POLYS];
 
-    // not sure what this is for?
-    int32 pathCount = 0;
+    if (!findCachedPath(startRef, endRef, polys) && !repairPath(query, startRef, endRef, enearest, filter, polys))
+    {
+        dtPolyRef m_polys[MAX_NAV_POLYS];
 
-    status = m_navMeshQuery.findPath(startRef, endRef, snearest, enearest, &filter, m_polys, &pathCount, MAX_NAV_POLYS);
+        // not sure what this is for?
+        int32 pathCount = 0;
 
-    if (dtStatusFailed(status))
-    {
-        ShowNavError("CNavMesh::findPath findPath error (%u)\n", m_zoneID);
-        outputError(status);
-        return ret;
+        status = query->findPath(startRef, endRef, snearest, enearest, &filter, m_polys, &pathCount, MAX_NAV_POLYS);
+
+        if (dtStatusFailed(status))
+        {
+            ShowNavError("CNavMesh::findPath findPath error (%u)\n", m_zoneID);
+            outputError(status);
+            return ret;
+        }
+
+        polys.assign(m_polys, m_polys + pathCount);
+        cachePath(startRef, endRef, enearest, polys);
     }
 
-    if (pathCount > 0)
+    if (!polys.empty())
     {
         int32 straightPathCount = MAX_NAV_POLYS * 3;
 
-        status = m_navMeshQuery.findStraightPath(snearest, enearest, m_polys, pathCount, straightPath, straightPathFlags, straightPathPolys, &straightPathCount, MAX_NAV_POLYS);
+        status = query->findStraightPath(snearest, enearest, polys.data(), (int32)polys.size(), straightPath, straightPathFlags, straightPathPolys, &straightPathCount, MAX_NAV_POLYS);
 
         if (dtStatusFailed(status))
         {
@@ -299,6 +483,12 @@ std::pair<int16, position_t> CNavMesh::findRandomPosition(const position_t& star
 {
     dtStatus status;
 
+    CQuery query(this);
+    if (!query)
+    {
+        return std::make_pair(ERROR_NEARESTPOLY, position_t{});
+    }
+
     float spos[3];
     CNavMesh::ToDetourPos(&start, spos);
 
@@ -317,7 +507,7 @@ std::pair<int16, position_t> CNavMesh::findRandomPosition(const position_t& star
     dtPolyRef startRef;
     dtPolyRef randomRef;
 
-    status = m_navMeshQuery.findNearestPoly(spos, polyPickExt, &filter, &startRef, snearest);
+    status = query->findNearestPoly(spos, polyPickExt, &filter, &startRef, snearest);
 
     if (dtStatusFailed(status))
     {
@@ -332,7 +522,7 @@ std::pair<int16, position_t> CNavMesh::findRandomPosition(const position_t& star
         return std::make_pair(ERROR_NEARESTPOLY, position_t{});
     }
 
-    status = m_navMeshQuery.findRandomPointAroundCircle(startRef, spos, maxRadius, &filter, []() -> float { return tpzrand::GetRandomNumber(1.f); }, &randomRef, randomPt);
+    status = query->findRandomPointAroundCircle(startRef, spos, maxRadius, &filter, []() -> float { return tpzrand::GetRandomNumber(1.f); }, &randomRef, randomPt);
 
     if (dtStatusFailed(status))
     {
@@ -370,7 +560,13 @@ bool CNavMesh::validPosition(const position_t& position)
 
     dtPolyRef startRef;
 
-    dtStatus status = m_navMeshQuery.findNearestPoly(spos, polyPickExt, &filter, &startRef, snearest);
+    CQuery query(this);
+    if (!query)
+    {
+        return false;
+    }
+
+    dtStatus status = query->findNearestPoly(spos, polyPickExt, &filter, &startRef, snearest);
 
     if (dtStatusFailed(status))
     {
@@ -405,7 +601,13 @@ bool CNavMesh::raycast(const position_t& start, const position_t& end)
 
     dtPolyRef startRef;
 
-    status = m_navMeshQuery.findNearestPoly(spos, polyPickExt, &filter, &startRef, snearest);
+    CQuery query(this);
+    if (!query)
+    {
+        return true;
+    }
+
+    status = query->findNearestPoly(spos, polyPickExt, &filter, &startRef, snearest);
 
     if (dtStatusFailed(status))
     {
@@ -420,7 +622,12 @@ bool CNavMesh::raycast(const position_t& start, const position_t& end)
         return true;
     }
 
-    status = m_navMeshQuery.raycast(startRef, spos, epos, &filter, 0, &m_hit);
+    dtPolyRef hitPath[20];
+    dtRaycastHit hit;
+    hit.path = hitPath;
+    hit.maxPath = 20;
+
+    status = query->raycast(startRef, spos, epos, &filter, 0, &hit);
 
     if (dtStatusFailed(status))
     {
@@ -430,7 +637,7 @@ bool CNavMesh::raycast(const position_t& start, const position_t& end)
     }
 
     // no wall was hit
-    if (m_hit.t == FLT_MAX)
+    if (hit.t == FLT_MAX)
     {
         return true;
     }
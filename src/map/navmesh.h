@@ -31,10 +31,15 @@ The NavMesh class will load and find paths given a start point and end point.
 #include "../common/showmsg.h"
 #include "../common/mmo.h"
 
-#include <vector>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #define MAX_NAV_POLYS 256
+#define NAV_PATH_CACHE_SIZE 256     // polygon paths remembered per zone
+#define NAV_PATH_REPAIR_DIST 4.0f   // a remembered path whose end moved less than this is extended instead of searched again
 
 static const int NAVMESHSET_MAGIC = 'M' << 24 | 'S' << 16 | 'E' << 8 | 'T'; //'MSET';
 static const int NAVMESHSET_VERSION = 1;
@@ -83,13 +88,49 @@ public:
     bool validPosition(const position_t& position);
 
 private:
+    // dtNavMeshQuery keeps search state, so every caller leases its own from the pool
+    class CQuery
+    {
+    public:
+        CQuery(CNavMesh* navMesh);
+        ~CQuery();
+
+        dtNavMeshQuery* operator->() const { return m_query.get(); }
+        explicit operator bool() const { return m_query != nullptr; }
+
+    private:
+        CNavMesh* m_navMesh;
+        std::unique_ptr<dtNavMeshQuery> m_query;
+    };
+
+    struct pathCacheEntry_t
+    {
+        dtPolyRef startRef;
+        dtPolyRef endRef;
+        float end[3];
+        std::vector<dtPolyRef> polys;
+    };
+
+    typedef std::list<pathCacheEntry_t> pathCache_t;
+
     void outputError(uint32 status);
 
+    bool findCachedPath(dtPolyRef startRef, dtPolyRef endRef, std::vector<dtPolyRef>& polys);
+    bool repairPath(CQuery& query, dtPolyRef startRef, dtPolyRef endRef, const float* epos, const dtQueryFilter& filter, std::vector<dtPolyRef>& polys);
+    void cachePath(dtPolyRef startRef, dtPolyRef endRef, const float* epos, const std::vector<dtPolyRef>& polys);
+    void eraseCachedPath(pathCache_t::iterator entry);
+    void clearCaches();
+
     uint16 m_zoneID;
-    dtRaycastHit m_hit;
-    dtPolyRef m_hitPath[20];
     std::unique_ptr<dtNavMesh> m_navMesh;
-    dtNavMeshQuery m_navMeshQuery;
+
+    std::mutex m_queryMutex;
+    std::vector<std::unique_ptr<dtNavMeshQuery>> m_queryPool;                   // idle queries
+
+    std::mutex m_pathCacheMutex;
+    pathCache_t m_pathCache;                                                    // most recently used first
+    std::unordered_map<uint64, pathCache_t::iterator> m_pathCacheIndex;         // (startRef, endRef)
+    std::unordered_map<dtPolyRef, pathCache_t::iterator> m_pathCacheByStart;    // newest path from a start poly, for repairs
 };
 
 #endif
@@ -0,0 +1,228 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#include "packet_queue.h"
+
+#include "packets/basic.h"
+#include "entities/baseentity.h"
+
+namespace
+{
+    // update mask bits only spawns and despawns carry: a spawn always sends
+    // the name (or model bit 0x40), a despawn is 0x20
+    const uint8 UPDATE_SPAWN_BITS = UPDATE_NAME | 0x20 | 0x40;
+
+    bool isEntityUpdate(CBasicPacket* packet)
+    {
+        return packet->id() == 0x00D || packet->id() == 0x00E;
+    }
+
+    uint64 updateKey(CBasicPacket* packet)
+    {
+        return ((uint64)packet->id() << 32) | packet->ref<uint32>(0x04);
+    }
+
+    uint8 getPriority(CBasicPacket* packet)
+    {
+        if (packet->id() == 0x017)
+        {
+            return PACKET_PRIORITY_HIGH;
+        }
+        if (isEntityUpdate(packet) && (packet->ref<uint8>(0x0A) & UPDATE_SPAWN_BITS) == 0)
+        {
+            return PACKET_PRIORITY_LOW;
+        }
+        return PACKET_PRIORITY_NORMAL;
+    }
+}
+
+void CPacketQueue::push(std::shared_ptr<CBasicPacket> packet, size_t limit)
+{
+    uint8 priority = getPriority(packet.get());
+    m_stats.pushed++;
+
+    if (isEntityUpdate(packet.get()))
+    {
+        auto pending = m_pendingUpdate.find(updateKey(packet.get()));
+        if (pending != m_pendingUpdate.end())
+        {
+            queue_t::iterator slot = m_queue[PACKET_PRIORITY_LOW].begin() + (pending->second - m_lowFront);
+            uint8 mask = packet->ref<uint8>(0x0A);
+
+            // spawns and despawns replace any pending update, an update only one it fully covers
+            if ((mask & UPDATE_SPAWN_BITS) || ((*slot)->ref<uint8>(0x0A) & ~mask) == 0)
+            {
+                discard(slot, PACKET_PRIORITY_LOW);
+                m_stats.coalesced++;
+            }
+            else
+            {
+                m_pendingUpdate.erase(pending);
+            }
+        }
+        if (priority == PACKET_PRIORITY_LOW)
+        {
+            m_pendingUpdate[updateKey(packet.get())] = m_lowFront + m_queue[PACKET_PRIORITY_LOW].size();
+        }
+    }
+
+    m_queue[priority].push_back(std::move(packet));
+    m_size++;
+
+    while (m_size > limit && evict())
+    {
+        m_stats.dropped++;
+    }
+}
+
+std::shared_ptr<CBasicPacket> CPacketQueue::pop()
+{
+    for (uint8 priority = 0; priority < PACKET_PRIORITY_COUNT; ++priority)
+    {
+        if (!m_queue[priority].empty())
+        {
+            queue_t::iterator slot = m_queue[priority].begin();
+            std::shared_ptr<CBasicPacket> packet = *slot;
+            discard(slot, priority);
+            return packet;
+        }
+    }
+    return nullptr;
+}
+
+void CPacketQueue::clear()
+{
+    for (queue_t& queue : m_queue)
+    {
+        queue.clear();
+    }
+    m_lowFront = 0;
+    m_pendingUpdate.clear();
+    m_size = 0;
+}
+
+bool CPacketQueue::empty() const
+{
+    return m_size == 0;
+}
+
+size_t CPacketQueue::size() const
+{
+    return m_size;
+}
+
+/************************************************************************
+*                                                                       *
+*  Hands packets to func in send order and pops each one it accepts.    *
+*  The packet is only valid during the call. Selecting and removing     *
+*  in one pass keeps a packet pushed meanwhile (by another thread,      *
+*  under the owner's lock) from being taken for one already sent.       *
+*                                                                       *
+************************************************************************/
+
+void CPacketQueue::Take(const std::function<bool(CBasicPacket*)>& func)
+{
+    for (uint8 priority = 0; priority < PACKET_PRIORITY_COUNT; ++priority)
+    {
+        // trim() keeps the front of every queue occupied
+        while (!m_queue[priority].empty())
+        {
+            if (!func(m_queue[priority].front().get()))
+            {
+                return;
+            }
+            discard(m_queue[priority].begin(), priority);
+        }
+    }
+}
+
+void CPacketQueue::erase(size_t num)
+{
+    for (uint8 priority = 0; priority < PACKET_PRIORITY_COUNT && num > 0; ++priority)
+    {
+        while (num > 0 && !m_queue[priority].empty())
+        {
+            discard(m_queue[priority].begin(), priority);
+            num--;
+        }
+    }
+}
+
+const packet_queue_stats_t& CPacketQueue::stats() const
+{
+    return m_stats;
+}
+
+/************************************************************************
+*                                                                       *
+*  Empties a slot and pops empty slots off the front of its queue       *
+*                                                                       *
+************************************************************************/
+
+void CPacketQueue::discard(queue_t::iterator slot, uint8 priority)
+{
+    if (*slot)
+    {
+        if (priority == PACKET_PRIORITY_LOW)
+        {
+            auto pending = m_pendingUpdate.find(updateKey(slot->get()));
+            if (pending != m_pendingUpdate.end() && pending->second == m_lowFront + (slot - m_queue[priority].begin()))
+            {
+                m_pendingUpdate.erase(pending);
+            }
+        }
+        slot->reset();
+        m_size--;
+    }
+    trim(priority);
+}
+
+void CPacketQueue::trim(uint8 priority)
+{
+    queue_t& queue = m_queue[priority];
+    while (!queue.empty() && !queue.front())
+    {
+        queue.pop_front();
+        if (priority == PACKET_PRIORITY_LOW)
+        {
+            m_lowFront++;
+        }
+    }
+}
+
+/************************************************************************
+*                                                                       *
+*  Drops the oldest packet of the least important non-empty class       *
+*                                                                       *
+************************************************************************/
+
+bool CPacketQueue::evict()
+{
+    for (uint8 priority : { PACKET_PRIORITY_LOW, PACKET_PRIORITY_HIGH, PACKET_PRIORITY_NORMAL })
+    {
+        if (!m_queue[priority].empty())
+        {
+            discard(m_queue[priority].begin(), priority);
+            return true;
+        }
+    }
+    return false;
+}
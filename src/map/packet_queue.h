@@ -0,0 +1,98 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#ifndef _CPACKETQUEUE_H
+#define _CPACKETQUEUE_H
+
+#include "../common/cbasetypes.h"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+class CBasicPacket;
+
+enum PACKET_PRIORITY
+{
+    PACKET_PRIORITY_HIGH,       // chat
+    PACKET_PRIORITY_NORMAL,     // everything that must keep its order
+    PACKET_PRIORITY_LOW,        // entity updates that a newer update may replace
+
+    PACKET_PRIORITY_COUNT
+};
+
+struct packet_queue_stats_t
+{
+    uint64 pushed    {0};
+    uint64 coalesced {0};       // updates replaced by a newer update of the same entity before they were sent
+    uint64 dropped   {0};       // packets evicted because the queue was full
+};
+
+/************************************************************************
+*                                                                       *
+*  Packets waiting to be sent to one character.                         *
+*                                                                       *
+*  Packets are sent high, normal, low; each class keeps its own order.  *
+*  An entity update (0x00D/0x00E) that only carries position, status    *
+*  or hp is queued low, and is replaced when a newer update of the      *
+*  same entity covers its mask, or when that entity is spawned or       *
+*  despawned again. The queue holds at most `limit` packets: beyond     *
+*  that the oldest low, then high, then normal packets are dropped.     *
+*                                                                       *
+*  Not locked, the owner guards it (CCharEntity::m_PacketListMutex).    *
+*                                                                       *
+************************************************************************/
+
+class CPacketQueue
+{
+public:
+
+    void   push(std::shared_ptr<CBasicPacket> packet, size_t limit);
+    std::shared_ptr<CBasicPacket> pop();
+    void   clear();
+
+    bool   empty() const;
+    size_t size() const;
+
+    void   Take(const std::function<bool(CBasicPacket*)>& func);      // pop packets in send order while func accepts them
+    void   erase(size_t num);                                           // erase the first num packets in send order
+
+    const packet_queue_stats_t& stats() const;
+
+private:
+
+    // replaced or dropped packets leave an empty slot until they reach the front
+    typedef std::deque<std::shared_ptr<CBasicPacket>> queue_t;
+
+    void   discard(queue_t::iterator slot, uint8 priority);
+    void   trim(uint8 priority);
+    bool   evict();
+
+    queue_t m_queue[PACKET_PRIORITY_COUNT];
+    uint64  m_lowFront {0};                                 // sequence number of m_queue[LOW].front()
+    std::unordered_map<uint64, uint64> m_pendingUpdate;    // (packet type, entity id) -> sequence number of its low update
+    size_t  m_size {0};
+
+    packet_queue_stats_t m_stats;
+};
+
+#endif
@@ -36,6 +36,7 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 #include "conquest_system.h"
 #include "utils/battleutils.h"
 #include "utils/blacklistutils.h"
+#include "utils/auctionutils.h"
 #include "utils/charutils.h"
 #include "utils/petutils.h"
 #include "utils/puppetutils.h"
@@ -61,6 +62,7 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 #include "recast_container.h"
 #include "enmity_container.h"
 #include "mob_modifier.h"
+#include "write_behind.h"
 #include "ai/ai_container.h"
 #include "ai/states/death_state.h"
 
@@ -435,6 +437,9 @@ void SmallPacket0x00D(map_session_data_t* session, CCharEntity* PChar, CBasicPac
     charutils::SaveCharStats(PChar);
     charutils::SaveCharExp(PChar, PChar->GetMJob());
 
+    // the next map server reads the character back from the database
+    writebehind::Flush(PChar->id);
+
     PChar->status = STATUS_DISAPPEAR;
     return;
 }
@@ -2315,21 +2320,28 @@ void SmallPacket0x04E(map_session_data_t* session, CCharEntity* PChar, CBasicPac
             PChar->m_AHHistoryTimestamp = curTick;
             PChar->pushPacket(new CAuctionHousePacket(action));
 
-            // A single SQL query for the player's AH history which is stored in a Char Entity struct + vector.
-            const char* Query = "SELECT itemid, price, stack FROM auction_house WHERE seller = %u and sale=0 ORDER BY id ASC LIMIT 7;";
+            if (auctionutils::enabled())
+            {
+                auctionutils::LoadHistory(PChar);
+            }
+            else
+            {
+                // A single SQL query for the player's AH history which is stored in a Char Entity struct + vector.
+                const char* Query = "SELECT itemid, price, stack FROM auction_house WHERE seller = %u and sale=0 ORDER BY id ASC LIMIT 7;";
 
-            int32 ret = Sql_Query(SqlHandle, Query, PChar->id);
+                int32 ret = Sql_Query(SqlHandle, Query, PChar->id);
 
-            if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
-            {
-                while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+                if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
                 {
-                    AuctionHistory_t ah;
-                    ah.itemid = (uint16)Sql_GetIntData(SqlHandle, 0);
-                    ah.price = (uint32)Sql_GetUIntData(SqlHandle, 1);
-                    ah.stack = (uint8)Sql_GetIntData(SqlHandle, 2);
-                    ah.status = 0;
-                    PChar->m_ah_history.push_back(ah);
+                    while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+                    {
+                        AuctionHistory_t ah;
+                        ah.itemid = (uint16)Sql_GetIntData(SqlHandle, 0);
+                        ah.price = (uint32)Sql_GetUIntData(SqlHandle, 1);
+                        ah.stack = (uint8)Sql_GetIntData(SqlHandle, 2);
+                        ah.status = 0;
+                        PChar->m_ah_history.push_back(ah);
+                    }
                 }
             }
             ShowDebug("%s has %i items up on the AH. \n", PChar->GetName(), PChar->m_ah_history.size());
@@ -2390,16 +2402,24 @@ void SmallPacket0x04E(map_session_data_t* session, CCharEntity* PChar, CBasicPac
             }
 
             // Get the current number of items the player has for sale
-            const char* Query = "SELECT COUNT(*) FROM auction_house WHERE seller = %u AND sale=0;";
-
-            int32 ret = Sql_Query(SqlHandle, Query, PChar->id);
             uint32 ah_listings = 0;
 
-            if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
+            if (auctionutils::enabled())
             {
-                Sql_NextRow(SqlHandle);
-                ah_listings = (uint32)Sql_GetIntData(SqlHandle, 0);
-                // ShowDebug(CL_CYAN"%s has %d outstanding listings before placing this one." CL_RESET, PChar->GetName(), ah_listings);
+                ah_listings = auctionutils::CountListings(PChar->id);
+            }
+            else
+            {
+                const char* Query = "SELECT COUNT(*) FROM auction_house WHERE seller = %u AND sale=0;";
+
+                int32 ret = Sql_Query(SqlHandle, Query, PChar->id);
+
+                if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
+                {
+                    Sql_NextRow(SqlHandle);
+                    ah_listings = (uint32)Sql_GetIntData(SqlHandle, 0);
+                    // ShowDebug(CL_CYAN"%s has %d outstanding listings before placing this one." CL_RESET, PChar->GetName(), ah_listings);
+                }
             }
 
             if (map_config.ah_list_limit && ah_listings >= map_config.ah_list_limit)
@@ -2411,7 +2431,33 @@ void SmallPacket0x04E(map_session_data_t* session, CCharEntity* PChar, CBasicPac
 
             const char* fmtQuery = "INSERT INTO auction_house(itemid, stack, seller, seller_name, date, price) VALUES(%u,%u,%u,'%s',%u,%u)";
 
-            if (Sql_Query(SqlHandle,
+            if (auctionutils::enabled())
+            {
+                // the listing row and the item leaving the inventory are committed together
+                bool isAutoCommitOn = Sql_GetAutoCommit(SqlHandle);
+
+                if (Sql_SetAutoCommit(SqlHandle, false) && Sql_TransactionStart(SqlHandle))
+                {
+                    if (auctionutils::AddListing(PChar, PItem->getID(), quantity == 0, price))
+                    {
+                        charutils::UpdateItem(PChar, LOC_INVENTORY, slot, -(int32)(quantity != 0 ? 1 : PItem->getStackSize()));
+                        charutils::UpdateItem(PChar, LOC_INVENTORY, 0, -(int32)auctionFee); // Deduct AH fee
+                        Sql_TransactionCommit(SqlHandle);
+                        Sql_SetAutoCommit(SqlHandle, isAutoCommitOn);
+
+                        PChar->pushPacket(new CAuctionHousePacket(action, 1, 0, 0)); // Merchandise put up on auction msg
+                        PChar->pushPacket(new CAuctionHousePacket(0x0C, (uint8)ah_listings, PChar)); // Inform history of slot
+                        return;
+                    }
+                    Sql_TransactionRollback(SqlHandle);
+                }
+                Sql_SetAutoCommit(SqlHandle, isAutoCommitOn);
+
+                ShowError(CL_RED"SmallPacket0x04E::AuctionHouse: Cannot insert item %s to database\n" CL_RESET, PItem->getName());
+                PChar->pushPacket(new CAuctionHousePacket(action, 197, 0, 0)); //failed to place up
+                return;
+            }
+            else if (Sql_Query(SqlHandle,
                 fmtQuery,
                 PItem->getID(),
                 quantity == 0,
@@ -2463,28 +2509,69 @@ void SmallPacket0x04E(map_session_data_t* session, CCharEntity* PChar, CBasicPac
                     gil->isType(ITEM_CURRENCY) &&
                     gil->getQuantity() >= price)
                 {
-                    const char* fmtQuery = "UPDATE auction_house SET buyer_name = '%s', sale = %u, sell_date = %u WHERE itemid = %u AND buyer_name IS NULL AND stack = %u AND price <= %u ORDER BY price LIMIT 1";
-
-                    if (Sql_Query(SqlHandle,
-                        fmtQuery,
-                        PChar->GetName(),
-                        price,
-                        (uint32)time(nullptr),
-                        itemid,
-                        quantity == 0,
-                        price) != SQL_ERROR &&
-                        Sql_AffectedRows(SqlHandle) != 0)
+                    if (auctionutils::enabled())
                     {
-                        uint8 SlotID = charutils::AddItem(PChar, LOC_INVENTORY, itemid, (quantity == 0 ? PItem->getStackSize() : 1));
+                        AuctionListing_t listing;
 
-                        if (SlotID != ERROR_SLOTID)
+                        while (PChar->getStorage(LOC_INVENTORY)->GetFreeSlotsCount() != 0 &&
+                            auctionutils::TakeCheapest(itemid, quantity == 0, price, listing))
                         {
-                            charutils::UpdateItem(PChar, LOC_INVENTORY, 0, -(int32)(price));
+                            // the sale, the item and the gil are committed together
+                            bool isAutoCommitOn = Sql_GetAutoCommit(SqlHandle);
+                            bool sold = true;
 
-                            PChar->pushPacket(new CAuctionHousePacket(action, 0x01, itemid, price));
-                            PChar->pushPacket(new CInventoryFinishPacket());
+                            if (Sql_SetAutoCommit(SqlHandle, false) && Sql_TransactionStart(SqlHandle))
+                            {
+                                sold = auctionutils::CommitSale(listing, PChar, price);
+
+                                if (sold && charutils::AddItem(PChar, LOC_INVENTORY, itemid, (quantity == 0 ? PItem->getStackSize() : 1)) != ERROR_SLOTID)
+                                {
+                                    charutils::UpdateItem(PChar, LOC_INVENTORY, 0, -(int32)(price));
+                                    Sql_TransactionCommit(SqlHandle);
+                                    Sql_SetAutoCommit(SqlHandle, isAutoCommitOn);
+
+                                    PChar->pushPacket(new CAuctionHousePacket(action, 0x01, itemid, price));
+                                    PChar->pushPacket(new CInventoryFinishPacket());
+                                    return;
+                                }
+                                Sql_TransactionRollback(SqlHandle);
+                            }
+                            Sql_SetAutoCommit(SqlHandle, isAutoCommitOn);
+
+                            if (sold) // nothing was committed, the listing stays open
+                            {
+                                auctionutils::Restore(listing);
+                                break;
+                            }
+                            // the row is gone (seller deleted), so drop it and try the next one
+                            ShowWarning("SmallPacket0x04E::AuctionHouse: listing %u is no longer in auction_house\n", listing.id);
+                        }
+                    }
+                    else
+                    {
+                        const char* fmtQuery = "UPDATE auction_house SET buyer_name = '%s', sale = %u, sell_date = %u WHERE itemid = %u AND buyer_name IS NULL AND stack = %u AND price <= %u ORDER BY price LIMIT 1";
+
+                        if (Sql_Query(SqlHandle,
+                            fmtQuery,
+                            PChar->GetName(),
+                            price,
+                            (uint32)time(nullptr),
+                            itemid,
+                            quantity == 0,
+                            price) != SQL_ERROR &&
+                            Sql_AffectedRows(SqlHandle) != 0)
+                        {
+                            uint8 SlotID = charutils::AddItem(PChar, LOC_INVENTORY, itemid, (quantity == 0 ? PItem->getStackSize() : 1));
+
+                            if (SlotID != ERROR_SLOTID)
+                            {
+                                charutils::UpdateItem(PChar, LOC_INVENTORY, 0, -(int32)(price));
+
+                                PChar->pushPacket(new CAuctionHousePacket(action, 0x01, itemid, price));
+                                PChar->pushPacket(new CInventoryFinishPacket());
+                            }
+                            return;
                         }
-                        return;
                     }
                 }
             }
@@ -2496,35 +2583,77 @@ void SmallPacket0x04E(map_session_data_t* session, CCharEntity* PChar, CBasicPac
     {
         if (slotid < PChar->m_ah_history.size())
         {
-            bool isAutoCommitOn = Sql_GetAutoCommit(SqlHandle);
-            AuctionHistory_t canceledItem = PChar->m_ah_history[slotid];
-
-            if (Sql_SetAutoCommit(SqlHandle, false) && Sql_TransactionStart(SqlHandle))
+            if (auctionutils::enabled())
             {
-                const char* fmtQuery = "DELETE FROM auction_house WHERE seller = %u AND itemid = %u AND stack = %u AND price = %u AND sale = 0 LIMIT 1;";
-                int32 ret = Sql_Query(SqlHandle, fmtQuery, PChar->id, canceledItem.itemid, canceledItem.stack, canceledItem.price);
-                if (ret != SQL_ERROR && Sql_AffectedRows(SqlHandle))
+                AuctionHistory_t canceledItem = PChar->m_ah_history[slotid];
+                AuctionListing_t listing;
+                CItem* PDelItem = itemutils::GetItemPointer(canceledItem.itemid);
+
+                if (PDelItem && auctionutils::TakeOwn(PChar->id, canceledItem.itemid, canceledItem.stack, canceledItem.price, listing))
                 {
-                    CItem* PDelItem = itemutils::GetItemPointer(canceledItem.itemid);
-                    if (PDelItem)
+                    // the listing is deleted in the same transaction that returns the item
+                    bool isAutoCommitOn = Sql_GetAutoCommit(SqlHandle);
+                    bool deleted = true;
+
+                    if (Sql_SetAutoCommit(SqlHandle, false) && Sql_TransactionStart(SqlHandle))
                     {
-                        uint8 SlotID = charutils::AddItem(PChar, LOC_INVENTORY, canceledItem.itemid, (canceledItem.stack != 0 ? PDelItem->getStackSize() : 1), true);
+                        deleted = auctionutils::CommitCancel(listing);
 
-                        if (SlotID != ERROR_SLOTID)
+                        if (deleted && charutils::AddItem(PChar, LOC_INVENTORY, canceledItem.itemid, (canceledItem.stack != 0 ? PDelItem->getStackSize() : 1), true) != ERROR_SLOTID)
                         {
                             Sql_TransactionCommit(SqlHandle);
+                            Sql_SetAutoCommit(SqlHandle, isAutoCommitOn);
+
                             PChar->pushPacket(new CAuctionHousePacket(action, 0, PChar, slotid, false));
                             PChar->pushPacket(new CInventoryFinishPacket());
-                            Sql_SetAutoCommit(SqlHandle, isAutoCommitOn);
                             return;
                         }
+                        Sql_TransactionRollback(SqlHandle);
+                    }
+                    Sql_SetAutoCommit(SqlHandle, isAutoCommitOn);
+
+                    if (deleted) // nothing was committed, the listing stays open
+                    {
+                        auctionutils::Restore(listing);
+                    }
+                    else
+                    {
+                        ShowError("Failed to return item id %u stack %u to char... \n", canceledItem.itemid, canceledItem.stack);
                     }
                 }
-                else
-                    ShowError("Failed to return item id %u stack %u to char... \n", canceledItem.itemid, canceledItem.stack);
+            }
+            else
+            {
+                bool isAutoCommitOn = Sql_GetAutoCommit(SqlHandle);
+                AuctionHistory_t canceledItem = PChar->m_ah_history[slotid];
 
-                Sql_TransactionRollback(SqlHandle);
-                Sql_SetAutoCommit(SqlHandle, isAutoCommitOn);
+                if (Sql_SetAutoCommit(SqlHandle, false) && Sql_TransactionStart(SqlHandle))
+                {
+                    const char* fmtQuery = "DELETE FROM auction_house WHERE seller = %u AND itemid = %u AND stack = %u AND price = %u AND sale = 0 LIMIT 1;";
+                    int32 ret = Sql_Query(SqlHandle, fmtQuery, PChar->id, canceledItem.itemid, canceledItem.stack, canceledItem.price);
+                    if (ret != SQL_ERROR && Sql_AffectedRows(SqlHandle))
+                    {
+                        CItem* PDelItem = itemutils::GetItemPointer(canceledItem.itemid);
+                        if (PDelItem)
+                        {
+                            uint8 SlotID = charutils::AddItem(PChar, LOC_INVENTORY, canceledItem.itemid, (canceledItem.stack != 0 ? PDelItem->getStackSize() : 1), true);
+
+                            if (SlotID != ERROR_SLOTID)
+                            {
+                                Sql_TransactionCommit(SqlHandle);
+                                PChar->pushPacket(new CAuctionHousePacket(action, 0, PChar, slotid, false));
+                                PChar->pushPacket(new CInventoryFinishPacket());
+                                Sql_SetAutoCommit(SqlHandle, isAutoCommitOn);
+                                return;
+                            }
+                        }
+                    }
+                    else
+                        ShowError("Failed to return item id %u stack %u to char... \n", canceledItem.itemid, canceledItem.stack);
+
+                    Sql_TransactionRollback(SqlHandle);
+                    Sql_SetAutoCommit(SqlHandle, isAutoCommitOn);
+                }
             }
         }
         // Let client know something went wrong
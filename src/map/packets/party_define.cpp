@@ -26,6 +26,7 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 #include "../entities/charentity.h"
 #include "../entities/trustentity.h"
 #include "../party.h"
+#include "../party_roster.h"
 #include "../alliance.h"
 #include "../utils/zoneutils.h"
 
@@ -45,23 +46,16 @@ CPartyDefinePacket::CPartyDefinePacket(CParty* PParty)
 
         uint8 i = 0;
 
-        int ret = Sql_Query(SqlHandle, "SELECT chars.charid, partyflag, pos_zone, pos_prevzone FROM accounts_parties \
-									   	LEFT JOIN chars ON accounts_parties.charid = chars.charid WHERE \
-										IF (allianceid <> 0, allianceid = %d, partyid = %d) ORDER BY partyflag & %u, timestamp;",
-            allianceid, PParty->GetPartyID(), PARTY_SECOND | PARTY_THIRD);
-        if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) > 0)
+        for (auto&& memberinfo : partyroster::GetMembers(PParty->GetPartyID(), allianceid))
         {
-            while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-            {
-                uint16 targid = 0;
-                CCharEntity* PChar = zoneutils::GetChar(Sql_GetUIntData(SqlHandle, 0));
-                if (PChar) targid = PChar->targid;
-                ref<uint32>(12 * i + 0x08) = Sql_GetUIntData(SqlHandle, 0);
-                ref<uint16>(12 * i + 0x0C) = targid;
-                ref<uint16>(12 * i + 0x0E) = Sql_GetUIntData(SqlHandle, 1);
-                ref<uint16>(12 * i + 0x10) = Sql_GetUIntData(SqlHandle, 2) ? Sql_GetUIntData(SqlHandle, 2) : Sql_GetUIntData(SqlHandle, 3);
-                i++;
-            }
+            uint16 targid = 0;
+            CCharEntity* PChar = zoneutils::GetChar(memberinfo.id);
+            if (PChar) targid = PChar->targid;
+            ref<uint32>(12 * i + 0x08) = memberinfo.id;
+            ref<uint16>(12 * i + 0x0C) = targid;
+            ref<uint16>(12 * i + 0x0E) = memberinfo.flags;
+            ref<uint16>(12 * i + 0x10) = memberinfo.zone ? memberinfo.zone : memberinfo.prev_zone;
+            i++;
         }
 
         if (PParty->GetLeader() != nullptr && PParty->GetLeader()->objtype == TYPE_PC)
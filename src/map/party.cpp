@@ -32,6 +32,7 @@
 #include "utils/zoneutils.h"
 #include "map.h"
 #include "party.h"
+#include "party_roster.h"
 #include "treasure_pool.h"
 #include "message.h"
 #include "latent_effect_container.h"
@@ -47,18 +48,6 @@
 #include "packets/party_member_update.h"
 #include "packets/message_basic.h"
 
-//should have brace-or-equal initializers when MSVC supports it
-struct CParty::partyInfo_t
-{
-    uint32 id;
-    uint32 partyid;
-    uint32 allianceid;
-    std::string name;
-    uint16 flags;
-    uint16 zone;
-    uint16 prev_zone;
-};
-
 /************************************************************************
 *																		*
 *  Конструктор   														*
@@ -150,6 +139,7 @@ void CParty::DisbandParty(bool playerInitiated)
                 sync->SetDuration(30000);
             }
             Sql_Query(SqlHandle, "DELETE FROM accounts_parties WHERE charid = %u;", PChar->id);
+            partyroster::Remove(PChar->id);
         }
 
         // make sure chat server isn't notified of a disband if this came from the chat server already
@@ -442,26 +432,9 @@ void CParty::RemovePartyLeader(CBattleEntity* PEntity)
     }
 }
 
-std::vector<CParty::partyInfo_t> CParty::GetPartyInfo()
+std::vector<partyInfo_t> CParty::GetPartyInfo()
 {
-    std::vector<CParty::partyInfo_t> memberinfo;
-    int ret = Sql_Query(SqlHandle, "SELECT chars.charid, partyid, allianceid, charname, partyflag, pos_zone, pos_prevzone FROM accounts_parties \
-                                    LEFT JOIN chars ON accounts_parties.charid = chars.charid WHERE \
-                                    (allianceid <> 0 AND allianceid = %d) OR partyid = %d ORDER BY partyflag & %u, timestamp;",
-        m_PAlliance ? m_PAlliance->m_AllianceID : 0, m_PartyID, PARTY_SECOND | PARTY_THIRD);
-
-    if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
-    {
-        while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-        {
-            memberinfo.push_back({Sql_GetUIntData(SqlHandle,0), Sql_GetUIntData(SqlHandle, 1),
-                Sql_GetUIntData(SqlHandle, 2), std::string((const char*)Sql_GetData(SqlHandle, 3)),
-                static_cast<uint16>(Sql_GetUIntData(SqlHandle, 4)),
-                static_cast<uint16>(Sql_GetUIntData(SqlHandle, 5)),
-                static_cast<uint16>(Sql_GetUIntData(SqlHandle, 6))});
-        }
-    }
-    return memberinfo;
+    return partyroster::GetMembers(m_PartyID, m_PAlliance ? m_PAlliance->m_AllianceID : 0);
 }
 
 /************************************************************************
@@ -806,7 +779,7 @@ void CParty::ReloadPartyMembers(CCharEntity* PChar)
             alliance = memberinfo.flags & (PARTY_SECOND | PARTY_THIRD);
             j = 0;
         }
-        CCharEntity* PPartyMember = zoneutils::GetChar(memberinfo.zone);
+        CCharEntity* PPartyMember = zoneutils::GetChar(memberinfo.id);
         if (PPartyMember)
         {
             PChar->pushPacket(new CPartyMemberUpdatePacket(PPartyMember, j, memberinfo.flags, PChar->getZone()));
@@ -923,6 +896,7 @@ void CParty::SetLeader(const char* MemberName)
 
         m_PartyID = newId;
         Sql_Query(SqlHandle, "UPDATE accounts_parties SET partyflag = partyflag | IF(allianceid = partyid, %d, %d) WHERE charid = %u", ALLIANCE_LEADER | PARTY_LEADER, PARTY_LEADER, newId);
+        partyroster::Refresh(m_PartyID);
     }
     else
     {
@@ -993,6 +967,7 @@ void CParty::SetSyncTarget(int8* MemberName, uint16 message)
                 }
                 Sql_Query(SqlHandle, "UPDATE accounts_parties SET partyflag = partyflag & ~%d WHERE partyid = %u AND partyflag & %d", PARTY_SYNC, m_PartyID, PARTY_SYNC);
                 Sql_Query(SqlHandle, "UPDATE accounts_parties SET partyflag = partyflag | %d WHERE partyid = %u AND charid = '%u';", PARTY_SYNC, m_PartyID, PChar->id);
+                partyroster::SetFlag(m_PartyID, (const char*)PChar->GetName(), PARTY_SYNC);
             }
         }
         else
@@ -1020,6 +995,7 @@ void CParty::SetSyncTarget(int8* MemberName, uint16 message)
             }
             m_PSyncTarget = nullptr;
             Sql_Query(SqlHandle, "UPDATE accounts_parties SET partyflag = partyflag & ~%d WHERE partyid = %u AND partyflag & %d", PARTY_SYNC, m_PartyID, PARTY_SYNC);
+            partyroster::SetFlag(m_PartyID, nullptr, PARTY_SYNC);
         }
     }
 }
@@ -1040,6 +1016,7 @@ void CParty::SetQuarterMaster(const char* MemberName)
         Sql_Query(SqlHandle, "UPDATE accounts_parties JOIN chars ON accounts_parties.charid = chars.charid \
                               SET partyflag = partyflag | %d WHERE partyid = %u AND charname = '%s';", PARTY_QM, m_PartyID, MemberName);
     }
+    partyroster::SetFlag(m_PartyID, MemberName, PARTY_QM);
 }
 
 /************************************************************************
@@ -1052,6 +1029,8 @@ void CParty::SetQuarterMaster(const char* MemberName)
 
 void CParty::PushPacket(uint32 senderID, uint16 ZoneID, CBasicPacket* packet)
 {
+    std::shared_ptr<CBasicPacket> sharedPacket(packet);
+
     for (uint32 i = 0; i < members.size(); ++i)
     {
         if (members.at(i) == nullptr || members.at(i)->objtype != TYPE_PC)
@@ -1067,11 +1046,10 @@ void CParty::PushPacket(uint32 senderID, uint16 ZoneID, CBasicPacket* packet)
         {
             if (ZoneID == 0 || member->getZone() == ZoneID)
             {
-                member->pushPacket(new CBasicPacket(*packet));
+                member->pushPacket(sharedPacket);
             }
         }
     }
-    delete packet;
 }
 
 void CParty::PushEffectsPacket()
@@ -23,6 +23,7 @@
 #define _CPARTY_H
 
 #include "map.h"
+#include "party_roster.h"
 #include "../common/cbasetypes.h"
 
 #include <vector>
@@ -98,7 +99,6 @@ public:
 
 private:
 
-    struct partyInfo_t;
     uint32    m_PartyID;                                // уникальный ID группы
     PARTYTYPE m_PartyType;                              // тип существ, составляющих группу
     uint8     m_PartyNumber;                            // party number in alliance
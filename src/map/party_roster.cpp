@@ -0,0 +1,370 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#include "../common/showmsg.h"
+#include "../common/socket.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "party_roster.h"
+#include "party.h"
+#include "map.h"
+
+namespace partyroster
+{
+    // wire layout of a snapshot: header, then one fixed-size record per member
+    constexpr size_t headerSize = 12;   // origin ip, origin port, member count, scope id
+    constexpr size_t nameSize   = 16;
+    constexpr size_t rowSize    = 22 + nameSize;
+
+    std::mutex rosterMutex;
+    std::unordered_map<uint32, std::vector<partyInfo_t>> parties;       // partyid -> member rows
+    std::unordered_map<uint32, uint32> charParty;                        // charid -> partyid
+    std::unordered_map<uint32, std::unordered_set<uint32>> alliances;    // allianceid -> partyids seen in it
+
+    /************************************************************************
+    *                                                                       *
+    *  Index maintenance, rosterMutex must be held                          *
+    *                                                                       *
+    ************************************************************************/
+
+    void eraseChar(uint32 charid)
+    {
+        auto it = charParty.find(charid);
+        if (it == charParty.end())
+        {
+            return;
+        }
+        auto party = parties.find(it->second);
+        if (party != parties.end())
+        {
+            auto& rows = party->second;
+            rows.erase(std::remove_if(rows.begin(), rows.end(), [charid](const partyInfo_t& row) { return row.id == charid; }), rows.end());
+            if (rows.empty())
+            {
+                parties.erase(party);
+            }
+        }
+        charParty.erase(it);
+    }
+
+    // drops every row of party id and every row tagged with alliance id
+    void eraseScope(uint32 id)
+    {
+        auto party = parties.find(id);
+        if (party != parties.end())
+        {
+            for (auto& row : party->second)
+            {
+                charParty.erase(row.id);
+            }
+            parties.erase(party);
+        }
+
+        auto alliance = alliances.find(id);
+        if (alliance != alliances.end())
+        {
+            for (auto partyid : alliance->second)
+            {
+                auto it = parties.find(partyid);
+                if (it == parties.end())
+                {
+                    continue;
+                }
+                auto& rows = it->second;
+                rows.erase(std::remove_if(rows.begin(), rows.end(), [id](const partyInfo_t& row)
+                {
+                    if (row.allianceid != id)
+                    {
+                        return false;
+                    }
+                    charParty.erase(row.id);
+                    return true;
+                }), rows.end());
+                if (rows.empty())
+                {
+                    parties.erase(it);
+                }
+            }
+            alliances.erase(alliance);
+        }
+    }
+
+    void insertRow(const partyInfo_t& info)
+    {
+        eraseChar(info.id);
+        parties[info.partyid].push_back(info);
+        charParty[info.id] = info.partyid;
+        if (info.allianceid != 0)
+        {
+            alliances[info.allianceid].insert(info.partyid);
+        }
+    }
+
+    // replaces everything known about party/alliance id with rows
+    void replace(uint32 id, const std::vector<partyInfo_t>& rows)
+    {
+        std::lock_guard<std::mutex> lk(rosterMutex);
+
+        eraseScope(id);
+        for (auto& row : rows)
+        {
+            if (row.allianceid != 0 && row.allianceid != id)
+            {
+                eraseScope(row.allianceid);
+            }
+        }
+        for (auto& row : rows)
+        {
+            insertRow(row);
+        }
+    }
+
+    bool load(uint32 id, std::vector<partyInfo_t>& rows)
+    {
+        int32 ret = Sql_Query(SqlHandle, "SELECT p.charid, partyid, allianceid, charname, partyflag, pos_zone, pos_prevzone, UNIX_TIMESTAMP(timestamp) \
+                                          FROM accounts_parties p LEFT JOIN chars ON p.charid = chars.charid \
+                                          WHERE partyid = %u OR allianceid = %u OR (allianceid <> 0 AND allianceid = \
+                                          (SELECT MAX(allianceid) FROM accounts_parties WHERE partyid = %u)) \
+                                          ORDER BY partyflag & %u, timestamp;",
+            id, id, id, PARTY_SECOND | PARTY_THIRD);
+
+        if (ret == SQL_ERROR)
+        {
+            return false;
+        }
+        while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+        {
+            const char* name = (const char*)Sql_GetData(SqlHandle, 3);
+            rows.push_back({ Sql_GetUIntData(SqlHandle, 0), Sql_GetUIntData(SqlHandle, 1), Sql_GetUIntData(SqlHandle, 2),
+                std::string(name ? name : ""),
+                static_cast<uint16>(Sql_GetUIntData(SqlHandle, 4)),
+                static_cast<uint16>(Sql_GetUIntData(SqlHandle, 5)),
+                static_cast<uint16>(Sql_GetUIntData(SqlHandle, 6)),
+                Sql_GetUIntData(SqlHandle, 7) });
+        }
+        return true;
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Lookups                                                              *
+    *                                                                       *
+    ************************************************************************/
+
+    std::vector<partyInfo_t> GetMembers(uint32 partyid, uint32 allianceid)
+    {
+        std::vector<partyInfo_t> members;
+
+        for (uint8 attempt = 0; attempt < 2; ++attempt)
+        {
+            {
+                std::lock_guard<std::mutex> lk(rosterMutex);
+
+                auto party = parties.find(partyid);
+                if (party != parties.end())
+                {
+                    members = party->second;
+                }
+                if (allianceid != 0)
+                {
+                    auto alliance = alliances.find(allianceid);
+                    if (alliance != alliances.end())
+                    {
+                        for (auto id : alliance->second)
+                        {
+                            auto it = parties.find(id);
+                            if (id == partyid || it == parties.end())
+                            {
+                                continue;
+                            }
+                            for (auto& row : it->second)
+                            {
+                                if (row.allianceid == allianceid)
+                                {
+                                    members.push_back(row);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            if (!members.empty())
+            {
+                break;
+            }
+            // nothing cached yet (first member on this server), fetch it once
+            Refresh(allianceid != 0 ? allianceid : partyid);
+        }
+
+        std::stable_sort(members.begin(), members.end(), [](const partyInfo_t& a, const partyInfo_t& b)
+        {
+            uint16 numberA = a.flags & (PARTY_SECOND | PARTY_THIRD);
+            uint16 numberB = b.flags & (PARTY_SECOND | PARTY_THIRD);
+            return numberA != numberB ? numberA < numberB : a.timestamp < b.timestamp;
+        });
+        return members;
+    }
+
+    bool GetMember(uint32 charid, partyInfo_t& info)
+    {
+        std::lock_guard<std::mutex> lk(rosterMutex);
+
+        auto it = charParty.find(charid);
+        if (it == charParty.end())
+        {
+            return false;
+        }
+        for (auto& row : parties[it->second])
+        {
+            if (row.id == charid)
+            {
+                info = row;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Updates                                                              *
+    *                                                                       *
+    ************************************************************************/
+
+    void Refresh(uint32 id)
+    {
+        std::vector<partyInfo_t> rows;
+        if (load(id, rows))
+        {
+            replace(id, rows);
+        }
+    }
+
+    void RefreshChar(uint32 charid)
+    {
+        int32 ret = Sql_Query(SqlHandle, "SELECT partyid FROM accounts_parties WHERE charid = %u;", charid);
+
+        if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0 && Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+        {
+            Refresh(Sql_GetUIntData(SqlHandle, 0));
+        }
+        else if (ret != SQL_ERROR)
+        {
+            Remove(charid);
+        }
+    }
+
+    void Remove(uint32 charid)
+    {
+        std::lock_guard<std::mutex> lk(rosterMutex);
+        eraseChar(charid);
+    }
+
+    void SetFlag(uint32 partyid, const char* name, uint16 flag)
+    {
+        std::lock_guard<std::mutex> lk(rosterMutex);
+
+        auto party = parties.find(partyid);
+        if (party == parties.end())
+        {
+            return;
+        }
+        for (auto& row : party->second)
+        {
+            row.flags &= ~flag;
+            if (name && strcmpi(row.name.c_str(), name) == 0)
+            {
+                row.flags |= flag;
+            }
+        }
+    }
+
+    std::vector<uint8> Snapshot(uint32 id)
+    {
+        std::vector<partyInfo_t> rows;
+        if (!load(id, rows))
+        {
+            return {};
+        }
+        replace(id, rows);
+
+        std::vector<uint8> data(headerSize + rows.size() * rowSize);
+        ref<uint32>(data.data(), 0) = map_ip.s_addr;
+        ref<uint16>(data.data(), 4) = map_port;
+        ref<uint16>(data.data(), 6) = (uint16)rows.size();
+        ref<uint32>(data.data(), 8) = id;
+
+        uint8* row = data.data() + headerSize;
+        for (auto& info : rows)
+        {
+            ref<uint32>(row, 0) = info.id;
+            ref<uint32>(row, 4) = info.partyid;
+            ref<uint32>(row, 8) = info.allianceid;
+            ref<uint32>(row, 12) = info.timestamp;
+            ref<uint16>(row, 16) = info.flags;
+            ref<uint16>(row, 18) = info.zone;
+            ref<uint16>(row, 20) = info.prev_zone;
+            memcpy(row + 22, info.name.c_str(), std::min(info.name.size(), nameSize - 1));
+            row += rowSize;
+        }
+        return data;
+    }
+
+    void Apply(uint8* data, size_t size)
+    {
+        if (size < headerSize)
+        {
+            return;
+        }
+        // the sender applied its own snapshot when it was taken
+        if (ref<uint32>(data, 0) == map_ip.s_addr && ref<uint16>(data, 4) == map_port)
+        {
+            return;
+        }
+
+        uint16 count = ref<uint16>(data, 6);
+        uint32 id = ref<uint32>(data, 8);
+        if (size < headerSize + count * rowSize)
+        {
+            ShowWarning("partyroster: truncated snapshot for party %u\n", id);
+            return;
+        }
+
+        std::vector<partyInfo_t> rows;
+        rows.reserve(count);
+
+        uint8* row = data + headerSize;
+        for (uint16 i = 0; i < count; ++i)
+        {
+            char name[nameSize] {};
+            memcpy(name, row + 22, nameSize - 1);
+            rows.push_back({ ref<uint32>(row, 0), ref<uint32>(row, 4), ref<uint32>(row, 8), name,
+                ref<uint16>(row, 16), ref<uint16>(row, 18), ref<uint16>(row, 20), ref<uint32>(row, 12) });
+            row += rowSize;
+        }
+        replace(id, rows);
+    }
+};
@@ -0,0 +1,69 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#ifndef _PARTYROSTER_H
+#define _PARTYROSTER_H
+
+#include "../common/cbasetypes.h"
+
+#include <string>
+#include <vector>
+
+/************************************************************************
+*                                                                       *
+*  In-memory copy of accounts_parties.                                  *
+*                                                                       *
+*  Party reloads read member rows from here instead of the database.    *
+*  The table is still written synchronously (the message server routes  *
+*  party traffic from it); after a write the sender reloads the         *
+*  affected party or alliance once and attaches the rows to its         *
+*  MSG_PT_RELOAD, so every other map server updates without a query.    *
+*                                                                       *
+************************************************************************/
+
+struct partyInfo_t
+{
+    uint32      id;             // charid
+    uint32      partyid;
+    uint32      allianceid;
+    std::string name;
+    uint16      flags;
+    uint16      zone;
+    uint16      prev_zone;
+    uint32      timestamp;      // join time, orders members inside a party
+};
+
+namespace partyroster
+{
+    // rows of the party, or of the whole alliance when allianceid != 0, in party list order
+    std::vector<partyInfo_t> GetMembers(uint32 partyid, uint32 allianceid);
+    bool   GetMember(uint32 charid, partyInfo_t& info);
+
+    void   Refresh(uint32 id);                  // reloads party/alliance id from the database
+    void   RefreshChar(uint32 charid);          // reloads whatever party the character is in
+    void   Remove(uint32 charid);
+    void   SetFlag(uint32 partyid, const char* name, uint16 flag);    // moves flag to the named member, nullptr clears it
+
+    std::vector<uint8> Snapshot(uint32 id);     // Refresh(id) and serialize the result for MSG_PT_RELOAD
+    void   Apply(uint8* data, size_t size);
+};
+
+#endif
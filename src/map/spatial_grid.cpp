@@ -0,0 +1,91 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#include "spatial_grid.h"
+
+#include "entities/baseentity.h"
+
+#include <cmath>
+
+int32 CSpatialGrid::CellCoord(float coord)
+{
+    return (int32)std::floor(coord / CellSize);
+}
+
+uint32 CSpatialGrid::CellKey(int32 x, int32 z)
+{
+    return ((uint32)(uint16)x << 16) | (uint16)z;
+}
+
+const position_t& CSpatialGrid::EntityPos(CBaseEntity* PEntity)
+{
+    return PEntity->loc.p;
+}
+
+void CSpatialGrid::Update(CBaseEntity* PEntity)
+{
+    uint32 key = CellKey(CellCoord(PEntity->loc.p.x), CellCoord(PEntity->loc.p.z));
+
+    auto filed = m_entityCell.find(PEntity);
+    if (filed != m_entityCell.end())
+    {
+        if (filed->second == key)
+        {
+            return;
+        }
+        auto& oldCell = m_cells[filed->second];
+        auto it = std::find(oldCell.begin(), oldCell.end(), PEntity);
+        if (it != oldCell.end())
+        {
+            *it = oldCell.back();
+            oldCell.pop_back();
+        }
+        filed->second = key;
+    }
+    else
+    {
+        m_entityCell.emplace(PEntity, key);
+    }
+    m_cells[key].push_back(PEntity);
+}
+
+void CSpatialGrid::Remove(CBaseEntity* PEntity)
+{
+    auto filed = m_entityCell.find(PEntity);
+    if (filed == m_entityCell.end())
+    {
+        return;
+    }
+    auto& cell = m_cells[filed->second];
+    auto it = std::find(cell.begin(), cell.end(), PEntity);
+    if (it != cell.end())
+    {
+        *it = cell.back();
+        cell.pop_back();
+    }
+    m_entityCell.erase(filed);
+}
+
+void CSpatialGrid::Clear()
+{
+    m_cells.clear();
+    m_entityCell.clear();
+}
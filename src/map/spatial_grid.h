@@ -0,0 +1,97 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#ifndef _CSPATIALGRID_H
+#define _CSPATIALGRID_H
+
+#include "../common/cbasetypes.h"
+#include "../common/mmo.h"
+#include "../common/utils.h"
+
+#include <unordered_map>
+#include <vector>
+
+class CBaseEntity;
+
+/************************************************************************
+*                                                                       *
+*  Uniform grid over the x/z plane of a zone, answers radius queries    *
+*  without walking every entity of the zone.                            *
+*                                                                       *
+*  Cells are refreshed by Update(), which the zone calls for every      *
+*  entity once per tick, so an entity may be found up to one tick of    *
+*  movement away from where it was filed. Queries widen the searched    *
+*  area by Margin and then test the exact (current) distance.           *
+*                                                                       *
+************************************************************************/
+
+class CSpatialGrid
+{
+public:
+
+    static constexpr float CellSize = 32.f;
+    static constexpr float Margin   = 8.f;
+
+    void    Update(CBaseEntity* PEntity);                                   // file the entity under the cell of its current position
+    void    Remove(CBaseEntity* PEntity);
+    void    Clear();
+
+    // calls func(CBaseEntity*) for every entity closer than radius to center
+    template<typename F>
+    void    ForEachInRange(const position_t& center, float radius, F func) const
+    {
+        const float radiusSq = radius * radius;
+        const int32 minX = CellCoord(center.x - radius - Margin);
+        const int32 maxX = CellCoord(center.x + radius + Margin);
+        const int32 minZ = CellCoord(center.z - radius - Margin);
+        const int32 maxZ = CellCoord(center.z + radius + Margin);
+
+        for (int32 x = minX; x <= maxX; ++x)
+        {
+            for (int32 z = minZ; z <= maxZ; ++z)
+            {
+                auto cell = m_cells.find(CellKey(x, z));
+                if (cell == m_cells.end())
+                {
+                    continue;
+                }
+                for (CBaseEntity* PEntity : cell->second)
+                {
+                    if (distanceSquared(center, EntityPos(PEntity)) < radiusSq)
+                    {
+                        func(PEntity);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+
+    static int32  CellCoord(float coord);
+    static uint32 CellKey(int32 x, int32 z);
+    static const position_t& EntityPos(CBaseEntity* PEntity);
+
+    std::unordered_map<uint32, std::vector<CBaseEntity*>> m_cells;          // entities filed under each cell
+    std::unordered_map<CBaseEntity*, uint32>              m_entityCell;     // cell each entity is filed under
+};
+
+#endif
@@ -0,0 +1,131 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#ifndef _SPAWNLIST_H
+#define _SPAWNLIST_H
+
+#include "../common/cbasetypes.h"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <vector>
+
+class CBaseEntity;
+
+/************************************************************************
+*                                                                       *
+*  Set of entities a character currently has spawned on its client.    *
+*                                                                       *
+*  Entries are kept sorted by id in one contiguous vector, and a small  *
+*  per-bucket counter (keyed by the low bits of the id, which hold the  *
+*  targid for npcs, mobs and pets) rejects most absent ids without a    *
+*  search. Packet fan-out tests membership for every recipient, so      *
+*  contains() must stay cheap and never copy the list.                  *
+*                                                                       *
+************************************************************************/
+
+class CSpawnList
+{
+public:
+    typedef std::pair<uint32, CBaseEntity*> value_type;
+    typedef std::vector<value_type>::iterator iterator;
+    typedef std::vector<value_type>::const_iterator const_iterator;
+
+    iterator begin() { return m_list.begin(); }
+    iterator end() { return m_list.end(); }
+    const_iterator begin() const { return m_list.begin(); }
+    const_iterator end() const { return m_list.end(); }
+
+    size_t size() const { return m_list.size(); }
+    bool empty() const { return m_list.empty(); }
+
+    void clear()
+    {
+        m_list.clear();
+        m_buckets.fill(0);
+    }
+
+    bool contains(uint32 id) const
+    {
+        return m_buckets[id & BUCKET_MASK] != 0 && find(id) != end();
+    }
+
+    iterator find(uint32 id)
+    {
+        iterator it = lower_bound(id);
+        return (it != end() && it->first == id) ? it : end();
+    }
+
+    const_iterator find(uint32 id) const
+    {
+        const_iterator it = std::lower_bound(m_list.begin(), m_list.end(), id, compare);
+        return (it != end() && it->first == id) ? it : end();
+    }
+
+    iterator lower_bound(uint32 id)
+    {
+        return std::lower_bound(m_list.begin(), m_list.end(), id, compare);
+    }
+
+    // returns false if the id was already in the list
+    bool insert(uint32 id, CBaseEntity* PEntity)
+    {
+        iterator it = lower_bound(id);
+        if (it != end() && it->first == id)
+        {
+            return false;
+        }
+        m_list.emplace(it, id, PEntity);
+        m_buckets[id & BUCKET_MASK]++;
+        return true;
+    }
+
+    iterator erase(iterator it)
+    {
+        m_buckets[it->first & BUCKET_MASK]--;
+        return m_list.erase(it);
+    }
+
+    size_t erase(uint32 id)
+    {
+        iterator it = find(id);
+        if (it == end())
+        {
+            return 0;
+        }
+        erase(it);
+        return 1;
+    }
+
+private:
+    static constexpr uint32 BUCKET_MASK = 0x3FF;
+
+    static bool compare(const value_type& entry, uint32 id)
+    {
+        return entry.first < id;
+    }
+
+    std::vector<value_type> m_list;
+    std::array<uint16, BUCKET_MASK + 1> m_buckets {};
+};
+
+#endif
@@ -0,0 +1,312 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+
+#include "../common/showmsg.h"
+#include "../common/sql.h"
+
+#include "startup_loader.h"
+#include "map.h"
+
+#include "lua/luautils.h"
+
+CStartupLoader::CStartupLoader(uint8 threads)
+{
+    m_threads = threads;
+    m_total = duration::zero();
+    m_finished = 0;
+    m_workers = 0;
+}
+
+void CStartupLoader::AddStage(const std::string& name, std::vector<std::string> after, std::function<void()> func)
+{
+    AddStage(name, std::move(after), std::move(func), false);
+}
+
+void CStartupLoader::AddSerialStage(const std::string& name, std::vector<std::string> after, std::function<void()> func)
+{
+    AddStage(name, std::move(after), std::move(func), true);
+}
+
+void CStartupLoader::AddStage(const std::string& name, std::vector<std::string> after, std::function<void()> func, bool serial)
+{
+    stage_t stage;
+    stage.name = name;
+    stage.after = std::move(after);
+    stage.func = std::move(func);
+    stage.serial = serial;
+    stage.waiting = 0;
+    stage.thread = 0;
+    stage.begin = duration::zero();
+    stage.elapsed = duration::zero();
+
+    m_stages.push_back(std::move(stage));
+}
+
+/************************************************************************
+*                                                                       *
+*  Resolves 'after' names and rejects graphs that could never finish    *
+*                                                                       *
+************************************************************************/
+
+bool CStartupLoader::Link()
+{
+    std::unordered_map<std::string, size_t> index;
+    for (size_t i = 0; i < m_stages.size(); ++i)
+    {
+        index[m_stages[i].name] = i;
+    }
+
+    for (size_t i = 0; i < m_stages.size(); ++i)
+    {
+        for (auto& name : m_stages[i].after)
+        {
+            auto it = index.find(name);
+            if (it == index.end())
+            {
+                ShowFatalError("CStartupLoader: stage '%s' waits on unknown stage '%s'\n", m_stages[i].name.c_str(), name.c_str());
+                return false;
+            }
+            m_stages[it->second].next.push_back(i);
+            m_stages[i].waiting++;
+        }
+    }
+
+    std::vector<size_t> waiting(m_stages.size());
+    std::vector<size_t> ready;
+    for (size_t i = 0; i < m_stages.size(); ++i)
+    {
+        waiting[i] = m_stages[i].waiting;
+        if (waiting[i] == 0)
+        {
+            ready.push_back(i);
+        }
+    }
+
+    size_t reached = 0;
+    while (!ready.empty())
+    {
+        size_t i = ready.back();
+        ready.pop_back();
+        reached++;
+
+        for (size_t n : m_stages[i].next)
+        {
+            if (--waiting[n] == 0)
+            {
+                ready.push_back(n);
+            }
+        }
+    }
+
+    if (reached != m_stages.size())
+    {
+        ShowFatalError("CStartupLoader: stage dependencies contain a cycle\n");
+        return false;
+    }
+    return true;
+}
+
+void CStartupLoader::RunStage(size_t index, uint8 thread)
+{
+    stage_t& stage = m_stages[index];
+
+    auto begin = server_clock::now();
+    stage.thread = thread;
+    stage.begin = begin - m_start;
+
+    stage.func();
+
+    stage.elapsed = server_clock::now() - begin;
+}
+
+// called with m_mutex held
+void CStartupLoader::Finish(size_t index)
+{
+    m_finished++;
+
+    for (size_t n : m_stages[index].next)
+    {
+        if (--m_stages[n].waiting == 0)
+        {
+            (m_stages[n].serial ? m_serialQueue : m_workerQueue).push_back(n);
+        }
+    }
+    m_condition.notify_all();
+}
+
+void CStartupLoader::WorkerLoop(uint8 thread)
+{
+    SqlHandle = Sql_Malloc();
+
+    if (Sql_Connect(SqlHandle, map_config.mysql_login.c_str(),
+        map_config.mysql_password.c_str(),
+        map_config.mysql_host.c_str(),
+        map_config.mysql_port,
+        map_config.mysql_database.c_str()) == SQL_ERROR)
+    {
+        Sql_Free(SqlHandle);
+        SqlHandle = nullptr;
+
+        ShowWarning("CStartupLoader: worker %u could not connect to the database\n", thread);
+
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_workers--;
+        m_condition.notify_all();
+        return;
+    }
+
+    std::unique_lock<std::mutex> lk(m_mutex);
+    while (true)
+    {
+        m_condition.wait(lk, [this] { return !m_workerQueue.empty() || m_finished == m_stages.size(); });
+
+        if (m_workerQueue.empty())
+        {
+            break;
+        }
+
+        size_t index = m_workerQueue.front();
+        m_workerQueue.pop_front();
+
+        lk.unlock();
+        RunStage(index, thread);
+        lk.lock();
+
+        Finish(index);
+    }
+    m_workers--;
+    lk.unlock();
+
+    Sql_Free(SqlHandle);
+    SqlHandle = nullptr;
+}
+
+/************************************************************************
+*                                                                       *
+*  The calling thread runs serial stages as they become ready, and      *
+*  takes over worker stages only if no worker managed to connect.       *
+*                                                                       *
+************************************************************************/
+
+bool CStartupLoader::Run()
+{
+    if (!Link())
+    {
+        return false;
+    }
+
+    m_start = server_clock::now();
+    m_finished = 0;
+
+    for (size_t i = 0; i < m_stages.size(); ++i)
+    {
+        if (m_stages[i].waiting == 0)
+        {
+            (m_stages[i].serial ? m_serialQueue : m_workerQueue).push_back(i);
+        }
+    }
+
+    m_workers = m_threads;
+
+    std::vector<std::thread> pool;
+    for (uint8 i = 1; i <= m_threads; ++i)
+    {
+        pool.emplace_back(&CStartupLoader::WorkerLoop, this, i);
+    }
+
+    std::unique_lock<std::mutex> lk(m_mutex);
+    while (m_finished < m_stages.size())
+    {
+        size_t index;
+
+        if (!m_serialQueue.empty())
+        {
+            index = m_serialQueue.front();
+            m_serialQueue.pop_front();
+        }
+        else if (!m_workerQueue.empty() && m_workers == 0)
+        {
+            index = m_workerQueue.front();
+            m_workerQueue.pop_front();
+        }
+        else
+        {
+            m_condition.wait(lk);
+            continue;
+        }
+
+        lk.unlock();
+        if (m_stages[index].serial)
+        {
+            std::lock_guard<std::recursive_mutex> lua(luautils::LuaMutex);
+            RunStage(index, 0);
+        }
+        else
+        {
+            RunStage(index, 0);
+        }
+        lk.lock();
+
+        Finish(index);
+    }
+    lk.unlock();
+
+    for (auto& worker : pool)
+    {
+        worker.join();
+    }
+
+    m_total = server_clock::now() - m_start;
+    return true;
+}
+
+void CStartupLoader::PrintTimings()
+{
+    std::vector<const stage_t*> stages;
+    duration sum = duration::zero();
+    for (auto& stage : m_stages)
+    {
+        stages.push_back(&stage);
+        sum += stage.elapsed;
+    }
+    std::sort(stages.begin(), stages.end(), [](const stage_t* a, const stage_t* b) { return a->begin < b->begin; });
+
+    auto ms = [](duration d) { return (unsigned long long)std::chrono::duration_cast<std::chrono::milliseconds>(d).count(); };
+
+    ShowInfo("Startup stages: %llu ms wall clock, %llu ms of loading, %u worker threads\n", ms(m_total), ms(sum), m_threads);
+    for (auto stage : stages)
+    {
+        char thread[16];
+        if (stage->thread == 0)
+        {
+            snprintf(thread, sizeof(thread), "main");
+        }
+        else
+        {
+            snprintf(thread, sizeof(thread), "worker %u", stage->thread);
+        }
+        ShowInfo("  %-24s %8llu ms, started at %6llu ms on %s\n", stage->name.c_str(), ms(stage->elapsed), ms(stage->begin), thread);
+    }
+}
@@ -0,0 +1,90 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#ifndef _CSTARTUPLOADER_H
+#define _CSTARTUPLOADER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../common/cbasetypes.h"
+
+/************************************************************************
+*                                                                       *
+*  Runs the map server's startup loaders as a dependency graph.         *
+*                                                                       *
+*  A stage starts once every stage it names in 'after' has finished.    *
+*  Worker stages run on a pool of threads, each with its own SqlHandle. *
+*  Serial stages always run on the thread that called Run() while       *
+*  holding luautils::LuaMutex, so they may use Lua and the task manager.*
+*                                                                       *
+************************************************************************/
+
+class CStartupLoader
+{
+public:
+    CStartupLoader(uint8 threads);
+
+    void AddStage(const std::string& name, std::vector<std::string> after, std::function<void()> func);
+    void AddSerialStage(const std::string& name, std::vector<std::string> after, std::function<void()> func);
+
+    bool Run();                 // false if the graph names an unknown stage or has a cycle
+    void PrintTimings();
+
+private:
+    struct stage_t
+    {
+        std::string              name;
+        std::vector<std::string> after;
+        std::function<void()>    func;
+        bool                     serial;
+
+        std::vector<size_t>      next;      // stages waiting on this one
+        size_t                   waiting;   // unfinished stages this one waits on
+        uint8                    thread;    // 0 = main thread
+        duration                 begin;     // relative to the start of Run()
+        duration                 elapsed;
+    };
+
+    std::vector<stage_t> m_stages;
+    uint8                m_threads;
+    time_point           m_start;
+    duration             m_total;
+
+    std::mutex              m_mutex;
+    std::condition_variable m_condition;
+    std::deque<size_t>      m_workerQueue;
+    std::deque<size_t>      m_serialQueue;
+    size_t                  m_finished;
+    uint8                   m_workers;      // worker threads that are connected and still running
+
+    void AddStage(const std::string& name, std::vector<std::string> after, std::function<void()> func, bool serial);
+    bool Link();
+    void RunStage(size_t index, uint8 thread);
+    void Finish(size_t index);
+    void WorkerLoop(uint8 thread);
+};
+
+#endif
@@ -0,0 +1,283 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#include "../../common/showmsg.h"
+#include "../../common/taskmgr.h"
+
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "auctionutils.h"
+#include "itemutils.h"
+#include "../entities/charentity.h"
+#include "../map.h"
+#include "../write_behind.h"
+
+namespace auctionutils
+{
+    constexpr uint32 HistorySize = 7;   // listings the client shows in the sales status window
+
+    typedef std::set<std::pair<uint32, uint32>> PriceQueue_t;  // (price, id), cheapest and then oldest first
+
+    std::unordered_map<uint32, AuctionListing_t> g_Listings;   // id -> open listing
+    std::unordered_map<uint32, PriceQueue_t> g_OrderBook;       // itemid << 1 | stack -> listings by price
+    std::unordered_map<uint32, std::set<uint32>> g_SellerListings; // seller -> listing ids, oldest first
+    uint32 g_NextListingID = 1;
+
+    uint32 BookKey(uint16 itemid, uint8 stack)
+    {
+        return ((uint32)itemid << 1) | (stack != 0);
+    }
+
+    void Insert(const AuctionListing_t& listing)
+    {
+        g_Listings[listing.id] = listing;
+        g_OrderBook[BookKey(listing.itemid, listing.stack)].emplace(listing.price, listing.id);
+        g_SellerListings[listing.seller].insert(listing.id);
+    }
+
+    void Remove(const AuctionListing_t& listing)
+    {
+        auto book = g_OrderBook.find(BookKey(listing.itemid, listing.stack));
+        if (book != g_OrderBook.end())
+        {
+            book->second.erase({ listing.price, listing.id });
+            if (book->second.empty())
+            {
+                g_OrderBook.erase(book);
+            }
+        }
+        auto seller = g_SellerListings.find(listing.seller);
+        if (seller != g_SellerListings.end())
+        {
+            seller->second.erase(listing.id);
+            if (seller->second.empty())
+            {
+                g_SellerListings.erase(seller);
+            }
+        }
+        g_Listings.erase(listing.id);
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Loads all open listings. Ids of new listings continue after the      *
+    *  highest id in the table, sold rows included.                         *
+    *                                                                       *
+    ************************************************************************/
+
+    void Initialize()
+    {
+        if (!map_config.ah_order_book)
+        {
+            return;
+        }
+
+        if (Sql_Query(SqlHandle, "SELECT MAX(id) FROM auction_house;") != SQL_ERROR && Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+        {
+            g_NextListingID = Sql_GetUIntData(SqlHandle, 0) + 1;
+        }
+
+        const char* Query = "SELECT id, itemid, stack, seller, price, date FROM auction_house WHERE buyer_name IS NULL;";
+
+        if (Sql_Query(SqlHandle, Query) != SQL_ERROR)
+        {
+            g_Listings.reserve((size_t)Sql_NumRows(SqlHandle));
+            while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+            {
+                AuctionListing_t listing;
+                listing.id = Sql_GetUIntData(SqlHandle, 0);
+                listing.itemid = (uint16)Sql_GetUIntData(SqlHandle, 1);
+                listing.stack = (uint8)Sql_GetUIntData(SqlHandle, 2);
+                listing.seller = Sql_GetUIntData(SqlHandle, 3);
+                listing.price = Sql_GetUIntData(SqlHandle, 4);
+                listing.date = Sql_GetUIntData(SqlHandle, 5);
+                Insert(listing);
+            }
+        }
+        ShowStatus("auctionutils: %u open listings loaded\n", (uint32)g_Listings.size());
+
+        if (map_config.ah_expire_days > 0)
+        {
+            CTaskMgr::getInstance()->AddTask("ah_expire", server_clock::now() + 1min, nullptr, CTaskMgr::TASK_INTERVAL,
+                [](time_point, CTaskMgr::CTask*) { ExpireListings(); return 0; }, 1h);
+        }
+    }
+
+    bool enabled()
+    {
+        return map_config.ah_order_book;
+    }
+
+    uint32 CountListings(uint32 seller)
+    {
+        auto it = g_SellerListings.find(seller);
+        return it != g_SellerListings.end() ? (uint32)it->second.size() : 0;
+    }
+
+    void LoadHistory(CCharEntity* PChar)
+    {
+        auto it = g_SellerListings.find(PChar->id);
+        if (it == g_SellerListings.end())
+        {
+            return;
+        }
+
+        for (uint32 id : it->second)
+        {
+            if (PChar->m_ah_history.size() >= HistorySize)
+            {
+                break;
+            }
+            const AuctionListing_t& listing = g_Listings[id];
+
+            AuctionHistory_t ah;
+            ah.itemid = listing.itemid;
+            ah.price = listing.price;
+            ah.stack = listing.stack;
+            ah.status = 0;
+            PChar->m_ah_history.push_back(ah);
+        }
+    }
+
+    bool AddListing(CCharEntity* PChar, uint16 itemid, uint8 stack, uint32 price)
+    {
+        AuctionListing_t listing;
+        listing.id = g_NextListingID;
+        listing.itemid = itemid;
+        listing.stack = stack;
+        listing.seller = PChar->id;
+        listing.price = price;
+        listing.date = (uint32)time(nullptr);
+
+        const char* Query = "INSERT INTO auction_house(id, itemid, stack, seller, seller_name, date, price) VALUES(%u,%u,%u,%u,'%s',%u,%u);";
+        if (Sql_Query(SqlHandle, Query, listing.id, itemid, stack, PChar->id, PChar->GetName(), listing.date, price) == SQL_ERROR)
+        {
+            return false;
+        }
+
+        g_NextListingID++;
+        Insert(listing);
+        return true;
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Takes the cheapest listing at or below maxPrice out of the book      *
+    *                                                                       *
+    ************************************************************************/
+
+    bool TakeCheapest(uint16 itemid, uint8 stack, uint32 maxPrice, AuctionListing_t& listing)
+    {
+        auto book = g_OrderBook.find(BookKey(itemid, stack));
+        if (book == g_OrderBook.end() || book->second.begin()->first > maxPrice)
+        {
+            return false;
+        }
+
+        listing = g_Listings[book->second.begin()->second];
+        Remove(listing);
+        return true;
+    }
+
+    bool TakeOwn(uint32 seller, uint16 itemid, uint8 stack, uint32 price, AuctionListing_t& listing)
+    {
+        auto it = g_SellerListings.find(seller);
+        if (it == g_SellerListings.end())
+        {
+            return false;
+        }
+
+        for (uint32 id : it->second)
+        {
+            const AuctionListing_t& candidate = g_Listings[id];
+            if (candidate.itemid == itemid && candidate.stack == stack && candidate.price == price)
+            {
+                listing = candidate;
+                Remove(listing);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Restore(const AuctionListing_t& listing)
+    {
+        Insert(listing);
+    }
+
+    // The commits run on SqlHandle right away, so that the caller can put them in the same
+    // transaction as the inventory change. A missing row means the listing is gone from the
+    // table (the char_delete trigger removes a deleted seller's listings); it must not be restored.
+
+    bool CommitSale(const AuctionListing_t& listing, CCharEntity* PBuyer, uint32 price)
+    {
+        const char* Query = "UPDATE auction_house SET buyer_name = '%s', sale = %u, sell_date = %u WHERE id = %u AND buyer_name IS NULL;";
+
+        return Sql_Query(SqlHandle, Query, PBuyer->GetName(), price, (uint32)time(nullptr), listing.id) != SQL_ERROR &&
+            Sql_AffectedRows(SqlHandle) != 0;
+    }
+
+    bool CommitCancel(const AuctionListing_t& listing)
+    {
+        return Sql_Query(SqlHandle, "DELETE FROM auction_house WHERE id = %u AND sale = 0;", listing.id) != SQL_ERROR &&
+            Sql_AffectedRows(SqlHandle) != 0;
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Sends listings older than ah_expire_days back to their sellers       *
+    *                                                                       *
+    ************************************************************************/
+
+    void ExpireListings()
+    {
+        uint32 cutoff = (uint32)time(nullptr) - map_config.ah_expire_days * 86400;
+
+        std::vector<AuctionListing_t> expired;
+        for (auto& entry : g_Listings)
+        {
+            if (entry.second.date <= cutoff)
+            {
+                expired.push_back(entry.second);
+            }
+        }
+
+        for (auto& listing : expired)
+        {
+            CItem* PItem = itemutils::GetItemPointer(listing.itemid);
+            uint32 quantity = (listing.stack != 0 && PItem != nullptr) ? PItem->getStackSize() : 1;
+
+            Remove(listing);
+            writebehind::Append({
+                fmt::sprintf("INSERT INTO delivery_box (charid, charname, box, itemid, itemsubid, quantity, senderid, sender) VALUES "
+                    "(%u, (SELECT charname FROM chars WHERE charid = %u), 1, %u, 0, %u, 0, 'AH-Jeuno');",
+                    listing.seller, listing.seller, listing.itemid, quantity),
+                fmt::sprintf("DELETE FROM auction_house WHERE id = %u;", listing.id) });
+        }
+
+        if (!expired.empty())
+        {
+            ShowMessage("Sent %u expired auction house items back to sellers\n", (uint32)expired.size());
+        }
+    }
+};
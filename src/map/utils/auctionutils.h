@@ -0,0 +1,72 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#ifndef _AUCTIONUTILS_H
+#define _AUCTIONUTILS_H
+
+#include "../../common/cbasetypes.h"
+
+/************************************************************************
+*                                                                       *
+*  In-memory order book of open auction house listings.                 *
+*                                                                       *
+*  With ah_order_book on, this map server owns auction_house: open      *
+*  listings are loaded once, kept per (itemid, stack) ordered by price  *
+*  and per seller. Listing, buying and cancelling write auction_house   *
+*  on SqlHandle at once, inside the caller's transaction with the       *
+*  matching inventory change; only expiry goes through write-behind.    *
+*                                                                       *
+*  A listing is taken out of the book before the item moves and is      *
+*  either committed or restored afterwards.                             *
+*                                                                       *
+************************************************************************/
+
+class CCharEntity;
+
+struct AuctionListing_t
+{
+    uint32 id;
+    uint16 itemid;
+    uint8  stack;
+    uint32 seller;
+    uint32 price;
+    uint32 date;
+};
+
+namespace auctionutils
+{
+    void   Initialize();
+    bool   enabled();
+
+    uint32 CountListings(uint32 seller);                    // open listings of a seller
+    void   LoadHistory(CCharEntity* PChar);                 // fills m_ah_history with the oldest open listings
+    bool   AddListing(CCharEntity* PChar, uint16 itemid, uint8 stack, uint32 price);
+
+    bool   TakeCheapest(uint16 itemid, uint8 stack, uint32 maxPrice, AuctionListing_t& listing);
+    bool   TakeOwn(uint32 seller, uint16 itemid, uint8 stack, uint32 price, AuctionListing_t& listing);
+    void   Restore(const AuctionListing_t& listing);       // puts a taken listing back
+    bool   CommitSale(const AuctionListing_t& listing, CCharEntity* PBuyer, uint32 price);    // false if the row is gone
+    bool   CommitCancel(const AuctionListing_t& listing);
+
+    void   ExpireListings();
+};
+
+#endif
@@ -68,6 +68,7 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 #include "../grades.h"
 #include "../conquest_system.h"
 #include "../map.h"
+#include "../party_roster.h"
 #include "../spell.h"
 #include "../trait.h"
 #include "../vana_time.h"
@@ -80,6 +81,7 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 #include "../latent_effect_container.h"
 #include "../treasure_pool.h"
 #include "../mob_modifier.h"
+#include "../write_behind.h"
 
 #include "../entities/charentity.h"
 #include "../entities/petentity.h"
@@ -794,6 +796,20 @@ namespace charutils
             PChar->menuConfigFlags.flags = (uint32)Sql_GetUIntData(SqlHandle, 2);
         }
 
+        fmtQuery = "SELECT varname, value FROM char_vars WHERE charid = %u;";
+
+        ret = Sql_Query(SqlHandle, fmtQuery, PChar->id);
+
+        PChar->m_charVars.clear();
+        if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
+        {
+            PChar->m_charVars.reserve((size_t)Sql_NumRows(SqlHandle));
+            while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+            {
+                PChar->m_charVars[(const char*)Sql_GetData(SqlHandle, 0)] = Sql_GetIntData(SqlHandle, 1);
+            }
+        }
+
         charutils::LoadInventory(PChar);
 
         CalculateStats(PChar);
@@ -3863,7 +3879,7 @@ namespace charutils
             "boundary = %u "
             "WHERE charid = %u;";
 
-        Sql_Query(SqlHandle, Query,
+        writebehind::Query(PChar->id, WB_POSITION, 0, Query,
             PChar->loc.p.rotation,
             PChar->loc.p.x,
             PChar->loc.p.y,
@@ -3889,7 +3905,7 @@ namespace charutils
         char questslist[sizeof(PChar->m_questLog) * 2 + 1];
         Sql_EscapeStringLen(SqlHandle, questslist, (const char*)PChar->m_questLog, sizeof(PChar->m_questLog));
 
-        Sql_Query(SqlHandle, Query,
+        writebehind::Query(PChar->id, WB_QUESTS, 0, Query,
             questslist,
             PChar->id);
     }
@@ -3922,7 +3938,7 @@ namespace charutils
             "fame_adoulin = %u "
             "WHERE charid = %u;";
 
-        Sql_Query(SqlHandle, Query,
+        writebehind::Query(PChar->id, WB_FAME, 0, Query,
             PChar->profile.fame[0],
             PChar->profile.fame[1],
             PChar->profile.fame[2],
@@ -3972,7 +3988,7 @@ namespace charutils
         char campaignList[sizeof(PChar->m_campaignLog) * 2 + 1];
         Sql_EscapeStringLen(SqlHandle, campaignList, (const char*)&PChar->m_campaignLog, sizeof(PChar->m_campaignLog));
 
-        Sql_Query(SqlHandle, Query,
+        writebehind::Query(PChar->id, WB_MISSIONS, 0, Query,
             missionslist,
             assaultList,
             campaignList,
@@ -4006,7 +4022,7 @@ namespace charutils
             "wardrobe4 = %u "
             "WHERE charid = %u";
 
-        Sql_Query(SqlHandle, Query,
+        writebehind::Query(PChar->id, WB_INVENTORY_CAPACITY, 0, Query,
             PChar->getStorage(LOC_INVENTORY)->GetSize(),
             PChar->getStorage(LOC_MOGSAFE)->GetSize(),
             PChar->getStorage(LOC_MOGLOCKER)->GetSize(),
@@ -4033,7 +4049,7 @@ namespace charutils
         char keyitems[sizeof(PChar->keys) * 2 + 1];
         Sql_EscapeStringLen(SqlHandle, keyitems, (const char*)&PChar->keys, sizeof(PChar->keys));
 
-        Sql_Query(SqlHandle, fmtQuery, keyitems, PChar->id);
+        writebehind::Query(PChar->id, WB_KEYITEMS, 0, fmtQuery, keyitems, PChar->id);
     }
 
     /************************************************************************
@@ -4083,7 +4099,7 @@ namespace charutils
         Sql_EscapeStringLen(SqlHandle, abilities, (const char*)PChar->m_LearnedAbilities, sizeof(PChar->m_LearnedAbilities));
         Sql_EscapeStringLen(SqlHandle, weaponskills, (const char*)&PChar->m_LearnedWeaponskills, sizeof(PChar->m_LearnedWeaponskills));
 
-        Sql_Query(SqlHandle, Query,
+        writebehind::Query(PChar->id, WB_LEARNED_ABILITIES, 0, Query,
             abilities,
             weaponskills,
             PChar->id);
@@ -4108,7 +4124,7 @@ namespace charutils
         char titles[sizeof(PChar->m_TitleList) * 2 + 1];
         Sql_EscapeStringLen(SqlHandle, titles, (const char*)PChar->m_TitleList, sizeof(PChar->m_TitleList));
 
-        Sql_Query(SqlHandle, Query,
+        writebehind::Query(PChar->id, WB_TITLES, 0, Query,
             titles,
             PChar->profile.title,
             PChar->id);
@@ -4127,7 +4143,7 @@ namespace charutils
         char zones[sizeof(PChar->m_ZonesList) * 2 + 1];
         Sql_EscapeStringLen(SqlHandle, zones, (const char*)PChar->m_ZonesList, sizeof(PChar->m_ZonesList));
 
-        Sql_Query(SqlHandle, fmtQuery, zones, PChar->id);
+        writebehind::Query(PChar->id, WB_ZONES_VISITED, 0, fmtQuery, zones, PChar->id);
     }
 
     /************************************************************************
@@ -4138,18 +4154,33 @@ namespace charutils
 
     void SaveCharEquip(CCharEntity* PChar)
     {
+        // one multi-row statement for the occupied slots and one for the empty ones
+        std::string equipped;
+        std::string empty;
+
         for (uint8 i = 0; i < 18; ++i)
         {
             if (PChar->equip[i] == 0)
             {
-                Sql_Query(SqlHandle, "DELETE FROM char_equip WHERE charid = %u AND  equipslotid = %u LIMIT 1;", PChar->id, i);
+                empty += fmt::sprintf("%s%u", empty.empty() ? "" : ",", i);
             }
             else
             {
-                const char* fmtQuery = "INSERT INTO char_equip SET charid = %u, equipslotid = %u , slotid  = %u, containerid = %u ON DUPLICATE KEY UPDATE slotid  = %u, containerid = %u;";
-                Sql_Query(SqlHandle, fmtQuery, PChar->id, i, PChar->equip[i], PChar->equipLoc[i], PChar->equip[i], PChar->equipLoc[i]);
+                equipped += fmt::sprintf("%s(%u,%u,%u,%u)", equipped.empty() ? "" : ",", PChar->id, i, PChar->equip[i], PChar->equipLoc[i]);
             }
         }
+
+        std::vector<std::string> queries;
+        if (!empty.empty())
+        {
+            queries.push_back(fmt::sprintf("DELETE FROM char_equip WHERE charid = %u AND equipslotid IN (%s);", PChar->id, empty));
+        }
+        if (!equipped.empty())
+        {
+            queries.push_back(fmt::sprintf("INSERT INTO char_equip (charid, equipslotid, slotid, containerid) VALUES %s "
+                "ON DUPLICATE KEY UPDATE slotid = VALUES(slotid), containerid = VALUES(containerid);", equipped));
+        }
+        writebehind::Execute(PChar->id, WB_EQUIP, 0, std::move(queries));
     }
 
     void SaveCharLook(CCharEntity* PChar)
@@ -4159,7 +4190,7 @@ namespace charutils
             "WHERE charid = %u;";
 
         look_t* look = (PChar->getStyleLocked() ? &PChar->mainlook : &PChar->look);
-        Sql_Query(SqlHandle,
+        writebehind::Query(PChar->id, WB_LOOK, 0,
             Query,
             look->head,
             look->body,
@@ -4171,7 +4202,7 @@ namespace charutils
             look->ranged,
             PChar->id);
 
-        Sql_Query(SqlHandle,
+        writebehind::Query(PChar->id, WB_STYLE_LOCK, 0,
             "UPDATE chars SET isstylelocked = %u WHERE charid = %u;",
             PChar->getStyleLocked() ? 1 : 0,
             PChar->id);
@@ -4182,7 +4213,7 @@ namespace charutils
             "hands = VALUES(hands), legs = VALUES(legs), feet = VALUES(feet), "
             "main = VALUES(main), sub = VALUES(sub), ranged = VALUES(ranged);";
 
-        Sql_Query(SqlHandle,
+        writebehind::Query(PChar->id, WB_STYLE, 0,
             Query,
             PChar->id,
             PChar->styleItems[SLOT_HEAD],
@@ -4208,7 +4239,7 @@ namespace charutils
             "pet_id = %u, pet_type = %u, pet_hp = %u, pet_mp = %u "
             "WHERE charid = %u;";
 
-        Sql_Query(SqlHandle,
+        writebehind::Query(PChar->id, WB_STATS, 0,
             Query,
             PChar->health.hp,
             PChar->health.mp,
@@ -4233,15 +4264,15 @@ namespace charutils
     {
         const char* Query = "UPDATE %s SET %s %u WHERE charid = %u;";
 
-        Sql_Query(SqlHandle, Query, "chars", "gmlevel =", PChar->m_GMlevel, PChar->id);
-        Sql_Query(SqlHandle, Query, "char_stats", "nameflags =", PChar->nameflags.flags, PChar->id);
+        writebehind::Query(PChar->id, WB_GMLEVEL, 0, Query, "chars", "gmlevel =", PChar->m_GMlevel, PChar->id);
+        writebehind::Query(PChar->id, WB_NAMEFLAGS, 0, Query, "char_stats", "nameflags =", PChar->nameflags.flags, PChar->id);
     }
 
     void SaveMentorFlag(CCharEntity* PChar)
     {
         const char* Query = "UPDATE %s SET %s %u WHERE charid = %u;";
 
-        Sql_Query(SqlHandle, Query, "chars", "mentor =", PChar->m_mentorUnlocked, PChar->id);
+        writebehind::Query(PChar->id, WB_MENTOR, 0, Query, "chars", "mentor =", PChar->m_mentorUnlocked, PChar->id);
     }
 
     /************************************************************************
@@ -4253,7 +4284,7 @@ namespace charutils
     {
         const char* Query = "UPDATE %s SET %s %u WHERE charid = %u;";
 
-        Sql_Query(SqlHandle, Query, "chars", "nnameflags =", PChar->menuConfigFlags.flags, PChar->id);
+        writebehind::Query(PChar->id, WB_MENU_CONFIG, 0, Query, "chars", "nnameflags =", PChar->menuConfigFlags.flags, PChar->id);
     }
 
     /************************************************************************
@@ -4269,7 +4300,7 @@ namespace charutils
             "SET nation = %u "
             "WHERE charid = %u;";
 
-        Sql_Query(SqlHandle,
+        writebehind::Query(PChar->id, WB_NATION, 0,
             Query,
             PChar->profile.nation,
             PChar->id);
@@ -4288,7 +4319,7 @@ namespace charutils
             "SET campaign_allegiance = %u "
             "WHERE charid = %u;";
 
-        Sql_Query(SqlHandle,
+        writebehind::Query(PChar->id, WB_CAMPAIGN_ALLEGIANCE, 0,
             Query,
             PChar->profile.campaign_allegiance,
             PChar->id);
@@ -4307,7 +4338,7 @@ namespace charutils
             "SET moghancement = %u "
             "WHERE charid = %u;";
 
-        Sql_Query(SqlHandle,
+        writebehind::Query(PChar->id, WB_MOGHANCEMENT, 0,
             Query,
             PChar->m_moghancementID,
             PChar->id);
@@ -4351,7 +4382,7 @@ namespace charutils
             case JOB_RUN: fmtQuery = "UPDATE char_jobs SET unlocked = %u, run = %u WHERE charid = %u LIMIT 1"; break;
             default: fmtQuery = ""; break;
         }
-        Sql_Query(SqlHandle, fmtQuery, PChar->jobs.unlocked, PChar->jobs.job[job], PChar->id);
+        writebehind::Query(PChar->id, WB_JOB, job, fmtQuery, PChar->jobs.unlocked, PChar->jobs.job[job], PChar->id);
 
         if (PChar->isNewPlayer() && PChar->jobs.job[job] >= 5)
         {
@@ -4399,7 +4430,7 @@ namespace charutils
             case JOB_RUN: Query = "UPDATE char_exp SET run = %u, merits = %u, limits = %u WHERE charid = %u"; break;
             default: Query = ""; break;
         }
-        Sql_Query(SqlHandle, Query,
+        writebehind::Query(PChar->id, WB_EXP, job, Query,
             PChar->jobs.exp[job],
             PChar->PMeritPoints->GetMeritPoints(),
             PChar->PMeritPoints->GetLimitPoints(),
@@ -4425,7 +4456,7 @@ namespace charutils
             "rank = %u "
             "ON DUPLICATE KEY UPDATE value = %u, rank = %u;";
 
-        Sql_Query(SqlHandle, Query,
+        writebehind::Query(PChar->id, WB_SKILL, SkillID, Query,
             PChar->id,
             SkillID,
             PChar->RealSkills.skill[SkillID],
@@ -4484,7 +4515,7 @@ namespace charutils
                 char buf[sizeof(PChar->teleport.homepoint) * 2 + 1];
                 Sql_EscapeStringLen(SqlHandle, buf, (const char*)&PChar->teleport.homepoint, sizeof(PChar->teleport.homepoint));
                 const char* query = "UPDATE char_unlocks SET homepoints = '%s' WHERE charid = %u;";
-                Sql_Query(SqlHandle, query, buf, PChar->id);
+                writebehind::Query(PChar->id, WB_TELEPORT, type, query, buf, PChar->id);
                 return;
             }
             case TELEPORT_SURVIVAL:
@@ -4492,7 +4523,7 @@ namespace charutils
                 char buf[sizeof(PChar->teleport.survival) * 2 + 1];
                 Sql_EscapeStringLen(SqlHandle, buf, (const char*)&PChar->teleport.survival, sizeof(PChar->teleport.survival));
                 const char* query = "UPDATE char_unlocks SET survivals = '%s' WHERE charid = %u;";
-                Sql_Query(SqlHandle, query, buf, PChar->id);
+                writebehind::Query(PChar->id, WB_TELEPORT, type, query, buf, PChar->id);
                 return;
             }
             default:
@@ -4501,7 +4532,7 @@ namespace charutils
         }
 
         const char* query = "UPDATE char_unlocks SET %s = %u WHERE charid = %u;";
-        Sql_Query(SqlHandle, query, column, value, PChar->id);
+        writebehind::Query(PChar->id, WB_TELEPORT, type, query, column, value, PChar->id);
     }
 
     float AddExpBonus(CCharEntity* PChar, float exp)
@@ -4549,17 +4580,8 @@ namespace charutils
     }
 
     bool hasMogLockerAccess(CCharEntity* PChar) {
-        char fmtQuery[] = "SELECT value FROM char_vars WHERE charid = %u AND varname = '%s' ";
-        Sql_Query(SqlHandle, fmtQuery, PChar->id, "mog-locker-expiry-timestamp");
-
-        if (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-        {
-            auto tstamp = (uint32)Sql_GetIntData(SqlHandle, 0);
-            if (CVanaTime::getInstance()->getVanaTime() < tstamp) {
-                return true;
-            }
-        }
-        return false;
+        auto tstamp = (uint32)GetCharVar(PChar, "mog-locker-expiry-timestamp");
+        return CVanaTime::getInstance()->getVanaTime() < tstamp;
     }
 
     /************************************************************************
@@ -4622,14 +4644,14 @@ namespace charutils
     void SaveDeathTime(CCharEntity* PChar)
     {
         const char* fmtQuery = "UPDATE char_stats SET death = %u WHERE charid = %u LIMIT 1;";
-        Sql_Query(SqlHandle, fmtQuery, PChar->GetSecondsElapsedSinceDeath(), PChar->id);
+        writebehind::Query(PChar->id, WB_DEATH_TIME, 0, fmtQuery, PChar->GetSecondsElapsedSinceDeath(), PChar->id);
     }
 
     void SavePlayTime(CCharEntity* PChar)
     {
         uint32 playtime = PChar->GetPlayTime();
 
-        Sql_Query(SqlHandle, "UPDATE chars SET playtime = '%u' WHERE charid = '%u' LIMIT 1;", playtime, PChar->id);
+        writebehind::Query(PChar->id, WB_PLAYTIME, 0, "UPDATE chars SET playtime = '%u' WHERE charid = '%u' LIMIT 1;", playtime, PChar->id);
 
         if (PChar->isNewPlayer() && playtime >= 36000)
         {
@@ -4832,13 +4854,19 @@ namespace charutils
 
     void ReloadParty(CCharEntity* PChar)
     {
-        int ret = Sql_Query(SqlHandle, "SELECT partyid, allianceid, partyflag & %d FROM accounts_sessions s JOIN accounts_parties p ON "
-            "s.charid = p.charid WHERE p.charid = %u;", (PARTY_SECOND | PARTY_THIRD), PChar->id);
-        if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0 && Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+        // a character without a party here has just arrived on this server, and the roster
+        // only follows parties that already had a member on it
+        if (!PChar->PParty)
         {
-            uint32 partyid = Sql_GetUIntData(SqlHandle, 0);
-            uint32 allianceid = Sql_GetUIntData(SqlHandle, 1);
-            uint32 partynumber = Sql_GetUIntData(SqlHandle, 2);
+            partyroster::RefreshChar(PChar->id);
+        }
+
+        partyInfo_t info;
+        if (partyroster::GetMember(PChar->id, info))
+        {
+            uint32 partyid = info.partyid;
+            uint32 allianceid = info.allianceid;
+            uint32 partynumber = info.flags & (PARTY_SECOND | PARTY_THIRD);
 
             //first, parties and alliances must be created or linked if the character's current party has changed
             // for example, joining a party from another server
@@ -5029,7 +5057,8 @@ namespace charutils
                 "boundary = %u "
                 "WHERE charid = %u;";
 
-            Sql_Query(SqlHandle, Query,
+            // replaces any position save still waiting in the write-behind queue
+            writebehind::Query(PChar->id, WB_POSITION, 0, Query,
                 PChar->loc.destination,
                 (PChar->m_moghouseID || PChar->loc.destination == PChar->getZone()) ? PChar->loc.prevzone : PChar->getZone(),
                 PChar->loc.p.rotation,
@@ -5093,19 +5122,67 @@ namespace charutils
         return false;
     }
 
+    /************************************************************************
+    *                                                                       *
+    *  char_vars are served from the copy loaded with the character,        *
+    *  changes are written through the write-behind queue                   *
+    *                                                                       *
+    ************************************************************************/
+
     int32 GetCharVar(CCharEntity* PChar, const char* var)
     {
-        const char* fmtQuery = "SELECT value FROM char_vars WHERE charid = %u AND varname = '%s' LIMIT 1;";
+        auto it = PChar->m_charVars.find(var);
+        return it != PChar->m_charVars.end() ? it->second : 0;
+    }
 
-        int32 ret = Sql_Query(SqlHandle, fmtQuery, PChar->id, var);
+    void SetCharVar(CCharEntity* PChar, const char* var, int32 value)
+    {
+        if (value == 0)
+        {
+            if (PChar->m_charVars.erase(var) != 0)
+            {
+                writebehind::Query(PChar->id, WB_CHAR_VAR, var, "DELETE FROM char_vars WHERE charid = %u AND varname = '%s' LIMIT 1;", PChar->id, var);
+            }
+            return;
+        }
 
-        if (ret != SQL_ERROR &&
-            Sql_NumRows(SqlHandle) != 0 &&
-            Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+        auto result = PChar->m_charVars.emplace(var, value);
+        if (!result.second)
         {
-            return Sql_GetIntData(SqlHandle, 0);
+            if (result.first->second == value)
+            {
+                return;
+            }
+            result.first->second = value;
         }
-        return 0;
+
+        const char* fmtQuery = "INSERT INTO char_vars SET charid = %u, varname = '%s', value = %i ON DUPLICATE KEY UPDATE value = %i;";
+        writebehind::Query(PChar->id, WB_CHAR_VAR, var, fmtQuery, PChar->id, var, value, value);
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Deletes a variable of all characters. Characters online in other     *
+    *  map processes keep their copy until they zone, which is why every    *
+    *  process runs the daily guild points reset with onlineOnly set.       *
+    *                                                                       *
+    ************************************************************************/
+
+    void ClearCharVarFromAll(const char* var, bool onlineOnly)
+    {
+        if (!onlineOnly)
+        {
+            Sql_Query(SqlHandle, "DELETE FROM char_vars WHERE varname = '%s';", var);
+        }
+
+        zoneutils::ForEachZone([var](CZone* PZone)
+        {
+            PZone->ForEachChar([var](CCharEntity* PChar)
+            {
+                // also replaces a write of the old value still waiting in the write-behind queue
+                SetCharVar(PChar, var, 0);
+            });
+        });
     }
 
 }; // namespace charutils
@@ -202,6 +202,8 @@ namespace charutils
     bool    AddWeaponSkillPoints(CCharEntity*, SLOTTYPE, int);
 
     int32   GetCharVar(CCharEntity* PChar, const char* var);
+    void    SetCharVar(CCharEntity* PChar, const char* var, int32 value);  // 0 deletes the variable
+    void    ClearCharVarFromAll(const char* var, bool onlineOnly = false);  // deletes the variable of every character
 };
 
 #endif
@@ -24,6 +24,7 @@
 #include "../items/item_shop.h"
 
 #include "guildutils.h"
+#include "charutils.h"
 #include "itemutils.h"
 #include "../guild.h"
 #include "../item_container.h"
@@ -167,8 +168,9 @@ void UpdateGuildPointsPattern()
         //write the new pattern and update time to prevent other servers from updating the pattern
         Sql_Query(SqlHandle, "REPLACE INTO server_variables (name,value) VALUES('[GUILD]pattern_update', %u), ('[GUILD]pattern', %u);",
             CVanaTime::getInstance()->getSysYearDay(), pattern);
-        Sql_Query(SqlHandle, "DELETE FROM char_vars WHERE varname = '[GUILD]daily_points';");
     }
+    // the server that updated the pattern also deletes the stored points, the others only reset characters online here
+    charutils::ClearCharVarFromAll("[GUILD]daily_points", !update);
 
     // load the pattern in case it was set by another server (and this server did not set it)
     Sql_Query(SqlHandle, "SELECT value FROM server_variables WHERE name = '[GUILD]pattern';");
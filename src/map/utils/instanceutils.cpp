@@ -19,14 +19,19 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 ===========================================================================
 */
 
+#include <unordered_map>
+
 #include "../instance_loader.h"
 
 #include "instanceutils.h"
+#include "mobutils.h"
 #include "zoneutils.h"
 
+#include "../map.h"
 #include "../lua/luautils.h"
 
 std::unique_ptr<CInstanceLoader> Loader;
+std::unordered_map<uint8, InstanceEntities_t> g_InstanceEntities;
 
 namespace instanceutils
 {
@@ -54,4 +59,86 @@ namespace instanceutils
 			luautils::OnInstanceCreated(PRequester, nullptr);
 		}
 	}
+
+    /************************************************************************
+    *                                                                       *
+    *  Caches instance_entities so that creating an instance does not need  *
+    *  the database. Must run after mobutils::LoadMobTemplates.             *
+    *                                                                       *
+    ************************************************************************/
+
+    void LoadInstanceEntities()
+    {
+        g_InstanceEntities.clear();
+
+        int32 ret = Sql_Query(SqlHandle, "SELECT instanceid, id FROM instance_entities ORDER BY instanceid, id;");
+
+        if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
+        {
+            while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+            {
+                uint32 mobid = Sql_GetUIntData(SqlHandle, 1);
+
+                if (mobutils::GetMobTemplate(mobid))
+                {
+                    g_InstanceEntities[(uint8)Sql_GetUIntData(SqlHandle, 0)].mobs.push_back(mobid);
+                }
+            }
+        }
+
+        const char* Query =
+            "SELECT instanceid, npcid, name, pos_rot, pos_x, pos_y, pos_z,\
+            flag, speed, speedsub, animation, animationsub, namevis,\
+            status, entityFlags, look, name_prefix, widescan \
+            FROM instance_entities INNER JOIN npc_list ON \
+            (instance_entities.id = npc_list.npcid) \
+            ORDER BY instanceid, npcid;";
+
+        ret = Sql_Query(SqlHandle, Query);
+
+        if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
+        {
+            while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+            {
+                InstanceNpc_t Npc {};
+
+                Npc.npcid = Sql_GetUIntData(SqlHandle, 1);
+                Npc.name = (const char*)Sql_GetData(SqlHandle, 2);
+
+                Npc.rotation = (uint8)Sql_GetIntData(SqlHandle, 3);
+                Npc.x = Sql_GetFloatData(SqlHandle, 4);
+                Npc.y = Sql_GetFloatData(SqlHandle, 5);
+                Npc.z = Sql_GetFloatData(SqlHandle, 6);
+                Npc.flag = Sql_GetUIntData(SqlHandle, 7);
+
+                Npc.speed = (uint8)Sql_GetIntData(SqlHandle, 8);
+                Npc.speedsub = (uint8)Sql_GetIntData(SqlHandle, 9);
+                Npc.animation = (uint8)Sql_GetIntData(SqlHandle, 10);
+                Npc.animationsub = (uint8)Sql_GetIntData(SqlHandle, 11);
+
+                Npc.namevis = (uint8)Sql_GetIntData(SqlHandle, 12);
+                Npc.status = (uint8)Sql_GetIntData(SqlHandle, 13);
+                Npc.flags = Sql_GetUIntData(SqlHandle, 14);
+
+                char* look = nullptr;
+                size_t lookLength = 0;
+                Sql_GetData(SqlHandle, 15, &look, &lookLength);
+                if (look)
+                {
+                    memcpy(&Npc.look, look, std::min(lookLength, sizeof(look_t)));
+                }
+
+                Npc.namePrefix = (uint8)Sql_GetIntData(SqlHandle, 16);
+                Npc.widescan = (uint8)Sql_GetIntData(SqlHandle, 17);
+
+                g_InstanceEntities[(uint8)Sql_GetUIntData(SqlHandle, 0)].npcs.push_back(std::move(Npc));
+            }
+        }
+    }
+
+    const InstanceEntities_t* GetInstanceEntities(uint8 instanceid)
+    {
+        auto it = g_InstanceEntities.find(instanceid);
+        return it != g_InstanceEntities.end() ? &it->second : nullptr;
+    }
 };
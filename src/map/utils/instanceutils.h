@@ -23,14 +23,45 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 #define _INSTANCEUTILS_H
 
 #include "../../common/cbasetypes.h"
+#include "../../common/mmo.h"
+
+#include <string>
+#include <vector>
 
 class CInstanceLoader;
 class CCharEntity;
 
+struct InstanceNpc_t
+{
+    uint32      npcid;
+    std::string name;
+    uint8       rotation;
+    float       x, y, z;
+    uint32      flag;
+    uint8       speed, speedsub;
+    uint8       animation, animationsub;
+    uint8       namevis;
+    uint8       status;
+    uint32      flags;
+    look_t      look;
+    uint8       namePrefix;
+    uint8       widescan;
+};
+
+// instance_entities, split into mob ids (see mobutils::GetMobTemplate) and npc rows
+struct InstanceEntities_t
+{
+    std::vector<uint32>        mobs;
+    std::vector<InstanceNpc_t> npcs;
+};
+
 namespace instanceutils
 {
 	void CheckInstance();
 	void LoadInstance(uint8 instanceid, uint16 zoneid, CCharEntity* PRequester);
+
+    void LoadInstanceEntities();
+    const InstanceEntities_t* GetInstanceEntities(uint8 instanceid);
 };
 
 #endif
@@ -38,6 +38,7 @@
 #include "../mob_spell_container.h"
 #include <vector>
 #include "../packets/action.h"
+#include "../map.h"
 
 namespace mobutils
 {
@@ -45,6 +46,9 @@ namespace mobutils
     ModsMap_t mobPoolModsList;
     ModsMap_t mobSpawnModsList;
 
+    std::map<uint32, MobTemplate_t> mobTemplateList;
+    std::unordered_map<uint32, std::vector<BattlefieldMobTemplate_t>> battlefieldMobList;
+
 /************************************************************************
 *                                                                       *
 *  Расчет базовой величины оружия монстров                              *
@@ -1303,6 +1307,298 @@ CMobEntity* InstantiateAlly(uint32 groupid, uint16 zoneID, CInstance* instance)
     return PMob;
 }
 
+/************************************************************************
+*                                                                       *
+*  Reads every spawn point served by this map process into the          *
+*  template store, plus the bcnm_battlefield mob lists. Nothing here    *
+*  touches a zone; entities are created later by InstantiateMob.        *
+*                                                                       *
+************************************************************************/
+
+void LoadMobTemplates()
+{
+    const char* Query =
+        "SELECT mob_groups.zoneid, mobname, mobid, pos_rot, pos_x, pos_y, pos_z, \
+            respawntime, spawntype, dropid, mob_groups.HP, mob_groups.MP, minLevel, maxLevel, \
+            modelid, mJob, sJob, cmbSkill, cmbDmgMult, cmbDelay, behavior, links, mobType, immunity, \
+            systemid, mobsize, speed, \
+            STR, DEX, VIT, AGI, `INT`, MND, CHR, EVA, DEF, \
+            Slash, Pierce, H2H, Impact, \
+            Fire, Ice, Wind, Earth, Lightning, Water, Light, Dark, Element, \
+            mob_pools.familyid, name_prefix, entityFlags, animationsub, \
+            (mob_family_system.HP / 100), (mob_family_system.MP / 100), hasSpellScript, spellList, ATT, ACC, mob_groups.poolid, \
+            allegiance, namevis, aggro, roamflag, mob_pools.skill_list_id, mob_pools.true_detection, mob_family_system.detects, \
+            mob_family_system.charmable \
+            FROM mob_groups INNER JOIN mob_pools ON mob_groups.poolid = mob_pools.poolid \
+            INNER JOIN mob_spawn_points ON mob_groups.groupid = mob_spawn_points.groupid \
+            INNER JOIN mob_family_system ON mob_pools.familyid = mob_family_system.familyid \
+            INNER JOIN zone_settings ON mob_groups.zoneid = zone_settings.zoneid \
+            WHERE NOT (pos_x = 0 AND pos_y = 0 AND pos_z = 0) AND IF(%d <> 0, '%s' = zoneip AND %d = zoneport, TRUE) \
+            AND mob_groups.zoneid = ((mobid >> 12) & 0xFFF);";
+
+    char address[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &map_ip, address, INET_ADDRSTRLEN);
+    int32 ret = Sql_Query(SqlHandle, Query, map_ip.s_addr, address, map_port);
+
+    mobTemplateList.clear();
+
+    if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
+    {
+        while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+        {
+            MobTemplate_t Template {};
+
+            Template.zoneid = (uint16)Sql_GetUIntData(SqlHandle, 0);
+            Template.name = (const char*)Sql_GetData(SqlHandle, 1);
+            Template.mobid = (uint32)Sql_GetUIntData(SqlHandle, 2);
+
+            Template.rotation = (uint8)Sql_GetIntData(SqlHandle, 3);
+            Template.x = Sql_GetFloatData(SqlHandle, 4);
+            Template.y = Sql_GetFloatData(SqlHandle, 5);
+            Template.z = Sql_GetFloatData(SqlHandle, 6);
+
+            Template.respawnTime = Sql_GetUIntData(SqlHandle, 7) * 1000;
+            Template.spawnType = (uint8)Sql_GetUIntData(SqlHandle, 8);
+            Template.dropid = Sql_GetUIntData(SqlHandle, 9);
+
+            Template.HPmodifier = (uint32)Sql_GetIntData(SqlHandle, 10);
+            Template.MPmodifier = (uint32)Sql_GetIntData(SqlHandle, 11);
+
+            Template.minLevel = (uint8)Sql_GetIntData(SqlHandle, 12);
+            Template.maxLevel = (uint8)Sql_GetIntData(SqlHandle, 13);
+
+            char* look = nullptr;
+            size_t lookLength = 0;
+            Sql_GetData(SqlHandle, 14, &look, &lookLength);
+            if (look)
+            {
+                memcpy(&Template.look, look, std::min(lookLength, sizeof(look_t)));
+            }
+
+            Template.mJob = (uint8)Sql_GetIntData(SqlHandle, 15);
+            Template.sJob = (uint8)Sql_GetIntData(SqlHandle, 16);
+
+            Template.cmbSkill = Sql_GetIntData(SqlHandle, 17);
+            Template.cmbDmgMult = Sql_GetUIntData(SqlHandle, 18);
+            Template.cmbDelay = (Sql_GetIntData(SqlHandle, 19) * 1000) / 60;
+
+            Template.behaviour = (uint16)Sql_GetIntData(SqlHandle, 20);
+            Template.link = (uint8)Sql_GetIntData(SqlHandle, 21);
+            Template.type = (uint8)Sql_GetIntData(SqlHandle, 22);
+            Template.immunity = (uint32)Sql_GetIntData(SqlHandle, 23);
+            Template.ecoSystem = (uint8)Sql_GetIntData(SqlHandle, 24);
+            Template.modelSize = (uint8)Sql_GetIntData(SqlHandle, 25);
+            Template.speed = (uint8)Sql_GetIntData(SqlHandle, 26);
+
+            Template.strRank = (uint8)Sql_GetIntData(SqlHandle, 27);
+            Template.dexRank = (uint8)Sql_GetIntData(SqlHandle, 28);
+            Template.vitRank = (uint8)Sql_GetIntData(SqlHandle, 29);
+            Template.agiRank = (uint8)Sql_GetIntData(SqlHandle, 30);
+            Template.intRank = (uint8)Sql_GetIntData(SqlHandle, 31);
+            Template.mndRank = (uint8)Sql_GetIntData(SqlHandle, 32);
+            Template.chrRank = (uint8)Sql_GetIntData(SqlHandle, 33);
+            Template.evaRank = (uint8)Sql_GetIntData(SqlHandle, 34);
+            Template.defRank = (uint8)Sql_GetIntData(SqlHandle, 35);
+            Template.attRank = (uint8)Sql_GetIntData(SqlHandle, 57);
+            Template.accRank = (uint8)Sql_GetIntData(SqlHandle, 58);
+
+            Template.slashRes = (uint16)(Sql_GetFloatData(SqlHandle, 36) * 1000);
+            Template.pierceRes = (uint16)(Sql_GetFloatData(SqlHandle, 37) * 1000);
+            Template.h2hRes = (uint16)(Sql_GetFloatData(SqlHandle, 38) * 1000);
+            Template.impactRes = (uint16)(Sql_GetFloatData(SqlHandle, 39) * 1000);
+
+            Template.fireRes = (int16)((Sql_GetFloatData(SqlHandle, 40) - 1) * -100); // These are stored as floating percentages
+            Template.iceRes = (int16)((Sql_GetFloatData(SqlHandle, 41) - 1) * -100); // and need to be adjusted into modifier units.
+            Template.windRes = (int16)((Sql_GetFloatData(SqlHandle, 42) - 1) * -100); // Higher RES = lower damage.
+            Template.earthRes = (int16)((Sql_GetFloatData(SqlHandle, 43) - 1) * -100); // Negatives signify lower resist chance.
+            Template.thunderRes = (int16)((Sql_GetFloatData(SqlHandle, 44) - 1) * -100); // Positives signify increased resist chance.
+            Template.waterRes = (int16)((Sql_GetFloatData(SqlHandle, 45) - 1) * -100);
+            Template.lightRes = (int16)((Sql_GetFloatData(SqlHandle, 46) - 1) * -100);
+            Template.darkRes = (int16)((Sql_GetFloatData(SqlHandle, 47) - 1) * -100);
+
+            Template.element = (uint8)Sql_GetIntData(SqlHandle, 48);
+            Template.family = (uint16)Sql_GetIntData(SqlHandle, 49);
+            Template.namePrefix = (uint8)Sql_GetIntData(SqlHandle, 50);
+            Template.flags = (uint32)Sql_GetIntData(SqlHandle, 51);
+            Template.animationsub = (uint32)Sql_GetIntData(SqlHandle, 52);
+
+            Template.HPscale = Sql_GetFloatData(SqlHandle, 53);
+            Template.MPscale = Sql_GetFloatData(SqlHandle, 54);
+
+            Template.hasSpellScript = (uint8)Sql_GetIntData(SqlHandle, 55);
+            Template.spellList = (uint16)Sql_GetIntData(SqlHandle, 56);
+
+            Template.pool = Sql_GetUIntData(SqlHandle, 59);
+            Template.allegiance = (uint8)Sql_GetUIntData(SqlHandle, 60);
+            Template.namevis = (uint8)Sql_GetUIntData(SqlHandle, 61);
+            Template.aggro = Sql_GetUIntData(SqlHandle, 62);
+            Template.roamFlags = (uint16)Sql_GetUIntData(SqlHandle, 63);
+            Template.skillList = (uint16)Sql_GetUIntData(SqlHandle, 64);
+            Template.trueDetection = (uint8)Sql_GetUIntData(SqlHandle, 65);
+            Template.detects = (uint16)Sql_GetUIntData(SqlHandle, 66);
+            Template.charmable = Sql_GetUIntData(SqlHandle, 67);
+
+            mobTemplateList[Template.mobid] = std::move(Template);
+        }
+    }
+
+    ret = Sql_Query(SqlHandle, "SELECT bcnmId, battlefieldNumber, monsterId, conditions FROM bcnm_battlefield WHERE battlefieldNumber IS NOT NULL;");
+
+    battlefieldMobList.clear();
+
+    if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
+    {
+        while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+        {
+            uint32 key = (Sql_GetUIntData(SqlHandle, 0) << 8) | (Sql_GetUIntData(SqlHandle, 1) & 0xFF);
+            battlefieldMobList[key].push_back({ Sql_GetUIntData(SqlHandle, 2), (uint8)Sql_GetUIntData(SqlHandle, 3) });
+        }
+    }
+
+    ShowStatus("mobutils::LoadMobTemplates: %u mob templates, %u battlefield mob lists\n",
+        (uint32)mobTemplateList.size(), (uint32)battlefieldMobList.size());
+}
+
+const MobTemplate_t* GetMobTemplate(uint32 mobid)
+{
+    auto it = mobTemplateList.find(mobid);
+    return it != mobTemplateList.end() ? &it->second : nullptr;
+}
+
+void ForEachMobTemplate(std::function<void(const MobTemplate_t&)> func)
+{
+    for (auto& Template : mobTemplateList)
+    {
+        func(Template.second);
+    }
+}
+
+/************************************************************************
+*                                                                       *
+*  Creates a mob from its template. Only the settings common to zone    *
+*  and instance spawns are applied here; callers add their own and      *
+*  then run InitializeMob.                                              *
+*                                                                       *
+************************************************************************/
+
+CMobEntity* InstantiateMob(const MobTemplate_t& Template)
+{
+    CMobEntity* PMob = new CMobEntity;
+
+    PMob->name = Template.name;
+    PMob->id = Template.mobid;
+    PMob->targid = (uint16)PMob->id & 0x0FFF;
+
+    PMob->m_SpawnPoint.rotation = Template.rotation;
+    PMob->m_SpawnPoint.x = Template.x;
+    PMob->m_SpawnPoint.y = Template.y;
+    PMob->m_SpawnPoint.z = Template.z;
+
+    PMob->m_RespawnTime = Template.respawnTime;
+    PMob->m_SpawnType = (SPAWNTYPE)Template.spawnType;
+    PMob->m_DropID = Template.dropid;
+
+    PMob->HPmodifier = Template.HPmodifier;
+    PMob->MPmodifier = Template.MPmodifier;
+
+    PMob->m_minLevel = Template.minLevel;
+    PMob->m_maxLevel = Template.maxLevel;
+
+    PMob->look = Template.look;
+
+    PMob->SetMJob(Template.mJob);
+    PMob->SetSJob(Template.sJob);
+
+    ((CItemWeapon*)PMob->m_Weapons[SLOT_MAIN])->setMaxHit(1);
+    ((CItemWeapon*)PMob->m_Weapons[SLOT_MAIN])->setSkillType(Template.cmbSkill);
+    PMob->m_dmgMult = Template.cmbDmgMult;
+    ((CItemWeapon*)PMob->m_Weapons[SLOT_MAIN])->setDelay(Template.cmbDelay);
+    ((CItemWeapon*)PMob->m_Weapons[SLOT_MAIN])->setBaseDelay(Template.cmbDelay);
+
+    PMob->m_Behaviour = Template.behaviour;
+    PMob->m_Link = Template.link;
+    PMob->m_Type = Template.type;
+    PMob->m_Immunity = (IMMUNITY)Template.immunity;
+    PMob->m_EcoSystem = (ECOSYSTEM)Template.ecoSystem;
+    PMob->m_ModelSize = Template.modelSize;
+
+    PMob->speed = Template.speed;
+    PMob->speedsub = Template.speed;
+
+    PMob->strRank = Template.strRank;
+    PMob->dexRank = Template.dexRank;
+    PMob->vitRank = Template.vitRank;
+    PMob->agiRank = Template.agiRank;
+    PMob->intRank = Template.intRank;
+    PMob->mndRank = Template.mndRank;
+    PMob->chrRank = Template.chrRank;
+    PMob->evaRank = Template.evaRank;
+    PMob->defRank = Template.defRank;
+    PMob->attRank = Template.attRank;
+    PMob->accRank = Template.accRank;
+
+    PMob->setModifier(Mod::SLASHRES, Template.slashRes);
+    PMob->setModifier(Mod::PIERCERES, Template.pierceRes);
+    PMob->setModifier(Mod::HTHRES, Template.h2hRes);
+    PMob->setModifier(Mod::IMPACTRES, Template.impactRes);
+
+    PMob->setModifier(Mod::FIRERES, Template.fireRes);
+    PMob->setModifier(Mod::ICERES, Template.iceRes);
+    PMob->setModifier(Mod::WINDRES, Template.windRes);
+    PMob->setModifier(Mod::EARTHRES, Template.earthRes);
+    PMob->setModifier(Mod::THUNDERRES, Template.thunderRes);
+    PMob->setModifier(Mod::WATERRES, Template.waterRes);
+    PMob->setModifier(Mod::LIGHTRES, Template.lightRes);
+    PMob->setModifier(Mod::DARKRES, Template.darkRes);
+
+    PMob->m_Element = Template.element;
+    PMob->m_Family = Template.family;
+    PMob->m_name_prefix = Template.namePrefix;
+    PMob->m_flags = Template.flags;
+
+    //Special sub animation for Mob (yovra, jailer of love, phuabo)
+    // yovra 1: en hauteur, 2: en bas, 3: en haut
+    // phuabo 1: sous l'eau, 2: sort de l'eau, 3: rentre dans l'eau
+    PMob->animationsub = Template.animationsub;
+
+    // Setup HP / MP Stat Percentage Boost
+    PMob->HPscale = Template.HPscale;
+    PMob->MPscale = Template.MPscale;
+
+    // Check if we should be looking up scripts for this mob
+    PMob->m_HasSpellScript = Template.hasSpellScript;
+
+    PMob->m_SpellListContainer = mobSpellList::GetMobSpellList(Template.spellList);
+
+    PMob->m_Pool = Template.pool;
+
+    PMob->allegiance = Template.allegiance;
+    PMob->namevis = Template.namevis;
+    PMob->m_Aggro = Template.aggro;
+
+    PMob->m_MobSkillList = Template.skillList;
+    PMob->m_TrueDetection = Template.trueDetection;
+    PMob->m_Detects = Template.detects;
+
+    PMob->setMobMod(MOBMOD_CHARMABLE, Template.charmable);
+
+    // Overwrite base family charmables depending on mob type. Disallowed mobs which should be charmable
+    // can be set in mob_spawn_mods or in their onInitialize
+    if (PMob->m_Type & MOBTYPE_EVENT || PMob->m_Type & MOBTYPE_FISHED || PMob->m_Type & MOBTYPE_BATTLEFIELD ||
+        PMob->m_Type & MOBTYPE_NOTORIOUS)
+    {
+        PMob->setMobMod(MOBMOD_CHARMABLE, 0);
+    }
+
+    return PMob;
+}
+
+const std::vector<BattlefieldMobTemplate_t>* GetBattlefieldMobs(uint16 bcnmid, uint8 area)
+{
+    auto it = battlefieldMobList.find(((uint32)bcnmid << 8) | area);
+    return it != battlefieldMobList.end() ? &it->second : nullptr;
+}
+
 void WeaknessTrigger(CBaseEntity* PTarget, WeaknessType level)
 {
     uint16 animationID = 0;
@@ -22,6 +22,8 @@
 #ifndef _MOBUTILS_H
 #define _MOBUTILS_H
 
+#include <functional>
+#include <map>
 #include <unordered_map>
 
 #include "../../common/cbasetypes.h"
@@ -41,6 +43,75 @@ enum class WeaknessType {BLUE = 0, YELLOW = 1, RED = 2, WHITE = 3};
 
 typedef std::unordered_map<uint32,ModsList_t*> ModsMap_t;
 
+/************************************************************************
+*                                                                       *
+*  One row of the mob_spawn_points / mob_groups / mob_pools /           *
+*  mob_family_system join, with the column conversions already applied. *
+*  Loaded once at startup; zones, instances and battlefields create     *
+*  their CMobEntity from here instead of querying the database.         *
+*                                                                       *
+************************************************************************/
+
+struct MobTemplate_t
+{
+    uint32      mobid;
+    uint16      zoneid;
+    std::string name;
+
+    uint8       rotation;
+    float       x, y, z;
+
+    uint32      respawnTime;                // ms
+    uint8       spawnType;
+    uint32      dropid;
+    uint32      HPmodifier, MPmodifier;
+    uint8       minLevel, maxLevel;
+    look_t      look;
+    uint8       mJob, sJob;
+
+    int32       cmbSkill;
+    uint32      cmbDmgMult;
+    int32       cmbDelay;                   // ms
+
+    uint16      behaviour;
+    uint8       link;
+    uint8       type;
+    uint32      immunity;
+    uint8       ecoSystem;
+    uint8       modelSize;
+    uint8       speed;
+
+    uint8       strRank, dexRank, vitRank, agiRank, intRank, mndRank, chrRank;
+    uint8       evaRank, defRank, attRank, accRank;
+
+    uint16      slashRes, pierceRes, h2hRes, impactRes;
+    int16       fireRes, iceRes, windRes, earthRes, thunderRes, waterRes, lightRes, darkRes;
+
+    uint8       element;
+    uint16      family;
+    uint8       namePrefix;
+    uint32      flags;
+    uint32      animationsub;
+    float       HPscale, MPscale;
+    uint8       hasSpellScript;
+    uint16      spellList;
+    uint32      pool;
+    uint8       allegiance;
+    uint8       namevis;
+    uint32      aggro;
+    uint16      roamFlags;
+    uint16      skillList;
+    uint8       trueDetection;
+    uint16      detects;
+    uint32      charmable;
+};
+
+struct BattlefieldMobTemplate_t
+{
+    uint32 mobid;
+    uint8  condition;
+};
+
 namespace mobutils
 {
 	void  CalculateStats(CMobEntity* PMob);
@@ -71,6 +142,13 @@ namespace mobutils
 
 	void  SetSpellList(CMobEntity*, uint16);
 	CMobEntity* InstantiateAlly(uint32 groupid, uint16 zoneID, CInstance* = nullptr);
+
+    // immutable mob template store, built once by LoadMobTemplates
+    void LoadMobTemplates();
+    const MobTemplate_t* GetMobTemplate(uint32 mobid);
+    void ForEachMobTemplate(std::function<void(const MobTemplate_t&)> func);
+    CMobEntity* InstantiateMob(const MobTemplate_t& Template);
+    const std::vector<BattlefieldMobTemplate_t>* GetBattlefieldMobs(uint16 bcnmid, uint8 area);
     void WeaknessTrigger(CBaseEntity* PTarget, WeaknessType level);
 };
 
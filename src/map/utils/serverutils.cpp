@@ -0,0 +1,83 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#include <unordered_map>
+
+#include "serverutils.h"
+#include "../map.h"
+#include "../write_behind.h"
+
+namespace serverutils
+{
+    struct server_var_t
+    {
+        int32 value;
+        time_point fetched;
+    };
+
+    std::unordered_map<std::string, server_var_t> g_ServerVars;
+
+    /************************************************************************
+    *                                                                       *
+    *  Other map servers may change a variable, so a cached value is read   *
+    *  again once it is older than server_var_cache_ttl. While this server  *
+    *  still has writes queued the database may be behind the cache, and   *
+    *  the cached value is kept.                                            *
+    *                                                                       *
+    ************************************************************************/
+
+    int32 GetServerVar(const std::string& name)
+    {
+        auto now = server_clock::now();
+        auto it = g_ServerVars.find(name);
+
+        if (it != g_ServerVars.end() &&
+            (now - it->second.fetched < std::chrono::milliseconds(map_config.server_var_cache_ttl) || writebehind::Pending(0)))
+        {
+            return it->second.value;
+        }
+
+        int32 value = 0;
+        int32 ret = Sql_Query(SqlHandle, "SELECT value FROM server_variables WHERE name = '%s' LIMIT 1;", name.c_str());
+
+        if (ret != SQL_ERROR &&
+            Sql_NumRows(SqlHandle) != 0 &&
+            Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+        {
+            value = (int32)Sql_GetIntData(SqlHandle, 0);
+        }
+
+        g_ServerVars[name] = { value, now };
+        return value;
+    }
+
+    void SetServerVar(const std::string& name, int32 value)
+    {
+        g_ServerVars[name] = { value, server_clock::now() };
+
+        if (value == 0)
+        {
+            writebehind::Query(0, WB_SERVER_VAR, name, "DELETE FROM server_variables WHERE name = '%s' LIMIT 1;", name);
+            return;
+        }
+        writebehind::Query(0, WB_SERVER_VAR, name, "INSERT INTO server_variables VALUES ('%s', %i) ON DUPLICATE KEY UPDATE value = %i;", name, value, value);
+    }
+};
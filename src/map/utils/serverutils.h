@@ -0,0 +1,42 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#ifndef _SERVERUTILS_H
+#define _SERVERUTILS_H
+
+#include "../../common/cbasetypes.h"
+
+#include <string>
+
+/************************************************************************
+*                                                                       *
+*  Cached access to server_variables. Values are kept in memory for     *
+*  server_var_cache_ttl ms, writes go through the write-behind queue.   *
+*                                                                       *
+************************************************************************/
+
+namespace serverutils
+{
+    int32 GetServerVar(const std::string& name);
+    void  SetServerVar(const std::string& name, int32 value);   // 0 deletes the variable
+};
+
+#endif
@@ -25,6 +25,10 @@
 
 #include <math.h>
 #include <string.h>
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+#include <vector>
 
 #include "../packets/char_skills.h"
 #include "../packets/char_update.h"
@@ -52,10 +56,117 @@
 namespace synthutils
 {
 
+/************************************************************************
+*                                                                       *
+*  synth_recipes is held in memory, indexed by the crystal and the      *
+*  ingredients sorted by item id (empty slots last). A recipe that      *
+*  accepts an HQ crystal is indexed under both crystals.                *
+*                                                                       *
+************************************************************************/
+
+struct SynthRecipe_t
+{
+    uint16 ID;
+    uint16 KeyItem;
+    uint8  Skill[8];            // in the order of SKILL_WOODWORKING..SKILL_COOKING
+    uint16 Result[4];           // normal, HQ1, HQ2, HQ3
+    uint8  ResultQty[4];
+    uint8  Desynth;
+};
+
+typedef std::array<uint16, 9> RecipeKey_t; // crystal, ingredients
+
+struct RecipeKeyHash
+{
+    size_t operator()(const RecipeKey_t& key) const
+    {
+        uint64 hash = 14695981039346656037ULL; // FNV-1a
+        for (uint16 item : key)
+        {
+            hash = (hash ^ item) * 1099511628211ULL;
+        }
+        return (size_t)hash;
+    }
+};
+
+std::vector<SynthRecipe_t> g_SynthRecipes;
+std::unordered_map<RecipeKey_t, uint32, RecipeKeyHash> g_SynthRecipeIndex; // key -> position in g_SynthRecipes
+
+void SortIngredients(RecipeKey_t& key)
+{
+    std::sort(key.begin() + 1, key.end(), [](uint16 a, uint16 b)
+    {
+        return (uint16)(a - 1) < (uint16)(b - 1); // 0 wraps around and sorts last
+    });
+}
+
+int32 LoadSynthRecipes()
+{
+    const char* Query =
+        "SELECT ID, KeyItem, Wood, Smith, Gold, Cloth, Leather, Bone, Alchemy, Cook, "
+            "Result, ResultHQ1, ResultHQ2, ResultHQ3, ResultQty, ResultHQ1Qty, ResultHQ2Qty, ResultHQ3Qty, Desynth, "
+            "Crystal, HQCrystal, Ingredient1, Ingredient2, Ingredient3, Ingredient4, Ingredient5, Ingredient6, Ingredient7, Ingredient8 "
+        "FROM synth_recipes "
+        "ORDER BY ID;";
+
+    if (Sql_Query(SqlHandle, Query) == SQL_ERROR)
+    {
+        ShowError("synthutils: cannot load synth_recipes, keeping %u recipes\n", (uint32)g_SynthRecipes.size());
+        return -1;
+    }
+
+    std::vector<SynthRecipe_t> recipes;
+    std::unordered_map<RecipeKey_t, uint32, RecipeKeyHash> index;
+    recipes.reserve((size_t)Sql_NumRows(SqlHandle));
+    index.reserve((size_t)Sql_NumRows(SqlHandle) * 2);
+
+    while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+    {
+        SynthRecipe_t recipe {};
+        recipe.ID = (uint16)Sql_GetUIntData(SqlHandle, 0);
+        recipe.KeyItem = (uint16)Sql_GetUIntData(SqlHandle, 1);
+        for (uint8 i = 0; i < 8; ++i)
+        {
+            recipe.Skill[i] = (uint8)Sql_GetUIntData(SqlHandle, 2 + i);
+        }
+        for (uint8 i = 0; i < 4; ++i)
+        {
+            recipe.Result[i] = (uint16)Sql_GetUIntData(SqlHandle, 10 + i);
+            recipe.ResultQty[i] = (uint8)Sql_GetUIntData(SqlHandle, 14 + i);
+        }
+        recipe.Desynth = (uint8)Sql_GetUIntData(SqlHandle, 18);
+
+        RecipeKey_t key;
+        for (uint8 i = 1; i < 9; ++i)
+        {
+            key[i] = (uint16)Sql_GetUIntData(SqlHandle, 20 + i);
+        }
+        SortIngredients(key);
+
+        uint32 position = (uint32)recipes.size();
+        recipes.push_back(recipe);
+
+        // the lowest ID wins when several recipes share the same ingredients, as LIMIT 1 did
+        uint16 crystal = (uint16)Sql_GetUIntData(SqlHandle, 19);
+        uint16 hqCrystal = (uint16)Sql_GetUIntData(SqlHandle, 20);
+        key[0] = crystal;
+        index.emplace(key, position);
+        if (hqCrystal != 0 && hqCrystal != crystal)
+        {
+            key[0] = hqCrystal;
+            index.emplace(key, position);
+        }
+    }
+
+    g_SynthRecipes = std::move(recipes);
+    g_SynthRecipeIndex = std::move(index);
+    return (int32)g_SynthRecipes.size();
+}
+
 /********************************************************************************************************************************
 * We check the availability of the recipe and the possibility of its synthesis.                                                 *
 * If its difficulty is 15 levels higher than character skill then recipe is considered too difficult and the synth is canceled. *
-* We also collect all the necessary information about the recipe, to avoid contacting the database repeatedly.                  *
+* We also collect all the necessary information about the recipe, to avoid looking it up repeatedly.                            *
 *                                                                                                                               *
 * In the itemID fields of the ninth cell, we save the recipe ID                                                                 *
 * In the quantity fields of 9-16 cells, write the required skills values                                                        *
@@ -64,62 +175,38 @@ namespace synthutils
 
 bool isRightRecipe(CCharEntity* PChar)
 {
-    const char* fmtQuery =
-
-        "SELECT ID, KeyItem, Wood, Smith, Gold, Cloth, Leather, Bone, Alchemy, Cook, \
-            Result, ResultHQ1, ResultHQ2, ResultHQ3, ResultQty, ResultHQ1Qty, ResultHQ2Qty, ResultHQ3Qty, Desynth \
-        FROM synth_recipes \
-        WHERE (Crystal = %u OR HQCrystal = %u) \
-            AND Ingredient1 = %u \
-            AND Ingredient2 = %u \
-            AND Ingredient3 = %u \
-            AND Ingredient4 = %u \
-            AND Ingredient5 = %u \
-            AND Ingredient6 = %u \
-            AND Ingredient7 = %u \
-            AND Ingredient8 = %u \
-        LIMIT 1";
-
-    int32 ret = Sql_Query(
-        SqlHandle,
-        fmtQuery,
-        PChar->CraftContainer->getItemID(0),
-        PChar->CraftContainer->getItemID(0),
-        PChar->CraftContainer->getItemID(1),
-        PChar->CraftContainer->getItemID(2),
-        PChar->CraftContainer->getItemID(3),
-        PChar->CraftContainer->getItemID(4),
-        PChar->CraftContainer->getItemID(5),
-        PChar->CraftContainer->getItemID(6),
-        PChar->CraftContainer->getItemID(7),
-        PChar->CraftContainer->getItemID(8));
-
-    if (ret != SQL_ERROR &&
-        Sql_NumRows(SqlHandle) != 0 &&
-        Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+    RecipeKey_t key;
+    for (uint8 slotID = 0; slotID < 9; ++slotID)
+    {
+        key[slotID] = PChar->CraftContainer->getItemID(slotID);
+    }
+    SortIngredients(key);
+
+    auto it = g_SynthRecipeIndex.find(key);
+    if (it != g_SynthRecipeIndex.end())
     {
-        uint16 KeyItemID = (uint16)Sql_GetUIntData(SqlHandle,1); // Check if recipe needs KI
+        const SynthRecipe_t& recipe = g_SynthRecipes[it->second];
 
-        if ((KeyItemID == 0) || (charutils::hasKeyItem(PChar,KeyItemID))) // If recipe doesn't need KI OR Player has the required KI
+        if ((recipe.KeyItem == 0) || (charutils::hasKeyItem(PChar, recipe.KeyItem))) // If recipe doesn't need KI OR Player has the required KI
         {
             // in the ninth cell write the id of the recipe
-            PChar->CraftContainer->setItem(9, Sql_GetUIntData(SqlHandle,0),0xFF,0);
+            PChar->CraftContainer->setItem(9, recipe.ID, 0xFF, 0);
             #ifdef _TPZ_SYNTH_DEBUG_MESSAGES_
             ShowDebug(CL_CYAN"Recipe matches ID %u.\n" CL_RESET, PChar->CraftContainer->getItemID(9));
             #endif
 
-            PChar->CraftContainer->setItem(10 + 1, (uint16)Sql_GetUIntData(SqlHandle,10), (uint8)Sql_GetUIntData(SqlHandle,14), 0); // RESULT_SUCCESS
-            PChar->CraftContainer->setItem(10 + 2, (uint16)Sql_GetUIntData(SqlHandle,11), (uint8)Sql_GetUIntData(SqlHandle,15), 0); // RESULT_HQ
-            PChar->CraftContainer->setItem(10 + 3, (uint16)Sql_GetUIntData(SqlHandle,12), (uint8)Sql_GetUIntData(SqlHandle,16), 0); // RESULT_HQ2
-            PChar->CraftContainer->setItem(10 + 4, (uint16)Sql_GetUIntData(SqlHandle,13), (uint8)Sql_GetUIntData(SqlHandle,17), 0); // RESULT_HQ3
-            PChar->CraftContainer->setCraftType((uint8)Sql_GetUIntData(SqlHandle, 18)); // Store if it's a desynth
+            PChar->CraftContainer->setItem(10 + 1, recipe.Result[0], recipe.ResultQty[0], 0); // RESULT_SUCCESS
+            PChar->CraftContainer->setItem(10 + 2, recipe.Result[1], recipe.ResultQty[1], 0); // RESULT_HQ
+            PChar->CraftContainer->setItem(10 + 3, recipe.Result[2], recipe.ResultQty[2], 0); // RESULT_HQ2
+            PChar->CraftContainer->setItem(10 + 4, recipe.Result[3], recipe.ResultQty[3], 0); // RESULT_HQ3
+            PChar->CraftContainer->setCraftType(recipe.Desynth); // Store if it's a desynth
 
             uint16 skillValue   = 0;
             uint16 currentSkill = 0;
 
             for (uint8 skillID = 49; skillID < 57; ++skillID) // range for all 8 synth skills
             {
-                skillValue   = (uint16)Sql_GetUIntData(SqlHandle,(skillID-49+2));
+                skillValue   = recipe.Skill[skillID - 49];
                 currentSkill = PChar->RealSkills.skill[skillID];
 
                 // skill write in the quantity field of cells 9-16
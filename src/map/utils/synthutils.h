@@ -55,6 +55,7 @@ namespace synthutils
         SYNTHESIS_HQ3		= 4
     };
 
+	int32 LoadSynthRecipes();       // (re)builds the recipe index from synth_recipes, returns the recipe count or -1 (old index kept)
 	int32 startSynth(CCharEntity* PChar);
 	int32 sendSynthDone(CCharEntity* PChar);
 };
@@ -21,7 +21,12 @@
 
 #include "../../common/showmsg.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <string.h>
+#include <thread>
+#include <unordered_map>
 #include "../../common/timer.h"
 
 #include "../ai/ai_container.h"
@@ -44,6 +49,16 @@
 std::map<uint16, CZone*> g_PZoneList;   // глобальный массив указателей на игровые зоны
 CNpcEntity*  g_PTrigger;    // триггер для запуска событий
 
+struct RegisteredChar
+{
+    CCharEntity* PChar;
+    uint8        zones;     // zone lists the character is currently in, normally one
+};
+
+// online characters of all zones, kept by CZoneEntities::InsertPC/DecreaseZoneCounter
+std::unordered_map<uint32, RegisteredChar> g_PCharByID;
+std::unordered_map<std::string, CCharEntity*> g_PCharByName;  // keyed by lowercase name
+
 
 namespace zoneutils
 {
@@ -150,24 +165,60 @@ CBaseEntity* GetEntity(uint32 ID, uint8 filter)
     }
 }
 
+static std::string FoldCharName(const int8* name)
+{
+    std::string key((const char*)name);
+    for (auto& c : key)
+    {
+        c = (char)tolower((uint8)c);
+    }
+    return key;
+}
+
 /************************************************************************
 *                                                                       *
-*  Получаем указатель на персонажа по имени                             *
+*  Maintains the world index of online characters                       *
 *                                                                       *
 ************************************************************************/
 
-CCharEntity* GetCharByName(int8* name)
+void RegisterChar(CCharEntity* PChar)
 {
-    for (auto PZone : g_PZoneList)
+    RegisteredChar& entry = g_PCharByID[PChar->id];
+    if (entry.PChar != PChar)
     {
-        CCharEntity* PChar = PZone.second->GetCharByName(name);
+        entry.PChar = PChar;
+        entry.zones = 0;
+    }
+    entry.zones++;
+    g_PCharByName[FoldCharName(PChar->GetName())] = PChar;
+}
 
-        if (PChar != nullptr)
-        {
-            return PChar;
-        }
+void UnregisterChar(CCharEntity* PChar)
+{
+    auto it = g_PCharByID.find(PChar->id);
+    if (it == g_PCharByID.end() || it->second.PChar != PChar || --it->second.zones > 0)
+    {
+        return;
+    }
+    g_PCharByID.erase(it);
+
+    auto name = g_PCharByName.find(FoldCharName(PChar->GetName()));
+    if (name != g_PCharByName.end() && name->second == PChar)
+    {
+        g_PCharByName.erase(name);
     }
-    return nullptr;
+}
+
+/************************************************************************
+*                                                                       *
+*  Получаем указатель на персонажа по имени                             *
+*                                                                       *
+************************************************************************/
+
+CCharEntity* GetCharByName(int8* name)
+{
+    auto it = g_PCharByName.find(FoldCharName(name));
+    return it != g_PCharByName.end() ? it->second : nullptr;
 }
 
 /************************************************************************
@@ -179,62 +230,38 @@ CCharEntity* GetCharByName(int8* name)
 CCharEntity* GetCharFromWorld(uint32 charid, uint16 targid)
 {
     // will not return pointers to players in Mog House
-    for (auto PZone : g_PZoneList)
+    CCharEntity* PChar = GetChar(charid);
+    if (PChar != nullptr && PChar->targid == targid && PChar->loc.zone != nullptr && PChar->loc.zone->GetID() != 0)
     {
-        if (PZone.first == 0)
-        {
-            continue;
-        }
-        CBaseEntity* PEntity = PZone.second->GetEntity(targid, TYPE_PC);
-        if (PEntity != nullptr && PEntity->id == charid)
-        {
-            return (CCharEntity*)PEntity;
-        }
+        return PChar;
     }
     return nullptr;
 }
 
 CCharEntity* GetChar(uint32 charid)
 {
-    for (auto PZone : g_PZoneList)
-    {
-        CBaseEntity* PEntity = PZone.second->GetCharByID(charid);
-        if (PEntity)
-        {
-            return (CCharEntity*)PEntity;
-        }
-    }
-    return nullptr;
+    auto it = g_PCharByID.find(charid);
+    return it != g_PCharByID.end() ? it->second.PChar : nullptr;
 }
 
 
 CCharEntity* GetCharToUpdate(uint32 primary, uint32 ternary)
 {
-    CCharEntity* PPrimary = nullptr;
-    CCharEntity* PSecondary = nullptr;
-    CCharEntity* PTernary = nullptr;
+    if (CCharEntity* PPrimary = GetChar(primary))
+    {
+        return PPrimary;
+    }
 
-    for (auto PZone : g_PZoneList)
+    // primary may be the id of a party whose leader is offline
+    for (auto& entry : g_PCharByID)
     {
-        PZone.second->ForEachChar([primary, ternary, &PPrimary, &PSecondary, &PTernary](CCharEntity* PChar)
+        CCharEntity* PChar = entry.second.PChar;
+        if (PChar->PParty && PChar->PParty->GetPartyID() == primary)
         {
-            if (!PPrimary)
-            {
-                if (PChar->id == primary)
-                    PPrimary = PChar;
-                else if (PChar->PParty && PChar->PParty->GetPartyID() == primary)
-                    PSecondary = PChar;
-                else if (PChar->id == ternary)
-                    PTernary = PChar;
-            }
-        });
-        if (PPrimary)
-            return PPrimary;
+            return PChar;
+        }
     }
-    if (PSecondary)
-        return PSecondary;
-
-    return PTernary;
+    return GetChar(ternary);
 }
 /************************************************************************
 *                                                                       *
@@ -343,176 +370,42 @@ void LoadMOBList()
     uint8 normalLevelRangeMin = luautils::GetSettingsVariable("NORMAL_MOB_MAX_LEVEL_RANGE_MIN");
     uint8 normalLevelRangeMax = luautils::GetSettingsVariable("NORMAL_MOB_MAX_LEVEL_RANGE_MAX");
 
-    const char* Query =
-        "SELECT mob_groups.zoneid, mobname, mobid, pos_rot, pos_x, pos_y, pos_z, \
-            respawntime, spawntype, dropid, mob_groups.HP, mob_groups.MP, minLevel, maxLevel, \
-            modelid, mJob, sJob, cmbSkill, cmbDmgMult, cmbDelay, behavior, links, mobType, immunity, \
-            systemid, mobsize, speed, \
-            STR, DEX, VIT, AGI, `INT`, MND, CHR, EVA, DEF, \
-            Slash, Pierce, H2H, Impact, \
-            Fire, Ice, Wind, Earth, Lightning, Water, Light, Dark, Element, \
-            mob_pools.familyid, name_prefix, entityFlags, animationsub, \
-            (mob_family_system.HP / 100), (mob_family_system.MP / 100), hasSpellScript, spellList, ATT, ACC, mob_groups.poolid, \
-            allegiance, namevis, aggro, roamflag, mob_pools.skill_list_id, mob_pools.true_detection, mob_family_system.detects, \
-            mob_family_system.charmable \
-            FROM mob_groups INNER JOIN mob_pools ON mob_groups.poolid = mob_pools.poolid \
-            INNER JOIN mob_spawn_points ON mob_groups.groupid = mob_spawn_points.groupid \
-            INNER JOIN mob_family_system ON mob_pools.familyid = mob_family_system.familyid \
-            INNER JOIN zone_settings ON mob_groups.zoneid = zone_settings.zoneid \
-            WHERE NOT (pos_x = 0 AND pos_y = 0 AND pos_z = 0) AND IF(%d <> 0, '%s' = zoneip AND %d = zoneport, TRUE) \
-            AND mob_groups.zoneid = ((mobid >> 12) & 0xFFF);";
-
-    char address[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &map_ip, address, INET_ADDRSTRLEN);
-    int32 ret = Sql_Query(SqlHandle, Query, map_ip.s_addr, address, map_port);
-
-    if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
+    mobutils::ForEachMobTemplate([&](const MobTemplate_t& Template)
     {
-        while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+        CZone* PZone = GetZone(Template.zoneid);
+        ZONETYPE zoneType = PZone->GetType();
+
+        if (zoneType != ZONETYPE_DUNGEON_INSTANCED)
         {
-            uint16 ZoneID = (uint16)Sql_GetUIntData(SqlHandle, 0);
-            ZONETYPE zoneType = GetZone(ZoneID)->GetType();
+            CMobEntity* PMob = mobutils::InstantiateMob(Template);
 
-            if (zoneType != ZONETYPE_DUNGEON_INSTANCED)
+            // Cap Level if Necessary (Don't Cap NMs)
+            if (normalLevelRangeMin > 0 && !(PMob->m_Type & MOBTYPE_NOTORIOUS) && PMob->m_minLevel > normalLevelRangeMin)
             {
-                CMobEntity* PMob = new CMobEntity;
-
-                PMob->name.insert(0, (const char*)Sql_GetData(SqlHandle, 1));
-                PMob->id = (uint32)Sql_GetUIntData(SqlHandle, 2);
-
-                PMob->targid = (uint16)PMob->id & 0x0FFF;
-
-                PMob->m_SpawnPoint.rotation = (uint8)Sql_GetIntData(SqlHandle, 3);
-                PMob->m_SpawnPoint.x = Sql_GetFloatData(SqlHandle, 4);
-                PMob->m_SpawnPoint.y = Sql_GetFloatData(SqlHandle, 5);
-                PMob->m_SpawnPoint.z = Sql_GetFloatData(SqlHandle, 6);
-
-                PMob->m_RespawnTime = Sql_GetUIntData(SqlHandle, 7) * 1000;
-                PMob->m_SpawnType = (SPAWNTYPE)Sql_GetUIntData(SqlHandle, 8);
-                PMob->m_DropID = Sql_GetUIntData(SqlHandle, 9);
-
-                PMob->HPmodifier = (uint32)Sql_GetIntData(SqlHandle, 10);
-                PMob->MPmodifier = (uint32)Sql_GetIntData(SqlHandle, 11);
-
-                PMob->m_minLevel = (uint8)Sql_GetIntData(SqlHandle, 12);
-                PMob->m_maxLevel = (uint8)Sql_GetIntData(SqlHandle, 13);
-
-                memcpy(&PMob->look, Sql_GetData(SqlHandle, 14), 23);
-
-                PMob->SetMJob(Sql_GetIntData(SqlHandle, 15));
-                PMob->SetSJob(Sql_GetIntData(SqlHandle, 16));
-
-                ((CItemWeapon*)PMob->m_Weapons[SLOT_MAIN])->setMaxHit(1);
-                ((CItemWeapon*)PMob->m_Weapons[SLOT_MAIN])->setSkillType(Sql_GetIntData(SqlHandle, 17));
-                PMob->m_dmgMult = Sql_GetUIntData(SqlHandle, 18);
-                ((CItemWeapon*)PMob->m_Weapons[SLOT_MAIN])->setDelay((Sql_GetIntData(SqlHandle, 19) * 1000) / 60);
-                ((CItemWeapon*)PMob->m_Weapons[SLOT_MAIN])->setBaseDelay((Sql_GetIntData(SqlHandle, 19) * 1000) / 60);
-
-                PMob->m_Behaviour = (uint16)Sql_GetIntData(SqlHandle, 20);
-                PMob->m_Link = (uint8)Sql_GetIntData(SqlHandle, 21);
-                PMob->m_Type = (uint8)Sql_GetIntData(SqlHandle, 22);
-                PMob->m_Immunity = (IMMUNITY)Sql_GetIntData(SqlHandle, 23);
-                PMob->m_EcoSystem = (ECOSYSTEM)Sql_GetIntData(SqlHandle, 24);
-                PMob->m_ModelSize = (uint8)Sql_GetIntData(SqlHandle, 25);
-
-                PMob->speed = (uint8)Sql_GetIntData(SqlHandle, 26);
-                PMob->speedsub = (uint8)Sql_GetIntData(SqlHandle, 26);
-
-                /*if(PMob->speed != 0)
-                {
-                PMob->speed += map_config.speed_mod;
-                // whats this for?
-                PMob->speedsub += map_config.speed_mod;
-                }*/
-
-                PMob->strRank = (uint8)Sql_GetIntData(SqlHandle, 27);
-                PMob->dexRank = (uint8)Sql_GetIntData(SqlHandle, 28);
-                PMob->vitRank = (uint8)Sql_GetIntData(SqlHandle, 29);
-                PMob->agiRank = (uint8)Sql_GetIntData(SqlHandle, 30);
-                PMob->intRank = (uint8)Sql_GetIntData(SqlHandle, 31);
-                PMob->mndRank = (uint8)Sql_GetIntData(SqlHandle, 32);
-                PMob->chrRank = (uint8)Sql_GetIntData(SqlHandle, 33);
-                PMob->evaRank = (uint8)Sql_GetIntData(SqlHandle, 34);
-                PMob->defRank = (uint8)Sql_GetIntData(SqlHandle, 35);
-                PMob->attRank = (uint8)Sql_GetIntData(SqlHandle, 57);
-                PMob->accRank = (uint8)Sql_GetIntData(SqlHandle, 58);
-
-                PMob->setModifier(Mod::SLASHRES, (uint16)(Sql_GetFloatData(SqlHandle, 36) * 1000));
-                PMob->setModifier(Mod::PIERCERES, (uint16)(Sql_GetFloatData(SqlHandle, 37) * 1000));
-                PMob->setModifier(Mod::HTHRES, (uint16)(Sql_GetFloatData(SqlHandle, 38) * 1000));
-                PMob->setModifier(Mod::IMPACTRES, (uint16)(Sql_GetFloatData(SqlHandle, 39) * 1000));
-
-                PMob->setModifier(Mod::FIRERES, (int16)((Sql_GetFloatData(SqlHandle, 40) - 1) * -100)); // These are stored as floating percentages
-                PMob->setModifier(Mod::ICERES, (int16)((Sql_GetFloatData(SqlHandle, 41) - 1) * -100)); // and need to be adjusted into modifier units.
-                PMob->setModifier(Mod::WINDRES, (int16)((Sql_GetFloatData(SqlHandle, 42) - 1) * -100)); // Higher RES = lower damage.
-                PMob->setModifier(Mod::EARTHRES, (int16)((Sql_GetFloatData(SqlHandle, 43) - 1) * -100)); // Negatives signify lower resist chance.
-                PMob->setModifier(Mod::THUNDERRES, (int16)((Sql_GetFloatData(SqlHandle, 44) - 1) * -100)); // Positives signify increased resist chance.
-                PMob->setModifier(Mod::WATERRES, (int16)((Sql_GetFloatData(SqlHandle, 45) - 1) * -100));
-                PMob->setModifier(Mod::LIGHTRES, (int16)((Sql_GetFloatData(SqlHandle, 46) - 1) * -100));
-                PMob->setModifier(Mod::DARKRES, (int16)((Sql_GetFloatData(SqlHandle, 47) - 1) * -100));
-
-                PMob->m_Element = (uint8)Sql_GetIntData(SqlHandle, 48);
-                PMob->m_Family = (uint16)Sql_GetIntData(SqlHandle, 49);
-                PMob->m_name_prefix = (uint8)Sql_GetIntData(SqlHandle, 50);
-                PMob->m_flags = (uint32)Sql_GetIntData(SqlHandle, 51);
-
-                // Cap Level if Necessary (Don't Cap NMs)
-                if (normalLevelRangeMin > 0 && !(PMob->m_Type & MOBTYPE_NOTORIOUS) && PMob->m_minLevel > normalLevelRangeMin)
-                {
-                    PMob->m_minLevel = normalLevelRangeMin;
-                }
-
-                if (normalLevelRangeMax > 0 && !(PMob->m_Type & MOBTYPE_NOTORIOUS) && PMob->m_maxLevel > normalLevelRangeMax)
-                {
-                    PMob->m_maxLevel = normalLevelRangeMax;
-                }
-
-                //Special sub animation for Mob (yovra, jailer of love, phuabo)
-                // yovra 1: en hauteur, 2: en bas, 3: en haut
-                // phuabo 1: sous l'eau, 2: sort de l'eau, 3: rentre dans l'eau
-                PMob->animationsub = (uint32)Sql_GetIntData(SqlHandle, 52);
-
-                if (PMob->animationsub != 0)
-                    PMob->setMobMod(MOBMOD_SPAWN_ANIMATIONSUB, PMob->animationsub);
-
-                // Setup HP / MP Stat Percentage Boost
-                PMob->HPscale = Sql_GetFloatData(SqlHandle, 53);
-                PMob->MPscale = Sql_GetFloatData(SqlHandle, 54);
-
-                // Check if we should be looking up scripts for this mob
-                PMob->m_HasSpellScript = (uint8)Sql_GetIntData(SqlHandle, 55);
-
-                PMob->m_SpellListContainer = mobSpellList::GetMobSpellList(Sql_GetIntData(SqlHandle, 56));
-
-                PMob->m_Pool = Sql_GetUIntData(SqlHandle, 59);
-
-                PMob->allegiance = Sql_GetUIntData(SqlHandle, 60);
-                PMob->namevis = Sql_GetUIntData(SqlHandle, 61);
-                PMob->m_Aggro = Sql_GetUIntData(SqlHandle, 62);
-
-                PMob->m_roamFlags = (uint16)Sql_GetUIntData(SqlHandle, 63);
-                PMob->m_MobSkillList = Sql_GetUIntData(SqlHandle, 64);
-
-                PMob->m_TrueDetection = Sql_GetUIntData(SqlHandle, 65);
-                PMob->m_Detects = Sql_GetUIntData(SqlHandle, 66);
-
-                PMob->setMobMod(MOBMOD_CHARMABLE, Sql_GetUIntData(SqlHandle, 67));
-
-                // Overwrite base family charmables depending on mob type. Disallowed mobs which should be charmable
-                // can be set in mob_spawn_mods or in their onInitialize
-                if (PMob->m_Type & MOBTYPE_EVENT || PMob->m_Type & MOBTYPE_FISHED || PMob->m_Type & MOBTYPE_BATTLEFIELD ||
-                    PMob->m_Type & MOBTYPE_NOTORIOUS || zoneType == ZONETYPE_BATTLEFIELD || zoneType == ZONETYPE_DYNAMIS)
-                {
-                    PMob->setMobMod(MOBMOD_CHARMABLE, 0);
-                }
-
-                // must be here first to define mobmods
-                mobutils::InitializeMob(PMob, GetZone(ZoneID));
-
-                GetZone(ZoneID)->InsertMOB(PMob);
+                PMob->m_minLevel = normalLevelRangeMin;
             }
+
+            if (normalLevelRangeMax > 0 && !(PMob->m_Type & MOBTYPE_NOTORIOUS) && PMob->m_maxLevel > normalLevelRangeMax)
+            {
+                PMob->m_maxLevel = normalLevelRangeMax;
+            }
+
+            if (PMob->animationsub != 0)
+                PMob->setMobMod(MOBMOD_SPAWN_ANIMATIONSUB, PMob->animationsub);
+
+            PMob->m_roamFlags = Template.roamFlags;
+
+            if (zoneType == ZONETYPE_BATTLEFIELD || zoneType == ZONETYPE_DYNAMIS)
+            {
+                PMob->setMobMod(MOBMOD_CHARMABLE, 0);
+            }
+
+            // must be here first to define mobmods
+            mobutils::InitializeMob(PMob, PZone);
+
+            PZone->InsertMOB(PMob);
         }
-    }
+    });
 
     // handle mob initialise functions after they're all loaded
     ForEachZone([](CZone* PZone)
@@ -538,24 +431,22 @@ void LoadMOBList()
     });
 
     // attach pets to mobs
-    const char* PetQuery =
-        "SELECT mob_groups.zoneid, mob_mobid, pet_offset \
-        FROM mob_pets \
-        LEFT JOIN mob_spawn_points ON mob_pets.mob_mobid = mob_spawn_points.mobid \
-        LEFT JOIN mob_groups ON mob_spawn_points.groupid = mob_groups.groupid \
-        INNER JOIN zone_settings ON mob_groups.zoneid = zone_settings.zoneid \
-        WHERE IF(%d <> 0, '%s' = zoneip AND %d = zoneport, TRUE) \
-        AND mob_groups.zoneid = ((mobid >> 12) & 0xFFF);";
-
-    ret = Sql_Query(SqlHandle, PetQuery, map_ip.s_addr, address, map_port);
+    int32 ret = Sql_Query(SqlHandle, "SELECT mob_mobid, pet_offset FROM mob_pets;");
 
     if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
     {
         while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
         {
-            uint16 ZoneID = (uint16)Sql_GetUIntData(SqlHandle, 0);
-            uint32 masterid = (uint32)Sql_GetUIntData(SqlHandle,1);
-            uint32 petid = masterid + (uint32)Sql_GetUIntData(SqlHandle,2);
+            uint32 masterid = (uint32)Sql_GetUIntData(SqlHandle,0);
+            uint32 petid = masterid + (uint32)Sql_GetUIntData(SqlHandle,1);
+
+            // only masters spawned by this process have a template; the rest belong to other map servers
+            const MobTemplate_t* MasterTemplate = mobutils::GetMobTemplate(masterid);
+            if (MasterTemplate == nullptr || GetZone(MasterTemplate->zoneid)->GetType() == ZONETYPE_DUNGEON_INSTANCED)
+            {
+                continue;
+            }
+            uint16 ZoneID = MasterTemplate->zoneid;
 
             CMobEntity* PMaster = (CMobEntity*)GetZone(ZoneID)->GetEntity(masterid & 0x0FFF, TYPE_MOB);
             CMobEntity* PPet = (CMobEntity*)GetZone(ZoneID)->GetEntity(petid & 0x0FFF, TYPE_MOB);
@@ -624,7 +515,7 @@ CZone* CreateZone(uint16 ZoneID)
 *                                                                       *
 ************************************************************************/
 
-void LoadZoneList()
+void CreateZoneList()
 {
     g_PTrigger = new CNpcEntity();  // нужно в конструкторе CNpcEntity задавать модель по умолчанию
 
@@ -657,7 +548,51 @@ void LoadZoneList()
     {
         g_PZoneList[0] = CreateZone(0);
     }
+}
+
+/************************************************************************
+*                                                                       *
+*  Navmeshes are plain files and each zone owns its own, so they are    *
+*  read concurrently once the zones exist.                              *
+*                                                                       *
+************************************************************************/
+
+void LoadNavMeshes(uint8 threads)
+{
+    std::vector<CZone*> zones;
+    zones.reserve(g_PZoneList.size());
+    for (auto PZone : g_PZoneList)
+    {
+        if (PZone.second)
+        {
+            zones.push_back(PZone.second);
+        }
+    }
+
+    std::atomic<size_t> next {0};
+    auto load = [&]()
+    {
+        for (size_t i = next++; i < zones.size(); i = next++)
+        {
+            zones[i]->LoadNavMesh();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (uint8 i = 1; i < threads; ++i)
+    {
+        workers.emplace_back(load);
+    }
+    load();
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
 
+void LoadZoneEntities()
+{
     LoadNPCList();
     LoadMOBList();
 
@@ -1023,6 +958,8 @@ void FreeZoneList()
         delete PZone.second;
     }
     g_PZoneList.clear();
+    g_PCharByID.clear();
+    g_PCharByName.clear();
     delete g_PTrigger;
     g_PTrigger = nullptr;
 }
@@ -1066,4 +1003,144 @@ bool IsResidentialArea(CCharEntity* PChar)
     return PChar->m_moghouseID != 0;
 }
 
+/************************************************************************
+*                                                                       *
+*  Zone tick timings. Every zone ticks on the main thread, so the sum   *
+*  of their tick times has to fit in one server tick.                   *
+*                                                                       *
+************************************************************************/
+
+namespace
+{
+    struct zone_population_t
+    {
+        uint32 chars {0};
+        uint32 mobs {0};
+        uint32 npcs {0};
+    };
+
+    zone_population_t GetPopulation(CZone* PZone)
+    {
+        zone_population_t population;
+        PZone->ForEachChar([&](CCharEntity*) { population.chars++; });
+        PZone->ForEachMob([&](CMobEntity*) { population.mobs++; });
+        PZone->ForEachNpc([&](CNpcEntity*) { population.npcs++; });
+        return population;
+    }
+
+    double toMs(duration value)
+    {
+        return std::chrono::duration<double, std::milli>(value).count();
+    }
+}
+
+void PrintZoneTickStats()
+{
+    std::vector<std::pair<CZone*, zone_tick_stats_t>> zones;
+    for (auto PZone : g_PZoneList)
+    {
+        zone_tick_stats_t stats = PZone.second->GetTickStats();
+        if (stats.ticks > 0)
+        {
+            zones.emplace_back(PZone.second, stats);
+        }
+        PZone.second->ResetTickStats();
+    }
+    std::sort(zones.begin(), zones.end(), [](auto& a, auto& b) { return a.second.total > b.second.total; });
+
+    ShowInfo("Zone ticks (ticks: avg/max ms, chars/mobs/npcs)\n");
+    for (auto& [PZone, stats] : zones)
+    {
+        zone_population_t population = GetPopulation(PZone);
+        ShowInfo("  %-32s %8llu: %.3f/%.3f ms, %u/%u/%u\n", (const char*)PZone->GetName(), (unsigned long long)stats.ticks,
+            toMs(stats.total) / stats.ticks, toMs(stats.max), population.chars, population.mobs, population.npcs);
+    }
+}
+
+/************************************************************************
+*                                                                       *
+*  Runs the zone ticks of the n most populated zones at the server      *
+*  tick rate for 'seconds', for n = 1, 2, 4... up to every zone with    *
+*  mobs, and reports the time one tick of all of them takes against     *
+*  the tick interval. Started with --zone-tick-bench, before any        *
+*  client can connect, so no zone timer is running meanwhile.           *
+*                                                                       *
+************************************************************************/
+
+void BenchmarkZoneTicks(uint32 seconds)
+{
+    const auto interval = std::chrono::milliseconds((int)(1000 / server_tick_rate));
+
+    std::vector<std::pair<CZone*, uint32>> zones;
+    for (auto PZone : g_PZoneList)
+    {
+        zone_population_t population = GetPopulation(PZone.second);
+        if (population.mobs > 0)
+        {
+            zones.emplace_back(PZone.second, population.mobs + population.npcs);
+        }
+    }
+    std::sort(zones.begin(), zones.end(), [](auto& a, auto& b) { return a.second > b.second; });
+
+    if (zones.empty())
+    {
+        ShowWarning("BenchmarkZoneTicks: no zone with mobs is hosted by this map server\n");
+        return;
+    }
+
+    ShowStatus("BenchmarkZoneTicks: %u zones with mobs, %u s per step, %lld ms tick\n", (uint32)zones.size(), seconds, (long long)interval.count());
+
+    for (size_t count = 1;; count = std::min(count * 2, zones.size()))
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            zones[i].first->ResetTickStats();
+        }
+
+        uint64 passes = 0;
+        duration passTotal = duration::zero();
+        duration passMax = duration::zero();
+
+        auto end = server_clock::now() + std::chrono::seconds(seconds);
+        while (server_clock::now() < end)
+        {
+            time_point tick = server_clock::now();
+            for (size_t i = 0; i < count; ++i)
+            {
+                zones[i].first->Tick(tick);
+            }
+
+            duration elapsed = server_clock::now() - tick;
+            passes++;
+            passTotal += elapsed;
+            passMax = std::max(passMax, elapsed);
+
+            std::this_thread::sleep_until(tick + interval);
+        }
+
+        duration zoneMax = duration::zero();
+        const char* slowest = "";
+        for (size_t i = 0; i < count; ++i)
+        {
+            zone_tick_stats_t stats = zones[i].first->GetTickStats();
+            if (stats.max > zoneMax)
+            {
+                zoneMax = stats.max;
+                slowest = (const char*)zones[i].first->GetName();
+            }
+        }
+
+        double passAvg = passes ? toMs(passTotal) / passes : 0;
+        ShowInfo("  %3u zones: %.3f/%.3f ms per tick (avg/max, %.1f%% of the tick), %.3f ms avg per zone, slowest zone tick %.3f ms (%s)\n",
+            (uint32)count, passAvg, toMs(passMax), 100.0 * passAvg / toMs(interval), passAvg / count, toMs(zoneMax), slowest);
+
+        if (count == zones.size())
+        {
+            break;
+        }
+    }
+
+    PrintZoneTickStats();
+}
+
 }; // namespace zoneutils
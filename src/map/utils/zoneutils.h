@@ -38,11 +38,15 @@ class CNpcEntity;
 
 namespace zoneutils
 {
-    void LoadZoneList();                                                            // загружаем список зон
+    void CreateZoneList();                                                          // загружаем список зон (settings, zonelines and weather only)
+    void LoadNavMeshes(uint8 threads);                                              // reads every zone's navmesh file, spread over threads
+    void LoadZoneEntities();                                                        // npcs and mobs, then OnZoneInitialise
     void FreeZoneList();                                                            // освобождаем список зон
     void InitializeWeather();                                                       // обновляем погоду в зонах
     void TOTDChange(TIMETYPE TOTD);                                                 // реакция мира на смену времени суток
     void SavePlayTime();
+    void PrintZoneTickStats();                                                      // tick time and population of every zone that ticked since the last report
+    void BenchmarkZoneTicks(uint32 seconds);                                        // ticks 1, 2, 4... of the most populated zones back to back and reports tick time per zone
 
     REGIONTYPE    GetCurrentRegion(uint16 ZoneID);
     CONTINENTTYPE GetCurrentContinent(uint16 ZoneID);
@@ -56,6 +60,8 @@ namespace zoneutils
     CCharEntity* GetCharFromWorld(uint32 charid, uint16 targid);                    // returns pointer to character by id and target id
     CCharEntity* GetChar(uint32 id);                                                // returns pointer to character by id
     CCharEntity* GetCharToUpdate(uint32 primary, uint32 ternary);                   // returnes pointer to preferred char to update for party changes
+    void         RegisterChar(CCharEntity* PChar);                                  // adds a character entering a zone to the world index
+    void         UnregisterChar(CCharEntity* PChar);                                // removes a character leaving a zone from the world index
     void         ForEachZone(std::function<void(CZone*)> func);
     uint64       GetZoneIPP(uint16 zoneid);                                         // returns IPP for zone ID
     bool         IsResidentialArea(CCharEntity*);                                  // returns whether or not the area is a residential zone
@@ -0,0 +1,469 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#include "../common/showmsg.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "write_behind.h"
+#include "map.h"
+
+namespace writebehind
+{
+    struct pending_t
+    {
+        uint64 seq;
+        std::vector<std::string> queries;
+    };
+
+    struct pending_key_t
+    {
+        uint64 id;          // charid << 32 | section << 16 | param
+        std::string name;   // variable name, empty for numeric sections
+
+        bool operator==(const pending_key_t& other) const
+        {
+            return id == other.id && name == other.name;
+        }
+    };
+
+    struct pending_key_hash
+    {
+        size_t operator()(const pending_key_t& key) const
+        {
+            return std::hash<uint64>()(key.id) ^ (std::hash<std::string>()(key.name) << 1);
+        }
+    };
+
+    // a batch taken off the queue, remembers where each entry came from so it can be put back
+    struct batch_entry_t
+    {
+        pending_t entry;
+        pending_key_t key;
+        bool appended;
+    };
+
+    // written by the DB thread if the transaction takes longer than this
+    constexpr auto slowBatchWarning = 500ms;
+
+    // wait before retrying a batch while the SQL server can't be reached
+    constexpr auto retryDelay = 1s;
+
+    // a failing batch is retried this many times during shutdown, then dropped
+    constexpr uint32 shutdownRetries = 5;
+
+    bool enable = false;
+    bool stopping = false;
+    bool flushRequested = false;
+
+    std::thread writerThread;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;     // wakes the DB thread
+    std::condition_variable commitCondition;    // wakes threads waiting in Flush
+
+    std::unordered_map<pending_key_t, pending_t, pending_key_hash> pending;
+    std::unordered_map<uint32, uint64> pendingChars;    // charid -> seq of its latest queued section
+    std::vector<pending_t> appended;                    // statements queued with Append, never coalesced
+    uint64 queuedSeq = 0;
+    uint64 committedSeq = 0;
+
+    writebehind_stats_t stats {};
+    uint64 totalLatency = 0;
+
+    /************************************************************************
+    *                                                                       *
+    *  Pings the DB thread's connection and replaces it if the ping fails   *
+    *                                                                       *
+    ************************************************************************/
+
+    bool reconnect()
+    {
+        if (Sql_Ping(SqlHandle) != SQL_ERROR)
+        {
+            return true;
+        }
+        ShowWarning("writebehind: ping to the SQL server failed, reconnecting\n");
+
+        Sql_t* handle = Sql_Malloc();
+        if (Sql_Connect(handle, map_config.mysql_login.c_str(),
+            map_config.mysql_password.c_str(),
+            map_config.mysql_host.c_str(),
+            map_config.mysql_port,
+            map_config.mysql_database.c_str()) == SQL_ERROR)
+        {
+            Sql_Free(handle);
+            return false;
+        }
+        Sql_Free(SqlHandle);
+        SqlHandle = handle;
+        return true;
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Writes a batch in one transaction, rolled back if anything fails.    *
+    *  On a failed statement 'failed' is the index of its entry, it is      *
+    *  batch.size() if the transaction itself could not start or commit.   *
+    *                                                                       *
+    ************************************************************************/
+
+    bool write(std::vector<batch_entry_t>& batch, size_t* failed)
+    {
+        *failed = batch.size();
+        if (!Sql_TransactionStart(SqlHandle))
+        {
+            return false;
+        }
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            for (auto& query : batch[i].entry.queries)
+            {
+                if (Sql_QueryStr(SqlHandle, query.c_str()) == SQL_ERROR)
+                {
+                    *failed = i;
+                    Sql_TransactionRollback(SqlHandle);
+                    return false;
+                }
+            }
+        }
+        if (!Sql_TransactionCommit(SqlHandle))
+        {
+            Sql_TransactionRollback(SqlHandle);
+            return false;
+        }
+        return true;
+    }
+
+    // called with queueMutex held: entries go back ahead of anything queued since, a
+    // newer save of the same section that was queued meanwhile replaces its old one
+    void requeue(std::vector<batch_entry_t>& batch)
+    {
+        std::vector<pending_t> older;
+        for (auto& item : batch)
+        {
+            if (item.appended)
+            {
+                older.push_back(std::move(item.entry));
+            }
+            else if (!pending.emplace(std::move(item.key), std::move(item.entry)).second)
+            {
+                stats.coalesced++;
+            }
+        }
+        appended.insert(appended.begin(), std::make_move_iterator(older.begin()), std::make_move_iterator(older.end()));
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  DB thread: waits up to async_char_save_interval for saves to         *
+    *  coalesce, then writes everything pending in one transaction.         *
+    *                                                                       *
+    ************************************************************************/
+
+    void run(std::promise<bool>* connected)
+    {
+        SqlHandle = Sql_Malloc();
+
+        if (Sql_Connect(SqlHandle, map_config.mysql_login.c_str(),
+            map_config.mysql_password.c_str(),
+            map_config.mysql_host.c_str(),
+            map_config.mysql_port,
+            map_config.mysql_database.c_str()) == SQL_ERROR)
+        {
+            Sql_Free(SqlHandle);
+            SqlHandle = nullptr;
+            connected->set_value(false);
+            return;
+        }
+        connected->set_value(true);
+
+        // Sql_Keepalive would ping this handle from the main thread's task list, so the
+        // connection is kept alive here instead: only this thread ever touches it.
+        uint32 timeout = 28800;
+        Sql_GetTimeout(SqlHandle, &timeout);
+        const auto pingInterval = std::chrono::seconds(std::max<uint32>(timeout, 60) - 30);
+        auto lastActivity = std::chrono::steady_clock::now();
+
+        const auto interval = std::chrono::milliseconds(map_config.async_char_save_interval);
+        std::vector<batch_entry_t> batch;
+        uint32 failures = 0;
+
+        std::unique_lock<std::mutex> lk(queueMutex);
+        while (true)
+        {
+            queueCondition.wait_for(lk, interval, [] { return stopping || flushRequested; });
+
+            if (pending.empty() && appended.empty())
+            {
+                if (stopping)
+                {
+                    break;
+                }
+                if (std::chrono::steady_clock::now() - lastActivity >= pingInterval)
+                {
+                    lk.unlock();
+                    reconnect();
+                    lastActivity = std::chrono::steady_clock::now();
+                    lk.lock();
+                }
+                continue;
+            }
+
+            batch.clear();
+            batch.reserve(pending.size() + appended.size());
+            for (auto& entry : pending)
+            {
+                batch.push_back({ std::move(entry.second), entry.first, false });
+            }
+            pending.clear();
+            for (auto& entry : appended)
+            {
+                batch.push_back({ std::move(entry), pending_key_t(), true });
+            }
+            appended.clear();
+            flushRequested = false;
+            uint64 batchSeq = queuedSeq;
+            lk.unlock();
+
+            // Sections of one character may touch the same column (nameflags is written by both
+            // stats and gm level saves), so statements are replayed in the order they were queued.
+            std::sort(batch.begin(), batch.end(), [](const batch_entry_t& a, const batch_entry_t& b) { return a.entry.seq < b.entry.seq; });
+
+            auto start = std::chrono::steady_clock::now();
+            size_t failed;
+            bool written = write(batch, &failed);
+            lastActivity = std::chrono::steady_clock::now();
+            auto latency = lastActivity - start;
+
+            if (!written)
+            {
+                // Nothing of the batch was committed. A dead connection is replaced and the whole
+                // batch retried; if the connection is fine a statement itself is bad, so only the
+                // section it belongs to is dropped, otherwise it would hold up every later save.
+                bool alive = Sql_Ping(SqlHandle) != SQL_ERROR;
+                bool reachable = alive || reconnect();
+                if (alive && failed < batch.size())
+                {
+                    ShowError("writebehind: dropping a section that failed to write: %s\n", batch[failed].entry.queries.front().c_str());
+                    batch.erase(batch.begin() + failed);
+                }
+                else if (!reachable)
+                {
+                    std::this_thread::sleep_for(retryDelay);
+                }
+
+                lk.lock();
+                if (stopping && !reachable && ++failures >= shutdownRetries)
+                {
+                    ShowError("writebehind: cannot reach the SQL server, %u queued sections are lost\n",
+                        (uint32)(batch.size() + pending.size() + appended.size()));
+                    break;
+                }
+                requeue(batch);
+                continue;
+            }
+            failures = 0;
+
+            if (latency > slowBatchWarning)
+            {
+                ShowWarning("writebehind: writing %u sections took %lld ms\n", (uint32)batch.size(),
+                    (long long)std::chrono::duration_cast<std::chrono::milliseconds>(latency).count());
+            }
+
+            lk.lock();
+            committedSeq = batchSeq;
+            for (auto it = pendingChars.begin(); it != pendingChars.end();)
+            {
+                it = it->second <= committedSeq ? pendingChars.erase(it) : std::next(it);
+            }
+
+            stats.lastLatency = (uint32)std::chrono::duration_cast<std::chrono::milliseconds>(latency).count();
+            stats.maxLatency = std::max(stats.maxLatency, stats.lastLatency);
+            stats.batches++;
+            totalLatency += stats.lastLatency;
+            commitCondition.notify_all();
+        }
+        lk.unlock();
+
+        Sql_Free(SqlHandle);
+        SqlHandle = nullptr;
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Starts the DB thread, saves stay synchronous if it can't connect     *
+    *                                                                       *
+    ************************************************************************/
+
+    void init()
+    {
+        if (!map_config.async_char_save)
+        {
+            return;
+        }
+
+        std::promise<bool> connected;
+        auto result = connected.get_future();
+        writerThread = std::thread(run, &connected);
+
+        if (!result.get())
+        {
+            writerThread.join();
+            ShowError("writebehind: cannot connect to the database, character saves stay synchronous\n");
+            return;
+        }
+        enable = true;
+    }
+
+    void final()
+    {
+        if (!writerThread.joinable())
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lk(queueMutex);
+            stopping = true;
+        }
+        queueCondition.notify_one();
+        writerThread.join();
+        enable = false;
+    }
+
+    bool enabled()
+    {
+        return enable;
+    }
+
+    // async saves disabled: runs on the calling thread's connection
+    void ExecuteNow(const std::vector<std::string>& queries)
+    {
+        for (auto& query : queries)
+        {
+            Sql_QueryStr(SqlHandle, query.c_str());
+        }
+    }
+
+    void Enqueue(uint32 charid, pending_key_t&& key, std::vector<std::string>&& queries)
+    {
+        if (!enable)
+        {
+            ExecuteNow(queries);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lk(queueMutex);
+        pending_t& entry = pending[std::move(key)];
+        if (entry.seq != 0)
+        {
+            stats.coalesced++;
+        }
+        entry.seq = ++queuedSeq;
+        entry.queries = std::move(queries);
+        pendingChars[charid] = entry.seq;
+        stats.queued++;
+    }
+
+    void Execute(uint32 charid, WRITEBEHIND_SECTION section, uint16 param, std::vector<std::string>&& queries)
+    {
+        Enqueue(charid, { ((uint64)charid << 32) | ((uint32)section << 16) | param, std::string() }, std::move(queries));
+    }
+
+    void Execute(uint32 charid, WRITEBEHIND_SECTION section, const std::string& name, std::vector<std::string>&& queries)
+    {
+        Enqueue(charid, { ((uint64)charid << 32) | ((uint32)section << 16), name }, std::move(queries));
+    }
+
+    void Append(std::vector<std::string>&& queries)
+    {
+        if (!enable)
+        {
+            ExecuteNow(queries);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lk(queueMutex);
+        appended.push_back({ ++queuedSeq, std::move(queries) });
+        stats.queued++;
+    }
+
+    void Flush(uint32 charid)
+    {
+        if (!enable)
+        {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lk(queueMutex);
+        auto it = pendingChars.find(charid);
+        if (it == pendingChars.end())
+        {
+            return;
+        }
+
+        uint64 target = it->second;
+        flushRequested = true;
+        queueCondition.notify_one();
+        commitCondition.wait(lk, [target] { return committedSeq >= target; });
+    }
+
+    void FlushAll()
+    {
+        if (!enable)
+        {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lk(queueMutex);
+        uint64 target = queuedSeq;
+        flushRequested = true;
+        queueCondition.notify_one();
+        commitCondition.wait(lk, [target] { return committedSeq >= target; });
+    }
+
+    bool Pending(uint32 charid)
+    {
+        if (!enable)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lk(queueMutex);
+        return pendingChars.find(charid) != pendingChars.end();
+    }
+
+    writebehind_stats_t GetStats()
+    {
+        std::lock_guard<std::mutex> lk(queueMutex);
+        writebehind_stats_t result = stats;
+        result.depth = pending.size() + appended.size();
+        result.avgLatency = stats.batches ? (uint32)(totalLatency / stats.batches) : 0;
+        return result;
+    }
+};
@@ -0,0 +1,134 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#ifndef _WRITEBEHIND_H
+#define _WRITEBEHIND_H
+
+#include "../common/cbasetypes.h"
+#include "../common/sql.h"
+
+#include <string>
+#include <vector>
+
+/************************************************************************
+*                                                                       *
+*  Write-behind queue for character saves.                              *
+*                                                                       *
+*  Save statements are formatted on the main thread and handed to a     *
+*  dedicated DB thread with its own connection. A newer save of the     *
+*  same character section replaces the one still waiting, and every     *
+*  pass writes everything pending inside one transaction. A pass that   *
+*  fails is rolled back and queued again ahead of newer saves; only a   *
+*  section whose statement fails on a working connection is dropped.    *
+*                                                                       *
+*  Variables (char_vars, server_variables) are keyed by name instead    *
+*  of a numeric param. Server variables are queued under charid 0.      *
+*                                                                       *
+*  When async_char_save is off every call runs immediately on the       *
+*  calling thread, exactly like a plain Sql_Query.                      *
+*                                                                       *
+************************************************************************/
+
+enum WRITEBEHIND_SECTION : uint16
+{
+    WB_POSITION,
+    WB_QUESTS,
+    WB_FAME,
+    WB_MISSIONS,
+    WB_INVENTORY_CAPACITY,
+    WB_KEYITEMS,
+    WB_LEARNED_ABILITIES,
+    WB_TITLES,
+    WB_ZONES_VISITED,
+    WB_EQUIP,
+    WB_LOOK,
+    WB_STYLE_LOCK,
+    WB_STYLE,
+    WB_STATS,
+    WB_GMLEVEL,
+    WB_NAMEFLAGS,
+    WB_MENTOR,
+    WB_MENU_CONFIG,
+    WB_NATION,
+    WB_CAMPAIGN_ALLEGIANCE,
+    WB_MOGHANCEMENT,
+    WB_JOB,
+    WB_EXP,
+    WB_SKILL,
+    WB_TELEPORT,
+    WB_DEATH_TIME,
+    WB_PLAYTIME,
+    WB_CHAR_VAR,
+    WB_SERVER_VAR,
+};
+
+struct writebehind_stats_t
+{
+    size_t depth;               // sections waiting to be written
+    uint64 queued;              // sections handed to the queue
+    uint64 coalesced;           // sections replaced by a newer save before being written
+    uint64 batches;             // transactions committed
+    uint32 lastLatency;         // ms, duration of the last transaction
+    uint32 maxLatency;          // ms, slowest transaction so far
+    uint32 avgLatency;          // ms, average transaction duration
+};
+
+namespace writebehind
+{
+    void   init();
+    void   final();
+    bool   enabled();
+
+    // Queues the statements of one character section, replacing any not yet written.
+    void   Execute(uint32 charid, WRITEBEHIND_SECTION section, uint16 param, std::vector<std::string>&& queries);
+
+    template<typename... Args>
+    void   Query(uint32 charid, WRITEBEHIND_SECTION section, uint16 param, const char* query, Args... args)
+    {
+        Execute(charid, section, param, { fmt::sprintf(query, args...) });
+    }
+
+    // Same as above for sections keyed by a variable name
+    void   Execute(uint32 charid, WRITEBEHIND_SECTION section, const std::string& name, std::vector<std::string>&& queries);
+
+    template<typename... Args>
+    void   Query(uint32 charid, WRITEBEHIND_SECTION section, const std::string& name, const char* query, Args... args)
+    {
+        Execute(charid, section, name, { fmt::sprintf(query, args...) });
+    }
+
+    // Queues statements that are never replaced by later ones and are written in queue order
+    void   Append(std::vector<std::string>&& queries);
+
+    template<typename... Args>
+    void   AppendQuery(const char* query, Args... args)
+    {
+        Append({ fmt::sprintf(query, args...) });
+    }
+
+    void   Flush(uint32 charid);    // blocks until everything queued for charid is committed
+    void   FlushAll();              // blocks until the queue is empty
+    bool   Pending(uint32 charid);  // true while statements queued for charid are not committed
+
+    writebehind_stats_t GetStats();
+};
+
+#endif
@@ -41,6 +41,7 @@
 #include "status_effect_container.h"
 #include "treasure_pool.h"
 #include "vana_time.h"
+#include "write_behind.h"
 #include "zone.h"
 #include "zone_entities.h"
 
@@ -71,42 +72,6 @@
 #include "utils/zoneutils.h"
 
 
-/************************************************************************
-*                                                                       *
-*  Cервер для обработки активности сущностей (по серверу на зону) без   *
-*  активных областей                                                    *
-*                                                                       *
-************************************************************************/
-
-int32 zone_server(time_point tick, CTaskMgr::CTask* PTask)
-{
-    std::any_cast<CZone*>(PTask->m_data)->ZoneServer(tick, false);
-    return 0;
-}
-
-/************************************************************************
-*                                                                       *
-*  Cервер для обработки активности сущностей (по серверу на зону) c     *
-*  активными областями                                                  *
-*                                                                       *
-************************************************************************/
-
-int32 zone_server_region(time_point tick, CTaskMgr::CTask* PTask)
-{
-    CZone* PZone = std::any_cast<CZone*>(PTask->m_data);
-
-    if ((tick - PZone->m_RegionCheckTime) < 800ms)
-    {
-        PZone->ZoneServer(tick, false);
-    }
-    else
-    {
-        PZone->ZoneServer(tick, true);
-        PZone->m_RegionCheckTime = tick;
-    }
-    return 0;
-}
-
 /************************************************************************
 *                                                                       *
 *                                                                       *
@@ -151,7 +116,6 @@ CZone::CZone(ZONEID ZoneID, REGIONTYPE RegionID, CONTINENTTYPE ContinentID)
 
     LoadZoneLines();
     LoadZoneWeather();
-    LoadNavMesh();
 }
 
 CZone::~CZone()
@@ -588,7 +552,7 @@ void CZone::DecreaseZoneCounter(CCharEntity* PChar)
 
     if (ZoneTimer && m_zoneEntities->CharListEmpty())
     {
-        ZoneTimer->m_type = CTaskMgr::TASK_REMOVE;
+        CTaskMgr::getInstance()->RemoveTask(ZoneTimer);
         ZoneTimer = nullptr;
 
         m_zoneEntities->HealAllMobs();
@@ -835,12 +799,51 @@ void CZone::createZoneTimer()
     ZoneTimer = CTaskMgr::getInstance()->AddTask(
         m_zoneName,
         server_clock::now(),
-        this,
+        nullptr,
         CTaskMgr::TASK_INTERVAL,
-        m_regionList.empty() ? zone_server : zone_server_region,
+        [this](time_point tick, CTaskMgr::CTask*)
+        {
+            Tick(tick);
+            return 0;
+        },
         std::chrono::milliseconds((int)(1000 / server_tick_rate)));
 }
 
+/************************************************************************
+*                                                                       *
+*  One pass of the zone timer. Kept apart from the timer so that the    *
+*  tick benchmark (zoneutils::BenchmarkZoneTicks) runs the same code.   *
+*                                                                       *
+************************************************************************/
+
+void CZone::Tick(time_point tick)
+{
+    auto start = server_clock::now();
+
+    // regions are checked every 800ms, entities every tick
+    bool checkRegions = !m_regionList.empty() && (tick - m_RegionCheckTime) >= 800ms;
+    ZoneServer(tick, checkRegions);
+    if (checkRegions)
+    {
+        m_RegionCheckTime = tick;
+    }
+
+    duration elapsed = server_clock::now() - start;
+    m_tickStats.ticks++;
+    m_tickStats.total += elapsed;
+    m_tickStats.max = std::max(m_tickStats.max, elapsed);
+}
+
+zone_tick_stats_t CZone::GetTickStats()
+{
+    return m_tickStats;
+}
+
+void CZone::ResetTickStats()
+{
+    m_tickStats = zone_tick_stats_t();
+}
+
 void CZone::CharZoneIn(CCharEntity* PChar)
 {
     // ищем свободный targid для входящего в зону персонажа
@@ -972,6 +975,9 @@ void CZone::CharZoneOut(CCharEntity* PChar)
 
     if (PChar->PParty && PChar->loc.destination != 0 && PChar->m_moghouseID == 0)
     {
+        // the reload carries a roster snapshot read back from chars, so the new position has to be there
+        writebehind::Flush(PChar->id);
+
         uint8 data[4] {};
         ref<uint32>(data, 0) = PChar->PParty->GetPartyID();
         message::send(MSG_PT_RELOAD, data, sizeof data, nullptr);
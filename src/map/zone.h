@@ -519,7 +519,14 @@ typedef std::map<uint16, zoneWeather_t> weatherVector_t;
 
 typedef std::map<uint16, CBaseEntity*> EntityList_t;
 
-int32 zone_update_weather(uint32 tick, CTaskMgr::CTask *PTask);
+struct zone_tick_stats_t
+{
+    uint64   ticks {0};
+    duration total {duration::zero()};
+    duration max   {duration::zero()};
+};
+
+int32 zone_update_weather(time_point tick, CTaskMgr::CTask *PTask);
 
 class CZone
 {
@@ -573,6 +580,7 @@ public:
     virtual void    TransportDepart(uint16 boundary, uint16 zone);                  // транспотр отправляется, необходимо собрать пассажиров
 
     void            InsertRegion(CRegion* Region);                                  // добавляем в зону активную область
+    void            LoadNavMesh();                                                  // Load the zones navmesh from navmeshes/:zone.nav, see zoneutils::LoadNavMeshes
 
     virtual void    TOTDChange(TIMETYPE TOTD);                                      // обработка реакции мира на смену времени суток
     virtual void    PushPacket(CBaseEntity*, GLOBAL_MESSAGE_TYPE, CBasicPacket*);   // отправляем глобальный пакет в пределах зоны
@@ -581,8 +589,12 @@ public:
     weatherVector_t m_WeatherVector;                                                // вероятность появления каждого типа погоды
 
     virtual void    ZoneServer(time_point tick, bool check_regions);
+    void            Tick(time_point tick);                                          // one zone timer pass, timed into the tick stats
     void            CheckRegions(CCharEntity* PChar);
 
+    zone_tick_stats_t GetTickStats();                                               // Tick() timings since the last ResetTickStats
+    void            ResetTickStats();
+
     virtual void    ForEachChar(std::function<void(CCharEntity*)> func);
     virtual void    ForEachCharInstance(CBaseEntity* PEntity, std::function<void(CCharEntity*)> func);
     virtual void    ForEachMob(std::function<void(CMobEntity*)> func);
@@ -622,11 +634,12 @@ private:
     void    LoadZoneLines();                // список zonelines (можно было бы заменить этот метод методом InsertZoneLine)
     void    LoadZoneWeather();              // погода
     void    LoadZoneSettings();             // настройки зоны
-    void    LoadNavMesh();                  // Load the zones navmesh. Must exist in scripts/zones/:zone/NavMesh.nav
 
 
     CTreasurePool*  m_TreasurePool;         // глобальный TreasuerPool
 
+    zone_tick_stats_t m_tickStats;
+
 protected:
 
     CTaskMgr::CTask* ZoneTimer;             // указатель на созданный таймер - ZoneServer. необходим для возможности его остановки
@@ -76,7 +76,14 @@ void CZoneEntities::HealAllMobs()
 
 void CZoneEntities::InsertPC(CCharEntity* PChar)
 {
+    // grids are refreshed by ZoneServer, which does not run while the zone is empty
+    if (m_charList.empty())
+    {
+        UpdateGrids();
+    }
     m_charList[PChar->targid] = PChar;
+    m_charGrid.Update(PChar);
+    zoneutils::RegisterChar(PChar);
     ShowDebug(CL_CYAN"CZone:: %s IncreaseZoneCounter <%u> %s \n" CL_RESET, m_zone->GetName(), m_charList.size(), PChar->GetName());
 }
 
@@ -97,6 +104,7 @@ void CZoneEntities::InsertMOB(CBaseEntity* PMob)
 
         FindPartyForMob(PMob);
         m_mobList[PMob->targid] = PMob;
+        m_mobGrid.Update(PMob);
     }
 }
 
@@ -112,6 +120,7 @@ void CZoneEntities::InsertNPC(CBaseEntity* PNpc)
             return;
         }
         m_npcList[PNpc->targid] = PNpc;
+        m_npcGrid.Update(PNpc);
     }
 }
 
@@ -120,6 +129,7 @@ void CZoneEntities::DeletePET(CBaseEntity* PPet)
     if (PPet != nullptr)
     {
         m_petList.erase(PPet->targid);
+        m_petGrid.Remove(PPet);
     }
 }
 
@@ -146,17 +156,17 @@ void CZoneEntities::InsertPET(CBaseEntity* PPet)
         PPet->targid = targid;
         PPet->loc.zone = m_zone;
         m_petList[PPet->targid] = PPet;
+        m_petGrid.Update(PPet);
 
-        for (EntityList_t::const_iterator it = m_charList.begin(); it != m_charList.end(); ++it)
+        m_charGrid.ForEachInRange(PPet->loc.p, 50, [PPet](CBaseEntity* PEntity)
         {
-            CCharEntity* PCurrentChar = (CCharEntity*)it->second;
+            CCharEntity* PCurrentChar = (CCharEntity*)PEntity;
 
-            if (distance(PPet->loc.p, PCurrentChar->loc.p) < 50)
-            {
-                PCurrentChar->SpawnPETList[PPet->id] = PPet;
-                PCurrentChar->pushPacket(new CEntityUpdatePacket(PPet, ENTITY_SPAWN, UPDATE_ALL_MOB));
-            }
-        }
+            // the targid may still be listed for a pet that used it before
+            PCurrentChar->SpawnPETList.erase(PPet->id);
+            PCurrentChar->SpawnPETList.insert(PPet->id, PPet);
+            PCurrentChar->pushPacket(new CEntityUpdatePacket(PPet, ENTITY_SPAWN, UPDATE_ALL_MOB));
+        });
         return;
     }
     ShowError(CL_RED"CZone::InsertPET : entity is null\n" CL_RESET);
@@ -308,11 +318,8 @@ void CZoneEntities::DecreaseZoneCounter(CCharEntity* PChar)
             {
                 //inform other players of the pets removal
                 CCharEntity* PCurrentChar = (CCharEntity*)it->second;
-                SpawnIDList_t::iterator PET = PCurrentChar->SpawnPETList.find(PChar->PPet->id);
-
-                if (PET != PCurrentChar->SpawnPETList.end())
+                if (PCurrentChar->SpawnPETList.erase(PChar->PPet->id))
                 {
-                    PCurrentChar->SpawnPETList.erase(PET);
                     PCurrentChar->pushPacket(new CEntityUpdatePacket(PChar->PPet, ENTITY_DESPAWN, UPDATE_NONE));
                 }
             }
@@ -347,6 +354,8 @@ void CZoneEntities::DecreaseZoneCounter(CCharEntity* PChar)
     // TODO: могут возникать проблемы с переходом между одной и той же зоной (zone == prevzone)
 
     m_charList.erase(PChar->targid);
+    m_charGrid.Remove(PChar);
+    zoneutils::UnregisterChar(PChar);
 
     ShowDebug(CL_CYAN"CZone:: %s DecreaseZoneCounter <%u> %s\n" CL_RESET, m_zone->GetName(), m_charList.size(), PChar->GetName());
 }
@@ -375,11 +384,8 @@ void CZoneEntities::DespawnPC(CCharEntity* PChar)
     for (EntityList_t::const_iterator it = m_charList.begin(); it != m_charList.end(); ++it)
     {
         CCharEntity* PCurrentChar = (CCharEntity*)it->second;
-        SpawnIDList_t::iterator PC = PCurrentChar->SpawnPCList.find(PChar->id);
-
-        if (PC != PCurrentChar->SpawnPCList.end())
+        if (PCurrentChar->SpawnPCList.erase(PChar->id))
         {
-            PCurrentChar->SpawnPCList.erase(PC);
             PCurrentChar->pushPacket(new CCharPacket(PChar, ENTITY_DESPAWN, 0));
         }
     }
@@ -387,70 +393,83 @@ void CZoneEntities::DespawnPC(CCharEntity* PChar)
 
 void CZoneEntities::SpawnMOBs(CCharEntity* PChar)
 {
-    for (EntityList_t::const_iterator it = m_mobList.begin(); it != m_mobList.end(); ++it)
+    m_mobGrid.ForEachInRange(PChar->loc.p, 50, [PChar](CBaseEntity* PEntity)
     {
-        CMobEntity* PCurrentMob = (CMobEntity*)it->second;
-        SpawnIDList_t::iterator MOB = PChar->SpawnMOBList.lower_bound(PCurrentMob->id);
+        CMobEntity* PCurrentMob = (CMobEntity*)PEntity;
 
-        float CurrentDistance = distance(PChar->loc.p, PCurrentMob->loc.p);
+        if (PCurrentMob->status == STATUS_DISAPPEAR)
+        {
+            return;
+        }
 
-        if (PCurrentMob->status != STATUS_DISAPPEAR && CurrentDistance < 50)
+        if (PChar->SpawnMOBList.insert(PCurrentMob->id, PCurrentMob))
         {
-            if (MOB == PChar->SpawnMOBList.end() || PChar->SpawnMOBList.key_comp()(PCurrentMob->id, MOB->first))
-            {
-                PChar->SpawnMOBList.insert(MOB, SpawnIDList_t::value_type(PCurrentMob->id, PCurrentMob));
-                PChar->pushPacket(new CEntityUpdatePacket(PCurrentMob, ENTITY_SPAWN, UPDATE_ALL_MOB));
-            }
+            PChar->pushPacket(new CEntityUpdatePacket(PCurrentMob, ENTITY_SPAWN, UPDATE_ALL_MOB));
+        }
+
+        if (PChar->isDead() || PChar->nameflags.flags & FLAG_GM || PCurrentMob->PMaster)
+            return;
 
-            if (PChar->isDead() || PChar->nameflags.flags & FLAG_GM || PCurrentMob->PMaster)
-                continue;
+        // проверка ночного/дневного сна монстров уже учтена в проверке CurrentAction, т.к. во сне монстры не ходят ^^
 
-            // проверка ночного/дневного сна монстров уже учтена в проверке CurrentAction, т.к. во сне монстры не ходят ^^
+        const EMobDifficulty mobCheck = charutils::CheckMob(PChar->GetMLevel(), PCurrentMob->GetMLevel());
 
-            const EMobDifficulty mobCheck = charutils::CheckMob(PChar->GetMLevel(), PCurrentMob->GetMLevel());
+        CMobController* PController = static_cast<CMobController*>(PCurrentMob->PAI->GetController());
 
-            CMobController* PController = static_cast<CMobController*>(PCurrentMob->PAI->GetController());
+        bool validAggro = mobCheck > EMobDifficulty::TooWeak || PChar->isSitting() || PCurrentMob->getMobMod(MOBMOD_ALWAYS_AGGRO);
 
-            bool validAggro = mobCheck > EMobDifficulty::TooWeak || PChar->isSitting() || PCurrentMob->getMobMod(MOBMOD_ALWAYS_AGGRO);
+        if (validAggro && PController->CanAggroTarget(PChar))
+            PCurrentMob->PEnmityContainer->AddBaseEnmity(PChar);
+    });
 
-            if (validAggro && PController->CanAggroTarget(PChar))
-                PCurrentMob->PEnmityContainer->AddBaseEnmity(PChar);
+    for (SpawnIDList_t::iterator MOB = PChar->SpawnMOBList.begin(); MOB != PChar->SpawnMOBList.end();)
+    {
+        // only mobs of this zone are despawned, the low bits of the id are the targid
+        EntityList_t::const_iterator it = m_mobList.find(MOB->first & 0xFFF);
+        CBaseEntity* PCurrentMob = MOB->second;
+
+        if (it != m_mobList.end() && it->second == PCurrentMob &&
+            (PCurrentMob->status == STATUS_DISAPPEAR || distance(PChar->loc.p, PCurrentMob->loc.p) >= 50))
+        {
+            MOB = PChar->SpawnMOBList.erase(MOB);
+            PChar->pushPacket(new CEntityUpdatePacket(PCurrentMob, ENTITY_DESPAWN, UPDATE_NONE));
         }
         else
         {
-            if (MOB != PChar->SpawnMOBList.end() && !(PChar->SpawnMOBList.key_comp()(PCurrentMob->id, MOB->first)))
-            {
-                PChar->SpawnMOBList.erase(MOB);
-                PChar->pushPacket(new CEntityUpdatePacket(PCurrentMob, ENTITY_DESPAWN, UPDATE_NONE));
-            }
+            ++MOB;
         }
     }
 }
 
 void CZoneEntities::SpawnPETs(CCharEntity* PChar)
 {
-    for (EntityList_t::const_iterator it = m_petList.begin(); it != m_petList.end(); ++it)
+    m_petGrid.ForEachInRange(PChar->loc.p, 50, [PChar](CBaseEntity* PEntity)
     {
-        CPetEntity* PCurrentPet = (CPetEntity*)it->second;
-        SpawnIDList_t::iterator PET = PChar->SpawnPETList.lower_bound(PCurrentPet->id);
+        CPetEntity* PCurrentPet = (CPetEntity*)PEntity;
 
-        if ((PCurrentPet->status == STATUS_NORMAL || PCurrentPet->status == STATUS_MOB) &&
-            distance(PChar->loc.p, PCurrentPet->loc.p) < 50)
+        if (PCurrentPet->status == STATUS_NORMAL || PCurrentPet->status == STATUS_MOB)
         {
-            if (PET == PChar->SpawnPETList.end() ||
-                PChar->SpawnPETList.key_comp()(PCurrentPet->id, PET->first))
+            if (PChar->SpawnPETList.insert(PCurrentPet->id, PCurrentPet))
             {
-                PChar->SpawnPETList.insert(PET, SpawnIDList_t::value_type(PCurrentPet->id, PCurrentPet));
                 PChar->pushPacket(new CEntityUpdatePacket(PCurrentPet, ENTITY_SPAWN, UPDATE_ALL_MOB));
             }
         }
-        else {
-            if (PET != PChar->SpawnPETList.end() &&
-                !(PChar->SpawnPETList.key_comp()(PCurrentPet->id, PET->first)))
-            {
-                PChar->SpawnPETList.erase(PET);
-                PChar->pushPacket(new CEntityUpdatePacket(PCurrentPet, ENTITY_DESPAWN, UPDATE_NONE));
-            }
+    });
+
+    for (SpawnIDList_t::iterator PET = PChar->SpawnPETList.begin(); PET != PChar->SpawnPETList.end();)
+    {
+        EntityList_t::const_iterator it = m_petList.find(PET->first & 0xFFF);
+        CBaseEntity* PCurrentPet = PET->second;
+
+        if (it != m_petList.end() && it->second == PCurrentPet &&
+            !((PCurrentPet->status == STATUS_NORMAL || PCurrentPet->status == STATUS_MOB) && distance(PChar->loc.p, PCurrentPet->loc.p) < 50))
+        {
+            PET = PChar->SpawnPETList.erase(PET);
+            PChar->pushPacket(new CEntityUpdatePacket(PCurrentPet, ENTITY_DESPAWN, UPDATE_NONE));
+        }
+        else
+        {
+            ++PET;
         }
     }
 }
@@ -459,87 +478,101 @@ void CZoneEntities::SpawnNPCs(CCharEntity* PChar)
 {
     if (!PChar->m_moghouseID)
     {
-        for (EntityList_t::const_iterator it = m_npcList.begin(); it != m_npcList.end(); ++it)
+        m_npcGrid.ForEachInRange(PChar->loc.p, 50, [PChar](CBaseEntity* PEntity)
         {
-            CNpcEntity* PCurrentNpc = (CNpcEntity*)it->second;
-            SpawnIDList_t::iterator NPC = PChar->SpawnNPCList.lower_bound(PCurrentNpc->id);
+            CNpcEntity* PCurrentNpc = (CNpcEntity*)PEntity;
 
             if (PCurrentNpc->status == STATUS_NORMAL || PCurrentNpc->status == STATUS_MOB)
             {
-                if (distance(PChar->loc.p, PCurrentNpc->loc.p) < 50)
+                if (PChar->SpawnNPCList.insert(PCurrentNpc->id, PCurrentNpc))
                 {
-                    if (NPC == PChar->SpawnNPCList.end() ||
-                        PChar->SpawnNPCList.key_comp()(PCurrentNpc->id, NPC->first))
-                    {
-                        PChar->SpawnNPCList.insert(NPC, SpawnIDList_t::value_type(PCurrentNpc->id, PCurrentNpc));
-                        PChar->pushPacket(new CEntityUpdatePacket(PCurrentNpc, ENTITY_SPAWN, UPDATE_ALL_MOB));
-                    }
-                }
-                else {
-                    if (NPC != PChar->SpawnNPCList.end() &&
-                        !(PChar->SpawnNPCList.key_comp()(PCurrentNpc->id, NPC->first)))
-                    {
-                        PChar->SpawnNPCList.erase(NPC);
-                        PChar->pushPacket(new CEntityUpdatePacket(PCurrentNpc, ENTITY_DESPAWN, UPDATE_NONE));
-                    }
+                    PChar->pushPacket(new CEntityUpdatePacket(PCurrentNpc, ENTITY_SPAWN, UPDATE_ALL_MOB));
                 }
             }
+        });
+
+        for (SpawnIDList_t::iterator NPC = PChar->SpawnNPCList.begin(); NPC != PChar->SpawnNPCList.end();)
+        {
+            EntityList_t::const_iterator it = m_npcList.find(NPC->first & 0xFFF);
+            CBaseEntity* PCurrentNpc = NPC->second;
+
+            // hidden npcs keep their spawn state until they are shown again
+            if (it != m_npcList.end() && it->second == PCurrentNpc &&
+                (PCurrentNpc->status == STATUS_NORMAL || PCurrentNpc->status == STATUS_MOB) &&
+                distance(PChar->loc.p, PCurrentNpc->loc.p) >= 50)
+            {
+                NPC = PChar->SpawnNPCList.erase(NPC);
+                PChar->pushPacket(new CEntityUpdatePacket(PCurrentNpc, ENTITY_DESPAWN, UPDATE_NONE));
+            }
+            else
+            {
+                ++NPC;
+            }
         }
     }
 }
 
 void CZoneEntities::SpawnPCs(CCharEntity* PChar)
 {
-    for (EntityList_t::const_iterator it = m_charList.begin(); it != m_charList.end(); ++it)
+    m_charGrid.Update(PChar);
+
+    m_charGrid.ForEachInRange(PChar->loc.p, 50, [PChar](CBaseEntity* PEntity)
     {
-        CCharEntity* PCurrentChar = (CCharEntity*)it->second;
+        CCharEntity* PCurrentChar = (CCharEntity*)PEntity;
+
+        if (PChar == PCurrentChar || PChar->m_moghouseID != PCurrentChar->m_moghouseID)
+        {
+            return;
+        }
+
         SpawnIDList_t::iterator PC = PChar->SpawnPCList.find(PCurrentChar->id);
 
-        if (PChar != PCurrentChar)
+        if (PC == PChar->SpawnPCList.end())
         {
-            if (distance(PChar->loc.p, PCurrentChar->loc.p) < 50 && PChar->m_moghouseID == PCurrentChar->m_moghouseID)
+            if (PCurrentChar->m_isGMHidden == false)
             {
-                if (PC == PChar->SpawnPCList.end())
-                {
-                    if (PCurrentChar->m_isGMHidden == false)
-                    {
-                        PChar->SpawnPCList[PCurrentChar->id] = PCurrentChar;
-                        PChar->pushPacket(new CCharPacket(PCurrentChar, ENTITY_SPAWN, UPDATE_ALL_CHAR));
-                        PChar->pushPacket(new CCharSyncPacket(PCurrentChar));
-                    }
+                PChar->SpawnPCList.insert(PCurrentChar->id, PCurrentChar);
+                PChar->pushPacket(new CCharPacket(PCurrentChar, ENTITY_SPAWN, UPDATE_ALL_CHAR));
+                PChar->pushPacket(new CCharSyncPacket(PCurrentChar));
+            }
 
-                    if (PChar->m_isGMHidden == false)
-                    {
-                        PCurrentChar->SpawnPCList[PChar->id] = PChar;
-                        PCurrentChar->pushPacket(new CCharPacket(PChar, ENTITY_SPAWN, UPDATE_ALL_CHAR));
-                        PCurrentChar->pushPacket(new CCharSyncPacket(PChar));
-                    }
-                }
-                else
-                {
-                    if (PCurrentChar->m_isGMHidden == true)
-                    {
-                        PChar->SpawnPCList.erase(PC);
-                    }
-                    // TODO: figure out a way to push these packets in response to 0x015s while preserving the mask
-                    //  every operation on the mask should persist for 400ms (0x015 frequency)
-                    /*else if (PChar->updatemask != 0)
-                    {
-                        PCurrentChar->pushPacket(new CCharPacket(PChar, ENTITY_UPDATE, PChar->updatemask));
-                    }*/
-                }
+            if (PChar->m_isGMHidden == false)
+            {
+                PCurrentChar->SpawnPCList.insert(PChar->id, PChar);
+                PCurrentChar->pushPacket(new CCharPacket(PChar, ENTITY_SPAWN, UPDATE_ALL_CHAR));
+                PCurrentChar->pushPacket(new CCharSyncPacket(PChar));
             }
-            else
+        }
+        else
+        {
+            if (PCurrentChar->m_isGMHidden == true)
             {
-                if (PC != PChar->SpawnPCList.end())
-                {
-                    PChar->SpawnPCList.erase(PC);
-                    PChar->pushPacket(new CCharPacket(PCurrentChar, ENTITY_DESPAWN, 0));
-
-                    PCurrentChar->SpawnPCList.erase(PChar->id);
-                    PCurrentChar->pushPacket(new CCharPacket(PChar, ENTITY_DESPAWN, 0));
-                }
+                PChar->SpawnPCList.erase(PC);
             }
+            // TODO: figure out a way to push these packets in response to 0x015s while preserving the mask
+            //  every operation on the mask should persist for 400ms (0x015 frequency)
+            /*else if (PChar->updatemask != 0)
+            {
+                PCurrentChar->pushPacket(new CCharPacket(PChar, ENTITY_UPDATE, PChar->updatemask));
+            }*/
+        }
+    });
+
+    for (SpawnIDList_t::iterator PC = PChar->SpawnPCList.begin(); PC != PChar->SpawnPCList.end();)
+    {
+        CCharEntity* PCurrentChar = (CCharEntity*)PC->second;
+
+        if (distance(PChar->loc.p, PCurrentChar->loc.p) >= 50 || PChar->m_moghouseID != PCurrentChar->m_moghouseID)
+        {
+            PC = PChar->SpawnPCList.erase(PC);
+            PChar->pushPacket(new CCharPacket(PCurrentChar, ENTITY_DESPAWN, 0));
+
+            PCurrentChar->SpawnPCList.erase(PChar->id);
+            PCurrentChar->pushPacket(new CCharPacket(PChar, ENTITY_DESPAWN, 0));
+        }
+        else
+        {
+            ++PC;
         }
     }
 }
@@ -772,6 +805,9 @@ void CZoneEntities::PushPacket(CBaseEntity* PEntity, GLOBAL_MESSAGE_TYPE message
         }
     }
 
+    // every recipient shares the same immutable packet
+    std::shared_ptr<CBasicPacket> sharedPacket(packet);
+
     if (!m_charList.empty())
     {
         switch (message_type)
@@ -780,22 +816,21 @@ void CZoneEntities::PushPacket(CBaseEntity* PEntity, GLOBAL_MESSAGE_TYPE message
             {
                 if (PEntity->objtype == TYPE_PC)
                 {
-                    ((CCharEntity*)PEntity)->pushPacket(new CBasicPacket(*packet));
+                    ((CCharEntity*)PEntity)->pushPacket(sharedPacket);
                 }
             }
             case CHAR_INRANGE:
             {
                 // todo: rewrite packet handlers and use enums instead of rawdog packet ids
                 // 30 yalms if action packet, 50 otherwise
-                const int checkDistanceSq = packet->id() == 0x0028 ? 900 : 2500;
+                const float checkDistance = packet->id() == 0x0028 ? 30.f : 50.f;
 
-                for (EntityList_t::const_iterator it = m_charList.begin(); it != m_charList.end(); ++it)
+                m_charGrid.ForEachInRange(PEntity->loc.p, checkDistance, [&](CBaseEntity* PRecipient)
                 {
-                    CCharEntity* PCurrentChar = (CCharEntity*)it->second;
+                    CCharEntity* PCurrentChar = (CCharEntity*)PRecipient;
                     if (PEntity != PCurrentChar)
                     {
-                        if (distanceSquared(PEntity->loc.p, PCurrentChar->loc.p) < checkDistanceSq &&
-                            ((PEntity->objtype != TYPE_PC) || (((CCharEntity*)PEntity)->m_moghouseID == PCurrentChar->m_moghouseID)))
+                        if ((PEntity->objtype != TYPE_PC) || (((CCharEntity*)PEntity)->m_moghouseID == PCurrentChar->m_moghouseID))
                         {
                             if (packet->id() == 0x00E &&
                                 (packet->ref<uint8>(0x0A) != 0x20 || packet->ref<uint8>(0x0A) != 0x0F))
@@ -805,7 +840,7 @@ void CZoneEntities::PushPacket(CBaseEntity* PEntity, GLOBAL_MESSAGE_TYPE message
 
                                 CBaseEntity* entity = GetEntity(targid);
 
-                                SpawnIDList_t spawnlist;
+                                const SpawnIDList_t* spawnlist = nullptr;
 
                                 if (entity)
                                 {
@@ -813,59 +848,51 @@ void CZoneEntities::PushPacket(CBaseEntity* PEntity, GLOBAL_MESSAGE_TYPE message
                                     {
                                         if (entity->objtype == TYPE_MOB)
                                         {
-                                            spawnlist = PCurrentChar->SpawnMOBList;
+                                            spawnlist = &PCurrentChar->SpawnMOBList;
                                         }
                                         else if (entity->objtype == TYPE_NPC)
                                         {
-                                            spawnlist = PCurrentChar->SpawnNPCList;
+                                            spawnlist = &PCurrentChar->SpawnNPCList;
                                         }
                                     }
                                     else if (entity->targid >= 0x700)
                                     {
-                                        spawnlist = PCurrentChar->SpawnPETList;
-                                    }
-                                    else
-                                    {
-                                        entity = nullptr;
+                                        spawnlist = &PCurrentChar->SpawnPETList;
                                     }
                                 }
-                                if (!entity)
+                                if (!spawnlist)
                                 {
                                     // got a char or nothing as the target of this entity update (which really shouldn't happen ever)
                                     // so we're just going to skip this packet
-                                    break;
+                                    return;
                                 }
-                                SpawnIDList_t::iterator iter = spawnlist.lower_bound(id);
-
-                                if (!(iter == spawnlist.end() ||
-                                    spawnlist.key_comp()(id, iter->first)))
+                                if (spawnlist->contains(id))
                                 {
-                                    PCurrentChar->pushPacket(new CBasicPacket(*packet));
+                                    PCurrentChar->pushPacket(sharedPacket);
                                 }
                             }
                             else
                             {
-                                PCurrentChar->pushPacket(new CBasicPacket(*packet));
+                                PCurrentChar->pushPacket(sharedPacket);
                             }
                         }
                     }
-                }
+                });
             }
             break;
             case CHAR_INSHOUT:
             {
-                for (EntityList_t::const_iterator it = m_charList.begin(); it != m_charList.end(); ++it)
+                m_charGrid.ForEachInRange(PEntity->loc.p, 180, [&](CBaseEntity* PRecipient)
                 {
-                    CCharEntity* PCurrentChar = (CCharEntity*)it->second;
+                    CCharEntity* PCurrentChar = (CCharEntity*)PRecipient;
                     if (PEntity != PCurrentChar)
                     {
-                        if (distance(PEntity->loc.p, PCurrentChar->loc.p) < 180 &&
-                            ((PEntity->objtype != TYPE_PC) || (((CCharEntity*)PEntity)->m_moghouseID == PCurrentChar->m_moghouseID)))
+                        if ((PEntity->objtype != TYPE_PC) || (((CCharEntity*)PEntity)->m_moghouseID == PCurrentChar->m_moghouseID))
                         {
-                            PCurrentChar->pushPacket(new CBasicPacket(*packet));
+                            PCurrentChar->pushPacket(sharedPacket);
                         }
                     }
-                }
+                });
             }
             break;
             case CHAR_INZONE:
@@ -878,7 +905,7 @@ void CZoneEntities::PushPacket(CBaseEntity* PEntity, GLOBAL_MESSAGE_TYPE message
                     {
                         if (PEntity != PCurrentChar)
                         {
-                            PCurrentChar->pushPacket(new CBasicPacket(*packet));
+                            PCurrentChar->pushPacket(sharedPacket);
                         }
                     }
                 }
@@ -886,37 +913,50 @@ void CZoneEntities::PushPacket(CBaseEntity* PEntity, GLOBAL_MESSAGE_TYPE message
             break;
         }
     }
-    delete packet;
 }
 
 void CZoneEntities::WideScan(CCharEntity* PChar, uint16 radius)
 {
     PChar->pushPacket(new CWideScanPacket(WIDESCAN_BEGIN));
-    for (EntityList_t::const_iterator it = m_npcList.begin(); it != m_npcList.end(); ++it)
+    m_npcGrid.ForEachInRange(PChar->loc.p, radius, [PChar](CBaseEntity* PEntity)
     {
-        CNpcEntity* PNpc = (CNpcEntity*)it->second;
+        CNpcEntity* PNpc = (CNpcEntity*)PEntity;
         if (PNpc->status == STATUS_NORMAL && !PNpc->IsNameHidden() && !PNpc->IsUntargetable() && PNpc->widescan == 1)
         {
-            if (distance(PChar->loc.p, PNpc->loc.p) < radius)
-            {
-                PChar->pushPacket(new CWideScanPacket(PChar, PNpc));
-            }
+            PChar->pushPacket(new CWideScanPacket(PChar, PNpc));
         }
-    }
-    for (EntityList_t::const_iterator it = m_mobList.begin(); it != m_mobList.end(); ++it)
+    });
+    m_mobGrid.ForEachInRange(PChar->loc.p, radius, [PChar](CBaseEntity* PEntity)
     {
-        CMobEntity* PMob = (CMobEntity*)it->second;
+        CMobEntity* PMob = (CMobEntity*)PEntity;
         if (PMob->status != STATUS_DISAPPEAR && !PMob->IsUntargetable())
         {
-            if (distance(PChar->loc.p, PMob->loc.p) < radius)
-            {
-                PChar->pushPacket(new CWideScanPacket(PChar, PMob));
-            }
+            PChar->pushPacket(new CWideScanPacket(PChar, PMob));
         }
-    }
+    });
     PChar->pushPacket(new CWideScanPacket(WIDESCAN_END));
 }
 
+void CZoneEntities::UpdateGrids()
+{
+    for (auto PMob : m_mobList)
+    {
+        m_mobGrid.Update(PMob.second);
+    }
+    for (auto PNpc : m_npcList)
+    {
+        m_npcGrid.Update(PNpc.second);
+    }
+    for (auto PPet : m_petList)
+    {
+        m_petGrid.Update(PPet.second);
+    }
+    for (auto PChar : m_charList)
+    {
+        m_charGrid.Update(PChar.second);
+    }
+}
+
 void CZoneEntities::ZoneServer(time_point tick, bool check_regions)
 {
     for (EntityList_t::const_iterator it = m_mobList.begin(); it != m_mobList.end(); ++it)
@@ -936,6 +976,7 @@ void CZoneEntities::ZoneServer(time_point tick, bool check_regions)
             PMob->StatusEffectContainer->TickEffects(tick);
         }
         PMob->PAI->Tick(tick);
+        m_mobGrid.Update(PMob);
     }
 
     for (EntityList_t::const_iterator it = m_npcList.begin(); it != m_npcList.end(); ++it)
@@ -943,6 +984,7 @@ void CZoneEntities::ZoneServer(time_point tick, bool check_regions)
         CNpcEntity* PNpc = (CNpcEntity*)it->second;
 
         PNpc->PAI->Tick(tick);
+        m_npcGrid.Update(PNpc);
     }
 
     EntityList_t::const_iterator pit = m_petList.begin();
@@ -964,6 +1006,7 @@ void CZoneEntities::ZoneServer(time_point tick, bool check_regions)
                 CMobEntity* PCurrentMob = (CMobEntity*)PMobIt.second;
                 PCurrentMob->PEnmityContainer->Clear(PPet->id);
             }
+            m_petGrid.Remove(PPet);
             if (PPet->getPetType() != PETTYPE_AUTOMATON || !PPet->PMaster)
             {
                 delete pit->second;
@@ -971,6 +1014,7 @@ void CZoneEntities::ZoneServer(time_point tick, bool check_regions)
             m_petList.erase(pit++);
         }
         else {
+            m_petGrid.Update(PPet);
             ++pit;
         }
     }
@@ -990,6 +1034,7 @@ void CZoneEntities::ZoneServer(time_point tick, bool check_regions)
             }
             PChar->PAI->Tick(tick);
             PChar->PTreasurePool->CheckItems(tick);
+            m_charGrid.Update(PChar);
             if (check_regions)
             {
                 m_zone->CheckRegions(PChar);
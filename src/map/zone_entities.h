@@ -23,6 +23,7 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 #define _CZONEENTITIES_H
 
 #include "zone.h"
+#include "spatial_grid.h"
 
 class CZoneEntities
 {
@@ -81,6 +82,13 @@ private:
 
     CZone* m_zone;
     CBaseEntity*    m_Transport;            // указатель на транспорт в зоне
+
+    CSpatialGrid    m_charGrid;             // position index of m_charList
+    CSpatialGrid    m_mobGrid;              // position index of m_mobList
+    CSpatialGrid    m_npcGrid;              // position index of m_npcList
+    CSpatialGrid    m_petGrid;              // position index of m_petList
+
+    void            UpdateGrids();          // refile every entity under its current position
     time_point m_EffectCheckTime {server_clock::now()};
 
 };
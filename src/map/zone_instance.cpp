@@ -292,10 +292,12 @@ void CZoneInstance::PushPacket(CBaseEntity* PEntity, GLOBAL_MESSAGE_TYPE message
     }
     else
     {
+        // each instance takes ownership of the packet it is given
         for (const auto& instance : instanceList)
         {
-            instance->PushPacket(PEntity, message_type, packet);
+            instance->PushPacket(PEntity, message_type, new CBasicPacket(*packet));
         }
+        delete packet;
     }
 }
 
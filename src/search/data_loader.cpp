@@ -23,30 +23,206 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 #include "../common/mmo.h"
 #include "../common/showmsg.h"
 #include "../common/sql.h"
+#include "../common/timer.h"
 
 #include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include "data_loader.h"
 #include "search.h"
 
-CDataLoader::CDataLoader()
+enum SEARCH_STATEMENT : uint8
+{
+    STMT_AH_HISTORY,
+    STMT_PARTY_LIST,
+    STMT_LINKSHELL_LIST,
+
+    STMT_COUNT
+};
+
+static const char* StatementQuery[STMT_COUNT] =
 {
-    SqlHandle = Sql_Malloc();
+    // STMT_AH_HISTORY
+    "SELECT sale, sell_date, seller_name, buyer_name "
+    "FROM auction_house "
+    "WHERE itemid = ? AND stack = ? AND buyer_name IS NOT NULL "
+    "ORDER BY sell_date DESC "
+    "LIMIT 10",
+
+    // STMT_PARTY_LIST
+    "SELECT charid, partyid, charname, pos_zone, nation, rank_sandoria, rank_bastok, rank_windurst, race, nameflags, mjob, sjob, mlvl, slvl "
+    "FROM accounts_sessions "
+    "LEFT JOIN accounts_parties USING(charid) "
+    "LEFT JOIN chars USING(charid) "
+    "LEFT JOIN char_look USING(charid) "
+    "LEFT JOIN char_stats USING(charid) "
+    "LEFT JOIN char_profile USING(charid) "
+    "WHERE IF (allianceid <> 0, allianceid IN (SELECT allianceid FROM accounts_parties WHERE charid = ?) , partyid = ?) "
+    "ORDER BY charname ASC "
+    "LIMIT 18",
+
+    // STMT_LINKSHELL_LIST
+    "SELECT charid, partyid, charname, pos_zone, nation, rank_sandoria, rank_bastok, rank_windurst, race, nameflags, mjob, sjob, "
+    "mlvl, slvl, linkshellid1, linkshellid2, "
+    "linkshellrank1, linkshellrank2 "
+    "FROM accounts_sessions "
+    "LEFT JOIN accounts_parties USING (charid) "
+    "LEFT JOIN chars USING (charid) "
+    "LEFT JOIN char_look USING (charid) "
+    "LEFT JOIN char_stats USING (charid) "
+    "LEFT JOIN char_profile USING(charid) "
+    "WHERE linkshellid1 = ? OR linkshellid2 = ? "
+    "ORDER BY charname ASC "
+    "LIMIT 18",
+};
+
+struct SearchSqlConnection
+{
+    Sql_t*      handle;
+    SqlStmt_t*  statements[STMT_COUNT];
+    time_point  lastUsed;
+    bool        connected;
+};
+
+namespace
+{
+    // connections idle for longer than this are pinged before they are handed out
+    constexpr auto ConnectionIdlePing = std::chrono::seconds(60);
+
+    std::mutex                         PoolMutex;
+    std::condition_variable            PoolCondition;
+    std::vector<SearchSqlConnection*>  PoolIdle;
+    size_t                             PoolOpen = 0;
+
+    void FreeStatements(SearchSqlConnection* PConnection)
+    {
+        for (auto& PStmt : PConnection->statements)
+        {
+            SqlStmt_Free(PStmt);
+            PStmt = nullptr;
+        }
+    }
+
+    // after a failed query the connection may be dead: it is closed when released and the
+    // next request opens a fresh one, pooled handles are not set to reconnect on their own
+    void MarkFailed(SearchSqlConnection* PConnection)
+    {
+        FreeStatements(PConnection);
+        PConnection->connected = false;
+    }
+
+    void FreeConnection(SearchSqlConnection* PConnection)
+    {
+        FreeStatements(PConnection);
+        Sql_Free(PConnection->handle);
+        delete PConnection;
+    }
 
-    //  ShowStatus("sqlhandle is allocating\n");
-    if (Sql_Connect(SqlHandle, search_config.mysql_login.c_str(),
-        search_config.mysql_password.c_str(),
-        search_config.mysql_host.c_str(),
-        search_config.mysql_port,
-        search_config.mysql_database.c_str()) == SQL_ERROR)
+    SearchSqlConnection* OpenConnection()
     {
-        ShowError("cant connect\n");
+        SearchSqlConnection* PConnection = new SearchSqlConnection{};
+        PConnection->handle = Sql_Malloc();
+        PConnection->connected = Sql_Connect(PConnection->handle, search_config.mysql_login.c_str(),
+            search_config.mysql_password.c_str(),
+            search_config.mysql_host.c_str(),
+            search_config.mysql_port,
+            search_config.mysql_database.c_str()) != SQL_ERROR;
+
+        if (!PConnection->connected)
+        {
+            ShowError("cant connect\n");
+        }
+        return PConnection;
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Takes an idle connection from the pool or opens a new one while the  *
+    *  pool is below mysql_pool_size, otherwise waits for a release.        *
+    *                                                                       *
+    ************************************************************************/
+
+    SearchSqlConnection* AcquireConnection()
+    {
+        std::unique_lock<std::mutex> lock(PoolMutex);
+        PoolCondition.wait(lock, [] { return !PoolIdle.empty() || PoolOpen < search_config.mysql_pool_size; });
+
+        if (PoolIdle.empty())
+        {
+            PoolOpen++;
+            lock.unlock();
+            return OpenConnection();
+        }
+
+        SearchSqlConnection* PConnection = PoolIdle.back();
+        PoolIdle.pop_back();
+        lock.unlock();
+
+        // replaces the keepalive timer: the server may have dropped a connection that sat idle
+        if (server_clock::now() - PConnection->lastUsed > ConnectionIdlePing && Sql_Ping(PConnection->handle) == SQL_ERROR)
+        {
+            ShowWarning("Search pool connection lost, reconnecting\n");
+            FreeConnection(PConnection);
+            PConnection = OpenConnection();
+        }
+        return PConnection;
+    }
+
+    void ReleaseConnection(SearchSqlConnection* PConnection)
+    {
+        {
+            std::lock_guard<std::mutex> lock(PoolMutex);
+            if (PConnection->connected)
+            {
+                PConnection->lastUsed = server_clock::now();
+                PoolIdle.push_back(PConnection);
+            }
+            else
+            {
+                PoolOpen--;
+            }
+        }
+        if (!PConnection->connected)
+        {
+            FreeConnection(PConnection);
+        }
+        PoolCondition.notify_one();
     }
 }
 
+CDataLoader::CDataLoader()
+{
+    Connection = AcquireConnection();
+    SqlHandle = Connection->handle;
+}
+
 CDataLoader::~CDataLoader()
 {
-    Sql_Free(SqlHandle);
+    ReleaseConnection(Connection);
+}
+
+/************************************************************************
+*                                                                       *
+*  Returns the prepared statement of the pooled connection, preparing   *
+*  it on first use.                                                     *
+*                                                                       *
+************************************************************************/
+
+SqlStmt_t* CDataLoader::GetStatement(uint8 index)
+{
+    SqlStmt_t*& PStmt = Connection->statements[index];
+    if (PStmt == nullptr && Connection->connected)
+    {
+        PStmt = SqlStmt_Malloc(SqlHandle);
+        if (PStmt != nullptr && SqlStmt_Prepare(PStmt, StatementQuery[index]) == SQL_ERROR)
+        {
+            MarkFailed(Connection);
+        }
+    }
+    return PStmt;
 }
 
 /************************************************************************
@@ -59,31 +235,186 @@ std::vector<ahHistory*> CDataLoader::GetAHItemHystory(uint16 ItemID, bool stack)
 {
     std::vector<ahHistory*> HistoryList;
 
-    const char* fmtQuery = "SELECT sale, sell_date, seller_name, buyer_name "
-        "FROM auction_house "
-        "WHERE itemid = %u AND stack = %u AND buyer_name IS NOT NULL "
-        "ORDER BY sell_date DESC "
-        "LIMIT 10";
+    SqlStmt_t* PStmt = GetStatement(STMT_AH_HISTORY);
+    if (PStmt == nullptr)
+    {
+        return HistoryList;
+    }
 
-    int32 ret = Sql_Query(SqlHandle, fmtQuery, ItemID, stack);
+    uint32 itemid = ItemID;
+    uint8  isStack = stack;
+    ahHistory row;
 
-    if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
+    SqlStmt_BindParam(PStmt, 0, SQLDT_UINT32, &itemid, sizeof(itemid));
+    SqlStmt_BindParam(PStmt, 1, SQLDT_UINT8, &isStack, sizeof(isStack));
+    SqlStmt_BindColumn(PStmt, 0, SQLDT_UINT32, &row.Price, sizeof(row.Price), nullptr);
+    SqlStmt_BindColumn(PStmt, 1, SQLDT_UINT32, &row.Data, sizeof(row.Data), nullptr);
+    SqlStmt_BindColumn(PStmt, 2, SQLDT_STRING, row.Name1, sizeof(row.Name1), nullptr);
+    SqlStmt_BindColumn(PStmt, 3, SQLDT_STRING, row.Name2, sizeof(row.Name2), nullptr);
+
+    if (SqlStmt_Execute(PStmt) == SQL_ERROR)
+    {
+        MarkFailed(Connection);
+        return HistoryList;
+    }
+
+    while (SqlStmt_NextRow(PStmt) == SQL_SUCCESS)
+    {
+        HistoryList.push_back(new ahHistory(row));
+    }
+    SqlStmt_FreeResult(PStmt);
+
+    std::reverse(HistoryList.begin(), HistoryList.end());
+    return HistoryList;
+}
+
+/************************************************************************
+*                                                                       *
+*  Category browsing is served from a snapshot: the item data of every  *
+*  category is read once, the amounts on sale are read with a single    *
+*  GROUP BY over auction_house at most every ah_snapshot_interval.      *
+*  Request threads share the current snapshot, one of them rebuilds it  *
+*  when it is stale while the others keep using the old one.            *
+*                                                                       *
+************************************************************************/
+
+namespace
+{
+    struct AHCategoryItem
     {
+        uint16      itemid;
+        bool        stackable;
+        int32       level;      // -1 where the joined row is missing (NULL sorts last in DESC)
+        int32       dmg;
+        int32       delay;
+        std::string sortname;
+    };
+
+    typedef std::unordered_map<uint8, std::vector<AHCategoryItem>> AHCategoryList_t;
+
+    struct AHSnapshot
+    {
+        std::shared_ptr<const AHCategoryList_t> categories;
+        std::unordered_map<uint16, std::pair<uint32, uint32>> amounts; // itemid -> singles, stacks on sale
+        time_point built;
+    };
+
+    std::mutex                        SnapshotMutex;
+    std::mutex                        SnapshotBuildMutex;
+    std::shared_ptr<const AHSnapshot> Snapshot;
+
+    std::shared_ptr<const AHCategoryList_t> LoadAHCategories(SearchSqlConnection* PConnection)
+    {
+        Sql_t* SqlHandle = PConnection->handle;
+        auto categories = std::make_shared<AHCategoryList_t>();
+
+        const char* Query = "SELECT item_basic.itemid, item_basic.stackSize, item_basic.aH, item_basic.sortname, "
+            "item_equipment.level, item_weapon.dmg, item_weapon.delay "
+            "FROM item_basic "
+            "LEFT JOIN item_equipment ON item_basic.itemid = item_equipment.itemid "
+            "LEFT JOIN item_weapon ON item_basic.itemid = item_weapon.itemid "
+            "WHERE aH != 0";
+
+        if (Sql_Query(SqlHandle, Query) == SQL_ERROR)
+        {
+            MarkFailed(PConnection);
+            return nullptr;
+        }
+
         while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
         {
-            ahHistory* PAHHistory = new ahHistory;
+            AHCategoryItem item;
+            item.itemid = (uint16)Sql_GetUIntData(SqlHandle, 0);
+            item.stackable = Sql_GetUIntData(SqlHandle, 1) != 1;
+            item.sortname = (const char*)Sql_GetData(SqlHandle, 3);
+            item.level = Sql_GetData(SqlHandle, 4) != nullptr ? Sql_GetIntData(SqlHandle, 4) : -1;
+            item.dmg = Sql_GetData(SqlHandle, 5) != nullptr ? Sql_GetIntData(SqlHandle, 5) : -1;
+            item.delay = Sql_GetData(SqlHandle, 6) != nullptr ? Sql_GetIntData(SqlHandle, 6) : -1;
+
+            (*categories)[(uint8)Sql_GetUIntData(SqlHandle, 2)].push_back(std::move(item));
+        }
+        return categories;
+    }
 
-            PAHHistory->Price = Sql_GetUIntData(SqlHandle, 0);
-            PAHHistory->Data = Sql_GetUIntData(SqlHandle, 1);
+    std::shared_ptr<const AHSnapshot> GetAHSnapshot(SearchSqlConnection* PConnection)
+    {
+        Sql_t* SqlHandle = PConnection->handle;
+        auto interval = std::chrono::seconds(search_config.ah_snapshot_interval);
+        std::shared_ptr<const AHSnapshot> current;
+        {
+            std::lock_guard<std::mutex> lock(SnapshotMutex);
+            current = Snapshot;
+        }
+        if (current && server_clock::now() - current->built < interval)
+        {
+            return current;
+        }
 
-            snprintf((char*)PAHHistory->Name1, 15, "%s", Sql_GetData(SqlHandle, 2));
-            snprintf((char*)PAHHistory->Name2, 15, "%s", Sql_GetData(SqlHandle, 3));
+        // without a snapshot every request waits for the first one, afterwards a single thread rebuilds it
+        std::unique_lock<std::mutex> build(SnapshotBuildMutex, std::defer_lock);
+        if (current)
+        {
+            if (!build.try_lock())
+            {
+                return current;
+            }
+        }
+        else
+        {
+            build.lock();
+        }
 
-            HistoryList.push_back(PAHHistory);
+        {
+            std::lock_guard<std::mutex> lock(SnapshotMutex);
+            if (Snapshot && Snapshot != current)
+            {
+                return Snapshot;
+            }
+        }
+
+        auto snapshot = std::make_shared<AHSnapshot>();
+        snapshot->categories = current ? current->categories : LoadAHCategories(PConnection);
+        if (!snapshot->categories)
+        {
+            return current;
+        }
+
+        const char* Query = "SELECT itemid, COUNT(*) - SUM(stack), SUM(stack) "
+            "FROM auction_house "
+            "WHERE buyer_name IS NULL "
+            "GROUP BY itemid";
+
+        if (Sql_Query(SqlHandle, Query) == SQL_ERROR)
+        {
+            MarkFailed(PConnection);
+            return current;
         }
-        std::reverse(HistoryList.begin(), HistoryList.end());
+
+        snapshot->amounts.reserve((size_t)Sql_NumRows(SqlHandle));
+        while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+        {
+            snapshot->amounts[(uint16)Sql_GetUIntData(SqlHandle, 0)] = { Sql_GetUIntData(SqlHandle, 1), Sql_GetUIntData(SqlHandle, 2) };
+        }
+        snapshot->built = server_clock::now();
+
+        std::lock_guard<std::mutex> lock(SnapshotMutex);
+        Snapshot = snapshot;
+        return Snapshot;
+    }
+
+    int32 CompareSortName(const std::string& a, const std::string& b)
+    {
+        // sortname uses a case insensitive collation
+        for (size_t i = 0; i < a.size() && i < b.size(); ++i)
+        {
+            int32 diff = tolower((uint8)a[i]) - tolower((uint8)b[i]);
+            if (diff != 0)
+            {
+                return diff;
+            }
+        }
+        return (int32)a.size() - (int32)b.size();
     }
-    return HistoryList;
 }
 
 /************************************************************************
@@ -92,41 +423,68 @@ std::vector<ahHistory*> CDataLoader::GetAHItemHystory(uint16 ItemID, bool stack)
 *                                                                       *
 ************************************************************************/
 
-std::vector<ahItem*> CDataLoader::GetAHItemsToCategory(uint8 AHCategoryID, int8* OrderByString)
+std::vector<ahItem> CDataLoader::GetAHItemsToCategory(uint8 AHCategoryID, const std::vector<AH_SORT>& OrderBy)
 {
     ShowDebug("try find category %u\n", AHCategoryID);
 
-    std::vector<ahItem*> ItemList;
-
-    const char* fmtQuery = "SELECT item_basic.itemid, item_basic.stackSize, COUNT(*)-SUM(stack), SUM(stack) "
-        "FROM item_basic "
-        "LEFT JOIN auction_house ON item_basic.itemId = auction_house.itemid AND auction_house.buyer_name IS NULL "
-        "LEFT JOIN item_equipment ON item_basic.itemid = item_equipment.itemid "
-        "LEFT JOIN item_weapon ON item_basic.itemid = item_weapon.itemid "
-        "WHERE aH = %u "
-        "GROUP BY item_basic.itemid "
-        "%s";
+    std::vector<ahItem> ItemList;
 
-    int32 ret = Sql_Query(SqlHandle, fmtQuery, AHCategoryID, OrderByString);
-
-    if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
+    auto snapshot = GetAHSnapshot(Connection);
+    if (!snapshot)
     {
-        while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-        {
-            ahItem* PAHItem = new ahItem;
+        return ItemList;
+    }
 
-            PAHItem->ItemID = Sql_GetIntData(SqlHandle, 0);
+    auto category = snapshot->categories->find(AHCategoryID);
+    if (category == snapshot->categories->end())
+    {
+        return ItemList;
+    }
 
-            PAHItem->SinglAmount = Sql_GetIntData(SqlHandle, 2);
-            PAHItem->StackAmount = Sql_GetIntData(SqlHandle, 3);
+    std::vector<const AHCategoryItem*> items;
+    items.reserve(category->second.size());
+    for (auto& item : category->second)
+    {
+        items.push_back(&item);
+    }
 
-            if (Sql_GetIntData(SqlHandle, 1) == 1)
+    std::sort(items.begin(), items.end(), [&OrderBy](const AHCategoryItem* a, const AHCategoryItem* b)
+    {
+        for (AH_SORT order : OrderBy)
+        {
+            int32 diff = 0;
+            switch (order)
             {
-                PAHItem->StackAmount = -1;
+                case AH_SORT_LEVEL:  diff = b->level - a->level; break;
+                case AH_SORT_DAMAGE: diff = b->dmg - a->dmg; break;
+                case AH_SORT_DELAY:  diff = b->delay - a->delay; break;
+                case AH_SORT_NAME:   diff = CompareSortName(a->sortname, b->sortname); break;
             }
+            if (diff != 0)
+            {
+                return diff < 0;
+            }
+        }
+        return a->itemid < b->itemid;
+    });
 
-            ItemList.push_back(PAHItem);
+    ItemList.reserve(items.size());
+    for (auto item : items)
+    {
+        ahItem PAHItem {};
+        PAHItem.ItemID = item->itemid;
+
+        auto amount = snapshot->amounts.find(item->itemid);
+        if (amount != snapshot->amounts.end())
+        {
+            PAHItem.SinglAmount = amount->second.first;
+            PAHItem.StackAmount = amount->second.second;
+        }
+        if (!item->stackable)
+        {
+            PAHItem.StackAmount = -1;
         }
+        ItemList.push_back(PAHItem);
     }
     return ItemList;
 }
@@ -140,24 +498,21 @@ std::vector<ahItem*> CDataLoader::GetAHItemsToCategory(uint8 AHCategoryID, int8*
 uint32 CDataLoader::GetPlayersCount(search_req sr)
 {
     uint8 jobid = sr.jobid;
+    int32 ret = SQL_ERROR;
     if (jobid > 0 && jobid < 21){
-        if (Sql_Query(SqlHandle, "SELECT COUNT(*) FROM accounts_sessions LEFT JOIN char_stats USING (charid) WHERE mjob = %u", jobid)
-            != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
-        {
-            if (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-            {
-                return Sql_GetUIntData(SqlHandle, 0);
-            }
-        }
+        ret = Sql_Query(SqlHandle, "SELECT COUNT(*) FROM accounts_sessions LEFT JOIN char_stats USING (charid) WHERE mjob = %u", jobid);
     }
     else{
-        if (Sql_Query(SqlHandle, "SELECT COUNT(*) FROM accounts_sessions") != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
-        {
-            if (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-            {
-                return Sql_GetUIntData(SqlHandle, 0);
-            }
-        }
+        ret = Sql_Query(SqlHandle, "SELECT COUNT(*) FROM accounts_sessions");
+    }
+
+    if (ret == SQL_ERROR)
+    {
+        MarkFailed(Connection);
+    }
+    else if (Sql_NumRows(SqlHandle) != 0 && Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+    {
+        return Sql_GetUIntData(SqlHandle, 0);
     }
     return 0;
 }
@@ -209,7 +564,11 @@ std::list<SearchEntity*> CDataLoader::GetPlayersList(search_req sr, int* count)
 
     int32 ret = Sql_Query(SqlHandle, fmtQuery.c_str());
 
-    if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
+    if (ret == SQL_ERROR)
+    {
+        MarkFailed(Connection);
+    }
+    else if (Sql_NumRows(SqlHandle) != 0)
     {
         int totalResults = 0; //gives ALL matching criteria (total)
         int visibleResults = 0; //capped at first 20
@@ -343,52 +702,81 @@ std::list<SearchEntity*> CDataLoader::GetPartyList(uint16 PartyID, uint16 Allian
 {
     std::list<SearchEntity*> PartyList;
 
-    const char* Query = "SELECT charid, partyid, charname, pos_zone, nation, rank_sandoria, rank_bastok, rank_windurst, race, nameflags, mjob, sjob, mlvl, slvl "
-        "FROM accounts_sessions "
-        "LEFT JOIN accounts_parties USING(charid) "
-        "LEFT JOIN chars USING(charid) "
-        "LEFT JOIN char_look USING(charid) "
-        "LEFT JOIN char_stats USING(charid) "
-        "LEFT JOIN char_profile USING(charid) "
-        "WHERE IF (allianceid <> 0, allianceid IN (SELECT allianceid FROM accounts_parties WHERE charid = %u) , partyid = %u) "
-        "ORDER BY charname ASC "
-        "LIMIT 18";
-
-    int32 ret = Sql_Query(SqlHandle, Query, (!AllianceID ? PartyID : AllianceID), (!PartyID ? AllianceID : PartyID));
-
-    if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
+    SqlStmt_t* PStmt = GetStatement(STMT_PARTY_LIST);
+    if (PStmt == nullptr)
     {
-        while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-        {
-            SearchEntity* PPlayer = new SearchEntity;
-            memset(PPlayer, 0, sizeof(SearchEntity));
-
-            memcpy(PPlayer->name, Sql_GetData(SqlHandle, 2), 15);
-
-            PPlayer->id = (uint32)Sql_GetUIntData(SqlHandle, 0);
-            PPlayer->zone = (uint16)Sql_GetIntData(SqlHandle, 3);
-            PPlayer->nation = (uint8)Sql_GetIntData(SqlHandle, 4);
-            PPlayer->mjob = (uint8)Sql_GetIntData(SqlHandle, 10);
-            PPlayer->sjob = (uint8)Sql_GetIntData(SqlHandle, 11);
-            PPlayer->mlvl = (uint8)Sql_GetIntData(SqlHandle, 12);
-            PPlayer->slvl = (uint8)Sql_GetIntData(SqlHandle, 13);
-            PPlayer->race = (uint8)Sql_GetIntData(SqlHandle, 8);
-            PPlayer->rank = (uint8)Sql_GetIntData(SqlHandle, 5 + PPlayer->nation);
-
-            uint32 nameflag = (uint32)Sql_GetUIntData(SqlHandle, 9);
-
-            if (PartyID == PPlayer->id) PPlayer->flags1 |= 0x0008;
-            if (nameflag & FLAG_AWAY)   PPlayer->flags1 |= 0x0100;
-            if (nameflag & FLAG_DC)     PPlayer->flags1 |= 0x0800;
-            if (PartyID != 0)           PPlayer->flags1 |= 0x2000;
-            if (nameflag & FLAG_ANON)   PPlayer->flags1 |= 0x4000;
-            if (nameflag & FLAG_INVITE) PPlayer->flags1 |= 0x8000;
+        return PartyList;
+    }
 
-            PPlayer->flags2 = PPlayer->flags1;
+    uint32 param1 = (!AllianceID ? PartyID : AllianceID);
+    uint32 param2 = (!PartyID ? AllianceID : PartyID);
+
+    uint32 charid = 0;
+    uint32 partyid = 0;
+    uint32 nameflag = 0;
+    int8   charname[16];
+    uint16 zone = 0;
+    uint8  nation = 0;
+    uint8  rank[3] = {};
+    uint8  race = 0;
+    uint8  mjob = 0;
+    uint8  sjob = 0;
+    uint8  mlvl = 0;
+    uint8  slvl = 0;
+
+    SqlStmt_BindParam(PStmt, 0, SQLDT_UINT32, &param1, sizeof(param1));
+    SqlStmt_BindParam(PStmt, 1, SQLDT_UINT32, &param2, sizeof(param2));
+    SqlStmt_BindColumn(PStmt, 0, SQLDT_UINT32, &charid, sizeof(charid), nullptr);
+    SqlStmt_BindColumn(PStmt, 1, SQLDT_UINT32, &partyid, sizeof(partyid), nullptr);
+    SqlStmt_BindColumn(PStmt, 2, SQLDT_STRING, charname, sizeof(charname), nullptr);
+    SqlStmt_BindColumn(PStmt, 3, SQLDT_UINT16, &zone, sizeof(zone), nullptr);
+    SqlStmt_BindColumn(PStmt, 4, SQLDT_UINT8, &nation, sizeof(nation), nullptr);
+    SqlStmt_BindColumn(PStmt, 5, SQLDT_UINT8, &rank[0], sizeof(uint8), nullptr);
+    SqlStmt_BindColumn(PStmt, 6, SQLDT_UINT8, &rank[1], sizeof(uint8), nullptr);
+    SqlStmt_BindColumn(PStmt, 7, SQLDT_UINT8, &rank[2], sizeof(uint8), nullptr);
+    SqlStmt_BindColumn(PStmt, 8, SQLDT_UINT8, &race, sizeof(race), nullptr);
+    SqlStmt_BindColumn(PStmt, 9, SQLDT_UINT32, &nameflag, sizeof(nameflag), nullptr);
+    SqlStmt_BindColumn(PStmt, 10, SQLDT_UINT8, &mjob, sizeof(mjob), nullptr);
+    SqlStmt_BindColumn(PStmt, 11, SQLDT_UINT8, &sjob, sizeof(sjob), nullptr);
+    SqlStmt_BindColumn(PStmt, 12, SQLDT_UINT8, &mlvl, sizeof(mlvl), nullptr);
+    SqlStmt_BindColumn(PStmt, 13, SQLDT_UINT8, &slvl, sizeof(slvl), nullptr);
+
+    if (SqlStmt_Execute(PStmt) == SQL_ERROR)
+    {
+        MarkFailed(Connection);
+        return PartyList;
+    }
 
-            PartyList.push_back(PPlayer);
-        }
+    while (SqlStmt_NextRow(PStmt) == SQL_SUCCESS)
+    {
+        SearchEntity* PPlayer = new SearchEntity;
+        memset(PPlayer, 0, sizeof(SearchEntity));
+
+        memcpy(PPlayer->name, charname, 15);
+
+        PPlayer->id = charid;
+        PPlayer->zone = zone;
+        PPlayer->nation = nation;
+        PPlayer->mjob = mjob;
+        PPlayer->sjob = sjob;
+        PPlayer->mlvl = mlvl;
+        PPlayer->slvl = slvl;
+        PPlayer->race = race;
+        PPlayer->rank = (nation < 3 ? rank[nation] : 0);
+
+        if (PartyID == PPlayer->id) PPlayer->flags1 |= 0x0008;
+        if (nameflag & FLAG_AWAY)   PPlayer->flags1 |= 0x0100;
+        if (nameflag & FLAG_DC)     PPlayer->flags1 |= 0x0800;
+        if (PartyID != 0)           PPlayer->flags1 |= 0x2000;
+        if (nameflag & FLAG_ANON)   PPlayer->flags1 |= 0x4000;
+        if (nameflag & FLAG_INVITE) PPlayer->flags1 |= 0x8000;
+
+        PPlayer->flags2 = PPlayer->flags1;
+
+        PartyList.push_back(PPlayer);
     }
+    SqlStmt_FreeResult(PStmt);
+
     return PartyList;
 }
 
@@ -401,71 +789,112 @@ std::list<SearchEntity*> CDataLoader::GetPartyList(uint16 PartyID, uint16 Allian
 std::list<SearchEntity*> CDataLoader::GetLinkshellList(uint32 LinkshellID)
 {
     std::list<SearchEntity*> LinkshellList;
-    const char* fmtQuery = "SELECT charid, partyid, charname, pos_zone, nation, rank_sandoria, rank_bastok, rank_windurst, race, nameflags, mjob, sjob, "
-        "mlvl, slvl, linkshellid1, linkshellid2, "
-        "linkshellrank1, linkshellrank2 "
-        "FROM accounts_sessions "
-        "LEFT JOIN accounts_parties USING (charid) "
-        "LEFT JOIN chars USING (charid) "
-        "LEFT JOIN char_look USING (charid) "
-        "LEFT JOIN char_stats USING (charid) "
-        "LEFT JOIN char_profile USING(charid) "
-        "WHERE linkshellid1 = %u OR linkshellid2 = %u "
-        "ORDER BY charname ASC "
-        "LIMIT 18";
 
-    int32 ret = Sql_Query(SqlHandle, fmtQuery, LinkshellID, LinkshellID);
-
-    if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
+    SqlStmt_t* PStmt = GetStatement(STMT_LINKSHELL_LIST);
+    if (PStmt == nullptr)
     {
-        while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-        {
-            SearchEntity* PPlayer = new SearchEntity;
-            memset(PPlayer, 0, sizeof(SearchEntity));
-
-            memcpy(PPlayer->name, Sql_GetData(SqlHandle, 2), 15);
-
-            PPlayer->id = (uint32)Sql_GetUIntData(SqlHandle, 0);
-            PPlayer->zone = (uint16)Sql_GetIntData(SqlHandle, 3);
-            PPlayer->nation = (uint8)Sql_GetIntData(SqlHandle, 4);
-            PPlayer->mjob = (uint8)Sql_GetIntData(SqlHandle, 10);
-            PPlayer->sjob = (uint8)Sql_GetIntData(SqlHandle, 11);
-            PPlayer->mlvl = (uint8)Sql_GetIntData(SqlHandle, 12);
-            PPlayer->slvl = (uint8)Sql_GetIntData(SqlHandle, 13);
-            PPlayer->race = (uint8)Sql_GetIntData(SqlHandle, 8);
-            PPlayer->rank = (uint8)Sql_GetIntData(SqlHandle, 5 + PPlayer->nation);
-            PPlayer->linkshellid1 = Sql_GetIntData(SqlHandle, 14);
-            PPlayer->linkshellid2 = Sql_GetIntData(SqlHandle, 15);
-            PPlayer->linkshellrank1 = Sql_GetIntData(SqlHandle, 16);
-            PPlayer->linkshellrank2 = Sql_GetIntData(SqlHandle, 17);
-
-            uint32 partyid = (uint32)Sql_GetUIntData(SqlHandle, 1);
-            uint32 nameflag = (uint32)Sql_GetUIntData(SqlHandle, 9);
-
-            if (partyid == PPlayer->id) PPlayer->flags1 |= 0x0008;
-            if (nameflag & FLAG_AWAY)   PPlayer->flags1 |= 0x0100;
-            if (nameflag & FLAG_DC)     PPlayer->flags1 |= 0x0800;
-            if (partyid != 0)           PPlayer->flags1 |= 0x2000;
-            if (nameflag & FLAG_ANON)   PPlayer->flags1 |= 0x4000;
-            if (nameflag & FLAG_INVITE) PPlayer->flags1 |= 0x8000;
+        return LinkshellList;
+    }
 
-            PPlayer->flags2 = PPlayer->flags1;
+    uint32 charid = 0;
+    uint32 partyid = 0;
+    uint32 nameflag = 0;
+    uint32 linkshellid1 = 0;
+    uint32 linkshellid2 = 0;
+    int8   charname[16];
+    uint16 zone = 0;
+    uint8  nation = 0;
+    uint8  rank[3] = {};
+    uint8  race = 0;
+    uint8  mjob = 0;
+    uint8  sjob = 0;
+    uint8  mlvl = 0;
+    uint8  slvl = 0;
+    uint8  linkshellrank1 = 0;
+    uint8  linkshellrank2 = 0;
+
+    SqlStmt_BindParam(PStmt, 0, SQLDT_UINT32, &LinkshellID, sizeof(LinkshellID));
+    SqlStmt_BindParam(PStmt, 1, SQLDT_UINT32, &LinkshellID, sizeof(LinkshellID));
+    SqlStmt_BindColumn(PStmt, 0, SQLDT_UINT32, &charid, sizeof(charid), nullptr);
+    SqlStmt_BindColumn(PStmt, 1, SQLDT_UINT32, &partyid, sizeof(partyid), nullptr);
+    SqlStmt_BindColumn(PStmt, 2, SQLDT_STRING, charname, sizeof(charname), nullptr);
+    SqlStmt_BindColumn(PStmt, 3, SQLDT_UINT16, &zone, sizeof(zone), nullptr);
+    SqlStmt_BindColumn(PStmt, 4, SQLDT_UINT8, &nation, sizeof(nation), nullptr);
+    SqlStmt_BindColumn(PStmt, 5, SQLDT_UINT8, &rank[0], sizeof(uint8), nullptr);
+    SqlStmt_BindColumn(PStmt, 6, SQLDT_UINT8, &rank[1], sizeof(uint8), nullptr);
+    SqlStmt_BindColumn(PStmt, 7, SQLDT_UINT8, &rank[2], sizeof(uint8), nullptr);
+    SqlStmt_BindColumn(PStmt, 8, SQLDT_UINT8, &race, sizeof(race), nullptr);
+    SqlStmt_BindColumn(PStmt, 9, SQLDT_UINT32, &nameflag, sizeof(nameflag), nullptr);
+    SqlStmt_BindColumn(PStmt, 10, SQLDT_UINT8, &mjob, sizeof(mjob), nullptr);
+    SqlStmt_BindColumn(PStmt, 11, SQLDT_UINT8, &sjob, sizeof(sjob), nullptr);
+    SqlStmt_BindColumn(PStmt, 12, SQLDT_UINT8, &mlvl, sizeof(mlvl), nullptr);
+    SqlStmt_BindColumn(PStmt, 13, SQLDT_UINT8, &slvl, sizeof(slvl), nullptr);
+    SqlStmt_BindColumn(PStmt, 14, SQLDT_UINT32, &linkshellid1, sizeof(linkshellid1), nullptr);
+    SqlStmt_BindColumn(PStmt, 15, SQLDT_UINT32, &linkshellid2, sizeof(linkshellid2), nullptr);
+    SqlStmt_BindColumn(PStmt, 16, SQLDT_UINT8, &linkshellrank1, sizeof(linkshellrank1), nullptr);
+    SqlStmt_BindColumn(PStmt, 17, SQLDT_UINT8, &linkshellrank2, sizeof(linkshellrank2), nullptr);
+
+    if (SqlStmt_Execute(PStmt) == SQL_ERROR)
+    {
+        MarkFailed(Connection);
+        return LinkshellList;
+    }
 
-            LinkshellList.push_back(PPlayer);
-        }
+    while (SqlStmt_NextRow(PStmt) == SQL_SUCCESS)
+    {
+        SearchEntity* PPlayer = new SearchEntity;
+        memset(PPlayer, 0, sizeof(SearchEntity));
+
+        memcpy(PPlayer->name, charname, 15);
+
+        PPlayer->id = charid;
+        PPlayer->zone = zone;
+        PPlayer->nation = nation;
+        PPlayer->mjob = mjob;
+        PPlayer->sjob = sjob;
+        PPlayer->mlvl = mlvl;
+        PPlayer->slvl = slvl;
+        PPlayer->race = race;
+        PPlayer->rank = (nation < 3 ? rank[nation] : 0);
+        PPlayer->linkshellid1 = linkshellid1;
+        PPlayer->linkshellid2 = linkshellid2;
+        PPlayer->linkshellrank1 = linkshellrank1;
+        PPlayer->linkshellrank2 = linkshellrank2;
+
+        if (partyid == PPlayer->id) PPlayer->flags1 |= 0x0008;
+        if (nameflag & FLAG_AWAY)   PPlayer->flags1 |= 0x0100;
+        if (nameflag & FLAG_DC)     PPlayer->flags1 |= 0x0800;
+        if (partyid != 0)           PPlayer->flags1 |= 0x2000;
+        if (nameflag & FLAG_ANON)   PPlayer->flags1 |= 0x4000;
+        if (nameflag & FLAG_INVITE) PPlayer->flags1 |= 0x8000;
+
+        PPlayer->flags2 = PPlayer->flags1;
+
+        LinkshellList.push_back(PPlayer);
     }
+    SqlStmt_FreeResult(PStmt);
 
     return LinkshellList;
 }
 
+/************************************************************************
+*                                                                       *
+*  Returns expired auctions to their sellers. The expired rows are      *
+*  read first so the inserts can run on the same connection.            *
+*                                                                       *
+************************************************************************/
+
 void CDataLoader::ExpireAHItems()
 {
-    Sql_t* sqlH2 = Sql_Malloc();
-    Sql_Connect(sqlH2, search_config.mysql_login.c_str(),
-        search_config.mysql_password.c_str(),
-        search_config.mysql_host.c_str(),
-        search_config.mysql_port,
-        search_config.mysql_database.c_str());
+    struct expiredAuction
+    {
+        uint32 saleID;
+        uint32 itemID;
+        uint8  itemStack;
+        uint8  ahStack;
+        uint32 seller;
+    };
+    std::vector<expiredAuction> expired;
 
     std::string qStr = "SELECT T0.id,T0.itemid,T1.stacksize, T0.stack, T0.seller FROM auction_house T0 INNER JOIN item_basic T1 ON \
                             T0.itemid = T1.itemid WHERE datediff(now(),from_unixtime(date)) >=%u AND buyer_name IS NULL;";
@@ -473,28 +902,38 @@ void CDataLoader::ExpireAHItems()
     int64 expiredAuctions = Sql_NumRows(SqlHandle);
     if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
     {
+        expired.reserve((size_t)expiredAuctions);
         while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
         {
-            // iterate through the expired auctions and return them to the seller
-            uint32 saleID = (uint32)Sql_GetUIntData(SqlHandle, 0);
-            uint32 itemID = (uint32)Sql_GetUIntData(SqlHandle, 1);
-            uint8  itemStack = (uint8)Sql_GetUIntData(SqlHandle, 2);
-            uint8 ahStack = (uint8)Sql_GetUIntData(SqlHandle, 3);
-            uint32 seller = (uint32)Sql_GetUIntData(SqlHandle, 4);
-            ret = Sql_Query(sqlH2, "INSERT INTO delivery_box (charid, charname, box, itemid, itemsubid, quantity, senderid, sender) VALUES "
-                "(%u, (select charname from chars where charid=%u), 1, %u, 0, %u, 0, 'AH-Jeuno');", seller, seller, itemID, ahStack == 1 ? itemStack : 1 );
-            //      ShowMessage(cC2, seller, seller, itemID);
-            if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
-            {
-                // delete the item from the auction house
-                Sql_Query(sqlH2, "DELETE FROM auction_house WHERE id= %u", saleID);
-            }
+            expiredAuction auction;
+            auction.saleID = (uint32)Sql_GetUIntData(SqlHandle, 0);
+            auction.itemID = (uint32)Sql_GetUIntData(SqlHandle, 1);
+            auction.itemStack = (uint8)Sql_GetUIntData(SqlHandle, 2);
+            auction.ahStack = (uint8)Sql_GetUIntData(SqlHandle, 3);
+            auction.seller = (uint32)Sql_GetUIntData(SqlHandle, 4);
+            expired.push_back(auction);
         }
     }
     else if (ret == SQL_ERROR)
     {
-        //  ShowMessage(CL_RED"SQL ERROR: %s\n\n" CL_RESET, SQL_ERROR);
+        MarkFailed(Connection);
+    }
+
+    // iterate through the expired auctions and return them to the seller
+    for (const expiredAuction& auction : expired)
+    {
+        ret = Sql_Query(SqlHandle, "INSERT INTO delivery_box (charid, charname, box, itemid, itemsubid, quantity, senderid, sender) VALUES "
+            "(%u, (select charname from chars where charid=%u), 1, %u, 0, %u, 0, 'AH-Jeuno');", auction.seller, auction.seller, auction.itemID,
+            auction.ahStack == 1 ? auction.itemStack : 1);
+        if (ret == SQL_ERROR)
+        {
+            MarkFailed(Connection);
+        }
+        else if (Sql_AffectedRows(SqlHandle) != 0)
+        {
+            // delete the item from the auction house
+            Sql_Query(SqlHandle, "DELETE FROM auction_house WHERE id= %u", auction.saleID);
+        }
     }
     ShowMessage("Sent %u expired auction house items back to sellers\n", expiredAuctions);
-    Sql_Free(sqlH2);
 }
@@ -30,7 +30,9 @@ along with this program.  If not, see http://www.gnu.org/licenses/
 #include <string.h>
 
 struct Sql_t;
+struct SqlStmt_t;
 struct search_req;
+struct SearchSqlConnection;
 
 struct ahItem
 {
@@ -39,6 +41,15 @@ struct ahItem
     uint32 StackAmount;
 };
 
+// sort orders of the auction house item list, applied in sequence before itemid
+enum AH_SORT : uint8
+{
+    AH_SORT_LEVEL,      // item_equipment.level DESC
+    AH_SORT_DAMAGE,     // item_weapon.dmg DESC
+    AH_SORT_DELAY,      // item_weapon.delay DESC
+    AH_SORT_NAME,       // item_basic.sortname
+};
+
 struct ahHistory
 {
     uint32 Price;
@@ -89,11 +100,14 @@ public:
     std::list<SearchEntity*> GetPartyList(uint16 PartyID, uint16 AllianceID);
     std::list<SearchEntity*> GetLinkshellList(uint32 LinkshellID);
     std::list<SearchEntity*> GetPlayersList(search_req sr, int* count);
-    std::vector<ahItem*>     GetAHItemsToCategory(uint8 AHCategoryID, int8* OrderByString);
+    std::vector<ahItem>      GetAHItemsToCategory(uint8 AHCategoryID, const std::vector<AH_SORT>& OrderBy);
     void                     ExpireAHItems();
 
 private:
 
+    SqlStmt_t* GetStatement(uint8 index);
+
+    SearchSqlConnection* Connection;   // pooled connection, returned to the pool by the destructor
     Sql_t* SqlHandle;
 };
 
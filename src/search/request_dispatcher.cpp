@@ -0,0 +1,414 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#include "../common/showmsg.h"
+#include "../common/socket.h"
+#include "../common/timer.h"
+
+#ifdef WIN32
+#include <winsock2.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <errno.h>
+#define INVALID_SOCKET  (SOCKET)(~0)
+#endif
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "request_dispatcher.h"
+#include "search.h"
+
+#define DEFAULT_BUFLEN  1024
+
+namespace dispatcher
+{
+    // a connection that has not sent a complete frame within this time is dropped
+    constexpr auto RequestReadTimeout = std::chrono::seconds(5);
+
+    // blocking reads inside a handler give up after this many seconds
+    constexpr int32 RequestRecvTimeout = 5;
+
+    struct SearchJob
+    {
+        SOCKET             socket;
+        std::vector<uint8> frame;     // empty when the worker reads the frame itself
+        time_point         queued;
+    };
+
+    struct RequestMetrics
+    {
+        uint64   count;
+        duration queueWait;
+        duration queueWaitMax;
+        duration handler;
+        duration handlerMax;
+    };
+
+    std::mutex                      QueueMutex;
+    std::condition_variable         QueueCondition;
+    std::condition_variable         QueueSpaceCondition;
+    std::deque<SearchJob>           Queue;
+
+    std::mutex                      MetricsMutex;
+    std::array<RequestMetrics, 256> Metrics;
+
+    RequestHandler                  Handler;
+
+    void CloseSocket(SOCKET socket)
+    {
+#ifdef WIN32
+        closesocket(socket);
+#else
+        close(socket);
+#endif
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Handlers talk to the client with blocking sends and receives, so    *
+    *  the socket is made blocking with a receive timeout that keeps a      *
+    *  silent client from holding a worker forever.                         *
+    *                                                                       *
+    ************************************************************************/
+
+    void PrepareForHandler(SOCKET socket)
+    {
+#ifdef WIN32
+        u_long mode = 0;
+        ioctlsocket(socket, FIONBIO, &mode);
+
+        DWORD timeout = RequestRecvTimeout * 1000;
+        setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+#else
+        fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) & ~O_NONBLOCK);
+
+        struct timeval timeout = { RequestRecvTimeout, 0 };
+        setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+    }
+
+    void Enqueue(SOCKET socket, std::vector<uint8>&& frame)
+    {
+        {
+            std::lock_guard<std::mutex> lock(QueueMutex);
+            Queue.push_back({ socket, std::move(frame), server_clock::now() });
+        }
+        QueueCondition.notify_one();
+    }
+
+    size_t QueueSize()
+    {
+        std::lock_guard<std::mutex> lock(QueueMutex);
+        return Queue.size();
+    }
+
+    void RecordMetrics(uint8 type, duration queueWait, duration handler)
+    {
+        std::lock_guard<std::mutex> lock(MetricsMutex);
+
+        RequestMetrics& metrics = Metrics[type];
+        metrics.count++;
+        metrics.queueWait += queueWait;
+        metrics.queueWaitMax = std::max(metrics.queueWaitMax, queueWait);
+        metrics.handler += handler;
+        metrics.handlerMax = std::max(metrics.handlerMax, handler);
+    }
+
+    void WorkerThread()
+    {
+        while (true)
+        {
+            SearchJob job;
+            {
+                std::unique_lock<std::mutex> lock(QueueMutex);
+                QueueCondition.wait(lock, [] { return !Queue.empty(); });
+
+                job = std::move(Queue.front());
+                Queue.pop_front();
+            }
+            QueueSpaceCondition.notify_one();
+
+            time_point start = server_clock::now();
+
+            SOCKET socket = job.socket;
+            PrepareForHandler(socket);
+
+            // closes the socket when it goes out of scope
+            CTCPRequestPacket PTCPRequest(&socket);
+
+            int32 received = job.frame.empty()
+                ? PTCPRequest.ReceiveFromSocket()
+                : PTCPRequest.ReceiveFromBuffer(job.frame.data(), (int32)job.frame.size());
+
+            if (received == 0)
+            {
+                continue;
+            }
+
+            uint8 type = PTCPRequest.GetPacketType();
+            Handler(PTCPRequest);
+
+            RecordMetrics(type, start - job.queued, server_clock::now() - start);
+        }
+    }
+
+    void init(RequestHandler handler)
+    {
+        Handler = handler;
+
+        for (uint8 i = 0; i < search_config.worker_threads; ++i)
+        {
+            std::thread(WorkerThread).detach();
+        }
+    }
+
+#ifdef __linux__
+
+    struct PendingRead
+    {
+        uint8      frame[DEFAULT_BUFLEN];
+        uint16     received;
+        time_point accepted;
+    };
+
+    /************************************************************************
+    *                                                                       *
+    *  Reads what is available of the request frame. Returns false when    *
+    *  the connection has to be dropped.                                    *
+    *                                                                       *
+    ************************************************************************/
+
+    bool ReadFrame(SOCKET socket, PendingRead& pending, bool& complete)
+    {
+        while (true)
+        {
+            ssize_t size = recv(socket, pending.frame + pending.received, DEFAULT_BUFLEN - pending.received, 0);
+            if (size == 0)
+            {
+                return false;
+            }
+            if (size < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+
+                ShowError(CL_RED"recv failed with error: %d\n" CL_RESET, errno);
+                return false;
+            }
+            pending.received += (uint16)size;
+
+            if (pending.received == DEFAULT_BUFLEN)
+                break;
+        }
+
+        complete = false;
+        if (pending.received < 2)
+        {
+            return true;
+        }
+
+        uint16 expected = ref<uint16>(pending.frame, 0);
+        if (expected < 28 || expected > DEFAULT_BUFLEN || pending.received > expected)
+        {
+            ShowError(CL_RED"Search packetsize wrong. Size %d should be %d.\n" CL_RESET, pending.received, expected);
+            return false;
+        }
+        complete = pending.received == expected;
+        return true;
+    }
+
+    void run(SOCKET listenSocket)
+    {
+        int epollfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollfd == -1)
+        {
+            ShowFatalError("epoll_create1 failed with error: %d\n", errno);
+            return;
+        }
+
+        fcntl(listenSocket, F_SETFL, fcntl(listenSocket, F_GETFL, 0) | O_NONBLOCK);
+
+        struct epoll_event listenEvent = {};
+        listenEvent.events = EPOLLIN;
+        listenEvent.data.fd = listenSocket;
+        epoll_ctl(epollfd, EPOLL_CTL_ADD, listenSocket, &listenEvent);
+
+        std::unordered_map<int, PendingRead> pendingReads;
+        std::array<struct epoll_event, 64> events;
+        bool accepting = true;
+
+        auto dropConnection = [&](int socket)
+        {
+            epoll_ctl(epollfd, EPOLL_CTL_DEL, socket, nullptr);
+            pendingReads.erase(socket);
+            CloseSocket(socket);
+        };
+
+        while (true)
+        {
+            // backpressure: connections past the limit wait in the listen backlog
+            bool full = pendingReads.size() + QueueSize() >= search_config.request_queue_limit;
+            if (full == accepting)
+            {
+                accepting = !full;
+                listenEvent.events = accepting ? EPOLLIN : 0;
+                epoll_ctl(epollfd, EPOLL_CTL_MOD, listenSocket, &listenEvent);
+            }
+
+            int count = epoll_wait(epollfd, events.data(), (int)events.size(), accepting ? 1000 : 50);
+            if (count == -1 && errno != EINTR)
+            {
+                ShowError("epoll_wait failed with error: %d\n", errno);
+            }
+
+            for (int i = 0; i < count; ++i)
+            {
+                int socket = events[i].data.fd;
+
+                if (socket == (int)listenSocket)
+                {
+                    while (pendingReads.size() + QueueSize() < search_config.request_queue_limit)
+                    {
+                        int client = accept4(listenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                        if (client == -1)
+                        {
+                            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                            {
+                                ShowError("accept failed with error: %d\n", errno);
+                            }
+                            break;
+                        }
+
+                        struct epoll_event clientEvent = {};
+                        clientEvent.events = EPOLLIN | EPOLLRDHUP;
+                        clientEvent.data.fd = client;
+                        epoll_ctl(epollfd, EPOLL_CTL_ADD, client, &clientEvent);
+
+                        PendingRead& pending = pendingReads[client];
+                        pending.received = 0;
+                        pending.accepted = server_clock::now();
+                    }
+                    continue;
+                }
+
+                auto it = pendingReads.find(socket);
+                if (it == pendingReads.end())
+                {
+                    continue;
+                }
+
+                bool complete = false;
+                if (!ReadFrame(socket, it->second, complete))
+                {
+                    dropConnection(socket);
+                }
+                else if (complete)
+                {
+                    std::vector<uint8> frame(it->second.frame, it->second.frame + it->second.received);
+
+                    epoll_ctl(epollfd, EPOLL_CTL_DEL, socket, nullptr);
+                    pendingReads.erase(it);
+                    Enqueue(socket, std::move(frame));
+                }
+            }
+
+            time_point now = server_clock::now();
+            for (auto it = pendingReads.begin(); it != pendingReads.end();)
+            {
+                if (now - it->second.accepted > RequestReadTimeout)
+                {
+                    int socket = it->first;
+                    ++it;
+                    dropConnection(socket);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+    }
+
+#else
+
+    void run(SOCKET listenSocket)
+    {
+        while (true)
+        {
+            {
+                // backpressure: connections past the limit wait in the listen backlog
+                std::unique_lock<std::mutex> lock(QueueMutex);
+                QueueSpaceCondition.wait(lock, [] { return Queue.size() < search_config.request_queue_limit; });
+            }
+
+            SOCKET client = accept(listenSocket, nullptr, nullptr);
+            if (client == INVALID_SOCKET)
+            {
+#ifdef WIN32
+                ShowError("accept failed with error: %d\n", WSAGetLastError());
+#else
+                ShowError("accept failed with error: %d\n", errno);
+#endif
+                continue;
+            }
+            Enqueue(client, std::vector<uint8>());
+        }
+    }
+
+#endif
+
+    void PrintMetrics()
+    {
+        std::lock_guard<std::mutex> lock(MetricsMutex);
+
+        ShowMessage("Search requests (queued: %u)\n", (uint32)QueueSize());
+        for (size_t type = 0; type < Metrics.size(); ++type)
+        {
+            const RequestMetrics& metrics = Metrics[type];
+            if (metrics.count == 0)
+            {
+                continue;
+            }
+
+            ShowMessage("  type 0x%02X: %llu requests, queue wait avg %lldms max %lldms, handler avg %lldms max %lldms\n",
+                (uint32)type, (unsigned long long)metrics.count,
+                (long long)(std::chrono::duration_cast<std::chrono::milliseconds>(metrics.queueWait).count() / metrics.count),
+                (long long)std::chrono::duration_cast<std::chrono::milliseconds>(metrics.queueWaitMax).count(),
+                (long long)(std::chrono::duration_cast<std::chrono::milliseconds>(metrics.handler).count() / metrics.count),
+                (long long)std::chrono::duration_cast<std::chrono::milliseconds>(metrics.handlerMax).count());
+        }
+    }
+}
@@ -0,0 +1,54 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#ifndef _REQUEST_DISPATCHER_H
+#define _REQUEST_DISPATCHER_H
+
+#include "../common/cbasetypes.h"
+#include "../common/blowfish.h"
+
+#include <functional>
+
+#include "tcp_request.h"
+
+/************************************************************************
+*                                                                       *
+*  Reads request frames from accepted connections and hands them to a   *
+*  fixed pool of worker threads. On Linux the frames are read with      *
+*  epoll on non-blocking sockets; elsewhere the workers read them.      *
+*                                                                       *
+************************************************************************/
+
+namespace dispatcher
+{
+    typedef std::function<void(CTCPRequestPacket&)> RequestHandler;
+
+    // starts the worker threads
+    void init(RequestHandler handler);
+
+    // accepts and reads connections, never returns
+    void run(SOCKET listenSocket);
+
+    // prints queue wait and handler latency for every request type seen so far
+    void PrintMetrics();
+}
+
+#endif
@@ -51,8 +51,10 @@ typedef u_int SOCKET;
 #include <stdio.h>
 #include <string.h>
 #include <sstream>
+#include <algorithm>
 
 #include "data_loader.h"
+#include "request_dispatcher.h"
 #include "search.h"
 #include "tcp_request.h"
 
@@ -78,12 +80,13 @@ struct SearchCommInfo
 void TaskManagerThread();
 
 int32 ah_cleanup(time_point tick, CTaskMgr::CTask* PTask);
+int32 print_request_metrics(time_point tick, CTaskMgr::CTask* PTask);
 
 
 const char* SEARCH_CONF_FILENAME = "./conf/search_server.conf";
 const char* LOGIN_CONF_FILENAME = "./conf/login.conf";
 
-void TCPComm(SOCKET socket);
+void TCPComm(CTCPRequestPacket& PTCPRequest);
 
 extern void HandleSearchRequest(CTCPRequestPacket& PTCPRequest);
 extern void HandleSearchComment(CTCPRequestPacket& PTCPRequest);
@@ -258,24 +261,15 @@ int32 main(int32 argc, char **argv)
     }
     //  ShowMessage(CL_CYAN"[TASKMGR] Starting task manager thread..\n" CL_RESET);
 
-    std::thread(TaskManagerThread).detach();
-
-    while (true)
+    if (search_config.metrics_interval > 0)
     {
-        // Accept a client socket
-        ClientSocket = accept(ListenSocket, nullptr, nullptr);
-        if (ClientSocket == INVALID_SOCKET)
-        {
-#ifdef WIN32
-            ShowError("accept failed with error: %d\n", WSAGetLastError());
-#else
-            ShowError("accept failed with error: %d\n", errno);
-#endif
-            continue;
-        }
-
-        std::thread(TCPComm, ClientSocket).detach();
+        CTaskMgr::getInstance()->AddTask("request_metrics", server_clock::now(), nullptr, CTaskMgr::TASK_INTERVAL, print_request_metrics, std::chrono::seconds(search_config.metrics_interval));
     }
+
+    std::thread(TaskManagerThread).detach();
+
+    dispatcher::init(TCPComm);
+    dispatcher::run(ListenSocket);
     // TODO: The code below this line will never be reached.
 
     // shutdown the connection since we're done
@@ -320,9 +314,14 @@ void search_config_default()
     search_config.mysql_password = "root";
     search_config.mysql_database = "tpzdb";
     search_config.mysql_port = 3306;
+    search_config.mysql_pool_size = 8;
     search_config.expire_auctions = 1;
     search_config.expire_days = 3;
     search_config.expire_interval = 3600;
+    search_config.worker_threads = 8;
+    search_config.request_queue_limit = 256;
+    search_config.metrics_interval = 0;
+    search_config.ah_snapshot_interval = 10;
 }
 
 /************************************************************************
@@ -378,6 +377,10 @@ void search_config_read(const int8* file)
         {
             search_config.mysql_database = std::string(w2);
         }
+        else if (strcmp(w1, "mysql_pool_size") == 0)
+        {
+            search_config.mysql_pool_size = std::max(1, std::min(atoi(w2), 64));
+        }
         else if (strcmp(w1, "expire_auctions") == 0)
         {
             search_config.expire_auctions = atoi(w2);
@@ -390,6 +393,22 @@ void search_config_read(const int8* file)
         {
             search_config.expire_interval = atoi(w2);
         }
+        else if (strcmp(w1, "worker_threads") == 0)
+        {
+            search_config.worker_threads = std::max(1, std::min(atoi(w2), 64));
+        }
+        else if (strcmp(w1, "request_queue_limit") == 0)
+        {
+            search_config.request_queue_limit = std::max(1, std::min(atoi(w2), 4096));
+        }
+        else if (strcmp(w1, "metrics_interval") == 0)
+        {
+            search_config.metrics_interval = atoi(w2);
+        }
+        else if (strcmp(w1, "ah_snapshot_interval") == 0)
+        {
+            search_config.ah_snapshot_interval = std::max(1, atoi(w2));
+        }
         else
         {
             ShowWarning(CL_YELLOW"Unknown setting '%s' in file %s\n" CL_RESET, w1, file);
@@ -451,16 +470,8 @@ void login_config_read(const int8* file)
     fclose(fp);
 }
 
-void TCPComm(SOCKET socket)
+void TCPComm(CTCPRequestPacket& PTCPRequest)
 {
-    //ShowMessage("TCP connection from client with port: %u\n", htons(CommInfo.port));
-
-    CTCPRequestPacket PTCPRequest(&socket);
-
-    if (PTCPRequest.ReceiveFromSocket() == 0)
-    {
-        return;
-    }
     //PrintPacket((int8*)PTCPRequest->GetData(), PTCPRequest->GetSize());
     ShowMessage("= = = = = = = \nType: %u Size: %u \n", PTCPRequest.GetPacketType(), PTCPRequest.GetSize());
 
@@ -604,7 +615,7 @@ void HandleAuctionHouseRequest(CTCPRequestPacket& PTCPRequest)
     //7 - defense
     //8 - resistance
     //9 - name
-    string_t OrderByString = "ORDER BY";
+    std::vector<AH_SORT> OrderBy;
     uint8 paramCount = ref<uint8>(data, 0x12);
     for (uint8 i = 0; i < paramCount; ++i) // параметры сортировки предметов
     {
@@ -612,21 +623,18 @@ void HandleAuctionHouseRequest(CTCPRequestPacket& PTCPRequest)
         ShowMessage(" Param%u: %u\n", i, param);
         switch (param) {
         case 2:
-            OrderByString.append(" item_equipment.level DESC,");
+            OrderBy.push_back(AH_SORT_LEVEL);
         case 5:
-            OrderByString.append(" item_weapon.dmg DESC,");
+            OrderBy.push_back(AH_SORT_DAMAGE);
         case 6:
-            OrderByString.append(" item_weapon.delay DESC,");
+            OrderBy.push_back(AH_SORT_DELAY);
         case 9:
-            OrderByString.append(" item_basic.sortname,");
+            OrderBy.push_back(AH_SORT_NAME);
         }
     }
 
-    OrderByString.append(" item_basic.itemid");
-    int8* OrderByArray = (int8*)OrderByString.data();
-
     CDataLoader PDataLoader;
-    std::vector<ahItem*> ItemList = PDataLoader.GetAHItemsToCategory(AHCatID, OrderByArray);
+    std::vector<ahItem> ItemList = PDataLoader.GetAHItemsToCategory(AHCatID, OrderBy);
 
     uint8 PacketsCount = (uint8)((ItemList.size() / 20) + (ItemList.size() % 20 != 0) + (ItemList.size() == 0));
 
@@ -638,7 +646,7 @@ void HandleAuctionHouseRequest(CTCPRequestPacket& PTCPRequest)
 
         for (uint16 y = 20 * i; (y != 20 * (i + 1)) && (y < ItemList.size()); ++y)
         {
-            PAHPacket.AddItem(ItemList.at(y));
+            PAHPacket.AddItem(&ItemList.at(y));
         }
 
         PTCPRequest.SendToSocket(PAHPacket.GetData(), PAHPacket.GetSize());
@@ -962,3 +970,10 @@ int32 ah_cleanup(time_point tick, CTaskMgr::CTask* PTask)
 
     return 0;
 }
+
+int32 print_request_metrics(time_point tick, CTaskMgr::CTask* PTask)
+{
+    dispatcher::PrintMetrics();
+
+    return 0;
+}
@@ -29,9 +29,14 @@ struct search_config_t
     std::string mysql_login;        // mysql login    -> default root
     std::string mysql_password;     // mysql pass     -> default root
     std::string mysql_database;     // mysql database -> default tpzdb
+    uint8       mysql_pool_size;    // Maximum number of pooled mysql connections shared by the request threads
     bool        expire_auctions;    // If true, then start task to expire old auctions off the auction house
     uint8       expire_days;        // Number of days to keep stuff on the auction house
     int16       expire_interval;    // How often the task should run (time * 1000) in seconds
+    uint8       worker_threads;     // Number of threads executing search requests
+    uint16      request_queue_limit;// Maximum number of connections being read or waiting for a worker
+    uint32      metrics_interval;   // How often request metrics are printed in seconds, 0 disables
+    uint32      ah_snapshot_interval; // Seconds an auction house category count snapshot is served before it is rebuilt
 };
 
 struct login_config_t
@@ -88,10 +88,10 @@ int32 CTCPRequestPacket::GetSize()
 
 int32 CTCPRequestPacket::ReceiveFromSocket()
 {
-    char recvbuf[DEFAULT_BUFLEN];
+    uint8 recvbuf[DEFAULT_BUFLEN];
 
-    m_size = recv(*m_socket, recvbuf, DEFAULT_BUFLEN, 0);
-    if (m_size == -1)
+    int32 size = recv(*m_socket, (char*)recvbuf, DEFAULT_BUFLEN, 0);
+    if (size == -1)
     {
 #ifdef WIN32
         ShowError(CL_RED"recv failed with error: %d\n" CL_RESET, WSAGetLastError());
@@ -100,20 +100,32 @@ int32 CTCPRequestPacket::ReceiveFromSocket()
 #endif
         return 0;
     }
-    if (m_size == 0)
+    if (size == 0)
     {
         //ShowError("TCP Connection closing...\n");
         return 0;
     }
-    if (m_size != ref<uint16>(recvbuf, (0x00)) || m_size < 28)
+    return ReceiveFromBuffer(recvbuf, size);
+}
+
+/************************************************************************
+*                                                                       *
+*  Takes a request frame that was already read from the socket.         *
+*                                                                       *
+************************************************************************/
+
+int32 CTCPRequestPacket::ReceiveFromBuffer(uint8* data, int32 size)
+{
+    m_size = size;
+    if (m_size != ref<uint16>(data, (0x00)) || m_size < 28)
     {
-        ShowError(CL_RED"Search packetsize wrong. Size %d should be %d.\n" CL_RESET, m_size, ref<uint16>(recvbuf, (0x00)));
+        ShowError(CL_RED"Search packetsize wrong. Size %d should be %d.\n" CL_RESET, m_size, ref<uint16>(data, (0x00)));
         return 0;
     }
     delete[] m_data;
     m_data = new uint8[m_size];
 
-    memcpy(&m_data[0], &recvbuf[0], m_size);
+    memcpy(&m_data[0], &data[0], m_size);
     ref<uint32>(key, (16)) = ref<uint32>(m_data, (m_size - 4));
 
     return decipher();
@@ -65,6 +65,7 @@ public:
     uint8 GetPacketType();
 
     int32 ReceiveFromSocket();
+    int32 ReceiveFromBuffer(uint8* data, int32 size);
     int32 SendToSocket(uint8* data, uint32 length);
     int32 SendRawToSocket(uint8* data, uint32 length);
 
@@ -0,0 +1,235 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../common/blowfish.h"
+#include "../common/md52.h"
+
+/************************************************************************
+*                                                                       *
+*  Known-answer checks for the packet sealing code: md5_batch against   *
+*  md5 and the RFC 1321 vectors, blowfish_*_blocks against the single   *
+*  block blowfish_encipher/decipher and fixed FFXI blowfish vectors.    *
+*                                                                       *
+************************************************************************/
+
+static uint32 failures = 0;
+
+static void check(bool ok, const char* what)
+{
+    if (!ok)
+    {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+static std::string hex(const uint8* data, size_t size)
+{
+    std::string result;
+    char digit[3];
+    for (size_t i = 0; i < size; ++i)
+    {
+        snprintf(digit, sizeof(digit), "%02x", data[i]);
+        result += digit;
+    }
+    return result;
+}
+
+static void md5_vectors()
+{
+    static const char* vectors[][2] =
+    {
+        { "", "d41d8cd98f00b204e9800998ecf8427e" },
+        { "a", "0cc175b9c0f1b6a831c399e269772661" },
+        { "abc", "900150983cd24fb0d6963f7d28e17f72" },
+        { "message digest", "f96b697d7cb7938d525a2f31aaf161d0" },
+        { "abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b" },
+        { "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", "d174ab98d277d9f5a5611c2c9f419d9f" },
+        { "12345678901234567890123456789012345678901234567890123456789012345678901234567890", "57edf4a22be3c955ac49da2e2107b67a" },
+    };
+    const uint32 count = sizeof(vectors) / sizeof(vectors[0]);
+
+    uint8* text[count];
+    uint8* hash[count];
+    uint32 size[count];
+    uint8  single[count][16];
+    uint8  batch[count][16];
+
+    for (uint32 i = 0; i < count; ++i)
+    {
+        text[i] = (uint8*)vectors[i][0];
+        size[i] = (uint32)strlen(vectors[i][0]);
+        hash[i] = batch[i];
+
+        md5(text[i], single[i], size[i]);
+        check(hex(single[i], 16) == vectors[i][1], "md5 RFC 1321 vector");
+    }
+
+    md5_batch(text, hash, size, count);
+    for (uint32 i = 0; i < count; ++i)
+    {
+        check(hex(batch[i], 16) == vectors[i][1], "md5_batch RFC 1321 vector");
+    }
+}
+
+// batches of every size up to two full groups of lanes, lengths around the 55/56/64 byte padding edges and up to a datagram
+static void md5_random(std::mt19937& rng)
+{
+    std::uniform_int_distribution<uint32> byte(0, 255);
+    std::uniform_int_distribution<uint32> length(0, 1500);
+    static const uint32 edges[] = { 0, 1, 55, 56, 57, 63, 64, 65, 119, 120, 127, 128, 129 };
+
+    for (uint32 count = 1; count <= 9; ++count)
+    {
+        for (uint32 round = 0; round < 50; ++round)
+        {
+            std::vector<std::vector<uint8>> data(count);
+            std::vector<uint8*> text(count);
+            std::vector<uint8*> hash(count);
+            std::vector<uint32> size(count);
+            std::vector<uint8>  batch(count * 16);
+
+            for (uint32 i = 0; i < count; ++i)
+            {
+                size[i] = round % 2 ? edges[(round + i) % (sizeof(edges) / sizeof(edges[0]))] : length(rng);
+                data[i].resize(size[i] + 1);
+                for (auto& value : data[i])
+                {
+                    value = (uint8)byte(rng);
+                }
+                text[i] = data[i].data();
+                hash[i] = &batch[i * 16];
+            }
+
+            md5_batch(text.data(), hash.data(), size.data(), count);
+
+            for (uint32 i = 0; i < count; ++i)
+            {
+                uint8 single[16];
+                md5(text[i], single, size[i]);
+                check(memcmp(single, hash[i], 16) == 0, "md5_batch matches md5");
+            }
+        }
+    }
+}
+
+static void blowfish_vectors()
+{
+    // computed with blowfish_init and blowfish_encipher, one block at a time
+    struct vector_t
+    {
+        const char* key;
+        uint32 plain[2];
+        uint32 cipher[2];
+    };
+    static const vector_t vectors[] =
+    {
+        { "0000000000000000", { 0x00000000, 0x00000000 }, { 0xe4631470, 0x4c2e8a04 } },
+        { "topaz packet key", { 0x01234567, 0x89abcdef }, { 0xbaa11f26, 0xd8e41b55 } },
+        { "\xff\x80\x7f\x01\xfe\x00\x10\x20\x30\x40\x50\x60\x70\x80\x90\xa0", { 0xffffffff, 0x00000001 }, { 0x62b51d33, 0x5c9254cd } },
+    };
+
+    for (auto& vector : vectors)
+    {
+        blowfish_t key;
+        blowfish_init((int8*)vector.key, 16, key.P, key.S[0]);
+
+        uint32 xl = vector.plain[0];
+        uint32 xr = vector.plain[1];
+        blowfish_encipher(&xl, &xr, key.P, key.S[0]);
+        check(xl == vector.cipher[0] && xr == vector.cipher[1], "blowfish_encipher known answer");
+
+        uint32 block[2] = { vector.plain[0], vector.plain[1] };
+        blowfish_encipher_blocks(block, 1, key.P, key.S[0]);
+        check(block[0] == vector.cipher[0] && block[1] == vector.cipher[1], "blowfish_encipher_blocks known answer");
+
+        blowfish_decipher_blocks(block, 1, key.P, key.S[0]);
+        check(block[0] == vector.plain[0] && block[1] == vector.plain[1], "blowfish_decipher_blocks known answer");
+    }
+}
+
+// every block count up to a full datagram, so each lane remainder is covered
+static void blowfish_random(std::mt19937& rng)
+{
+    for (uint32 round = 0; round < 20; ++round)
+    {
+        int8 keydata[16];
+        for (auto& value : keydata)
+        {
+            value = (int8)rng();
+        }
+        blowfish_t key;
+        blowfish_init(keydata, 16, key.P, key.S[0]);
+
+        for (uint32 count = 0; count <= 162; ++count)
+        {
+            std::vector<uint32> plain(count * 2);
+            for (auto& value : plain)
+            {
+                value = (uint32)rng();
+            }
+
+            std::vector<uint32> single = plain;
+            for (uint32 i = 0; i < count; ++i)
+            {
+                blowfish_encipher(&single[i * 2], &single[i * 2 + 1], key.P, key.S[0]);
+            }
+
+            std::vector<uint32> batch = plain;
+            blowfish_encipher_blocks(batch.data(), count, key.P, key.S[0]);
+            check(batch == single, "blowfish_encipher_blocks matches blowfish_encipher");
+
+            for (uint32 i = 0; i < count; ++i)
+            {
+                blowfish_decipher(&single[i * 2], &single[i * 2 + 1], key.P, key.S[0]);
+            }
+            check(single == plain, "blowfish_decipher inverts blowfish_encipher");
+
+            blowfish_decipher_blocks(batch.data(), count, key.P, key.S[0]);
+            check(batch == plain, "blowfish_decipher_blocks matches blowfish_decipher");
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::mt19937 rng(0x746f7061);
+
+    md5_vectors();
+    md5_random(rng);
+    blowfish_vectors();
+    blowfish_random(rng);
+
+    if (failures > 0)
+    {
+        printf("crypto_test: %u checks failed\n", failures);
+        return 1;
+    }
+    printf("crypto_test: all checks passed\n");
+    return 0;
+}
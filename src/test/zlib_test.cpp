@@ -0,0 +1,262 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+===========================================================================
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../common/showmsg.h"
+#include "../common/zlib.h"
+
+/************************************************************************
+*                                                                       *
+*  Checks the table-driven zlib_compress and the multi-bit              *
+*  zlib_decompress against the original bit-at-a-time code, kept       *
+*  below as the reference, and that every packet survives a round trip. *
+*  Reads compress.dat and decompress.dat from the working directory.    *
+*                                                                       *
+************************************************************************/
+
+namespace reference
+{
+    #define JMPBIT(table, i) ((table[i / 8] >> (i & 7)) & 1)
+
+    struct zlib_jump
+    {
+        const void *ptr;
+    };
+
+    std::vector<uint32> enc;
+    std::vector<zlib_jump> jump;
+
+    bool read_to_vector(const std::string &file, std::vector<uint32> &vec)
+    {
+        FILE *f;
+        if (!(f = fopen(file.c_str(), "rb")))
+            return false;
+
+        fseek(f, 0, SEEK_END);
+        const size_t size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+
+        vec.resize(size / sizeof(uint32));
+        bool ok = fread(vec.data(), sizeof(uint32), vec.size(), f) == vec.size();
+        fclose(f);
+        return ok;
+    }
+
+    bool init()
+    {
+        std::vector<uint32> dec;
+        if (!read_to_vector("compress.dat", enc) || !read_to_vector("decompress.dat", dec))
+            return false;
+
+        jump.resize(dec.size());
+        const uint32 base = dec[0] - sizeof(uint32);
+        for (size_t i = 0; i < dec.size(); ++i)
+        {
+            if (dec[i] > 0xff)
+                jump[i].ptr = jump.data() + (dec[i] - base) / sizeof(base);
+            else
+                jump[i].ptr = reinterpret_cast<void*>(static_cast<std::uintptr_t>(dec[i]));
+        }
+        return true;
+    }
+
+    int32 compress_sub(const uint8 *b32, const uint32 read, const uint32 elem, int8 *out, const uint32 out_sz)
+    {
+        if (zlib_compressed_size(elem) > sizeof(uint32))
+            return -1;
+
+        if (zlib_compressed_size(read + elem) > out_sz)
+            return -1;
+
+        for (uint32 i = 0; i < elem; ++i)
+        {
+            const uint8 shift = (read + i) & 7;
+            const uint32 v = (read + i) / 8;
+            const uint32 inv_mask = ~(1 << shift);
+            out[v] = (inv_mask & out[v]) + (JMPBIT(b32, i) << shift);
+        }
+        return 0;
+    }
+
+    int32 compress(const int8 *in, const uint32 in_sz, int8 *out, const uint32 out_sz)
+    {
+        uint32 read = 0;
+        const uint32 max_sz = (out_sz - 1) * 8;
+        for (uint32 i = 0; i < in_sz; ++i)
+        {
+            const uint32 elem = enc[static_cast<int8>(in[i]) + 0x180];
+            if (elem + read < max_sz)
+            {
+                uint32 v = enc[static_cast<int8>(in[i]) + 0x80];
+                uint8 b32[sizeof(v)];
+                memcpy(b32, &v, sizeof(b32));
+                compress_sub(b32, read, elem, out + 1, out_sz - 1);
+                read += elem;
+            }
+            else if (in_sz + 1 >= out_sz)
+            {
+                memset(out, 0, (out_sz / 4) + (in_sz & 3));
+                memset(out + 1, in_sz, in_sz / 4);
+                memset(out + 1 + in_sz / 4, (in_sz + 1) * 8, in_sz & 3);
+                return in_sz;
+            }
+            else
+            {
+                return -1;
+            }
+        }
+
+        out[0] = 1;
+        return read + 8;
+    }
+
+    uint32 decompress(const int8 *in, const uint32 in_sz, int8 *out, const uint32 out_sz)
+    {
+        const zlib_jump *jmp = static_cast<const zlib_jump*>(jump[0].ptr);
+
+        if (in[0] != 1)
+            return -1;
+
+        uint32 w = 0;
+        const int8 *data = in + 1;
+        for (uint32 i = 0; i < in_sz && w < out_sz; ++i)
+        {
+            jmp = static_cast<const zlib_jump*>(jmp[JMPBIT(data, i)].ptr);
+
+            if (jmp[0].ptr != 0 || jmp[1].ptr != 0)
+                continue;
+
+            out[w++] = static_cast<uint8>(reinterpret_cast<std::uintptr_t>(jmp[3].ptr));
+            jmp = static_cast<const zlib_jump*>(jump[0].ptr);
+
+            if (w >= out_sz)
+                return -1;
+        }
+        return w;
+    }
+
+    #undef JMPBIT
+}
+
+static uint32 failures = 0;
+
+static void check(bool ok, const char* what, uint32 size)
+{
+    if (!ok)
+    {
+        printf("FAILED: %s (%u bytes)\n", what, size);
+        failures++;
+    }
+}
+
+// compresses in with both encoders into identically prefilled buffers, then decompresses with both decoders
+static void compare(std::vector<int8> in, uint32 out_sz, std::mt19937& rng)
+{
+    const uint32 size = (uint32)in.size();
+    in.reserve(size + 1); // both encoders assert on a null input, even when it is empty
+
+    std::vector<int8> prefill(out_sz + 8);
+    for (auto& value : prefill)
+    {
+        value = (int8)rng();
+    }
+    std::vector<int8> actual = prefill;
+    std::vector<int8> expected = prefill;
+
+    int32 actualSize = zlib_compress(in.data(), size, actual.data(), out_sz);
+    int32 expectedSize = reference::compress(in.data(), size, expected.data(), out_sz);
+
+    check(actualSize == expectedSize, "zlib_compress returns the reference size", size);
+    check(actual == expected, "zlib_compress writes the reference bytes", size);
+
+    if (actualSize <= 0 || expected[0] != 1)
+    {
+        return;
+    }
+    check(zlib_compressed_bits(in.data(), size) + 8 == (uint32)actualSize, "zlib_compressed_bits predicts the compressed size", size);
+
+    std::vector<int8> decoded(size + 64);
+    std::vector<int8> decodedReference(size + 64);
+    uint32 decodedSize = zlib_decompress(actual.data(), actualSize, decoded.data(), (uint32)decoded.size());
+    uint32 decodedReferenceSize = reference::decompress(actual.data(), actualSize, decodedReference.data(), (uint32)decodedReference.size());
+
+    check(decodedSize == decodedReferenceSize, "zlib_decompress returns the reference size", size);
+    check(decoded == decodedReference, "zlib_decompress writes the reference bytes", size);
+    check(decodedSize >= size && memcmp(decoded.data(), in.data(), size) == 0, "round trip restores the input", size);
+}
+
+int main(int argc, char** argv)
+{
+    msg_silent = MSG_WARNING; // expected from the out of space cases below
+
+    if (zlib_init() != 0 || !reference::init())
+    {
+        printf("zlib_test: compress.dat and decompress.dat must be in the working directory\n");
+        return 1;
+    }
+
+    std::mt19937 rng(0x7a6c6962);
+    std::uniform_int_distribution<uint32> length(0, 1400);
+
+    // every single byte value
+    for (uint32 b = 0; b < 256; ++b)
+    {
+        compare(std::vector<int8>(1, (int8)b), 1300, rng);
+    }
+
+    for (uint32 round = 0; round < 2000; ++round)
+    {
+        std::vector<int8> in(length(rng));
+        for (auto& value : in)
+        {
+            // packets are mostly zero bytes, half the buffers look like that
+            value = (round % 2 && rng() % 4 != 0) ? 0 : (int8)rng();
+        }
+        compare(in, 1300, rng);
+    }
+
+    // output too small: the error and the "garbage" paths
+    for (uint32 size : { 16u, 64u, 200u })
+    {
+        std::vector<int8> in(size);
+        for (auto& value : in)
+        {
+            value = (int8)rng();
+        }
+        compare(in, size / 2, rng);
+        compare(in, size + 1, rng);
+    }
+
+    if (failures > 0)
+    {
+        printf("zlib_test: %u checks failed\n", failures);
+        return 1;
+    }
+    printf("zlib_test: all checks passed\n");
+    return 0;
+}